@@ -138,6 +138,7 @@ static int		CheckDoubleResult(Tcl_Interp *interp, double dResult);
 static void		DeleteCoroutine(ClientData clientData);
 static Tcl_FreeProc	DeleteInterpProc;
 static void		DeleteOpCmdClientData(ClientData clientData);
+static Tcl_ObjCmdProc	LazyEnsembleNRCmd;
 #ifdef USE_DTRACE
 static Tcl_ObjCmdProc	DTraceObjCmd;
 static Tcl_NRPostProc	DTraceCmdReturn;
@@ -438,6 +439,34 @@ static const OpCmdInfo mathOpCmds[] = {
     { NULL,	NULL,			NULL,
 		{0},			NULL}
 };
+
+/*
+ * The core ensembles that are only built when first resolved. Until then the
+ * global namespace holds a placeholder command for each of them (with
+ * TclLazyEnsembleObjCmd as its objProc) and neither the ensemble's namespace
+ * within ::tcl nor its subcommands exist. The "clock" and "info" ensembles
+ * are not here: the former is replaced by an alias in safe interpreters and
+ * the latter is extended by TclOO during interpreter creation anyway.
+ */
+
+typedef struct {
+    const char *name;		/* Name of the ensemble command, and of its
+				 * implementation namespace within ::tcl. */
+    Tcl_Command (*initProc)(Tcl_Interp *interp);
+				/* Function that builds the ensemble. */
+} LazyEnsembleInfo;
+
+static const LazyEnsembleInfo lazyEnsembles[] = {
+    {"array",		TclInitArrayCmd},
+    {"binary",		TclInitBinaryCmd},
+    {"chan",		TclInitChanCmd},
+    {"dict",		TclInitDictCmd},
+    {"encoding",	TclInitEncodingCmd},
+    {"file",		TclInitFileCmd},
+    {"namespace",	TclInitNamespaceCmd},
+    {"string",		TclInitStringCmd},
+    {NULL,		NULL}
+};
 
 /*
  *----------------------------------------------------------------------
@@ -493,6 +522,7 @@ Tcl_CreateInterp(void)
     const BuiltinFuncDef *builtinFuncPtr;
     const OpCmdInfo *opcmdInfoPtr;
     const CmdInfo *cmdInfoPtr;
+    const LazyEnsembleInfo *lazyPtr;
     Tcl_Namespace *nsPtr;
     Tcl_HashEntry *hPtr;
     int isNew;
@@ -695,6 +725,8 @@ Tcl_CreateInterp(void)
      */
 
     iPtr->execEnvPtr = TclCreateExecEnv(interp, INTERP_STACK_INITIAL_SIZE);
+    iPtr->execEnvPool = NULL;
+    iPtr->execEnvPoolSize = 0;
 
     /*
      * TIP #219, Tcl Channel Reflection API support.
@@ -835,18 +867,17 @@ Tcl_CreateInterp(void)
      * "file", "info", "namespace" and "string" ensembles. Note that all these
      * commands (and their subcommands that are not present in the global
      * namespace) are wholly safe *except* for "clock", "encoding" and "file".
+     * Most of them only get placeholders here; the real ensemble is built by
+     * TclMaterializeEnsemble when the command is first looked up.
      */
 
-    TclInitArrayCmd(interp);
-    TclInitBinaryCmd(interp);
-    TclInitChanCmd(interp);
-    TclInitDictCmd(interp);
-    TclInitEncodingCmd(interp);
-    TclInitFileCmd(interp);
+    for (lazyPtr = lazyEnsembles; lazyPtr->name != NULL; lazyPtr++) {
+	Tcl_NRCreateCommand(interp, lazyPtr->name, TclLazyEnsembleObjCmd,
+		LazyEnsembleNRCmd, (void *) lazyPtr, NULL);
+    }
     TclInitInfoCmd(interp);
-    TclInitNamespaceCmd(interp);
-    TclInitStringCmd(interp);
     TclInitPrefixCmd(interp);
+    TclInitThreadPoolCmd(interp);
 
     /*
      * Register "clock" subcommands. These *do* go through
@@ -878,6 +909,14 @@ Tcl_CreateInterp(void)
 	    Tcl_DisassembleObjCmd, INT2PTR(1), NULL);
     Tcl_CreateObjCommand(interp, "::tcl::unsupported::representation",
 	    Tcl_RepresentationCmd, NULL, NULL);
+    Tcl_CreateObjCommand(interp, "::tcl::unsupported::sharedliterals",
+	    TclSharedLiteralsObjCmd, NULL, NULL);
+    Tcl_CreateObjCommand(interp, "::tcl::unsupported::statcache",
+	    TclStatCacheObjCmd, NULL, NULL);
+#ifndef _WIN32
+    Tcl_CreateObjCommand(interp, "::tcl::unsupported::resolvecache",
+	    TclResolveCacheObjCmd, NULL, NULL);
+#endif
 
     /* Adding the bytecode assembler command */
     cmdPtr = (Command *) Tcl_NRCreateCommand(interp,
@@ -895,6 +934,12 @@ Tcl_CreateInterp(void)
     Tcl_CreateObjCommand(interp, "::tcl::unsupported::timerate",
 	    Tcl_TimeRateObjCmd, NULL, NULL);
 
+#if defined(TCL_THREADS) && defined(USE_THREAD_ALLOC)
+    /* Create an unsupported command for the threaded allocator's caches */
+    Tcl_CreateObjCommand(interp, "::tcl::unsupported::alloccache",
+	    TclAllocCacheObjCmd, NULL, NULL);
+#endif
+
     /* Export unsupported commands */
     nsPtr = Tcl_FindNamespace(interp, "::tcl::unsupported", NULL, 0);
     if (nsPtr) {
@@ -1086,6 +1131,194 @@ TclHideUnsafeCommands(
     TclMakeFileCommandSafe(interp);     /* Ugh! */
     return TCL_OK;
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclMaterializeEnsemble --
+ *
+ *	Replaces the placeholder for one of the lazily created core ensembles
+ *	with the real ensemble, building its implementation namespace and
+ *	subcommands.
+ *
+ * Results:
+ *	The command that now has the placeholder's name, or NULL if building
+ *	the ensemble failed. If the interpreter is being deleted, nothing is
+ *	built and the placeholder itself is returned.
+ *
+ * Side effects:
+ *	Deletes the placeholder command and creates the ensemble.
+ *
+ *----------------------------------------------------------------------
+ */
+
+Command *
+TclMaterializeEnsemble(
+    Tcl_Interp *interp,		/* Interpreter owning the placeholder. */
+    Command *cmdPtr)		/* The placeholder command. */
+{
+    const LazyEnsembleInfo *lazyPtr = (const LazyEnsembleInfo *)
+	    cmdPtr->objClientData;
+
+    if (((Interp *) interp)->flags & DELETED) {
+	return cmdPtr;
+    }
+
+    /*
+     * Clearing the client data marks the placeholder as being built, so that
+     * nothing done while building the ensemble tries to materialize it
+     * again. The placeholder is then replaced like any other redefined
+     * command, which carries over any imports of it.
+     */
+
+    cmdPtr->objClientData = NULL;
+    return (Command *) lazyPtr->initProc(interp);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclMaterializeEnsembleNs --
+ *
+ *	Called when a lookup of a child of the ::tcl namespace fails, in case
+ *	the child is the implementation namespace of a lazily created core
+ *	ensemble that has not been built yet.
+ *
+ * Results:
+ *	The child namespace if it now exists, NULL otherwise.
+ *
+ * Side effects:
+ *	May build one of the core ensembles.
+ *
+ *----------------------------------------------------------------------
+ */
+
+Namespace *
+TclMaterializeEnsembleNs(
+    Tcl_Interp *interp,		/* Interpreter doing the lookup. */
+    Namespace *parentPtr,	/* Namespace that lacks the child. */
+    const char *name)		/* Name of the missing child. */
+{
+    Interp *iPtr = (Interp *) interp;
+    Tcl_HashEntry *hPtr;
+    Command *cmdPtr;
+
+    if ((parentPtr->parentPtr != iPtr->globalNsPtr)
+	    || strcmp(parentPtr->name, "tcl") != 0
+	    || (iPtr->flags & DELETED)) {
+	return NULL;
+    }
+    hPtr = Tcl_FindHashEntry(&iPtr->globalNsPtr->cmdTable, name);
+    if (hPtr == NULL) {
+	return NULL;
+    }
+    cmdPtr = (Command *) Tcl_GetHashValue(hPtr);
+    if (!TclIsLazyEnsemble(cmdPtr)
+	    || (TclMaterializeEnsemble(interp, cmdPtr) == NULL)) {
+	return NULL;
+    }
+    hPtr = Tcl_FindHashEntry(
+	    TclGetNamespaceChildTable((Tcl_Namespace *) parentPtr), name);
+    return (hPtr ? (Namespace *) Tcl_GetHashValue(hPtr) : NULL);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclMaterializeEnsembles --
+ *
+ *	Builds all the lazily created core ensembles of an interpreter that
+ *	have not been built yet, for operations that need to see the complete
+ *	contents of the ::tcl namespace.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	May build any of the core ensembles.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclMaterializeEnsembles(
+    Tcl_Interp *interp)
+{
+    Interp *iPtr = (Interp *) interp;
+    const LazyEnsembleInfo *lazyPtr;
+    Tcl_HashEntry *hPtr;
+
+    for (lazyPtr = lazyEnsembles; lazyPtr->name != NULL; lazyPtr++) {
+	hPtr = Tcl_FindHashEntry(&iPtr->globalNsPtr->cmdTable, lazyPtr->name);
+	if ((hPtr != NULL)
+		&& TclIsLazyEnsemble((Command *) Tcl_GetHashValue(hPtr))) {
+	    TclMaterializeEnsemble(interp, (Command *) Tcl_GetHashValue(hPtr));
+	}
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclLazyEnsembleObjCmd, LazyEnsembleNRCmd --
+ *
+ *	Implementation of the placeholders for the lazily created core
+ *	ensembles. Command lookup normally replaces a placeholder before it
+ *	can be invoked; these only run when a reference to the placeholder
+ *	was obtained some other way, such as through a namespace import. They
+ *	build the ensemble and pass the call on to it.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	Builds one of the core ensembles.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclLazyEnsembleObjCmd(
+    ClientData clientData,
+    Tcl_Interp *interp,
+    int objc,
+    Tcl_Obj *const objv[])
+{
+    return Tcl_NRCallObjProc(interp, LazyEnsembleNRCmd, clientData, objc,
+	    objv);
+}
+
+static int
+LazyEnsembleNRCmd(
+    ClientData clientData,
+    Tcl_Interp *interp,
+    int objc,
+    Tcl_Obj *const objv[])
+{
+    Interp *iPtr = (Interp *) interp;
+    const LazyEnsembleInfo *lazyPtr = (const LazyEnsembleInfo *) clientData;
+    Tcl_HashEntry *hPtr;
+    Command *cmdPtr = NULL;
+
+    hPtr = Tcl_FindHashEntry(&iPtr->globalNsPtr->cmdTable, lazyPtr->name);
+    if (hPtr != NULL) {
+	cmdPtr = (Command *) Tcl_GetHashValue(hPtr);
+	if (TclIsLazyEnsemble(cmdPtr)) {
+	    cmdPtr = TclMaterializeEnsemble(interp, cmdPtr);
+	}
+    }
+    if ((cmdPtr == NULL) || (cmdPtr->objProc == TclLazyEnsembleObjCmd)) {
+	Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+		"unable to build the \"%s\" ensemble", lazyPtr->name));
+	Tcl_SetErrorCode(interp, "TCL", "LOOKUP", "COMMAND", lazyPtr->name,
+		(char *)NULL);
+	return TCL_ERROR;
+    }
+    if (cmdPtr->nreProc != NULL) {
+	return cmdPtr->nreProc(cmdPtr->objClientData, interp, objc, objv);
+    }
+    return cmdPtr->objProc(cmdPtr->objClientData, interp, objc, objv);
+}
 
 /*
  *--------------------------------------------------------------
@@ -1602,6 +1835,7 @@ DeleteInterpProc(
     if (iPtr->execEnvPtr != NULL) {
 	TclDeleteExecEnv(iPtr->execEnvPtr);
     }
+    TclDeleteExecEnvPool((Tcl_Interp *) iPtr);
     if (iPtr->scriptFile) {
 	Tcl_DecrRefCount(iPtr->scriptFile);
 	iPtr->scriptFile = NULL;
@@ -2017,6 +2251,7 @@ Tcl_ExposeCommand(
      */
 
     TclInvalidateNsCmdLookup(nsPtr);
+    nsPtr->cmdCreateEpoch++;
 
     /*
      * Remove the hash entry for the command from the interpreter hidden
@@ -2158,6 +2393,16 @@ Tcl_CreateCommand(
 
 	cmdPtr = (Command *)Tcl_GetHashValue(hPtr);
 
+	/*
+	 * Redefining a core ensemble that has not been built yet still leaves
+	 * its implementation namespace behind, as if it had been.
+	 */
+
+	if (TclIsLazyEnsemble(cmdPtr)) {
+	    TclMaterializeEnsemble(interp, cmdPtr);
+	    continue;
+	}
+
 	/*
 	 * Be careful to preserve any existing import links so we can restore
 	 * them down below. That way, you can redefine a command and its
@@ -2205,11 +2450,11 @@ Tcl_CreateCommand(
 	/*
 	 * The list of command exported from the namespace might have changed.
 	 * However, we do not need to recompute this just yet; next time we
-	 * need the info will be soon enough.
+	 * need the info will be soon enough. Cached command references are
+	 * only invalidated where the new command shadows another one.
 	 */
 
-	TclInvalidateNsCmdLookup(nsPtr);
-	TclInvalidateNsPath(nsPtr);
+	TclInvalidateNsCmdAdded(nsPtr, tail);
     }
     cmdPtr = (Command *)ckalloc(sizeof(Command));
     Tcl_SetHashValue(hPtr, cmdPtr);
@@ -2376,6 +2621,16 @@ TclCreateObjCommandInNs(
 
 	cmdPtr = (Command *)Tcl_GetHashValue(hPtr);
 
+	/*
+	 * Redefining a core ensemble that has not been built yet still leaves
+	 * its implementation namespace behind, as if it had been.
+	 */
+
+	if (TclIsLazyEnsemble(cmdPtr)) {
+	    TclMaterializeEnsemble(interp, cmdPtr);
+	    continue;
+	}
+
 	/*
 	 * [***] This is wrong.  See Tcl Bug a16752c252.
 	 * However, this buggy behavior is kept under particular circumstances
@@ -2449,11 +2704,11 @@ TclCreateObjCommandInNs(
 	/*
 	 * The list of command exported from the namespace might have changed.
 	 * However, we do not need to recompute this just yet; next time we
-	 * need the info will be soon enough.
+	 * need the info will be soon enough. Cached command references are
+	 * only invalidated where the new command shadows another one.
 	 */
 
-	TclInvalidateNsCmdLookup(nsPtr);
-	TclInvalidateNsPath(nsPtr);
+	TclInvalidateNsCmdAdded(nsPtr, cmdName);
     }
     cmdPtr = (Command *)ckalloc(sizeof(Command));
     Tcl_SetHashValue(hPtr, cmdPtr);
@@ -4696,7 +4951,14 @@ TEOV_Error(
     int objc = PTR2INT(data[0]);
     Tcl_Obj **objv = (Tcl_Obj **)data[1];
 
-    if ((result == TCL_ERROR) && !(iPtr->flags & ERR_ALREADY_LOGGED)) {
+    /*
+     * Nothing is logged while a coroutine is being wound down: the error is
+     * only the means of unwinding, and RewindCoroutine restores the interp
+     * state afterwards anyway.
+     */
+
+    if ((result == TCL_ERROR) && !(iPtr->flags & ERR_ALREADY_LOGGED)
+	    && !iPtr->execEnvPtr->rewind) {
 	/*
 	 * If there was an error, a command string will be needed for the
 	 * error log: get it out of the itemPtr. The details depend on the
@@ -8816,7 +9078,7 @@ NRCoroutineExitCallback(
     TclCleanupCommandMacro(cmdPtr);
 
     corPtr->eePtr->corPtr = NULL;
-    TclDeleteExecEnv(corPtr->eePtr);
+    TclReleaseExecEnv(corPtr->eePtr);
     corPtr->eePtr = NULL;
 
     corPtr->stackLevel = NULL;
@@ -9242,7 +9504,7 @@ TclNRCoroutineObjCmd(
      * command callbacks, then switch back.
      */
 
-    corPtr->eePtr = TclCreateExecEnv(interp, CORO_STACK_INITIAL_SIZE);
+    corPtr->eePtr = TclAcquireExecEnv(interp, CORO_STACK_INITIAL_SIZE);
     corPtr->callerEEPtr = iPtr->execEnvPtr;
     corPtr->eePtr->corPtr = corPtr;
 
@@ -58,11 +58,17 @@ static void		DupByteArrayInternalRep(Tcl_Obj *srcPtr,
 			    Tcl_Obj *copyPtr);
 static int		FormatNumber(Tcl_Interp *interp, int type,
 			    Tcl_Obj *src, unsigned char **cursorPtr);
+static int		FormatNumbers(Tcl_Interp *interp, int type,
+			    int count, Tcl_Obj *const *srcv,
+			    unsigned char **cursorPtr);
 static void		FreeByteArrayInternalRep(Tcl_Obj *objPtr);
 static int		GetFormatSpec(const char **formatPtr, char *cmdPtr,
 			    int *countPtr, int *flagsPtr);
 static Tcl_Obj *	ScanNumber(unsigned char *buffer, int type,
 			    int flags, Tcl_HashTable **numberCachePtr);
+static Tcl_Obj *	ScanNumbers(unsigned char *buffer, int type,
+			    int size, int flags, int count,
+			    Tcl_HashTable **numberCachePtr);
 static int		SetByteArrayFromAny(Tcl_Interp *interp,
 			    Tcl_Obj *objPtr);
 static void		UpdateStringOfByteArray(Tcl_Obj *listPtr);
@@ -196,6 +202,33 @@ typedef struct ByteArray {
 #define SET_BYTEARRAY(objPtr, baPtr) \
 		(objPtr)->internalRep.twoPtrValue.ptr1 = (void *) (baPtr)
 
+/*
+ * A ByteArray object may instead refer to bytes that it does not own, such
+ * as the contents of a memory-mapped file (see [file map]). Such an object
+ * has no ByteArray structure (ptr1 is NULL); ptr2 points to a description
+ * of the foreign bytes, which belong to that object alone: duplicates get an
+ * ordinary ByteArray holding a copy, as the owner of an unshared object may
+ * write to its bytes in place. The bytes are also copied into an ordinary
+ * ByteArray the first time that the object's length is changed.
+ */
+
+typedef struct ByteArrayMapping {
+    unsigned char *bytes;	/* The first byte. */
+    int length;			/* Number of bytes. */
+    TclByteArrayReleaseProc *releaseProc;
+				/* Called to release the bytes when the last
+				 * reference goes. */
+    ClientData clientData;	/* Arbitrary value for releaseProc. */
+} ByteArrayMapping;
+
+#define GET_BYTEARRAY_MAPPING(objPtr) \
+		((ByteArrayMapping *) (objPtr)->internalRep.twoPtrValue.ptr2)
+#define IS_MAPPED_BYTEARRAY(objPtr) \
+		(GET_BYTEARRAY(objPtr) == NULL)
+
+static void		ReleaseByteArrayMapping(ByteArrayMapping *mapPtr);
+static ByteArray *	UnmapByteArray(Tcl_Obj *objPtr);
+
 
 /*
  *----------------------------------------------------------------------
@@ -360,6 +393,14 @@ Tcl_GetByteArrayFromObj(
 	SetByteArrayFromAny(NULL, objPtr);
     }
     baPtr = GET_BYTEARRAY(objPtr);
+    if (baPtr == NULL) {
+	ByteArrayMapping *mapPtr = GET_BYTEARRAY_MAPPING(objPtr);
+
+	if (numBytesPtr != NULL) {
+	    *numBytesPtr = mapPtr->length;
+	}
+	return mapPtr->bytes;
+    }
 
     if (numBytesPtr != NULL) {
 	*numBytesPtr = baPtr->used;
@@ -406,6 +447,9 @@ Tcl_SetByteArrayLength(
 	numBytes = 0;
     }
     byteArrayPtr = GET_BYTEARRAY(objPtr);
+    if (byteArrayPtr == NULL) {
+	byteArrayPtr = UnmapByteArray(objPtr);
+    }
     if ((unsigned int)numBytes > byteArrayPtr->allocated) {
 	byteArrayPtr = (ByteArray *)ckrealloc(byteArrayPtr, BYTEARRAY_SIZE(numBytes));
 	byteArrayPtr->allocated = numBytes;
@@ -484,7 +528,11 @@ static void
 FreeByteArrayInternalRep(
     Tcl_Obj *objPtr)		/* Object with internal rep to free. */
 {
-    ckfree(GET_BYTEARRAY(objPtr));
+    if (IS_MAPPED_BYTEARRAY(objPtr)) {
+	ReleaseByteArrayMapping(GET_BYTEARRAY_MAPPING(objPtr));
+    } else {
+	ckfree(GET_BYTEARRAY(objPtr));
+    }
     objPtr->typePtr = NULL;
 }
 
@@ -513,13 +561,30 @@ DupByteArrayInternalRep(
     unsigned int length;
     ByteArray *srcArrayPtr, *copyArrayPtr;
 
+    const unsigned char *srcBytes;
+
     srcArrayPtr = GET_BYTEARRAY(srcPtr);
-    length = srcArrayPtr->used;
+    if (srcArrayPtr == NULL) {
+	/*
+	 * Foreign bytes are copied too: either object may be modified in
+	 * place once it is unshared.
+	 */
+
+	ByteArrayMapping *mapPtr = GET_BYTEARRAY_MAPPING(srcPtr);
+
+	length = mapPtr->length;
+	srcBytes = mapPtr->bytes;
+    } else {
+	length = srcArrayPtr->used;
+	srcBytes = srcArrayPtr->bytes;
+    }
 
     copyArrayPtr = (ByteArray *)ckalloc(BYTEARRAY_SIZE(length));
     copyArrayPtr->used = length;
     copyArrayPtr->allocated = length;
-    memcpy(copyArrayPtr->bytes, srcArrayPtr->bytes, length);
+    if (length > 0) {
+	memcpy(copyArrayPtr->bytes, srcBytes, length);
+    }
     SET_BYTEARRAY(copyPtr, copyArrayPtr);
 
     copyPtr->typePtr = &tclByteArrayType;
@@ -558,8 +623,13 @@ UpdateStringOfByteArray(
     ByteArray *byteArrayPtr;
 
     byteArrayPtr = GET_BYTEARRAY(objPtr);
-    src = byteArrayPtr->bytes;
-    length = byteArrayPtr->used;
+    if (byteArrayPtr == NULL) {
+	src = GET_BYTEARRAY_MAPPING(objPtr)->bytes;
+	length = GET_BYTEARRAY_MAPPING(objPtr)->length;
+    } else {
+	src = byteArrayPtr->bytes;
+	length = byteArrayPtr->used;
+    }
 
     /*
      * How much space will string rep need?
@@ -636,6 +706,9 @@ TclAppendBytesToByteArray(
 	SetByteArrayFromAny(NULL, objPtr);
     }
     byteArrayPtr = GET_BYTEARRAY(objPtr);
+    if (byteArrayPtr == NULL) {
+	byteArrayPtr = UnmapByteArray(objPtr);
+    }
 
     if ((unsigned int)len > INT_MAX - byteArrayPtr->used) {
 	Tcl_Panic("max size for a Tcl value (%d bytes) exceeded", INT_MAX);
@@ -690,6 +763,126 @@ TclAppendBytesToByteArray(
     TclInvalidateStringRep(objPtr);
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclNewMappedByteArrayObj --
+ *
+ *	Create a ByteArray object whose bytes are owned by someone else, such
+ *	as the contents of a memory-mapped file, without copying them. The
+ *	bytes must stay valid until releaseProc is called, and they may be
+ *	written to by code that modifies unshared byte arrays in place (so a
+ *	mapped file should be mapped copy-on-write). Duplicates of the object
+ *	copy the bytes.
+ *
+ * Results:
+ *	The newly created object, with a ref count of 0.
+ *
+ * Side effects:
+ *	releaseProc (if not NULL) is called with clientData, bytes and length
+ *	when the last object referring to the bytes lets go of them.
+ *
+ *----------------------------------------------------------------------
+ */
+
+Tcl_Obj *
+TclNewMappedByteArrayObj(
+    unsigned char *bytes,	/* The bytes to refer to. */
+    int length,			/* How many bytes there are. */
+    TclByteArrayReleaseProc *releaseProc,
+				/* How to release the bytes, or NULL. */
+    ClientData clientData)	/* Arbitrary value passed to releaseProc. */
+{
+    Tcl_Obj *objPtr;
+    ByteArrayMapping *mapPtr = (ByteArrayMapping *)
+	    ckalloc(sizeof(ByteArrayMapping));
+
+    mapPtr->bytes = bytes;
+    mapPtr->length = length;
+    mapPtr->releaseProc = releaseProc;
+    mapPtr->clientData = clientData;
+
+    TclNewObj(objPtr);
+    TclInvalidateStringRep(objPtr);
+    SET_BYTEARRAY(objPtr, NULL);
+    objPtr->internalRep.twoPtrValue.ptr2 = mapPtr;
+    objPtr->typePtr = &tclByteArrayType;
+    return objPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclUnmapByteArrayObj --
+ *
+ *	Makes sure that a ByteArray object holds its bytes in an ordinary
+ *	ByteArray of its own rather than referring to foreign bytes, e.g.
+ *	before it is handed over to another thread.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	May copy the bytes and release the foreign ones.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclUnmapByteArrayObj(
+    Tcl_Obj *objPtr)		/* A ByteArray object. */
+{
+    if (objPtr->typePtr == &tclByteArrayType && IS_MAPPED_BYTEARRAY(objPtr)) {
+	UnmapByteArray(objPtr);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * UnmapByteArray, ReleaseByteArrayMapping --
+ *
+ *	Support for ByteArray objects that refer to foreign bytes.
+ *	UnmapByteArray gives such an object an ordinary ByteArray holding a
+ *	copy of the bytes, so that its length can be changed.
+ *
+ * Results:
+ *	UnmapByteArray returns the new ByteArray.
+ *
+ * Side effects:
+ *	Releases the foreign bytes.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static ByteArray *
+UnmapByteArray(
+    Tcl_Obj *objPtr)
+{
+    ByteArrayMapping *mapPtr = GET_BYTEARRAY_MAPPING(objPtr);
+    ByteArray *byteArrayPtr = (ByteArray *)
+	    ckalloc(BYTEARRAY_SIZE(mapPtr->length));
+
+    byteArrayPtr->used = mapPtr->length;
+    byteArrayPtr->allocated = mapPtr->length;
+    memcpy(byteArrayPtr->bytes, mapPtr->bytes, mapPtr->length);
+    SET_BYTEARRAY(objPtr, byteArrayPtr);
+    objPtr->internalRep.twoPtrValue.ptr2 = NULL;
+    ReleaseByteArrayMapping(mapPtr);
+    return byteArrayPtr;
+}
+
+static void
+ReleaseByteArrayMapping(
+    ByteArrayMapping *mapPtr)
+{
+    if (mapPtr->releaseProc != NULL) {
+	mapPtr->releaseProc(mapPtr->clientData, mapPtr->bytes,
+		mapPtr->length);
+    }
+    ckfree(mapPtr);
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -1130,7 +1323,7 @@ BinaryFormatCmd(
 	case 'q':
 	case 'Q':
 	case 'f': {
-	    int listc, i;
+	    int listc;
 	    Tcl_Obj **listv;
 
 	    if (count == BINARY_NOCOUNT) {
@@ -1149,11 +1342,9 @@ BinaryFormatCmd(
 		}
 	    }
 	    arg++;
-	    for (i = 0; i < count; i++) {
-		if (FormatNumber(interp, cmd, listv[i], &cursor) != TCL_OK) {
-		    Tcl_DecrRefCount(resultPtr);
-		    return TCL_ERROR;
-		}
+	    if (FormatNumbers(interp, cmd, count, listv, &cursor) != TCL_OK) {
+		Tcl_DecrRefCount(resultPtr);
+		return TCL_ERROR;
 	    }
 	    break;
 	}
@@ -1262,7 +1453,7 @@ BinaryScanCmd(
     const char *str;
     int offset, size, length, i;
 
-    Tcl_Obj *valuePtr, *elementPtr;
+    Tcl_Obj *valuePtr;
     Tcl_HashTable numberCacheHash;
     Tcl_HashTable *numberCachePtr;
 
@@ -1476,9 +1667,7 @@ BinaryScanCmd(
 	    goto scanNumber;
 	case 'q':
 	case 'Q':
-	case 'd': {
-	    unsigned char *src;
-
+	case 'd':
 	    size = sizeof(double);
 	    /* fall through */
 
@@ -1501,13 +1690,8 @@ BinaryScanCmd(
 		if ((length - offset) < (count * size)) {
 		    goto done;
 		}
-		TclNewObj(valuePtr);
-		src = buffer + offset;
-		for (i = 0; i < count; i++) {
-		    elementPtr = ScanNumber(src, cmd, flags, &numberCachePtr);
-		    src += size;
-		    Tcl_ListObjAppendElement(NULL, valuePtr, elementPtr);
-		}
+		valuePtr = ScanNumbers(buffer+offset, cmd, size, flags, count,
+			&numberCachePtr);
 		offset += count * size;
 	    }
 
@@ -1519,7 +1703,6 @@ BinaryScanCmd(
 		return TCL_ERROR;
 	    }
 	    break;
-	}
 	case 'x':
 	    if (count == BINARY_NOCOUNT) {
 		count = 1;
@@ -2012,6 +2195,129 @@ FormatNumber(
 	return TCL_ERROR;
     }
 }
+
+/*
+ * Byte-order reversal of whole words, written so that compilers turn them
+ * into single byte-swap instructions.
+ */
+
+#define SWAP32(x) \
+    ((((x) & 0xFF) << 24) | (((x) & 0xFF00) << 8) \
+	    | (((x) >> 8) & 0xFF00) | (((x) >> 24) & 0xFF))
+#define SWAP64(x) \
+    (((Tcl_WideUInt) SWAP32((unsigned) (x)) << 32) \
+	    | SWAP32((unsigned) ((x) >> 32)))
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FormatNumbers --
+ *
+ *	This routine is called by Tcl_BinaryObjCmd to format a run of numbers
+ *	of the same type. Floating point runs are handled here, with the byte
+ *	order decided once for the whole run and with doubles read straight
+ *	from their internal representation; everything else goes through
+ *	FormatNumber.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	Moves the cursor past the formatted numbers.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+FormatNumbers(
+    Tcl_Interp *interp,		/* Current interpreter, used to report
+				 * errors. */
+    int type,			/* Type of number to format. */
+    int count,			/* Number of numbers to format. */
+    Tcl_Obj *const *srcv,	/* Numbers to format. */
+    unsigned char **cursorPtr)	/* Pointer to index into destination buffer. */
+{
+    unsigned char *cursor = *cursorPtr;
+    double dvalue;
+    int i, reverse;
+
+    switch (type) {
+    case 'd':
+    case 'q':
+    case 'Q':
+	reverse = NeedReversing(type);
+	if (reverse > 1) {
+	    break;
+	}
+	for (i = 0; i < count; i++) {
+	    Tcl_WideUInt bits;
+
+	    /*
+	     * Tcl_GetDoubleFromObj returns TCL_ERROR for NaN, but we can check
+	     * by comparing the object's type pointer.
+	     */
+
+	    if (srcv[i]->typePtr == &tclDoubleType) {
+		dvalue = srcv[i]->internalRep.doubleValue;
+	    } else if (Tcl_GetDoubleFromObj(interp, srcv[i],
+		    &dvalue) != TCL_OK) {
+		if (srcv[i]->typePtr != &tclDoubleType) {
+		    *cursorPtr = cursor;
+		    return TCL_ERROR;
+		}
+		dvalue = srcv[i]->internalRep.doubleValue;
+	    }
+	    memcpy(&bits, &dvalue, sizeof(double));
+	    if (reverse) {
+		bits = SWAP64(bits);
+	    }
+	    memcpy(cursor, &bits, sizeof(double));
+	    cursor += sizeof(double);
+	}
+	*cursorPtr = cursor;
+	return TCL_OK;
+
+    case 'f':
+    case 'r':
+    case 'R':
+	reverse = NeedReversing(type);
+	for (i = 0; i < count; i++) {
+	    float fvalue;
+	    unsigned bits;
+
+	    if (srcv[i]->typePtr == &tclDoubleType) {
+		dvalue = srcv[i]->internalRep.doubleValue;
+	    } else if (Tcl_GetDoubleFromObj(interp, srcv[i],
+		    &dvalue) != TCL_OK) {
+		if (srcv[i]->typePtr != &tclDoubleType) {
+		    *cursorPtr = cursor;
+		    return TCL_ERROR;
+		}
+		dvalue = srcv[i]->internalRep.doubleValue;
+	    }
+	    if (fabs(dvalue) > (double) FLT_MAX) {
+		fvalue = (dvalue >= 0.0) ? FLT_MAX : -FLT_MAX;
+	    } else {
+		fvalue = (float) dvalue;
+	    }
+	    memcpy(&bits, &fvalue, sizeof(float));
+	    if (reverse) {
+		bits = SWAP32(bits);
+	    }
+	    memcpy(cursor, &bits, sizeof(float));
+	    cursor += sizeof(float);
+	}
+	*cursorPtr = cursor;
+	return TCL_OK;
+    }
+
+    for (i = 0; i < count; i++) {
+	if (FormatNumber(interp, type, srcv[i], cursorPtr) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+    }
+    return TCL_OK;
+}
 
 /*
  *----------------------------------------------------------------------
@@ -2228,6 +2534,133 @@ ScanNumber(
     return NULL;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * ScanNumbers --
+ *
+ *	This routine is called by Tcl_BinaryObjCmd to scan a run of numbers of
+ *	the same type out of a buffer. The list holding them is allocated at
+ *	its final size up front and filled in directly. Floating point and
+ *	signed 64-bit runs are decoded in a single loop, with the byte order
+ *	decided once for the whole run; everything else goes through
+ *	ScanNumber.
+ *
+ * Results:
+ *	Returns a newly created list object containing the scanned numbers.
+ *	This object has a ref count of zero.
+ *
+ * Side effects:
+ *	As for ScanNumber.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_Obj *
+ScanNumbers(
+    unsigned char *buffer,	/* Buffer to scan numbers from. */
+    int type,			/* Format character from "binary scan" */
+    int size,			/* Size of each number, in bytes. */
+    int flags,			/* Format field flags */
+    int count,			/* Number of numbers to scan. */
+    Tcl_HashTable **numberCachePtrPtr)
+				/* Place to look for cache of scanned value
+				 * objects, or NULL if too many different
+				 * numbers have been scanned. */
+{
+    Tcl_Obj *listPtr, **elemPtrs;
+    int i, reverse;
+
+    if (count == 0) {
+	return Tcl_NewObj();
+    }
+    listPtr = Tcl_NewListObj(count, NULL);
+    elemPtrs = &ListRepPtr(listPtr)->elements;
+
+    switch (type) {
+    case 'f':
+    case 'r':
+    case 'R':
+	reverse = NeedReversing(type);
+	for (i = 0; i < count; i++) {
+	    unsigned bits;
+	    float fvalue;
+
+	    memcpy(&bits, buffer, sizeof(float));
+	    if (reverse) {
+		bits = SWAP32(bits);
+	    }
+	    memcpy(&fvalue, &bits, sizeof(float));
+	    TclNewDoubleObj(elemPtrs[i], fvalue);
+	    buffer += sizeof(float);
+	}
+	break;
+
+    case 'd':
+    case 'q':
+    case 'Q':
+	reverse = NeedReversing(type);
+	if (reverse > 1) {
+	    goto oneByOne;
+	}
+	for (i = 0; i < count; i++) {
+	    Tcl_WideUInt bits;
+	    double dvalue;
+
+	    memcpy(&bits, buffer, sizeof(double));
+	    if (reverse) {
+		bits = SWAP64(bits);
+	    }
+	    memcpy(&dvalue, &bits, sizeof(double));
+	    TclNewDoubleObj(elemPtrs[i], dvalue);
+	    buffer += sizeof(double);
+	}
+	break;
+
+    case 'w':
+    case 'W':
+    case 'm':
+	if (flags & BINARY_UNSIGNED) {
+	    goto oneByOne;
+	}
+
+	/*
+	 * For integer types NeedReversing tells whether the bytes are in
+	 * little-endian order, not whether they differ from ours.
+	 */
+
+	reverse = NeedReversing(type);
+#ifndef WORDS_BIGENDIAN
+	reverse = !reverse;
+#endif
+	for (i = 0; i < count; i++) {
+	    Tcl_WideUInt uwvalue;
+
+	    memcpy(&uwvalue, buffer, sizeof(Tcl_WideUInt));
+	    if (reverse) {
+		uwvalue = SWAP64(uwvalue);
+	    }
+	    elemPtrs[i] = Tcl_NewWideIntObj((Tcl_WideInt) uwvalue);
+	    buffer += sizeof(Tcl_WideUInt);
+	}
+	break;
+
+    default:
+    oneByOne:
+	for (i = 0; i < count; i++) {
+	    elemPtrs[i] = ScanNumber(buffer, type, flags, numberCachePtrPtr);
+	    buffer += size;
+	}
+	break;
+    }
+
+    for (i = 0; i < count; i++) {
+	Tcl_IncrRefCount(elemPtrs[i]);
+    }
+    ListRepPtr(listPtr)->elemCount = count;
+    return listPtr;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -69,6 +69,8 @@ typedef enum ClockLiteral {
     LIT_MONTH,
     LIT_SECONDS,	LIT_TZNAME,		LIT_TZOFFSET,
     LIT_YEAR,
+    LIT_FORMATTCL,	LIT_GETFORMATLOCALEDATA,
+    LIT_GETSYSTEMTIMEZONE,	LIT_SCANTCL,		LIT_TZDATA,
     LIT__END
 } ClockLiteral;
 static const char *const literals[] = {
@@ -84,9 +86,55 @@ static const char *const literals[] = {
     "julianDay",	"localSeconds",
     "month",
     "seconds",		"tzName",		"tzOffset",
-    "year"
+    "year",
+    "::tcl::clock::FormatTcl",	"::tcl::clock::GetFormatLocaleData",
+    "::tcl::clock::GetSystemTimeZone",	"::tcl::clock::ScanTcl",
+    "::tcl::clock::TZData"
 };
 
+/*
+ * Time zone transition table: the rows {start offset isDst abbreviation} of
+ * a TZData value, packed into C arrays for binary search. Tables are
+ * immutable once built and are interned process-wide, so that all the
+ * interpreters and threads using a zone share one copy.
+ */
+
+typedef struct ClockTZTable {
+    size_t refCount;		/* Number of users; protected by
+				 * clockMutex. */
+    unsigned int hash;		/* Hash of the contents. */
+    int numRows;		/* Number of transitions. */
+    int sorted;			/* Flag == 1 if the start times ascend, so
+				 * that the previous lookup's row can be
+				 * tried first. */
+    Tcl_WideInt *starts;	/* Times from the epoch at which the rows
+				 * take effect. */
+    int *offsets;		/* Offsets from UTC in seconds. */
+    unsigned char *isDst;	/* Flags == 1 for Daylight Saving Time. */
+    int namesLength;		/* Size of 'names'. */
+    char *names;		/* NUL-terminated abbreviations of the rows,
+				 * in order. */
+} ClockTZTable;
+
+/*
+ * An interpreter's handle on the table of one TZData value.
+ */
+
+typedef struct ClockTZCache {
+    Tcl_Obj *tzdata;		/* The TZData value. A reference is held so
+				 * that it cannot change. */
+    ClockTZTable *tablePtr;	/* Packed table, or NULL if the value does
+				 * not parse and the lists must be used. */
+    Tcl_Obj **abbrevObjs;	/* Abbreviation of each row. */
+    int lastRow;		/* Row found by the previous lookup. */
+} ClockTZCache;
+
+/*
+ * Most time zone tables an interpreter keeps before it starts over.
+ */
+
+#define CLOCK_TZ_CACHE_SIZE 64
+
 /*
  * Structure containing the client data for [clock]
  */
@@ -94,6 +142,20 @@ static const char *const literals[] = {
 typedef struct {
     size_t refCount;		/* Number of live references. */
     Tcl_Obj **literals;		/* Pool of object literals. */
+    size_t epoch;		/* Generation of the caches below. Compiled
+				 * formats carrying any other generation are
+				 * stale. */
+    Tcl_HashTable formatCache;	/* Compiled formats, keyed by the list
+				 * {format locale}. Keeps them alive when the
+				 * format object loses its internal rep. */
+    Tcl_Obj *systemTZ;		/* Last result of GetSystemTimeZone, or
+				 * NULL. */
+    size_t systemTZEpoch;	/* Cache generation of systemTZ. */
+    size_t systemTZEnvEpoch;	/* TclEnvEpoch when systemTZ was fetched. */
+    long systemTZRefresh;	/* Second at which systemTZ was fetched. */
+    Tcl_HashTable tzCache;	/* ClockTZCache of each TZData value used,
+				 * keyed by the value's address. */
+    ClockTZCache *lastTZ;	/* Entry of tzCache used last, or NULL. */
 } ClockClientData;
 
 /*
@@ -121,6 +183,167 @@ typedef struct TclDateFields {
 } TclDateFields;
 static const char *const eras[] = { "CE", "BCE", NULL };
 
+/*
+ * Format groups recognized by the native [clock format] engine. Each group
+ * of the (localized) format string compiles to one token.
+ */
+
+typedef enum ClockFormatGroup {
+    FMT_LITERAL,		/* Run of literal text */
+    FMT_DAYNAME_ABBREV,		/* %a */
+    FMT_DAYNAME,		/* %A */
+    FMT_MONTHNAME_ABBREV,	/* %b %h */
+    FMT_MONTHNAME,		/* %B */
+    FMT_CENTURY,		/* %C */
+    FMT_DAY,			/* %d */
+    FMT_DAY_SPACE,		/* %e */
+    FMT_ISO_YEAR2,		/* %g */
+    FMT_ISO_YEAR,		/* %G */
+    FMT_HOUR,			/* %H */
+    FMT_HOUR12,			/* %I */
+    FMT_YDAY,			/* %j */
+    FMT_JULIAN,			/* %J */
+    FMT_HOUR_SPACE,		/* %k */
+    FMT_HOUR12_SPACE,		/* %l */
+    FMT_MONTH,			/* %m */
+    FMT_MINUTE,			/* %M */
+    FMT_MONTH_SPACE,		/* %N */
+    FMT_AMPM_UPPER,		/* %p */
+    FMT_AMPM,			/* %P */
+    FMT_STARDATE,		/* %Q */
+    FMT_EPOCH,			/* %s */
+    FMT_SECOND,			/* %S */
+    FMT_WDAY_MON,		/* %u */
+    FMT_WEEK_SUN,		/* %U */
+    FMT_ISO_WEEK,		/* %V */
+    FMT_WDAY_SUN,		/* %w */
+    FMT_WEEK_MON,		/* %W */
+    FMT_YEAR2,			/* %y */
+    FMT_YEAR,			/* %Y */
+    FMT_TZ_NUMERIC,		/* %z */
+    FMT_TZ_NAME,		/* %Z */
+    FMT_ERA,			/* %EE */
+    FMT_LOCALE_ERA,		/* %EC */
+    FMT_LOCALE_ERA_YEAR,	/* %Ey */
+    FMT_NUM_DAY,		/* %Od %Oe */
+    FMT_NUM_HOUR,		/* %OH %Ok */
+    FMT_NUM_HOUR12,		/* %OI %Ol */
+    FMT_NUM_MONTH,		/* %Om */
+    FMT_NUM_MINUTE,		/* %OM */
+    FMT_NUM_SECOND,		/* %OS */
+    FMT_NUM_WDAY_MON,		/* %Ou */
+    FMT_NUM_WDAY_SUN,		/* %Ow */
+    FMT_NUM_YEAR2		/* %Oy */
+} ClockFormatGroup;
+
+typedef struct ClockFormatToken {
+    ClockFormatGroup group;	/* Format group */
+    int litStart;		/* FMT_LITERAL: offset of the text in the
+				 * literal buffer of the compiled format */
+    int litLength;		/* FMT_LITERAL: length of the text */
+} ClockFormatToken;
+
+/*
+ * Elements of the [clock scan] recognizer. The native engine handles the
+ * purely numeric groups; any other group leaves the format to the scripted
+ * scanner.
+ */
+
+typedef enum ClockScanElement {
+    SCAN_LITERAL,		/* A single character, matched without regard
+				 * to case */
+    SCAN_SPACES,		/* One or more white space characters */
+    SCAN_OPT_SPACES,		/* Zero or more white space characters */
+    SCAN_NUMBER,		/* Optional white space and a run of digits */
+    SCAN_EPOCH,			/* %s: seconds from the epoch */
+    SCAN_TZ_NUMERIC		/* %z/%Z given as [-+]hh[[:]mm[[:]ss]] */
+} ClockScanElement;
+
+enum ClockScanField {
+    SCANF_CENTURY, SCANF_YEAROFCENTURY, SCANF_MONTH, SCANF_DAYOFMONTH,
+    SCANF_HOUR, SCANF_MINUTE, SCANF_SECOND,
+    SCANF_YEAR,			/* %Y: century and year of century */
+    SCANF__END
+};
+#define SCANF_SECONDS	SCANF__END	/* Bit for %s in the field set */
+#define SCANF_TZNAME	(SCANF__END+1)	/* Bit for %z in the field set */
+
+typedef struct ClockScanToken {
+    ClockScanElement element;	/* Kind of element */
+    int field;			/* SCAN_NUMBER: field being scanned */
+    int minDigits, maxDigits;	/* SCAN_NUMBER: width of the field */
+    int ch;			/* SCAN_LITERAL: the character, folded to
+				 * lower case */
+} ClockScanToken;
+
+/*
+ * A compiled format: a format string as seen through a given locale,
+ * together with the message catalog data that rendering it needs. Shared
+ * between the internal rep of the format object and the per-interpreter
+ * cache.
+ */
+
+typedef struct ClockLocaleEra {
+    Tcl_WideInt start;		/* Local seconds at which the era begins */
+    Tcl_Obj *name;		/* Name of the era */
+    int year;			/* Gregorian year preceding year 1 of the
+				 * era */
+} ClockLocaleEra;
+
+typedef struct ClockCompiledFormat {
+    size_t refCount;		/* Number of references */
+    size_t epoch;		/* Cache generation that compiled this */
+    Tcl_Obj *localeObj;		/* Locale (lower case) the format is for */
+    Tcl_Obj *localeData;	/* Result of GetFormatLocaleData */
+    Tcl_Obj *upperAmPm[2];	/* [string toupper] of AM and PM */
+    int changeover;		/* Julian Day of the Gregorian changeover */
+    int formatNative;		/* 1 if the native engine formats this */
+    int numFormatTokens;
+    ClockFormatToken *formatTokens;
+    char *literals;		/* Text of the FMT_LITERAL tokens */
+    int numEras;		/* Entries in LOCALE_ERAS, if needed */
+    ClockLocaleEra *localeEras;
+    int scanNative;		/* 1 if the native engine scans this */
+    int numScanTokens;
+    ClockScanToken *scanTokens;
+} ClockCompiledFormat;
+
+/*
+ * Indices into the list returned by GetFormatLocaleData.
+ */
+
+enum ClockLocaleDataIndex {
+    LOC_FORMAT, LOC_DAYS_ABBREV, LOC_DAYS_FULL, LOC_MONTHS_ABBREV,
+    LOC_MONTHS_FULL, LOC_AM, LOC_PM, LOC_BCE, LOC_CE, LOC_NUMERALS,
+    LOC_ERAS, LOC_CHANGEOVER, LOC__END
+};
+
+/*
+ * Source of cache generations; protected by clockMutex.
+ */
+
+static size_t clockCacheEpoch = 0;
+
+/*
+ * Interned time zone tables, keyed by their contents; protected by
+ * clockMutex.
+ */
+
+static unsigned int	HashTZTable(Tcl_HashTable *, void *);
+static int		CompareTZTables(void *, Tcl_HashEntry *);
+
+static const Tcl_HashKeyType tzTableKeyType = {
+    TCL_HASH_KEY_TYPE_VERSION,	/* version */
+    TCL_HASH_KEY_DIRECT_COMPARE,/* flags */
+    HashTZTable,		/* hashKeyProc */
+    CompareTZTables,		/* compareKeysProc */
+    NULL,			/* allocEntryProc */
+    NULL			/* freeEntryProc */
+};
+static Tcl_HashTable tzTables;
+static int tzTablesInitialized = 0;
+static void		FreeTZTables(ClientData);
+
 /*
  * Thread specific data block holding a 'struct tm' for the 'gmtime' and
  * 'localtime' library calls.
@@ -139,18 +362,24 @@ TCL_DECLARE_MUTEX(clockMutex)
  * Function prototypes for local procedures in this file:
  */
 
-static int		ConvertUTCToLocal(Tcl_Interp *,
+static int		ConvertUTCToLocal(Tcl_Interp *, ClockClientData *,
 			    TclDateFields *, Tcl_Obj *, int);
 static int		ConvertUTCToLocalUsingTable(Tcl_Interp *,
 			    TclDateFields *, int, Tcl_Obj *const[]);
 static int		ConvertUTCToLocalUsingC(Tcl_Interp *,
 			    TclDateFields *, int);
-static int		ConvertLocalToUTC(Tcl_Interp *,
+static int		ConvertLocalToUTC(Tcl_Interp *, ClockClientData *,
 			    TclDateFields *, Tcl_Obj *, int);
 static int		ConvertLocalToUTCUsingTable(Tcl_Interp *,
 			    TclDateFields *, int, Tcl_Obj *const[]);
 static int		ConvertLocalToUTCUsingC(Tcl_Interp *,
 			    TclDateFields *, int);
+static void		ConvertLocalToUTCUsingCache(ClockTZCache *,
+			    TclDateFields *);
+static ClockTZCache *	GetTZCache(ClockClientData *, Tcl_Obj *);
+static void		BuildTZTable(ClockTZCache *);
+static void		ClearTZCache(ClockClientData *);
+static int		LookupTZRow(ClockTZCache *, Tcl_WideInt);
 static Tcl_Obj *	LookupLastTransition(Tcl_Interp *, Tcl_WideInt,
 			    int, Tcl_Obj *const *);
 static void		GetYearWeekDay(TclDateFields *, int);
@@ -160,12 +389,20 @@ static void		GetJulianDayFromEraYearWeekDay(TclDateFields *, int);
 static void		GetJulianDayFromEraYearMonthDay(TclDateFields *, int);
 static int		IsGregorianLeapYear(TclDateFields *);
 static int		WeekdayOnOrBefore(int, int);
+static int		GetDateFields(Tcl_Interp *, ClockClientData *,
+			    TclDateFields *, Tcl_Obj *, int);
 static int		ClockClicksObjCmd(
 			    ClientData clientData, Tcl_Interp *interp,
 			    int objc, Tcl_Obj *const objv[]);
+static int		ClockClearnativecachesObjCmd(
+			    ClientData clientData, Tcl_Interp *interp,
+			    int objc, Tcl_Obj *const objv[]);
 static int		ClockConvertlocaltoutcObjCmd(
 			    ClientData clientData, Tcl_Interp *interp,
 			    int objc, Tcl_Obj *const objv[]);
+static int		ClockFormatObjCmd(
+			    ClientData clientData, Tcl_Interp *interp,
+			    int objc, Tcl_Obj *const objv[]);
 static int		ClockGetdatefieldsObjCmd(
 			    ClientData clientData, Tcl_Interp *interp,
 			    int objc, Tcl_Obj *const objv[]);
@@ -187,12 +424,51 @@ static int		ClockMillisecondsObjCmd(
 static int		ClockParseformatargsObjCmd(
 			    ClientData clientData, Tcl_Interp *interp,
 			    int objc, Tcl_Obj *const objv[]);
+static int		ParseFormatArgs(ClockClientData *, Tcl_Interp *,
+			    int, Tcl_Obj *const[], Tcl_Obj *[3],
+			    Tcl_WideInt *);
+static int		ClockScanObjCmd(
+			    ClientData clientData, Tcl_Interp *interp,
+			    int objc, Tcl_Obj *const objv[]);
 static int		ClockSecondsObjCmd(
 			    ClientData clientData, Tcl_Interp *interp,
 			    int objc, Tcl_Obj *const objv[]);
 static struct tm *	ThreadSafeLocalTime(const time_t *);
 static void		TzsetIfNecessary(void);
 static void		ClockDeleteCmdProc(ClientData);
+static void		ClockClearNativeCaches(ClockClientData *);
+static ClockCompiledFormat *GetCompiledFormat(Tcl_Interp *,
+			    ClockClientData *, Tcl_Obj *, Tcl_Obj *);
+static void		ReleaseCompiledFormat(ClockCompiledFormat *);
+static void		DupClockFormatInternalRep(Tcl_Obj *, Tcl_Obj *);
+static void		FreeClockFormatInternalRep(Tcl_Obj *);
+static ClockCompiledFormat *CompileFormat(Tcl_Interp *, ClockClientData *,
+			    Tcl_Obj *, Tcl_Obj *);
+static void		CompileFormatTokens(ClockCompiledFormat *,
+			    const char *, int);
+static void		CompileScanTokens(ClockCompiledFormat *,
+			    const char *, int);
+static Tcl_Obj *	ClockGetSystemTimeZone(Tcl_Interp *,
+			    ClockClientData *);
+static int		ClockCallScripted(Tcl_Interp *, Tcl_Obj *, int,
+			    Tcl_Obj *const *);
+static Tcl_Obj *	LowerCaseLocale(Tcl_Obj *);
+static int		GetStrictBoolean(Tcl_Obj *, int *);
+static int		FormatDate(ClockCompiledFormat *, TclDateFields *,
+			    Tcl_DString *);
+static int		ScanDate(ClockCompiledFormat *, Tcl_Obj *, int *,
+			    unsigned *, Tcl_WideInt *, Tcl_Obj **);
+static const char *	SkipSpaces(const char *, const char *);
+
+/*
+ * A Tcl_ObjType caching the compiled form of a [clock format] or [clock scan]
+ * format string in the twoPtrValue.ptr1 field of the internal rep.
+ */
+
+static const Tcl_ObjType clockFormatType = {
+    "clockFormat", FreeClockFormatInternalRep, DupClockFormatInternalRep,
+    NULL, NULL
+};
 
 /*
  * Structure containing description of "native" clock commands to create.
@@ -208,6 +484,7 @@ struct ClockCommand {
 };
 
 static const struct ClockCommand clockCommands[] = {
+    { "format",			ClockFormatObjCmd },
     { "getenv",			ClockGetenvObjCmd },
     { "Oldscan",		TclClockOldscanObjCmd },
     { "ConvertLocalToUTC",	ClockConvertlocaltoutcObjCmd },
@@ -217,6 +494,8 @@ static const struct ClockCommand clockCommands[] = {
     { "GetJulianDayFromEraYearWeekDay",
 		ClockGetjuliandayfromerayearweekdayObjCmd },
     { "ParseFormatArgs",	ClockParseformatargsObjCmd },
+    { "ClearNativeCaches",	ClockClearnativecachesObjCmd },
+    { "scan",			ClockScanObjCmd },
     { NULL, NULL }
 };
 
@@ -282,6 +561,13 @@ TclClockInit(
 	data->literals[i] = Tcl_NewStringObj(literals[i], -1);
 	Tcl_IncrRefCount(data->literals[i]);
     }
+    Tcl_MutexLock(&clockMutex);
+    data->epoch = ++clockCacheEpoch;
+    Tcl_MutexUnlock(&clockMutex);
+    Tcl_InitObjHashTable(&data->formatCache);
+    data->systemTZ = NULL;
+    Tcl_InitHashTable(&data->tzCache, TCL_ONE_WORD_KEYS);
+    data->lastTZ = NULL;
 
     /*
      * Install the commands.
@@ -366,7 +652,7 @@ ClockConvertlocaltoutcObjCmd(
     if ((TclGetWideIntFromObj(interp, secondsObj,
 	    &fields.localSeconds) != TCL_OK)
 	|| (TclGetIntFromObj(interp, objv[3], &changeover) != TCL_OK)
-	|| ConvertLocalToUTC(interp, &fields, objv[2], changeover)) {
+	|| ConvertLocalToUTC(interp, data, &fields, objv[2], changeover)) {
 	return TCL_ERROR;
     }
 
@@ -457,31 +743,10 @@ ClockGetdatefieldsObjCmd(
 	return TCL_ERROR;
     }
 
-    /*
-     * Convert UTC time to local.
-     */
-
-    if (ConvertUTCToLocal(interp, &fields, objv[2], changeover) != TCL_OK) {
+    if (GetDateFields(interp, data, &fields, objv[2], changeover) != TCL_OK) {
 	return TCL_ERROR;
     }
 
-    /*
-     * Extract Julian day. Always round the quotient down by subtracting 1
-     * when the remainder is negative (i.e. if the quotient was rounded up).
-     */
-
-    fields.julianDay = (int) ((fields.localSeconds / SECONDS_PER_DAY) -
-	    ((fields.localSeconds % SECONDS_PER_DAY) < 0) +
-	    JULIAN_DAY_POSIX_EPOCH);
-
-    /*
-     * Convert to Julian or Gregorian calendar.
-     */
-
-    GetGregorianEraYearDay(&fields, changeover);
-    GetMonthDay(&fields);
-    GetYearWeekDay(&fields, changeover);
-
     dict = Tcl_NewDictObj();
     Tcl_DictObjPut(NULL, dict, lit[LIT_LOCALSECONDS],
 	    Tcl_NewWideIntObj(fields.localSeconds));
@@ -516,6 +781,60 @@ ClockGetdatefieldsObjCmd(
     return TCL_OK;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetDateFields --
+ *
+ *	Fills in the fields of a date, given its time in seconds from the
+ *	Posix epoch and the time zone in which to express it.
+ *
+ * Results:
+ *	Returns a standard Tcl result.
+ *
+ * Side effects:
+ *	On success, populates 'fields' and leaves a reference to the time
+ *	zone name in fields->tzName that the caller must release.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+GetDateFields(
+    Tcl_Interp *interp,		/* Tcl interpreter */
+    ClockClientData *dataPtr,	/* Client data of [clock] */
+    TclDateFields *fields,	/* Date, with 'seconds' filled in */
+    Tcl_Obj *tzdata,		/* Time zone data */
+    int changeover)		/* Julian Day of the Gregorian transition */
+{
+    /*
+     * Convert UTC time to local.
+     */
+
+    if (ConvertUTCToLocal(interp, dataPtr, fields, tzdata,
+	    changeover) != TCL_OK) {
+	return TCL_ERROR;
+    }
+
+    /*
+     * Extract Julian day. Always round the quotient down by subtracting 1
+     * when the remainder is negative (i.e. if the quotient was rounded up).
+     */
+
+    fields->julianDay = (int) ((fields->localSeconds / SECONDS_PER_DAY) -
+	    ((fields->localSeconds % SECONDS_PER_DAY) < 0) +
+	    JULIAN_DAY_POSIX_EPOCH);
+
+    /*
+     * Convert to Julian or Gregorian calendar.
+     */
+
+    GetGregorianEraYearDay(fields, changeover);
+    GetMonthDay(fields);
+    GetYearWeekDay(fields, changeover);
+    return TCL_OK;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -745,12 +1064,19 @@ ClockGetjuliandayfromerayearweekdayObjCmd(
 static int
 ConvertLocalToUTC(
     Tcl_Interp *interp,		/* Tcl interpreter */
+    ClockClientData *dataPtr,	/* Client data of [clock] */
     TclDateFields *fields,	/* Fields of the time */
     Tcl_Obj *tzdata,		/* Time zone data */
     int changeover)		/* Julian Day of the Gregorian transition */
 {
     int rowc;			/* Number of rows in tzdata */
     Tcl_Obj **rowv;		/* Pointers to the rows */
+    ClockTZCache *cachePtr = GetTZCache(dataPtr, tzdata);
+
+    if (cachePtr->tablePtr != NULL) {
+	ConvertLocalToUTCUsingCache(cachePtr, fields);
+	return TCL_OK;
+    }
 
     /*
      * Unpack the tz data.
@@ -847,6 +1173,61 @@ ConvertLocalToUTCUsingTable(
     return TCL_OK;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * ConvertLocalToUTCUsingCache --
+ *
+ *	Packed-table counterpart of ConvertLocalToUTCUsingTable.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Stores the 'seconds' and 'tzOffset' fields in 'fields'.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+ConvertLocalToUTCUsingCache(
+    ClockTZCache *cachePtr,	/* Cache entry with a table */
+    TclDateFields *fields)	/* Time to convert, with 'localSeconds'
+				 * filled in */
+{
+    const int *offsets = cachePtr->tablePtr->offsets;
+    int have[8];
+    int nHave = 0;
+    int i;
+    int found;
+
+    /*
+     * See ConvertLocalToUTCUsingTable for the algorithm.
+     */
+
+    found = 0;
+    fields->tzOffset = 0;
+    fields->seconds = fields->localSeconds;
+    while (!found) {
+	fields->tzOffset = offsets[LookupTZRow(cachePtr, fields->seconds)];
+	for (i = 0; !found && i < nHave; ++i) {
+	    if (have[i] == fields->tzOffset) {
+		found = 1;
+		break;
+	    }
+	}
+	if (!found) {
+	    if (nHave == 8) {
+		Tcl_Panic("loop in ConvertLocalToUTCUsingCache");
+	    }
+	    have[nHave++] = fields->tzOffset;
+	}
+	fields->seconds = fields->localSeconds - fields->tzOffset;
+    }
+    fields->tzOffset = have[i];
+    fields->seconds = fields->localSeconds - fields->tzOffset;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -948,12 +1329,28 @@ ConvertLocalToUTCUsingC(
 static int
 ConvertUTCToLocal(
     Tcl_Interp *interp,		/* Tcl interpreter */
+    ClockClientData *dataPtr,	/* Client data of [clock] */
     TclDateFields *fields,	/* Fields of the time */
     Tcl_Obj *tzdata,		/* Time zone data */
     int changeover)		/* Julian Day of the Gregorian transition */
 {
     int rowc;			/* Number of rows in tzdata */
     Tcl_Obj **rowv;		/* Pointers to the rows */
+    ClockTZCache *cachePtr = GetTZCache(dataPtr, tzdata);
+
+    /*
+     * Use the packed table if there is one.
+     */
+
+    if (cachePtr->tablePtr != NULL) {
+	int row = LookupTZRow(cachePtr, fields->seconds);
+
+	fields->tzOffset = cachePtr->tablePtr->offsets[row];
+	fields->tzName = cachePtr->abbrevObjs[row];
+	Tcl_IncrRefCount(fields->tzName);
+	fields->localSeconds = fields->seconds + fields->tzOffset;
+	return TCL_OK;
+    }
 
     /*
      * Unpack the tz data.
@@ -1184,127 +1581,499 @@ LookupLastTransition(
     }
     return rowv[l];
 }
-
+
 /*
  *----------------------------------------------------------------------
  *
- * GetYearWeekDay --
+ * GetTZCache --
  *
- *	Given a date with Julian Calendar Day, compute the year, week, and day
- *	in the ISO8601 calendar.
+ *	Finds an interpreter's packed transition table for a TZData value,
+ *	building it the first time the value is seen.
  *
  * Results:
- *	None.
+ *	Returns the interpreter's cache entry for the value. The entry's
+ *	table is NULL if the value is not a table that the packed form can
+ *	represent, in which case the caller should use the lists directly.
  *
  * Side effects:
- *	Stores 'iso8601Year', 'iso8601Week' and 'dayOfWeek' in the date
- *	fields.
+ *	May add an entry to the interpreter's cache, and a table to the
+ *	process-wide one.
  *
  *----------------------------------------------------------------------
  */
 
-static void
-GetYearWeekDay(
-    TclDateFields *fields,	/* Date to convert, must have 'julianDay' */
-    int changeover)		/* Julian Day Number of the Gregorian
-				 * transition */
+static ClockTZCache *
+GetTZCache(
+    ClockClientData *dataPtr,	/* Client data of [clock] */
+    Tcl_Obj *tzdata)		/* Time zone data */
 {
-    TclDateFields temp;
-    int dayOfFiscalYear;
+    ClockTZCache *cachePtr = dataPtr->lastTZ;
+    Tcl_HashEntry *hPtr;
+    int isNew;
 
     /*
-     * Find the given date, minus three days, plus one year. That date's
-     * iso8601 year is an upper bound on the ISO8601 year of the given date.
+     * The entry holds a reference to the value, so its address cannot be
+     * reused for another value while the entry exists.
      */
 
-    temp.julianDay = fields->julianDay - 3;
-    GetGregorianEraYearDay(&temp, changeover);
-    if (temp.era == BCE) {
-	temp.iso8601Year = temp.year - 1;
-    } else {
-	temp.iso8601Year = temp.year + 1;
+    if (cachePtr != NULL && cachePtr->tzdata == tzdata) {
+	return cachePtr;
     }
-    temp.iso8601Week = 1;
-    temp.dayOfWeek = 1;
-    GetJulianDayFromEraYearWeekDay(&temp, changeover);
-
-    /*
-     * temp.julianDay is now the start of an ISO8601 year, either the one
-     * corresponding to the given date, or the one after. If we guessed high,
-     * move one year earlier
-     */
-
-    if (fields->julianDay < temp.julianDay) {
-	if (temp.era == BCE) {
-	    temp.iso8601Year += 1;
-	} else {
-	    temp.iso8601Year -= 1;
+    hPtr = Tcl_FindHashEntry(&dataPtr->tzCache, (char *) tzdata);
+    if (hPtr != NULL) {
+	cachePtr = (ClockTZCache *)Tcl_GetHashValue(hPtr);
+    } else {
+	if (dataPtr->tzCache.numEntries >= CLOCK_TZ_CACHE_SIZE) {
+	    ClearTZCache(dataPtr);
 	}
-	GetJulianDayFromEraYearWeekDay(&temp, changeover);
-    }
-
-    fields->iso8601Year = temp.iso8601Year;
-    dayOfFiscalYear = fields->julianDay - temp.julianDay;
-    fields->iso8601Week = (dayOfFiscalYear / 7) + 1;
-    fields->dayOfWeek = (dayOfFiscalYear + 1) % 7;
-    if (fields->dayOfWeek < 1) {
-	fields->dayOfWeek += 7;
+	cachePtr = (ClockTZCache *)ckalloc(sizeof(ClockTZCache));
+	cachePtr->tzdata = tzdata;
+	Tcl_IncrRefCount(tzdata);
+	cachePtr->tablePtr = NULL;
+	cachePtr->abbrevObjs = NULL;
+	cachePtr->lastRow = 0;
+	BuildTZTable(cachePtr);
+	hPtr = Tcl_CreateHashEntry(&dataPtr->tzCache, (char *) tzdata,
+		&isNew);
+	Tcl_SetHashValue(hPtr, cachePtr);
     }
+    dataPtr->lastTZ = cachePtr;
+    return cachePtr;
 }
-
+
 /*
  *----------------------------------------------------------------------
  *
- * GetGregorianEraYearDay --
+ * BuildTZTable --
  *
- *	Given a Julian Day Number, extracts the year and day of the year and
- *	puts them into TclDateFields, along with the era (BCE or CE) and a
- *	flag indicating whether the date is Gregorian or Julian.
+ *	Packs the rows of a TZData value into a transition table, and
+ *	interns the table process-wide.
  *
  * Results:
  *	None.
  *
  * Side effects:
- *	Stores 'era', 'gregorian', 'year', and 'dayOfYear'.
+ *	Fills in the table and abbreviations of the cache entry, unless the
+ *	value is empty (:localtime) or malformed.
  *
  *----------------------------------------------------------------------
  */
 
 static void
-GetGregorianEraYearDay(
-    TclDateFields *fields,	/* Date fields containing 'julianDay' */
-    int changeover)		/* Gregorian transition date */
+BuildTZTable(
+    ClockTZCache *cachePtr)	/* Cache entry to fill in */
 {
-    int jday = fields->julianDay;
-    int day;
-    int year;
-    int n;
-
-    if (jday >= changeover) {
-	/*
-	 * Gregorian calendar.
-	 */
+    ClockTZTable *tablePtr;
+    Tcl_Obj **rowv, **cellv, **abbrevObjs;
+    Tcl_HashEntry *hPtr;
+    int rowc, cellc, namesLength = 0, length, isDst, isNew, initialized, i;
+    unsigned int hash = 0;
+    const char *bytes;
+    char *data;
+
+    if (TclListObjGetElements(NULL, cachePtr->tzdata, &rowc,
+	    &rowv) != TCL_OK || rowc == 0) {
+	return;
+    }
 
-	fields->gregorian = 1;
-	year = 1;
+    /*
+     * Check the rows and size the abbreviations.
+     */
 
-	/*
-	 * n = Number of 400-year cycles since 1 January, 1 CE in the
-	 * proleptic Gregorian calendar. day = remaining days.
-	 */
+    for (i = 0; i < rowc; i++) {
+	if (TclListObjGetElements(NULL, rowv[i], &cellc, &cellv) != TCL_OK
+		|| cellc < 4) {
+	    return;
+	}
+	(void) TclGetStringFromObj(cellv[3], &length);
+	namesLength += length + 1;
+    }
 
-	day = jday - JDAY_1_JAN_1_CE_GREGORIAN;
-	n = day / FOUR_CENTURIES;
-	day %= FOUR_CENTURIES;
-	if (day < 0) {
-	    day += FOUR_CENTURIES;
-	    n--;
+    tablePtr = (ClockTZTable *)ckalloc(sizeof(ClockTZTable));
+    data = (char *)ckalloc(rowc * (sizeof(Tcl_WideInt) + sizeof(int) + 1)
+	    + namesLength);
+    tablePtr->refCount = 0;
+    tablePtr->numRows = rowc;
+    tablePtr->sorted = 1;
+    tablePtr->starts = (Tcl_WideInt *) data;
+    tablePtr->offsets = (int *) (tablePtr->starts + rowc);
+    tablePtr->isDst = (unsigned char *) (tablePtr->offsets + rowc);
+    tablePtr->names = (char *) (tablePtr->isDst + rowc);
+    tablePtr->namesLength = namesLength;
+    abbrevObjs = (Tcl_Obj **)ckalloc(rowc * sizeof(Tcl_Obj *));
+
+    namesLength = 0;
+    for (i = 0; i < rowc; i++) {
+	TclListObjGetElements(NULL, rowv[i], &cellc, &cellv);
+	if (TclGetWideIntFromObj(NULL, cellv[0],
+		&tablePtr->starts[i]) != TCL_OK
+		|| TclGetIntFromObj(NULL, cellv[1],
+		    &tablePtr->offsets[i]) != TCL_OK) {
+	    ckfree(abbrevObjs);
+	    ckfree(data);
+	    ckfree(tablePtr);
+	    return;
 	}
-	year += 400 * n;
+	if (i > 0 && tablePtr->starts[i] < tablePtr->starts[i-1]) {
+	    tablePtr->sorted = 0;
+	}
+	if (Tcl_GetBooleanFromObj(NULL, cellv[2], &isDst) != TCL_OK) {
+	    isDst = 0;
+	}
+	tablePtr->isDst[i] = (unsigned char) isDst;
+	bytes = TclGetStringFromObj(cellv[3], &length);
+	memcpy(tablePtr->names + namesLength, bytes, length + 1);
+	namesLength += length + 1;
+	abbrevObjs[i] = cellv[3];
+    }
 
-	/*
-	 * n = number of centuries since the start of (year);
-	 * day = remaining days
+    /*
+     * Hold the abbreviations themselves: the rows go away if the value
+     * loses its list rep.
+     */
+
+    for (i = 0; i < rowc; i++) {
+	Tcl_IncrRefCount(abbrevObjs[i]);
+    }
+    cachePtr->abbrevObjs = abbrevObjs;
+
+    for (i = 0; i < rowc * (int) (sizeof(Tcl_WideInt) + sizeof(int) + 1)
+	    + namesLength; i++) {
+	hash += (hash << 3) + UCHAR(data[i]);
+    }
+    tablePtr->hash = hash;
+
+    /*
+     * Share the table with every other user of the same zone.
+     */
+
+    Tcl_MutexLock(&clockMutex);
+    initialized = tzTablesInitialized;
+    if (!initialized) {
+	Tcl_InitCustomHashTable(&tzTables, TCL_CUSTOM_PTR_KEYS,
+		&tzTableKeyType);
+	tzTablesInitialized = 1;
+    }
+    hPtr = Tcl_CreateHashEntry(&tzTables, (char *) tablePtr, &isNew);
+    if (isNew) {
+	Tcl_SetHashValue(hPtr, tablePtr);
+    } else {
+	ckfree(data);
+	ckfree(tablePtr);
+	tablePtr = (ClockTZTable *)Tcl_GetHashValue(hPtr);
+    }
+    tablePtr->refCount++;
+    Tcl_MutexUnlock(&clockMutex);
+    cachePtr->tablePtr = tablePtr;
+
+    /*
+     * Late, so that interpreters deleted by ordinary exit handlers (such as
+     * the main one of tclsh) have let go of their tables by then.
+     */
+
+    if (!initialized) {
+	TclCreateLateExitHandler(FreeTZTables, NULL);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FreeTZTables --
+ *
+ *	Exit handler that frees the interned time zone tables still in use
+ *	and the table holding them.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Interpreters deleted later find the tables gone, see ClearTZCache.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+FreeTZTables(
+    ClientData dummy)		/* Not used. */
+{
+    Tcl_HashEntry *hPtr;
+    Tcl_HashSearch search;
+    ClockTZTable *tablePtr;
+    (void)dummy;
+
+    Tcl_MutexLock(&clockMutex);
+    for (hPtr = Tcl_FirstHashEntry(&tzTables, &search); hPtr != NULL;
+	    hPtr = Tcl_NextHashEntry(&search)) {
+	tablePtr = (ClockTZTable *)Tcl_GetHashValue(hPtr);
+	ckfree(tablePtr->starts);
+	ckfree(tablePtr);
+    }
+    Tcl_DeleteHashTable(&tzTables);
+    tzTablesInitialized = 0;
+    Tcl_MutexUnlock(&clockMutex);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * HashTZTable, CompareTZTables --
+ *
+ *	Key procedures of the table of interned time zone tables.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static unsigned int
+HashTZTable(
+    Tcl_HashTable *tablePtr,	/* Hash table */
+    void *keyPtr)		/* Time zone table */
+{
+    return ((ClockTZTable *) keyPtr)->hash;
+}
+
+static int
+CompareTZTables(
+    void *keyPtr,		/* Time zone table being looked up */
+    Tcl_HashEntry *hPtr)	/* Entry of an interned table */
+{
+    ClockTZTable *t1 = (ClockTZTable *) keyPtr;
+    ClockTZTable *t2 = (ClockTZTable *) hPtr->key.oneWordValue;
+
+    return t1->numRows == t2->numRows && t1->namesLength == t2->namesLength
+	    && memcmp(t1->starts, t2->starts, t1->numRows
+		* (sizeof(Tcl_WideInt) + sizeof(int) + 1)
+		+ t1->namesLength) == 0;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ClearTZCache --
+ *
+ *	Releases all of an interpreter's time zone tables.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Tables no longer used by any interpreter are freed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+ClearTZCache(
+    ClockClientData *dataPtr)	/* Client data of [clock] */
+{
+    Tcl_HashEntry *hPtr;
+    Tcl_HashSearch search;
+    ClockTZCache *cachePtr;
+    ClockTZTable *tablePtr;
+    int i;
+
+    for (hPtr = Tcl_FirstHashEntry(&dataPtr->tzCache, &search);
+	    hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+	cachePtr = (ClockTZCache *)Tcl_GetHashValue(hPtr);
+	tablePtr = cachePtr->tablePtr;
+	if (tablePtr != NULL) {
+	    for (i = 0; i < tablePtr->numRows; i++) {
+		Tcl_DecrRefCount(cachePtr->abbrevObjs[i]);
+	    }
+	    ckfree(cachePtr->abbrevObjs);
+	    Tcl_MutexLock(&clockMutex);
+	    if (!tzTablesInitialized) {
+		/*
+		 * Freed by FreeTZTables already.
+		 */
+	    } else if (tablePtr->refCount-- <= 1) {
+		Tcl_DeleteHashEntry(Tcl_FindHashEntry(&tzTables,
+			(char *) tablePtr));
+		ckfree(tablePtr->starts);
+		ckfree(tablePtr);
+	    }
+	    Tcl_MutexUnlock(&clockMutex);
+	}
+	Tcl_DecrRefCount(cachePtr->tzdata);
+	ckfree(cachePtr);
+	Tcl_DeleteHashEntry(hPtr);
+    }
+    dataPtr->lastTZ = NULL;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * LookupTZRow --
+ *
+ *	Packed-table counterpart of LookupLastTransition.
+ *
+ * Results:
+ *	Returns the index of the row in effect at the given time.
+ *
+ * Side effects:
+ *	Remembers the row, which is tried first on the next lookup.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+LookupTZRow(
+    ClockTZCache *cachePtr,	/* Cache entry with a table */
+    Tcl_WideInt tick)		/* Time from the epoch */
+{
+    ClockTZTable *tablePtr = cachePtr->tablePtr;
+    const Tcl_WideInt *starts = tablePtr->starts;
+    int l, u;
+
+    /*
+     * Conversions tend to come in runs of nearby times.
+     */
+
+    l = cachePtr->lastRow;
+    if (tablePtr->sorted && tick >= starts[l]
+	    && (l + 1 == tablePtr->numRows || tick < starts[l + 1])) {
+	return l;
+    }
+
+    if (tick < starts[0]) {
+	return 0;
+    }
+    l = 0;
+    u = tablePtr->numRows - 1;
+    while (l < u) {
+	int m = (l + u + 1) / 2;
+
+	if (tick >= starts[m]) {
+	    l = m;
+	} else {
+	    u = m - 1;
+	}
+    }
+    cachePtr->lastRow = l;
+    return l;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetYearWeekDay --
+ *
+ *	Given a date with Julian Calendar Day, compute the year, week, and day
+ *	in the ISO8601 calendar.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Stores 'iso8601Year', 'iso8601Week' and 'dayOfWeek' in the date
+ *	fields.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+GetYearWeekDay(
+    TclDateFields *fields,	/* Date to convert, must have 'julianDay' */
+    int changeover)		/* Julian Day Number of the Gregorian
+				 * transition */
+{
+    TclDateFields temp;
+    int dayOfFiscalYear;
+
+    /*
+     * Find the given date, minus three days, plus one year. That date's
+     * iso8601 year is an upper bound on the ISO8601 year of the given date.
+     */
+
+    temp.julianDay = fields->julianDay - 3;
+    GetGregorianEraYearDay(&temp, changeover);
+    if (temp.era == BCE) {
+	temp.iso8601Year = temp.year - 1;
+    } else {
+	temp.iso8601Year = temp.year + 1;
+    }
+    temp.iso8601Week = 1;
+    temp.dayOfWeek = 1;
+    GetJulianDayFromEraYearWeekDay(&temp, changeover);
+
+    /*
+     * temp.julianDay is now the start of an ISO8601 year, either the one
+     * corresponding to the given date, or the one after. If we guessed high,
+     * move one year earlier
+     */
+
+    if (fields->julianDay < temp.julianDay) {
+	if (temp.era == BCE) {
+	    temp.iso8601Year += 1;
+	} else {
+	    temp.iso8601Year -= 1;
+	}
+	GetJulianDayFromEraYearWeekDay(&temp, changeover);
+    }
+
+    fields->iso8601Year = temp.iso8601Year;
+    dayOfFiscalYear = fields->julianDay - temp.julianDay;
+    fields->iso8601Week = (dayOfFiscalYear / 7) + 1;
+    fields->dayOfWeek = (dayOfFiscalYear + 1) % 7;
+    if (fields->dayOfWeek < 1) {
+	fields->dayOfWeek += 7;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetGregorianEraYearDay --
+ *
+ *	Given a Julian Day Number, extracts the year and day of the year and
+ *	puts them into TclDateFields, along with the era (BCE or CE) and a
+ *	flag indicating whether the date is Gregorian or Julian.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Stores 'era', 'gregorian', 'year', and 'dayOfYear'.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+GetGregorianEraYearDay(
+    TclDateFields *fields,	/* Date fields containing 'julianDay' */
+    int changeover)		/* Gregorian transition date */
+{
+    int jday = fields->julianDay;
+    int day;
+    int year;
+    int n;
+
+    if (jday >= changeover) {
+	/*
+	 * Gregorian calendar.
+	 */
+
+	fields->gregorian = 1;
+	year = 1;
+
+	/*
+	 * n = Number of 400-year cycles since 1 January, 1 CE in the
+	 * proleptic Gregorian calendar. day = remaining days.
+	 */
+
+	day = jday - JDAY_1_JAN_1_CE_GREGORIAN;
+	n = day / FOUR_CENTURIES;
+	day %= FOUR_CENTURIES;
+	if (day < 0) {
+	    day += FOUR_CENTURIES;
+	    n--;
+	}
+	year += 400 * n;
+
+	/*
+	 * n = number of centuries since the start of (year);
+	 * day = remaining days
 	 */
 
 	n = day / ONE_CENTURY_GREGORIAN;
@@ -1898,27 +2667,1611 @@ ClockParseformatargsObjCmd(
     int objc,			/* Parameter count */
     Tcl_Obj *const objv[])	/* Parameter vector */
 {
-    ClockClientData *dataPtr = (ClockClientData *)clientData;
-    Tcl_Obj **litPtr = dataPtr->literals;
     Tcl_Obj *results[3];	/* Format, locale and timezone */
-#define formatObj results[0]
-#define localeObj results[1]
-#define timezoneObj results[2]
-    int gmtFlag = 0;
-    static const char *const options[] = { /* Command line options expected */
-	"-format",	"-gmt",		"-locale",
-	"-timezone",	NULL };
-    enum optionInd {
-	CLOCK_FORMAT_FORMAT,	CLOCK_FORMAT_GMT,	CLOCK_FORMAT_LOCALE,
-	CLOCK_FORMAT_TIMEZONE
-    };
-    int optionIndex;		/* Index of an option. */
-    int saw = 0;		/* Flag == 1 if option was seen already. */
     Tcl_WideInt clockVal;	/* Clock value - just used to parse. */
-    int i;
+
+    if (ParseFormatArgs((ClockClientData *)clientData, interp, objc, objv,
+	    results, &clockVal) != TCL_OK) {
+	return TCL_ERROR;
+    }
 
     /*
-     * Args consist of a time followed by keyword-value pairs.
+     * Return options as a list.
+     */
+
+    Tcl_SetObjResult(interp, Tcl_NewListObj(3, results));
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ClockFormatObjCmd --
+ *
+ *	Native implementation of [clock format].
+ *
+ * Usage:
+ *	clock format clockval ?-format string? ?-gmt boolean?
+ *		?-locale LOCALE? ?-timezone ZONE?
+ *
+ * Results:
+ *	Returns a standard Tcl result.
+ *
+ * Side effects:
+ *	Compiles the format string and caches the result in its internal
+ *	rep. Formats that the native engine cannot render, and all errors,
+ *	are handed to the scripted implementation, ::tcl::clock::FormatTcl,
+ *	which also takes care of loading clock.tcl, setting up time zones
+ *	that have never been used, and reporting errors.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ClockFormatObjCmd(
+    ClientData clientData,	/* Client data containing literal pool */
+    Tcl_Interp *interp,		/* Tcl interpreter */
+    int objc,			/* Parameter count */
+    Tcl_Obj *const objv[])	/* Parameter vector */
+{
+    ClockClientData *dataPtr = (ClockClientData *)clientData;
+    Tcl_Obj **lit = dataPtr->literals;
+    Tcl_Obj *results[3];	/* Format, locale and timezone */
+    Tcl_Obj *localeObj = NULL, *timezoneObj = NULL, *tzdata;
+    ClockCompiledFormat *cfPtr;
+    TclDateFields fields;
+    Tcl_DString ds;
+    int status;
+
+    if (ParseFormatArgs(dataPtr, interp, objc, objv, results,
+	    &fields.seconds) != TCL_OK
+	    || objv[1]->typePtr == &tclBignumType) {
+	goto scripted;
+    }
+    localeObj = LowerCaseLocale(results[1]);
+    timezoneObj = results[2];
+    if (timezoneObj->length == 0 && TclGetString(timezoneObj)[0] == '\0') {
+	timezoneObj = ClockGetSystemTimeZone(interp, dataPtr);
+	if (timezoneObj == NULL) {
+	    goto scripted;
+	}
+    }
+    Tcl_IncrRefCount(timezoneObj);
+
+    cfPtr = GetCompiledFormat(interp, dataPtr, results[0], localeObj);
+    if (cfPtr == NULL || !cfPtr->formatNative) {
+	goto scripted;
+    }
+    tzdata = Tcl_ObjGetVar2(interp, lit[LIT_TZDATA], timezoneObj,
+	    TCL_GLOBAL_ONLY);
+    if (tzdata == NULL || GetDateFields(interp, dataPtr, &fields, tzdata,
+	    cfPtr->changeover) != TCL_OK) {
+	goto scripted;
+    }
+
+    Tcl_DStringInit(&ds);
+    status = FormatDate(cfPtr, &fields, &ds);
+    Tcl_DecrRefCount(fields.tzName);
+    if (status != TCL_OK) {
+	Tcl_DStringFree(&ds);
+	goto scripted;
+    }
+    Tcl_DStringResult(interp, &ds);
+    Tcl_DecrRefCount(localeObj);
+    Tcl_DecrRefCount(timezoneObj);
+    return TCL_OK;
+
+  scripted:
+    if (localeObj != NULL) {
+	Tcl_DecrRefCount(localeObj);
+    }
+    if (timezoneObj != NULL) {
+	Tcl_DecrRefCount(timezoneObj);
+    }
+    Tcl_ResetResult(interp);
+    return ClockCallScripted(interp, lit[LIT_FORMATTCL], objc, objv);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ClockScanObjCmd --
+ *
+ *	Native implementation of [clock scan].
+ *
+ * Usage:
+ *	clock scan string ?-base seconds? ?-format string? ?-gmt boolean?
+ *		?-locale LOCALE? ?-timezone ZONE?
+ *
+ * Results:
+ *	Returns a standard Tcl result.
+ *
+ * Side effects:
+ *	Compiles the format string and caches the result in its internal
+ *	rep. The native engine handles formats made of literal text and
+ *	numeric groups that fully determine the date; free-form scans, other
+ *	groups, strings that do not match and all errors are handed to the
+ *	scripted implementation, ::tcl::clock::ScanTcl.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ClockScanObjCmd(
+    ClientData clientData,	/* Client data containing literal pool */
+    Tcl_Interp *interp,		/* Tcl interpreter */
+    int objc,			/* Parameter count */
+    Tcl_Obj *const objv[])	/* Parameter vector */
+{
+    ClockClientData *dataPtr = (ClockClientData *)clientData;
+    Tcl_Obj **lit = dataPtr->literals;
+    static const char *const options[] = {
+	"-base",	"-format",	"-gmt",		"-locale",
+	"-timezone",	NULL
+    };
+    enum optionInd {
+	CLOCK_SCAN_BASE,	CLOCK_SCAN_FORMAT,	CLOCK_SCAN_GMT,
+	CLOCK_SCAN_LOCALE,	CLOCK_SCAN_TIMEZONE
+    };
+    Tcl_Obj *formatObj = NULL, *localeObj = lit[LIT_C];
+    Tcl_Obj *timezoneObj = NULL, *tzNameObj = NULL, *tzdata;
+    ClockCompiledFormat *cfPtr;
+    TclDateFields fields;
+    int values[SCANF__END];
+    unsigned seen;
+    Tcl_WideInt base, epoch;
+    int gmtFlag = 0, saw = 0, optionIndex, secondOfDay, i;
+
+    /*
+     * Parse the options. Anything unusual is for the scripted
+     * implementation to diagnose.
+     */
+
+    if (objc < 2 || (objc % 2) != 0) {
+	goto scripted;
+    }
+    for (i = 2; i < objc; i += 2) {
+	if (Tcl_GetIndexFromObj(NULL, objv[i], options, "option", 0,
+		&optionIndex) != TCL_OK) {
+	    goto scripted;
+	}
+	switch (optionIndex) {
+	case CLOCK_SCAN_BASE:
+	    /*
+	     * The native scanner only handles complete dates, but the base
+	     * must still be valid.
+	     */
+
+	    if (TclGetWideIntFromObj(NULL, objv[i+1], &base) != TCL_OK) {
+		goto scripted;
+	    }
+	    break;
+	case CLOCK_SCAN_FORMAT:
+	    formatObj = objv[i+1];
+	    break;
+	case CLOCK_SCAN_GMT:
+	    if (GetStrictBoolean(objv[i+1], &gmtFlag) != TCL_OK) {
+		goto scripted;
+	    }
+	    break;
+	case CLOCK_SCAN_LOCALE:
+	    localeObj = objv[i+1];
+	    break;
+	case CLOCK_SCAN_TIMEZONE:
+	    timezoneObj = objv[i+1];
+	    break;
+	}
+	saw |= 1 << optionIndex;
+    }
+    if (formatObj == NULL || ((saw & (1 << CLOCK_SCAN_GMT))
+	    && (saw & (1 << CLOCK_SCAN_TIMEZONE)))) {
+	goto scripted;
+    }
+    if (gmtFlag) {
+	timezoneObj = lit[LIT_GMT];
+    }
+
+    localeObj = LowerCaseLocale(localeObj);
+    cfPtr = GetCompiledFormat(interp, dataPtr, formatObj, localeObj);
+    Tcl_DecrRefCount(localeObj);
+    if (cfPtr == NULL || !cfPtr->scanNative
+	    || !ScanDate(cfPtr, objv[1], values, &seen, &epoch, &tzNameObj)) {
+	goto scripted;
+    }
+
+    /*
+     * Seconds from the epoch override everything else, and need no time
+     * zone.
+     */
+
+    if (seen & (1 << SCANF_SECONDS)) {
+	if (tzNameObj != NULL) {
+	    Tcl_DecrRefCount(tzNameObj);
+	}
+	Tcl_SetObjResult(interp, Tcl_NewWideIntObj(epoch));
+	return TCL_OK;
+    }
+
+    /*
+     * Otherwise only a complete Gregorian date is handled here; dates that
+     * need the base time are left to the script.
+     */
+
+#define SEEN(f)	(seen & (1 << (f)))
+    if (!SEEN(SCANF_CENTURY) || !SEEN(SCANF_YEAROFCENTURY)
+	    || !SEEN(SCANF_MONTH) || !SEEN(SCANF_DAYOFMONTH)) {
+	goto scriptedTZ;
+    }
+    fields.era = CE;
+    fields.year = 100 * values[SCANF_CENTURY] + values[SCANF_YEAROFCENTURY];
+    fields.month = values[SCANF_MONTH];
+    fields.dayOfMonth = values[SCANF_DAYOFMONTH];
+    GetJulianDayFromEraYearMonthDay(&fields, cfPtr->changeover);
+    if (fields.julianDay > 5373484) {
+	goto scriptedTZ;
+    }
+
+    /*
+     * Time of day, following the priorities of TimeParseActions.
+     */
+
+    secondOfDay = 0;
+    if (SEEN(SCANF_HOUR)) {
+	secondOfDay = values[SCANF_HOUR] * 3600;
+	if (SEEN(SCANF_MINUTE)) {
+	    secondOfDay += values[SCANF_MINUTE] * 60;
+	    if (SEEN(SCANF_SECOND)) {
+		secondOfDay += values[SCANF_SECOND];
+	    }
+	}
+    }
+#undef SEEN
+    fields.localSeconds = -210866803200LL
+	    + SECONDS_PER_DAY * (Tcl_WideInt) fields.julianDay + secondOfDay;
+
+    /*
+     * Convert to UTC in the time zone given in the string, on the command
+     * line, or the system one.
+     */
+
+    if (tzNameObj != NULL) {
+	timezoneObj = tzNameObj;
+    } else if (timezoneObj != NULL) {
+	Tcl_IncrRefCount(timezoneObj);
+    } else {
+	timezoneObj = ClockGetSystemTimeZone(interp, dataPtr);
+	if (timezoneObj == NULL) {
+	    goto scripted;
+	}
+	Tcl_IncrRefCount(timezoneObj);
+    }
+    tzdata = Tcl_ObjGetVar2(interp, lit[LIT_TZDATA], timezoneObj,
+	    TCL_GLOBAL_ONLY);
+    Tcl_DecrRefCount(timezoneObj);
+    if (tzdata == NULL || ConvertLocalToUTC(interp, dataPtr, &fields, tzdata,
+	    cfPtr->changeover) != TCL_OK) {
+	goto scripted;
+    }
+    Tcl_SetObjResult(interp, Tcl_NewWideIntObj(fields.seconds));
+    return TCL_OK;
+
+  scriptedTZ:
+    if (tzNameObj != NULL) {
+	Tcl_DecrRefCount(tzNameObj);
+    }
+  scripted:
+    Tcl_ResetResult(interp);
+    return ClockCallScripted(interp, lit[LIT_SCANTCL], objc, objv);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ClockCallScripted --
+ *
+ *	Hands a [clock format] or [clock scan] over to its scripted
+ *	implementation in clock.tcl.
+ *
+ * Results:
+ *	Returns the result of the scripted command.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ClockCallScripted(
+    Tcl_Interp *interp,		/* Tcl interpreter */
+    Tcl_Obj *cmdObj,		/* Name of the scripted command */
+    int objc,			/* Parameter count */
+    Tcl_Obj *const objv[])	/* Parameter vector */
+{
+    Tcl_Obj *staticv[8], **cmdv = staticv;
+    int status;
+
+    if (objc > 8) {
+	cmdv = (Tcl_Obj **)ckalloc(objc * sizeof(Tcl_Obj *));
+    }
+    cmdv[0] = cmdObj;
+    memcpy(cmdv + 1, objv + 1, (objc - 1) * sizeof(Tcl_Obj *));
+    status = Tcl_EvalObjv(interp, objc, cmdv, 0);
+    if (cmdv != staticv) {
+	ckfree(cmdv);
+    }
+    return status;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * LowerCaseLocale --
+ *
+ *	Does [string tolower] on a locale name.
+ *
+ * Results:
+ *	Returns the locale name with a reference count incremented for the
+ *	caller; usually this is the object that was passed in.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_Obj *
+LowerCaseLocale(
+    Tcl_Obj *localeObj)		/* Locale name */
+{
+    int length;
+    const char *p = TclGetStringFromObj(localeObj, &length);
+    const char *end = p + length;
+
+    while (p < end && !(*p >= 'A' && *p <= 'Z') && !(*p & 0x80)) {
+	p++;
+    }
+    if (p < end) {
+	localeObj = Tcl_NewStringObj(TclGetString(localeObj), length);
+	Tcl_SetObjLength(localeObj, Tcl_UtfToLower(TclGetString(localeObj)));
+    }
+    Tcl_IncrRefCount(localeObj);
+    return localeObj;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetStrictBoolean --
+ *
+ *	Parses a value the way that [string is boolean -strict] accepts it.
+ *
+ * Results:
+ *	Returns TCL_OK and stores the value if the object is a boolean;
+ *	returns TCL_ERROR without leaving a message otherwise. Numbers other
+ *	than 0 and 1 are refused.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+GetStrictBoolean(
+    Tcl_Obj *objPtr,		/* Value to parse */
+    int *boolPtr)		/* Where to store the result */
+{
+    const char *str = TclGetString(objPtr);
+
+    if (isalpha(UCHAR(*str)) || ((*str == '0' || *str == '1')
+	    && str[1] == '\0')) {
+	return Tcl_GetBooleanFromObj(NULL, objPtr, boolPtr);
+    }
+    return TCL_ERROR;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ClockGetSystemTimeZone --
+ *
+ *	Returns the result of ::tcl::clock::GetSystemTimeZone, memoized for
+ *	as long as the environment and the clock caches do not change, and at
+ *	most for a second, like TzsetIfNecessary does for TZ.
+ *
+ * Results:
+ *	Returns the time zone name, or NULL if clock.tcl is not loaded or the
+ *	script failed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_Obj *
+ClockGetSystemTimeZone(
+    Tcl_Interp *interp,		/* Tcl interpreter */
+    ClockClientData *dataPtr)	/* Client data of [clock] */
+{
+    Tcl_Obj *cmdObj = dataPtr->literals[LIT_GETSYSTEMTIMEZONE];
+    Tcl_Time now;
+
+    Tcl_GetTime(&now);
+    if (dataPtr->systemTZ != NULL && dataPtr->systemTZEpoch == dataPtr->epoch
+	    && dataPtr->systemTZEnvEpoch == TclEnvEpoch
+	    && dataPtr->systemTZRefresh == now.sec) {
+	return dataPtr->systemTZ;
+    }
+    if (Tcl_FindCommand(interp, TclGetString(cmdObj), NULL,
+	    TCL_GLOBAL_ONLY) == NULL
+	    || Tcl_EvalObjv(interp, 1, &cmdObj, TCL_EVAL_GLOBAL) != TCL_OK) {
+	return NULL;
+    }
+    if (dataPtr->systemTZ != NULL) {
+	Tcl_DecrRefCount(dataPtr->systemTZ);
+    }
+    dataPtr->systemTZ = Tcl_GetObjResult(interp);
+    Tcl_IncrRefCount(dataPtr->systemTZ);
+    Tcl_ResetResult(interp);
+    dataPtr->systemTZEpoch = dataPtr->epoch;
+    dataPtr->systemTZEnvEpoch = TclEnvEpoch;
+    dataPtr->systemTZRefresh = now.sec;
+    return dataPtr->systemTZ;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetCompiledFormat --
+ *
+ *	Finds or makes the compiled form of a format string in a locale.
+ *
+ * Results:
+ *	Returns the compiled format, or NULL if it could not be made; in
+ *	that case the caller should let the scripted implementation report
+ *	the problem.
+ *
+ * Side effects:
+ *	Caches the compiled format in the internal rep of the format object
+ *	and in the interpreter's format cache.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static ClockCompiledFormat *
+GetCompiledFormat(
+    Tcl_Interp *interp,		/* Tcl interpreter */
+    ClockClientData *dataPtr,	/* Client data of [clock] */
+    Tcl_Obj *formatObj,		/* Format string */
+    Tcl_Obj *localeObj)		/* Locale, in lower case */
+{
+    ClockCompiledFormat *cfPtr;
+    Tcl_Obj *keyv[2], *keyObj;
+    Tcl_HashEntry *hPtr;
+    int isNew;
+
+    if (formatObj->typePtr == &clockFormatType) {
+	cfPtr = (ClockCompiledFormat *)
+		formatObj->internalRep.twoPtrValue.ptr1;
+	if (cfPtr->epoch == dataPtr->epoch && (cfPtr->localeObj == localeObj
+		|| strcmp(TclGetString(cfPtr->localeObj),
+			TclGetString(localeObj)) == 0)) {
+	    return cfPtr;
+	}
+    }
+
+    keyv[0] = formatObj;
+    keyv[1] = localeObj;
+    keyObj = Tcl_NewListObj(2, keyv);
+    Tcl_IncrRefCount(keyObj);
+    hPtr = Tcl_FindHashEntry(&dataPtr->formatCache, (char *) keyObj);
+    if (hPtr != NULL) {
+	cfPtr = (ClockCompiledFormat *)Tcl_GetHashValue(hPtr);
+    } else {
+	cfPtr = CompileFormat(interp, dataPtr, formatObj, localeObj);
+	if (cfPtr != NULL && cfPtr->epoch != dataPtr->epoch) {
+	    /*
+	     * The caches were cleared by the scripts that compiling ran.
+	     */
+
+	    ReleaseCompiledFormat(cfPtr);
+	    cfPtr = NULL;
+	}
+	if (cfPtr == NULL) {
+	    Tcl_DecrRefCount(keyObj);
+	    return NULL;
+	}
+	hPtr = Tcl_CreateHashEntry(&dataPtr->formatCache, (char *) keyObj,
+		&isNew);
+	cfPtr->refCount++;
+	Tcl_SetHashValue(hPtr, cfPtr);
+    }
+    Tcl_DecrRefCount(keyObj);
+
+    (void) TclGetString(formatObj);
+    cfPtr->refCount++;
+    TclFreeIntRep(formatObj);
+    formatObj->internalRep.twoPtrValue.ptr1 = cfPtr;
+    formatObj->typePtr = &clockFormatType;
+    return cfPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * CompileFormat --
+ *
+ *	Compiles a format string for the native [clock format] and
+ *	[clock scan].
+ *
+ * Results:
+ *	Returns a new compiled format with a reference count of zero, or NULL
+ *	if clock.tcl is not loaded or the locale data could not be obtained.
+ *	A format that the native engines cannot handle still compiles, with
+ *	its formatNative or scanNative flag cleared.
+ *
+ * Side effects:
+ *	Runs ::tcl::clock::GetFormatLocaleData, which may load the locale's
+ *	message catalog.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static ClockCompiledFormat *
+CompileFormat(
+    Tcl_Interp *interp,		/* Tcl interpreter */
+    ClockClientData *dataPtr,	/* Client data of [clock] */
+    Tcl_Obj *formatObj,		/* Format string */
+    Tcl_Obj *localeObj)		/* Locale, in lower case */
+{
+    Tcl_Obj **lit = dataPtr->literals;
+    Tcl_Obj *cmdv[3], *localeData, **locv;
+    ClockCompiledFormat *cfPtr;
+    const char *format;
+    int locc, length, i;
+
+    /*
+     * The message catalogs are only reachable from the script level, so
+     * ask clock.tcl for the localized format and everything that rendering
+     * it can need.
+     */
+
+    if (Tcl_FindCommand(interp, TclGetString(lit[LIT_GETFORMATLOCALEDATA]),
+	    NULL, TCL_GLOBAL_ONLY) == NULL) {
+	return NULL;
+    }
+    cmdv[0] = lit[LIT_GETFORMATLOCALEDATA];
+    cmdv[1] = formatObj;
+    cmdv[2] = localeObj;
+    if (Tcl_EvalObjv(interp, 3, cmdv, TCL_EVAL_GLOBAL) != TCL_OK) {
+	return NULL;
+    }
+    localeData = Tcl_GetObjResult(interp);
+    if (TclListObjGetElements(NULL, localeData, &locc, &locv) != TCL_OK
+	    || locc != LOC__END) {
+	return NULL;
+    }
+    Tcl_IncrRefCount(localeData);
+    Tcl_ResetResult(interp);
+
+    cfPtr = (ClockCompiledFormat *)ckalloc(sizeof(ClockCompiledFormat));
+    memset(cfPtr, 0, sizeof(ClockCompiledFormat));
+    cfPtr->epoch = dataPtr->epoch;
+    cfPtr->localeObj = localeObj;
+    Tcl_IncrRefCount(localeObj);
+    cfPtr->localeData = localeData;
+    for (i = 0; i < 2; i++) {
+	Tcl_Obj *objPtr = Tcl_NewStringObj(TclGetString(locv[LOC_AM + i]),
+		-1);
+
+	Tcl_SetObjLength(objPtr, Tcl_UtfToUpper(TclGetString(objPtr)));
+	Tcl_IncrRefCount(objPtr);
+	cfPtr->upperAmPm[i] = objPtr;
+    }
+    if (TclGetIntFromObj(NULL, locv[LOC_CHANGEOVER],
+	    &cfPtr->changeover) == TCL_OK) {
+	format = TclGetStringFromObj(locv[LOC_FORMAT], &length);
+	CompileFormatTokens(cfPtr, format, length);
+	CompileScanTokens(cfPtr, format, length);
+    }
+    return cfPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * CompileFormatTokens --
+ *
+ *	Splits a localized format string into the groups that FormatDate
+ *	renders. Mirrors ParseClockFormatFormat2 in clock.tcl.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Fills in the format tokens of the compiled format and sets its
+ *	formatNative flag.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+CompileFormatTokens(
+    ClockCompiledFormat *cfPtr,	/* Compiled format to fill in */
+    const char *format,		/* Localized format string */
+    int length)			/* Length of the format string */
+{
+    ClockFormatToken *tokens;
+    Tcl_DString lits;
+    int numTokens = 0, state = 0, needEras = 0, native = 1, i;
+    const char *p, *end = format + length;
+    ClockFormatGroup group;
+
+    tokens = (ClockFormatToken *)
+	    ckalloc(sizeof(ClockFormatToken) * (length + 1));
+    Tcl_DStringInit(&lits);
+
+#define APPEND_LITERAL(str, len) \
+    do {								\
+	if (numTokens == 0 || tokens[numTokens-1].group != FMT_LITERAL) { \
+	    tokens[numTokens].group = FMT_LITERAL;			\
+	    tokens[numTokens].litStart = Tcl_DStringLength(&lits);	\
+	    tokens[numTokens++].litLength = 0;				\
+	}								\
+	Tcl_DStringAppend(&lits, (str), (len));				\
+	tokens[numTokens-1].litLength += (len);				\
+    } while (0)
+
+    for (p = format; p < end; p++) {
+	switch (state) {
+	case 0:
+	    if (*p == '%') {
+		state = '%';
+	    } else {
+		APPEND_LITERAL(p, 1);
+	    }
+	    continue;
+	case '%':
+	    state = 0;
+	    switch (*p) {
+	    case 'a': group = FMT_DAYNAME_ABBREV; break;
+	    case 'A': group = FMT_DAYNAME; break;
+	    case 'b': case 'h': group = FMT_MONTHNAME_ABBREV; break;
+	    case 'B': group = FMT_MONTHNAME; break;
+	    case 'C': group = FMT_CENTURY; break;
+	    case 'd': group = FMT_DAY; break;
+	    case 'e': group = FMT_DAY_SPACE; break;
+	    case 'g': group = FMT_ISO_YEAR2; break;
+	    case 'G': group = FMT_ISO_YEAR; break;
+	    case 'H': group = FMT_HOUR; break;
+	    case 'I': group = FMT_HOUR12; break;
+	    case 'j': group = FMT_YDAY; break;
+	    case 'J': group = FMT_JULIAN; break;
+	    case 'k': group = FMT_HOUR_SPACE; break;
+	    case 'l': group = FMT_HOUR12_SPACE; break;
+	    case 'm': group = FMT_MONTH; break;
+	    case 'M': group = FMT_MINUTE; break;
+	    case 'N': group = FMT_MONTH_SPACE; break;
+	    case 'p': group = FMT_AMPM_UPPER; break;
+	    case 'P': group = FMT_AMPM; break;
+	    case 'Q': group = FMT_STARDATE; break;
+	    case 's': group = FMT_EPOCH; break;
+	    case 'S': group = FMT_SECOND; break;
+	    case 'u': group = FMT_WDAY_MON; break;
+	    case 'U': group = FMT_WEEK_SUN; break;
+	    case 'V': group = FMT_ISO_WEEK; break;
+	    case 'w': group = FMT_WDAY_SUN; break;
+	    case 'W': group = FMT_WEEK_MON; break;
+	    case 'y': group = FMT_YEAR2; break;
+	    case 'Y': group = FMT_YEAR; break;
+	    case 'z': group = FMT_TZ_NUMERIC; break;
+	    case 'Z': group = FMT_TZ_NAME; break;
+	    case 'E':
+	    case 'O':
+		state = *p;
+		continue;
+	    case '%':
+		APPEND_LITERAL("%", 1);
+		continue;
+	    case 'n':
+		APPEND_LITERAL("\n", 1);
+		continue;
+	    case 't':
+		APPEND_LITERAL("\t", 1);
+		continue;
+	    default:
+		APPEND_LITERAL("%", 1);
+		APPEND_LITERAL(p, 1);
+		continue;
+	    }
+	    break;
+	case 'E':
+	    state = 0;
+	    switch (*p) {
+	    case 'E': group = FMT_ERA; break;
+	    case 'C': group = FMT_LOCALE_ERA; needEras = 1; break;
+	    case 'y': group = FMT_LOCALE_ERA_YEAR; needEras = 1; break;
+	    default:
+		if (*p == '%') {
+		    native = 0;
+		}
+		APPEND_LITERAL("%E", 2);
+		APPEND_LITERAL(p, 1);
+		continue;
+	    }
+	    break;
+	default:		/* 'O' */
+	    state = 0;
+	    switch (*p) {
+	    case 'd': case 'e': group = FMT_NUM_DAY; break;
+	    case 'H': case 'k': group = FMT_NUM_HOUR; break;
+	    case 'I': case 'l': group = FMT_NUM_HOUR12; break;
+	    case 'm': group = FMT_NUM_MONTH; break;
+	    case 'M': group = FMT_NUM_MINUTE; break;
+	    case 'S': group = FMT_NUM_SECOND; break;
+	    case 'u': group = FMT_NUM_WDAY_MON; break;
+	    case 'w': group = FMT_NUM_WDAY_SUN; break;
+	    case 'y': group = FMT_NUM_YEAR2; break;
+	    default:
+		if (*p == '%') {
+		    native = 0;
+		}
+		APPEND_LITERAL("%O", 2);
+		APPEND_LITERAL(p, 1);
+		continue;
+	    }
+	    break;
+	}
+	tokens[numTokens++].group = group;
+    }
+
+    /*
+     * A trailing '%' stands for itself; a trailing %E or %O vanishes, as it
+     * does in the scripted implementation.
+     */
+
+    if (state == '%') {
+	APPEND_LITERAL("%", 1);
+    }
+#undef APPEND_LITERAL
+
+    cfPtr->formatTokens = tokens;
+    cfPtr->numFormatTokens = numTokens;
+    cfPtr->literals = (char *)ckalloc(Tcl_DStringLength(&lits) + 1);
+    memcpy(cfPtr->literals, Tcl_DStringValue(&lits),
+	    Tcl_DStringLength(&lits) + 1);
+    Tcl_DStringFree(&lits);
+
+    /*
+     * The scripted implementation copies the character after an unknown
+     * %E or %O group into its [format] string verbatim. When that is a
+     * '%', the result depends on what follows, so leave it to the script.
+     */
+
+    cfPtr->formatNative = native;
+
+    /*
+     * The locale's alternative eras are needed for %EC and %Ey. A table
+     * that does not parse is left to the script to complain about.
+     */
+
+    if (needEras) {
+	Tcl_Obj **locv, **erav, **fieldv;
+	int locc, erac, fieldc;
+
+	TclListObjGetElements(NULL, cfPtr->localeData, &locc, &locv);
+	if (TclListObjGetElements(NULL, locv[LOC_ERAS], &erac,
+		&erav) != TCL_OK) {
+	    cfPtr->formatNative = 0;
+	    return;
+	}
+	cfPtr->localeEras = (ClockLocaleEra *)
+		ckalloc(sizeof(ClockLocaleEra) * (erac + 1));
+	for (i = 0; i < erac; i++) {
+	    if (TclListObjGetElements(NULL, erav[i], &fieldc,
+		    &fieldv) != TCL_OK || fieldc < 3
+		    || TclGetWideIntFromObj(NULL, fieldv[0],
+			&cfPtr->localeEras[i].start) != TCL_OK
+		    || TclGetIntFromObj(NULL, fieldv[2],
+			&cfPtr->localeEras[i].year) != TCL_OK) {
+		cfPtr->formatNative = 0;
+		break;
+	    }
+	    cfPtr->localeEras[i].name = fieldv[1];
+	    Tcl_IncrRefCount(fieldv[1]);
+	    cfPtr->numEras++;
+	}
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * CompileScanTokens --
+ *
+ *	Compiles a localized format string into the recognizer used by
+ *	ScanDate. Mirrors the regular expressions that ParseClockScanFormat
+ *	in clock.tcl builds, for the groups the native engine supports.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Fills in the scan tokens of the compiled format and sets its
+ *	scanNative flag if all the groups are supported.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+CompileScanTokens(
+    ClockCompiledFormat *cfPtr,	/* Compiled format to fill in */
+    const char *format,		/* Localized format string */
+    int length)			/* Length of the format string */
+{
+    ClockScanToken *tokens, *tokPtr;
+    const char *p = format, *end = format + length;
+    int numTokens = 0, percent = 0, n;
+    Tcl_UniChar ch = 0;
+
+    tokens = (ClockScanToken *)
+	    ckalloc(sizeof(ClockScanToken) * (length + 1));
+    while (p < end) {
+	p += TclUtfToUniChar(p, &ch);
+	tokPtr = tokens + numTokens++;
+	tokPtr->element = SCAN_LITERAL;
+	tokPtr->ch = ch;
+
+	/*
+	 * Runs of white space in the format condense to a single space.
+	 */
+
+	if (Tcl_UniCharIsSpace(ch)) {
+	    p = SkipSpaces(p, end);
+	    tokPtr->element = percent ? SCAN_OPT_SPACES : SCAN_SPACES;
+	    percent = 0;
+	    continue;
+	}
+	if (!percent) {
+	    if (ch == '%') {
+		percent = 1;
+		numTokens--;
+	    } else {
+		tokPtr->ch = Tcl_UniCharToLower(ch);
+	    }
+	    continue;
+	}
+	percent = 0;
+	tokPtr->element = SCAN_NUMBER;
+	tokPtr->minDigits = 1;
+	tokPtr->maxDigits = 2;
+	switch (ch) {
+	case '%':
+	    tokPtr->element = SCAN_LITERAL;
+	    break;
+	case 'n':
+	    tokPtr->element = SCAN_LITERAL;
+	    tokPtr->ch = '\n';
+	    break;
+	case 't':
+	    tokPtr->element = SCAN_LITERAL;
+	    tokPtr->ch = '\t';
+	    break;
+	case 'C':
+	    tokPtr->field = SCANF_CENTURY;
+	    break;
+	case 'd': case 'e':
+	    tokPtr->field = SCANF_DAYOFMONTH;
+	    break;
+	case 'H': case 'k':
+	    tokPtr->field = SCANF_HOUR;
+	    break;
+	case 'm': case 'N':
+	    tokPtr->field = SCANF_MONTH;
+	    break;
+	case 'M':
+	    tokPtr->field = SCANF_MINUTE;
+	    break;
+	case 'S':
+	    tokPtr->field = SCANF_SECOND;
+	    break;
+	case 'y':
+	    tokPtr->field = SCANF_YEAROFCENTURY;
+	    break;
+	case 'Y':
+	    tokPtr->field = SCANF_YEAR;
+	    tokPtr->minDigits = tokPtr->maxDigits = 4;
+	    break;
+	case 's':
+	    tokPtr->element = SCAN_EPOCH;
+	    break;
+	case 'z': case 'Z':
+	    tokPtr->element = SCAN_TZ_NUMERIC;
+	    break;
+	default:
+	    /*
+	     * Names, week-based dates, locale numerals and so on are for the
+	     * scripted scanner.
+	     */
+
+	    ckfree(tokens);
+	    return;
+	}
+    }
+    if (percent) {
+	tokPtr = tokens + numTokens++;
+	tokPtr->element = SCAN_LITERAL;
+	tokPtr->ch = '%';
+    }
+
+    /*
+     * The matcher does not backtrack, so a numeric time zone directly
+     * followed by digits is left to the regular expression engine.
+     */
+
+    for (n = 0; n + 1 < numTokens; n++) {
+	if (tokens[n].element == SCAN_TZ_NUMERIC
+		&& (tokens[n+1].element == SCAN_NUMBER
+		|| tokens[n+1].element == SCAN_EPOCH)) {
+	    ckfree(tokens);
+	    return;
+	}
+    }
+    cfPtr->scanTokens = tokens;
+    cfPtr->numScanTokens = numTokens;
+    cfPtr->scanNative = 1;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ReleaseCompiledFormat, FreeClockFormatInternalRep,
+ * DupClockFormatInternalRep --
+ *
+ *	Reference management of compiled formats, and the internal rep
+ *	procedures of the "clockFormat" Tcl_ObjType.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+ReleaseCompiledFormat(
+    ClockCompiledFormat *cfPtr)	/* Compiled format */
+{
+    int i;
+
+    if (cfPtr->refCount-- > 1) {
+	return;
+    }
+    Tcl_DecrRefCount(cfPtr->localeObj);
+    Tcl_DecrRefCount(cfPtr->localeData);
+    for (i = 0; i < 2; i++) {
+	Tcl_DecrRefCount(cfPtr->upperAmPm[i]);
+    }
+    for (i = 0; i < cfPtr->numEras; i++) {
+	Tcl_DecrRefCount(cfPtr->localeEras[i].name);
+    }
+    if (cfPtr->localeEras != NULL) {
+	ckfree(cfPtr->localeEras);
+    }
+    if (cfPtr->formatTokens != NULL) {
+	ckfree(cfPtr->formatTokens);
+	ckfree(cfPtr->literals);
+    }
+    if (cfPtr->scanTokens != NULL) {
+	ckfree(cfPtr->scanTokens);
+    }
+    ckfree(cfPtr);
+}
+
+static void
+FreeClockFormatInternalRep(
+    Tcl_Obj *objPtr)
+{
+    ReleaseCompiledFormat((ClockCompiledFormat *)
+	    objPtr->internalRep.twoPtrValue.ptr1);
+    objPtr->typePtr = NULL;
+}
+
+static void
+DupClockFormatInternalRep(
+    Tcl_Obj *srcPtr,
+    Tcl_Obj *dupPtr)
+{
+    ClockCompiledFormat *cfPtr = (ClockCompiledFormat *)
+	    srcPtr->internalRep.twoPtrValue.ptr1;
+
+    cfPtr->refCount++;
+    dupPtr->internalRep.twoPtrValue.ptr1 = cfPtr;
+    dupPtr->typePtr = &clockFormatType;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ClockClearNativeCaches --
+ *
+ *	Discards the compiled formats, time zone tables and memoized system
+ *	time zone of an interpreter, and starts a new cache generation so that
+ *	compiled formats still held in internal reps are not used again.
+ *
+ * Results:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+ClockClearNativeCaches(
+    ClockClientData *dataPtr)	/* Client data of [clock] */
+{
+    Tcl_HashEntry *hPtr;
+    Tcl_HashSearch search;
+
+    for (hPtr = Tcl_FirstHashEntry(&dataPtr->formatCache, &search);
+	    hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+	ReleaseCompiledFormat((ClockCompiledFormat *)Tcl_GetHashValue(hPtr));
+	Tcl_DeleteHashEntry(hPtr);
+    }
+    if (dataPtr->systemTZ != NULL) {
+	Tcl_DecrRefCount(dataPtr->systemTZ);
+	dataPtr->systemTZ = NULL;
+    }
+    ClearTZCache(dataPtr);
+    Tcl_MutexLock(&clockMutex);
+    dataPtr->epoch = ++clockCacheEpoch;
+    Tcl_MutexUnlock(&clockMutex);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ClockClearnativecachesObjCmd --
+ *
+ *	Tcl command that discards the compiled formats of the native
+ *	[clock format] and [clock scan]. Called from ClearCaches and
+ *	ChangeCurrentLocale in clock.tcl.
+ *
+ * Usage:
+ *	::tcl::clock::ClearNativeCaches
+ *
+ * Results:
+ *	Returns a standard Tcl result.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ClockClearnativecachesObjCmd(
+    ClientData clientData,	/* Client data containing literal pool */
+    Tcl_Interp *interp,		/* Tcl interpreter */
+    int objc,			/* Parameter count */
+    Tcl_Obj *const objv[])	/* Parameter vector */
+{
+    if (objc != 1) {
+	Tcl_WrongNumArgs(interp, 1, objv, NULL);
+	return TCL_ERROR;
+    }
+    ClockClearNativeCaches((ClockClientData *)clientData);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FormatDate --
+ *
+ *	Renders the fields of a date according to a compiled format. Mirrors
+ *	the procedures built by ParseClockFormatFormat2 in clock.tcl.
+ *
+ * Results:
+ *	Returns TCL_OK, or TCL_ERROR (without a message) if the locale data
+ *	turned out to be malformed.
+ *
+ * Side effects:
+ *	Appends the formatted date to the string.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static inline int
+FloorDiv(
+    int a,
+    int b)
+{
+    return a / b - ((a % b) < 0);
+}
+
+static inline int
+FloorMod(
+    int a,
+    int b)
+{
+    int r = a % b;
+
+    return (r < 0) ? r + b : r;
+}
+
+static int
+AppendListElement(
+    Tcl_DString *dsPtr,		/* String to append to */
+    Tcl_Obj *listObj,		/* List */
+    int index)			/* Index of the element; out of range ones
+				 * append nothing, like [lindex] */
+{
+    Tcl_Obj *elemObj;
+    int length;
+    const char *bytes;
+
+    if (Tcl_ListObjIndex(NULL, listObj, index, &elemObj) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    if (elemObj != NULL) {
+	bytes = TclGetStringFromObj(elemObj, &length);
+	Tcl_DStringAppend(dsPtr, bytes, length);
+    }
+    return TCL_OK;
+}
+
+static void
+AppendFormattedInt(
+    Tcl_DString *dsPtr,		/* String to append to */
+    const char *format,		/* sprintf format with one int conversion */
+    int value)			/* Value to format */
+{
+    char buf[TCL_INTEGER_SPACE + 8];
+
+    Tcl_DStringAppend(dsPtr, buf, sprintf(buf, format, value));
+}
+
+static void
+AppendObj(
+    Tcl_DString *dsPtr,		/* String to append to */
+    Tcl_Obj *objPtr)		/* Value to append */
+{
+    int length;
+    const char *bytes = TclGetStringFromObj(objPtr, &length);
+
+    Tcl_DStringAppend(dsPtr, bytes, length);
+}
+
+static int
+FormatDate(
+    ClockCompiledFormat *cfPtr,	/* Compiled format */
+    TclDateFields *fields,	/* Date to render */
+    Tcl_DString *dsPtr)		/* String to append to */
+{
+    Tcl_Obj **locv;
+    ClockFormatToken *tokPtr, *endPtr;
+    int locc, secondOfDay, hour12, eraIndex = -2, value, status = TCL_OK;
+    char buf[TCL_INTEGER_SPACE + 16];
+
+    TclListObjGetElements(NULL, cfPtr->localeData, &locc, &locv);
+    secondOfDay = (int) (fields->localSeconds % SECONDS_PER_DAY);
+    if (secondOfDay < 0) {
+	secondOfDay += SECONDS_PER_DAY;
+    }
+    hour12 = ((secondOfDay + SECONDS_PER_DAY - 3600) / 3600) % 12 + 1;
+
+    endPtr = cfPtr->formatTokens + cfPtr->numFormatTokens;
+    for (tokPtr = cfPtr->formatTokens; tokPtr < endPtr; tokPtr++) {
+	switch (tokPtr->group) {
+	case FMT_LITERAL:
+	    Tcl_DStringAppend(dsPtr, cfPtr->literals + tokPtr->litStart,
+		    tokPtr->litLength);
+	    break;
+	case FMT_DAYNAME_ABBREV:
+	    status = AppendListElement(dsPtr, locv[LOC_DAYS_ABBREV],
+		    fields->dayOfWeek % 7);
+	    break;
+	case FMT_DAYNAME:
+	    status = AppendListElement(dsPtr, locv[LOC_DAYS_FULL],
+		    fields->dayOfWeek % 7);
+	    break;
+	case FMT_MONTHNAME_ABBREV:
+	    status = AppendListElement(dsPtr, locv[LOC_MONTHS_ABBREV],
+		    fields->month - 1);
+	    break;
+	case FMT_MONTHNAME:
+	    status = AppendListElement(dsPtr, locv[LOC_MONTHS_FULL],
+		    fields->month - 1);
+	    break;
+	case FMT_CENTURY:
+	    AppendFormattedInt(dsPtr, "%02d", FloorDiv(fields->year, 100));
+	    break;
+	case FMT_DAY:
+	    AppendFormattedInt(dsPtr, "%02d", fields->dayOfMonth);
+	    break;
+	case FMT_DAY_SPACE:
+	    AppendFormattedInt(dsPtr, "%2d", fields->dayOfMonth);
+	    break;
+	case FMT_ISO_YEAR2:
+	    AppendFormattedInt(dsPtr, "%02d",
+		    FloorMod(fields->iso8601Year, 100));
+	    break;
+	case FMT_ISO_YEAR:
+	    AppendFormattedInt(dsPtr, "%02d", fields->iso8601Year);
+	    break;
+	case FMT_HOUR:
+	    AppendFormattedInt(dsPtr, "%02d", secondOfDay / 3600);
+	    break;
+	case FMT_HOUR12:
+	    AppendFormattedInt(dsPtr, "%02d", hour12);
+	    break;
+	case FMT_YDAY:
+	    AppendFormattedInt(dsPtr, "%03d", fields->dayOfYear);
+	    break;
+	case FMT_JULIAN:
+	    AppendFormattedInt(dsPtr, "%07d", fields->julianDay);
+	    break;
+	case FMT_HOUR_SPACE:
+	    AppendFormattedInt(dsPtr, "%2d", secondOfDay / 3600);
+	    break;
+	case FMT_HOUR12_SPACE:
+	    AppendFormattedInt(dsPtr, "%2d", hour12);
+	    break;
+	case FMT_MONTH:
+	    AppendFormattedInt(dsPtr, "%02d", fields->month);
+	    break;
+	case FMT_MINUTE:
+	    AppendFormattedInt(dsPtr, "%02d", secondOfDay / 60 % 60);
+	    break;
+	case FMT_MONTH_SPACE:
+	    AppendFormattedInt(dsPtr, "%2d", fields->month);
+	    break;
+	case FMT_AMPM_UPPER:
+	    AppendObj(dsPtr, cfPtr->upperAmPm[secondOfDay >= 43200]);
+	    break;
+	case FMT_AMPM:
+	    AppendObj(dsPtr, locv[secondOfDay < 43200 ? LOC_AM : LOC_PM]);
+	    break;
+	case FMT_STARDATE:
+	    /*
+	     * Hi, Jeff! See FormatStarDate in clock.tcl.
+	     */
+
+	    Tcl_DStringAppend(dsPtr, buf, sprintf(buf,
+		    "Stardate %02d%03d.%1d", fields->year - 1946,
+		    1000 * (fields->dayOfYear - 1)
+			    / (IsGregorianLeapYear(fields) ? 366 : 365),
+		    secondOfDay / (SECONDS_PER_DAY / 10)));
+	    break;
+	case FMT_EPOCH:
+	    Tcl_DStringAppend(dsPtr, buf, sprintf(buf,
+		    "%" TCL_LL_MODIFIER "d", fields->seconds));
+	    break;
+	case FMT_SECOND:
+	    AppendFormattedInt(dsPtr, "%02d", secondOfDay % 60);
+	    break;
+	case FMT_WDAY_MON:
+	    AppendFormattedInt(dsPtr, "%1d", fields->dayOfWeek);
+	    break;
+	case FMT_WEEK_SUN:
+	    AppendFormattedInt(dsPtr, "%02d", FloorDiv(fields->dayOfYear
+		    - (fields->dayOfWeek % 7 + 1) + 7, 7));
+	    break;
+	case FMT_ISO_WEEK:
+	    AppendFormattedInt(dsPtr, "%02d", fields->iso8601Week);
+	    break;
+	case FMT_WDAY_SUN:
+	    AppendFormattedInt(dsPtr, "%1d", fields->dayOfWeek % 7);
+	    break;
+	case FMT_WEEK_MON:
+	    AppendFormattedInt(dsPtr, "%02d", FloorDiv(fields->dayOfYear
+		    - fields->dayOfWeek + 7, 7));
+	    break;
+	case FMT_YEAR2:
+	    AppendFormattedInt(dsPtr, "%02d", FloorMod(fields->year, 100));
+	    break;
+	case FMT_YEAR:
+	    AppendFormattedInt(dsPtr, "%04d", fields->year);
+	    break;
+	case FMT_TZ_NUMERIC:
+	    value = fields->tzOffset;
+	    Tcl_DStringAppend(dsPtr, (value < 0) ? "-" : "+", 1);
+	    if (value < 0) {
+		value = -value;
+	    }
+	    AppendFormattedInt(dsPtr, "%02d", value / 3600);
+	    AppendFormattedInt(dsPtr, "%02d", value % 3600 / 60);
+	    if (value % 60 != 0) {
+		AppendFormattedInt(dsPtr, "%02d", value % 60);
+	    }
+	    break;
+	case FMT_TZ_NAME:
+	    AppendObj(dsPtr, fields->tzName);
+	    break;
+	case FMT_ERA:
+	    AppendObj(dsPtr, locv[fields->era == BCE ? LOC_BCE : LOC_CE]);
+	    break;
+	case FMT_LOCALE_ERA:
+	case FMT_LOCALE_ERA_YEAR:
+	    /*
+	     * Find the last era beginning at or before the date, as
+	     * GetLocaleEra does.
+	     */
+
+	    if (eraIndex == -2) {
+		ClockLocaleEra *eras = cfPtr->localeEras;
+		int l = 0, u = cfPtr->numEras - 1, m;
+
+		if (cfPtr->numEras == 0
+			|| fields->localSeconds < eras[0].start) {
+		    eraIndex = -1;
+		} else {
+		    while (l < u) {
+			m = (l + u + 1) / 2;
+			if (fields->localSeconds >= eras[m].start) {
+			    l = m;
+			} else {
+			    u = m - 1;
+			}
+		    }
+		    eraIndex = l;
+		}
+	    }
+	    if (tokPtr->group == FMT_LOCALE_ERA) {
+		if (eraIndex < 0) {
+		    AppendFormattedInt(dsPtr, "%02d",
+			    FloorDiv(fields->year, 100));
+		} else {
+		    AppendObj(dsPtr, cfPtr->localeEras[eraIndex].name);
+		}
+		break;
+	    }
+	    value = (eraIndex < 0) ? FloorMod(fields->year, 100)
+		    : fields->year - cfPtr->localeEras[eraIndex].year;
+	    if (value >= 0 && value < 100) {
+		status = AppendListElement(dsPtr, locv[LOC_NUMERALS], value);
+	    } else {
+		AppendFormattedInt(dsPtr, "%d", value);
+	    }
+	    break;
+	case FMT_NUM_DAY:
+	    status = AppendListElement(dsPtr, locv[LOC_NUMERALS],
+		    fields->dayOfMonth);
+	    break;
+	case FMT_NUM_HOUR:
+	    status = AppendListElement(dsPtr, locv[LOC_NUMERALS],
+		    secondOfDay / 3600);
+	    break;
+	case FMT_NUM_HOUR12:
+	    status = AppendListElement(dsPtr, locv[LOC_NUMERALS], hour12);
+	    break;
+	case FMT_NUM_MONTH:
+	    status = AppendListElement(dsPtr, locv[LOC_NUMERALS],
+		    fields->month);
+	    break;
+	case FMT_NUM_MINUTE:
+	    status = AppendListElement(dsPtr, locv[LOC_NUMERALS],
+		    secondOfDay / 60 % 60);
+	    break;
+	case FMT_NUM_SECOND:
+	    status = AppendListElement(dsPtr, locv[LOC_NUMERALS],
+		    secondOfDay % 60);
+	    break;
+	case FMT_NUM_WDAY_MON:
+	    status = AppendListElement(dsPtr, locv[LOC_NUMERALS],
+		    fields->dayOfWeek);
+	    break;
+	case FMT_NUM_WDAY_SUN:
+	    status = AppendListElement(dsPtr, locv[LOC_NUMERALS],
+		    fields->dayOfWeek % 7);
+	    break;
+	case FMT_NUM_YEAR2:
+	    status = AppendListElement(dsPtr, locv[LOC_NUMERALS],
+		    FloorMod(fields->year, 100));
+	    break;
+	}
+	if (status != TCL_OK) {
+	    return TCL_ERROR;
+	}
+    }
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ScanDate --
+ *
+ *	Matches a string against a compiled format's recognizer. Matching is
+ *	greedy without backtracking; a string that would need backtracking
+ *	is reported as not matching, so the scripted scanner (whose regular
+ *	expression does backtrack) gets to decide.
+ *
+ * Results:
+ *	Returns 1 if the whole string matched, in which case the scanned
+ *	numeric fields are stored in values[], the set of fields seen in
+ *	*seenPtr, %s in *epochPtr and the text of a numeric %z in *tzNamePtr
+ *	(with a reference for the caller). Returns 0 otherwise.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static const char *
+SkipSpaces(
+    const char *p,
+    const char *end)
+{
+    Tcl_UniChar ch = 0;
+    int n;
+
+    while (p < end) {
+	n = TclUtfToUniChar(p, &ch);
+	if (!Tcl_UniCharIsSpace(ch)) {
+	    break;
+	}
+	p += n;
+    }
+    return p;
+}
+
+static int
+ScanDate(
+    ClockCompiledFormat *cfPtr,	/* Compiled format */
+    Tcl_Obj *strObj,		/* String to scan */
+    int values[],		/* Scanned values of the numeric fields */
+    unsigned *seenPtr,		/* Set of the fields seen */
+    Tcl_WideInt *epochPtr,	/* Scanned %s */
+    Tcl_Obj **tzNamePtr)	/* Scanned %z */
+{
+    ClockScanToken *tokPtr, *endPtr;
+    const char *p, *q, *end, *start;
+    int length, value, digits;
+    unsigned seen = 0;
+    Tcl_WideInt epoch = 0;
+    Tcl_UniChar ch = 0;
+
+    p = TclGetStringFromObj(strObj, &length);
+    end = p + length;
+    p = SkipSpaces(p, end);
+
+    endPtr = cfPtr->scanTokens + cfPtr->numScanTokens;
+    for (tokPtr = cfPtr->scanTokens; tokPtr < endPtr; tokPtr++) {
+	switch (tokPtr->element) {
+	case SCAN_LITERAL:
+	    if (p >= end) {
+		goto noMatch;
+	    }
+	    p += TclUtfToUniChar(p, &ch);
+	    if (Tcl_UniCharToLower(ch) != tokPtr->ch) {
+		goto noMatch;
+	    }
+	    break;
+	case SCAN_SPACES:
+	    q = SkipSpaces(p, end);
+	    if (q == p) {
+		goto noMatch;
+	    }
+	    p = q;
+	    break;
+	case SCAN_OPT_SPACES:
+	    p = SkipSpaces(p, end);
+	    break;
+	case SCAN_NUMBER:
+	    p = SkipSpaces(p, end);
+	    value = 0;
+	    for (digits = 0; digits < tokPtr->maxDigits && p < end
+		    && *p >= '0' && *p <= '9'; digits++) {
+		value = 10 * value + (*p++ - '0');
+	    }
+	    if (digits < tokPtr->minDigits) {
+		goto noMatch;
+	    }
+	    if (tokPtr->field == SCANF_YEAR) {
+		values[SCANF_CENTURY] = value / 100;
+		values[SCANF_YEAROFCENTURY] = value % 100;
+		seen |= (1 << SCANF_CENTURY) | (1 << SCANF_YEAROFCENTURY);
+	    } else {
+		values[tokPtr->field] = value;
+		seen |= 1 << tokPtr->field;
+	    }
+	    break;
+	case SCAN_EPOCH:
+	    /*
+	     * Leading zeroes and values out of range are for ScanWide to
+	     * diagnose.
+	     */
+
+	    p = SkipSpaces(p, end);
+	    q = p;
+	    if (p < end && (*p == '-' || *p == '+')) {
+		p++;
+	    }
+	    start = p;
+	    epoch = 0;
+	    while (p < end && *p >= '0' && *p <= '9') {
+		if (epoch > (WIDE_MAX - 9) / 10) {
+		    goto noMatch;
+		}
+		epoch = 10 * epoch + (*p++ - '0');
+	    }
+	    if (p == start || (*start == '0' && p - start > 1)) {
+		goto noMatch;
+	    }
+	    if (*q == '-') {
+		epoch = -epoch;
+	    }
+	    seen |= 1 << SCANF_SECONDS;
+	    break;
+	case SCAN_TZ_NUMERIC:
+	    /*
+	     * [-+]hh, optionally followed by [:]mm and [:]ss. Time zone names
+	     * are left to the script.
+	     */
+
+	    start = p;
+	    if (p + 3 > end || (*p != '-' && *p != '+')
+		    || !isdigit(UCHAR(p[1])) || !isdigit(UCHAR(p[2]))) {
+		goto noMatch;
+	    }
+	    p += 3;
+	    for (digits = 0; digits < 2; digits++) {
+		q = p + (p < end && *p == ':');
+		if (q + 2 > end || !isdigit(UCHAR(q[0]))
+			|| !isdigit(UCHAR(q[1]))) {
+		    break;
+		}
+		p = q + 2;
+	    }
+	    if (*tzNamePtr != NULL) {
+		Tcl_DecrRefCount(*tzNamePtr);
+	    }
+	    *tzNamePtr = Tcl_NewStringObj(start, p - start);
+	    Tcl_IncrRefCount(*tzNamePtr);
+	    seen |= 1 << SCANF_TZNAME;
+	    break;
+	}
+    }
+    if (SkipSpaces(p, end) != end) {
+	goto noMatch;
+    }
+    *seenPtr = seen;
+    *epochPtr = epoch;
+    return 1;
+
+  noMatch:
+    if (*tzNamePtr != NULL) {
+	Tcl_DecrRefCount(*tzNamePtr);
+	*tzNamePtr = NULL;
+    }
+    return 0;
+}
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * ParseFormatArgs --
+ *
+ *	Does the work of ClockParseformatargsObjCmd, for it and for the native
+ *	[clock format].
+ *
+ * Results:
+ *	Returns a standard Tcl result. On success, stores the time format, the
+ *	locale and the timezone in results[0..2] and the clock value in
+ *	*clockValPtr.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static int
+ParseFormatArgs(
+    ClockClientData *dataPtr,	/* Client data containing literal pool */
+    Tcl_Interp *interp,		/* Tcl interpreter */
+    int objc,			/* Parameter count */
+    Tcl_Obj *const objv[],	/* Parameter vector */
+    Tcl_Obj *results[3],	/* Format, locale and timezone */
+    Tcl_WideInt *clockValPtr)	/* Clock value */
+{
+    Tcl_Obj **litPtr = dataPtr->literals;
+#define formatObj results[0]
+#define localeObj results[1]
+#define timezoneObj results[2]
+    int gmtFlag = 0;
+    static const char *const options[] = { /* Command line options expected */
+	"-format",	"-gmt",		"-locale",
+	"-timezone",	NULL };
+    enum optionInd {
+	CLOCK_FORMAT_FORMAT,	CLOCK_FORMAT_GMT,	CLOCK_FORMAT_LOCALE,
+	CLOCK_FORMAT_TIMEZONE
+    };
+    int optionIndex;		/* Index of an option. */
+    int saw = 0;		/* Flag == 1 if option was seen already. */
+    int i;
+
+    /*
+     * Args consist of a time followed by keyword-value pairs.
      */
 
     if (objc < 2 || (objc % 2) != 0) {
@@ -1966,7 +4319,7 @@ ClockParseformatargsObjCmd(
      * Check options.
      */
 
-    if (TclGetWideIntFromObj(interp, objv[1], &clockVal) != TCL_OK) {
+    if (TclGetWideIntFromObj(interp, objv[1], clockValPtr) != TCL_OK) {
 	return TCL_ERROR;
     }
     if ((saw & (1 << CLOCK_FORMAT_GMT))
@@ -1979,11 +4332,6 @@ ClockParseformatargsObjCmd(
 	timezoneObj = litPtr[LIT_GMT];
     }
 
-    /*
-     * Return options as a list.
-     */
-
-    Tcl_SetObjResult(interp, Tcl_NewListObj(3, results));
     return TCL_OK;
 
 #undef timezoneObj
@@ -2118,6 +4466,9 @@ ClockDeleteCmdProc(
     int i;
 
     if (data->refCount-- <= 1) {
+	ClockClearNativeCaches(data);
+	Tcl_DeleteHashTable(&data->formatCache);
+	Tcl_DeleteHashTable(&data->tzCache);
 	for (i = 0; i < LIT__END; ++i) {
 	    Tcl_DecrRefCount(data->literals[i]);
 	}
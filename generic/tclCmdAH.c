@@ -86,6 +86,7 @@ static Tcl_ObjCmdProc FileAttrModifyTimeCmd;
 static Tcl_ObjCmdProc FileAttrSizeCmd;
 static Tcl_ObjCmdProc FileAttrStatCmd;
 static Tcl_ObjCmdProc FileAttrTypeCmd;
+static Tcl_ObjCmdProc FileMapCmd;
 static Tcl_ObjCmdProc FilesystemSeparatorCmd;
 static Tcl_ObjCmdProc FilesystemVolumesCmd;
 static Tcl_ObjCmdProc PathDirNameCmd;
@@ -1163,6 +1164,7 @@ TclInitFileCmd(
 	{"join",	PathJoinCmd,		TclCompileBasicMin1ArgCmd, NULL, NULL, 0},
 	{"link",	TclFileLinkCmd,		TclCompileBasic1To3ArgCmd, NULL, NULL, 0},
 	{"lstat",	FileAttrLinkStatCmd,	TclCompileBasic2ArgCmd, NULL, NULL, 0},
+	{"map",		FileMapCmd,		TclCompileBasic1To3ArgCmd, NULL, NULL, 0},
 	{"mtime",	FileAttrModifyTimeCmd,	TclCompileBasic1Or2ArgCmd, NULL, NULL, 0},
 	{"mkdir",	TclFileMakeDirsCmd,	TclCompileBasicMin0ArgCmd, NULL, NULL, 0},
 	{"nativename",	PathNativeNameCmd,	TclCompileBasic1ArgCmd, NULL, NULL, 0},
@@ -1227,6 +1229,7 @@ TclMakeFileCommandSafe(
 	{"join",	 0},
 	{"link",	 1},
 	{"lstat",	 1},
+	{"map",		 1},
 	{"mtime",	 1},
 	{"mkdir",	 1},
 	{"nativename",	 1},
@@ -1626,6 +1629,93 @@ FileAttrSizeCmd(
     return TCL_OK;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * FileMapCmd --
+ *
+ *	This function is invoked to process the "file map" Tcl command. See
+ *	the user documentation for details on what it does.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	Maps the file into memory; the result is a byte array that refers to
+ *	the mapped bytes directly, so they are only copied if the value is
+ *	converted to a string or its length is changed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+FileMapCmd(
+    ClientData clientData,
+    Tcl_Interp *interp,
+    int objc,
+    Tcl_Obj *const objv[])
+{
+    Tcl_WideInt offset = 0, length = -1;
+    unsigned char *bytes;
+    int numBytes;
+    ClientData mapData;
+
+    if (objc < 2 || objc > 4) {
+	Tcl_WrongNumArgs(interp, 1, objv, "name ?offset? ?length?");
+	return TCL_ERROR;
+    }
+    if (objc > 2) {
+	if (TclGetWideIntFromObj(interp, objv[2], &offset) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+	if (offset < 0) {
+	    Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+		    "bad offset \"%s\": must be non-negative",
+		    TclGetString(objv[2])));
+	    Tcl_SetErrorCode(interp, "TCL", "VALUE", "OFFSET", NULL);
+	    return TCL_ERROR;
+	}
+    }
+    if (objc > 3) {
+	if (TclGetWideIntFromObj(interp, objv[3], &length) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+	if (length < 0) {
+	    Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+		    "bad length \"%s\": must be non-negative",
+		    TclGetString(objv[3])));
+	    Tcl_SetErrorCode(interp, "TCL", "VALUE", "LENGTH", NULL);
+	    return TCL_ERROR;
+	}
+    }
+
+    if (Tcl_FSConvertToPathType(interp, objv[1]) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    if (Tcl_FSGetNativePath(objv[1]) == NULL) {
+	Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+		"couldn't map \"%s\": not a file in the native filesystem",
+		TclGetString(objv[1])));
+	Tcl_SetErrorCode(interp, "TCL", "OPERATION", "MAP", "NOT_NATIVE",
+		NULL);
+	return TCL_ERROR;
+    }
+    if (TclpMapFile(objv[1], offset, length, &bytes, &numBytes,
+	    &mapData) != 0) {
+	Tcl_SetObjResult(interp, Tcl_ObjPrintf("couldn't map \"%s\": %s",
+		TclGetString(objv[1]), Tcl_PosixError(interp)));
+	return TCL_ERROR;
+    }
+
+    if (numBytes == 0) {
+	Tcl_SetObjResult(interp, Tcl_NewByteArrayObj(NULL, 0));
+    } else {
+	Tcl_SetObjResult(interp, TclNewMappedByteArrayObj(bytes, numBytes,
+		TclpUnmapFile, mapData));
+    }
+    return TCL_OK;
+}
+
 /*
  *----------------------------------------------------------------------
  *
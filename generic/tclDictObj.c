@@ -1554,6 +1554,43 @@ TclDictPutString(
     return code;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclDictObjVisitElements --
+ *
+ *	Calls visitProc with the address of the slot of each key and each
+ *	value of the dictionary in dictPtr. The callback may replace a key or
+ *	value by an equal one.
+ *
+ * Results:
+ *	TCL_OK, or TCL_ERROR without calling visitProc if the dictionary is
+ *	being iterated over or updated, when its entries may not be touched.
+ *
+ * Side effects:
+ *	None. dictPtr must be a dictionary.
+ *
+ *----------------------------------------------------------------------
+ */
+int
+TclDictObjVisitElements(
+    Tcl_Obj *dictPtr,
+    TclObjSlotProc *visitProc,	/* Called for each key and value slot. */
+    ClientData clientData)	/* Passed to visitProc. */
+{
+    Dict *dict = (Dict *)DICT(dictPtr);
+    ChainEntry *cPtr;
+
+    if (dict->refCount > 1 || dict->chain != NULL) {
+	return TCL_ERROR;
+    }
+    for (cPtr=dict->entryChainHead ; cPtr!=NULL ; cPtr=cPtr->nextPtr) {
+	visitProc(clientData, &cPtr->entry.key.objPtr);
+	visitProc(clientData, (Tcl_Obj **) &cPtr->entry.clientData);
+    }
+    return TCL_OK;
+}
+
 /*
  *----------------------------------------------------------------------
  *
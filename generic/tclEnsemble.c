@@ -1551,8 +1551,18 @@ TclMakeEnsemble(
 	}
     }
 
-    ns = Tcl_FindNamespace(interp, Tcl_DStringValue(&buf), NULL,
-	    TCL_CREATE_NS_IF_UNKNOWN);
+    /*
+     * Core ensembles can be built while a command name is being resolved
+     * (see TclMaterializeEnsemble), which may happen while the bytecode
+     * engine has values on the Tcl stack that it has not accounted for.
+     * Creating the namespace by its absolute name avoids the stack frame
+     * that creating it relative to its parent would push.
+     */
+
+    ns = Tcl_FindNamespace(interp, Tcl_DStringValue(&buf), NULL, 0);
+    if (!ns) {
+	ns = Tcl_CreateNamespace(interp, Tcl_DStringValue(&buf), NULL, NULL);
+    }
     if (!ns) {
 	Tcl_Panic("unable to find or create %s namespace!",
 		Tcl_DStringValue(&buf));
@@ -43,6 +43,15 @@
 #   define ASYNC_CHECK_COUNT_MASK	63
 #endif /* !ASYNC_CHECK_COUNT_MASK */
 
+/*
+ * The number of execution environments of finished coroutines that an
+ * interpreter keeps for reuse.
+ */
+
+#ifndef EXEC_ENV_POOL_SIZE
+#   define EXEC_ENV_POOL_SIZE	8
+#endif /* !EXEC_ENV_POOL_SIZE */
+
 /*
  * Boolean flag indicating whether the Tcl bytecode interpreter has been
  * initialized.
@@ -926,6 +935,7 @@ TclCreateExecEnv(
     eePtr->callbackPtr = NULL;
     eePtr->corPtr = NULL;
     eePtr->rewind = 0;
+    eePtr->nextPtr = NULL;
 
     esPtr->prevPtr = NULL;
     esPtr->nextPtr = NULL;
@@ -1009,6 +1019,107 @@ TclDeleteExecEnv(
     ckfree(eePtr);
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclAcquireExecEnv, TclReleaseExecEnv --
+ *
+ *	Get an execution environment for a coroutine, and give it back when
+ *	the coroutine has finished. Released environments whose evaluation
+ *	stack is empty are kept in a small per-interpreter pool, so that
+ *	short-lived coroutines do not pay for allocating and initialising a
+ *	new environment each time.
+ *
+ * Results:
+ *	TclAcquireExecEnv returns an execution environment with an empty
+ *	evaluation stack of at least the given size.
+ *
+ * Side effects:
+ *	Memory may be allocated or freed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+ExecEnv *
+TclAcquireExecEnv(
+    Tcl_Interp *interp,		/* Interpreter the environment is for. */
+    int size)			/* The initial stack size, in number of words
+				 * [sizeof(Tcl_Obj*)], when one has to be
+				 * created. */
+{
+    Interp *iPtr = (Interp *) interp;
+    ExecEnv *eePtr = iPtr->execEnvPool;
+
+    if (eePtr == NULL) {
+	return TclCreateExecEnv(interp, size);
+    }
+    iPtr->execEnvPool = eePtr->nextPtr;
+    iPtr->execEnvPoolSize--;
+    eePtr->nextPtr = NULL;
+    return eePtr;
+}
+
+void
+TclReleaseExecEnv(
+    ExecEnv *eePtr)		/* Execution environment no longer used. */
+{
+    Interp *iPtr = (Interp *) eePtr->interp;
+    ExecStack *esPtr = eePtr->execStackPtr;
+
+    if ((iPtr->flags & DELETED) || TclInExit()
+	    || (iPtr->execEnvPoolSize >= EXEC_ENV_POOL_SIZE)
+	    || eePtr->callbackPtr || eePtr->corPtr
+	    || esPtr->prevPtr || esPtr->markerPtr
+	    || (esPtr->tosPtr != STACK_BASE(esPtr))) {
+	TclDeleteExecEnv(eePtr);
+	return;
+    }
+
+    /*
+     * Only the first stack is kept; a spare one left over from deep nesting
+     * would just be dead weight in the pool.
+     */
+
+    if (esPtr->nextPtr) {
+	DeleteExecStack(esPtr->nextPtr);
+    }
+    eePtr->rewind = 0;
+    eePtr->nextPtr = iPtr->execEnvPool;
+    iPtr->execEnvPool = eePtr;
+    iPtr->execEnvPoolSize++;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclDeleteExecEnvPool --
+ *
+ *	Frees the execution environments pooled by an interpreter.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Memory is freed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclDeleteExecEnvPool(
+    Tcl_Interp *interp)
+{
+    Interp *iPtr = (Interp *) interp;
+    ExecEnv *eePtr;
+
+    while (iPtr->execEnvPool != NULL) {
+	eePtr = iPtr->execEnvPool;
+	iPtr->execEnvPool = eePtr->nextPtr;
+	TclDeleteExecEnv(eePtr);
+    }
+    iPtr->execEnvPoolSize = 0;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -3347,9 +3458,11 @@ TEBCresume(
 
     doLoadStk:
 	part1Ptr = objPtr;
+	DECACHE_STACK_INFO();
 	varPtr = TclObjLookupVarEx(interp, part1Ptr, part2Ptr,
 		TCL_LEAVE_ERR_MSG, "read", /*createPart1*/0, /*createPart2*/1,
 		&arrayPtr);
+	CACHE_STACK_INFO();
 	if (!varPtr) {
 	    TRACE_ERROR(interp);
 	    goto gotError;
@@ -3524,8 +3637,10 @@ TEBCresume(
 		    O2S(part1Ptr), O2S(part2Ptr), O2S(valuePtr)));
 	}
 #endif
+	DECACHE_STACK_INFO();
 	varPtr = TclObjLookupVarEx(interp, objPtr,part2Ptr, TCL_LEAVE_ERR_MSG,
 		"set", /*createPart1*/ 1, /*createPart2*/ 1, &arrayPtr);
+	CACHE_STACK_INFO();
 	if (!varPtr) {
 	    TRACE_ERROR(interp);
 	    goto gotError;
@@ -3867,8 +3982,10 @@ TEBCresume(
 	}
 	part1Ptr = objPtr;
 	opnd = -1;
+	DECACHE_STACK_INFO();
 	varPtr = TclObjLookupVarEx(interp, objPtr, part2Ptr,
 		TCL_LEAVE_ERR_MSG, "read", 1, 1, &arrayPtr);
+	CACHE_STACK_INFO();
 	if (!varPtr) {
 	    DECACHE_STACK_INFO();
 	    Tcl_AddErrorInfo(interp,
@@ -4149,8 +4266,10 @@ TEBCresume(
 	TRACE(("\"%.30s\" => ", O2S(part1Ptr)));
 
     doExistStk:
+	DECACHE_STACK_INFO();
 	varPtr = TclObjLookupVarEx(interp, part1Ptr, part2Ptr, 0, "access",
 		/*createPart1*/0, /*createPart2*/1, &arrayPtr);
+	CACHE_STACK_INFO();
 	if (varPtr) {
 	    if (ReadTraced(varPtr) || (arrayPtr && ReadTraced(arrayPtr))) {
 		DECACHE_STACK_INFO();
@@ -4351,8 +4470,10 @@ TEBCresume(
 	cleanup = 1;
 	part1Ptr = OBJ_AT_TOS;
 	TRACE(("\"%.30s\" => ", O2S(part1Ptr)));
+	DECACHE_STACK_INFO();
 	varPtr = TclObjLookupVarEx(interp, part1Ptr, NULL, 0, NULL,
 		/*createPart1*/0, /*createPart2*/0, &arrayPtr);
+	CACHE_STACK_INFO();
     doArrayExists:
 	DECACHE_STACK_INFO();
 	result = TclCheckArrayTraces(interp, varPtr, arrayPtr, part1Ptr, opnd);
@@ -4387,8 +4508,10 @@ TEBCresume(
 	cleanup = 1;
 	part1Ptr = OBJ_AT_TOS;
 	TRACE(("\"%.30s\" => ", O2S(part1Ptr)));
+	DECACHE_STACK_INFO();
 	varPtr = TclObjLookupVarEx(interp, part1Ptr, NULL, TCL_LEAVE_ERR_MSG,
 		"set", /*createPart1*/1, /*createPart2*/0, &arrayPtr);
+	CACHE_STACK_INFO();
 	if (varPtr == NULL) {
 	    TRACE_ERROR(interp);
 	    goto gotError;
@@ -4447,9 +4570,11 @@ TEBCresume(
 
 	savedFramePtr = iPtr->varFramePtr;
 	iPtr->varFramePtr = framePtr;
+	DECACHE_STACK_INFO();
 	otherPtr = TclObjLookupVarEx(interp, OBJ_AT_TOS, NULL,
 		TCL_LEAVE_ERR_MSG, "access", /*createPart1*/ 1,
 		/*createPart2*/ 1, &varPtr);
+	CACHE_STACK_INFO();
 	iPtr->varFramePtr = savedFramePtr;
 	if (!otherPtr) {
 	    TRACE_ERROR(interp);
@@ -4460,10 +4585,13 @@ TEBCresume(
     case INST_NSUPVAR:
 	TRACE(("%d %.30s %.30s => ", TclGetInt4AtPtr(pc+1),
 		O2S(OBJ_UNDER_TOS), O2S(OBJ_AT_TOS)));
+	DECACHE_STACK_INFO();
 	if (TclGetNamespaceFromObj(interp, OBJ_UNDER_TOS, &nsPtr) != TCL_OK) {
+	    CACHE_STACK_INFO();
 	    TRACE_ERROR(interp);
 	    goto gotError;
 	}
+	CACHE_STACK_INFO();
 
 	/*
 	 * Locate the other variable.
@@ -4471,9 +4599,11 @@ TEBCresume(
 
 	savedNsPtr = iPtr->varFramePtr->nsPtr;
 	iPtr->varFramePtr->nsPtr = (Namespace *) nsPtr;
+	DECACHE_STACK_INFO();
 	otherPtr = TclObjLookupVarEx(interp, OBJ_AT_TOS, NULL,
 		(TCL_NAMESPACE_ONLY|TCL_LEAVE_ERR_MSG|TCL_AVOID_RESOLVERS),
 		"access", /*createPart1*/ 1, /*createPart2*/ 1, &varPtr);
+	CACHE_STACK_INFO();
 	iPtr->varFramePtr->nsPtr = savedNsPtr;
 	if (!otherPtr) {
 	    TRACE_ERROR(interp);
@@ -4483,9 +4613,11 @@ TEBCresume(
 
     case INST_VARIABLE:
 	TRACE(("%d, %.30s => ", TclGetInt4AtPtr(pc+1), O2S(OBJ_AT_TOS)));
+	DECACHE_STACK_INFO();
 	otherPtr = TclObjLookupVarEx(interp, OBJ_AT_TOS, NULL,
 		(TCL_NAMESPACE_ONLY | TCL_LEAVE_ERR_MSG), "access",
 		/*createPart1*/ 1, /*createPart2*/ 1, &varPtr);
+	CACHE_STACK_INFO();
 	if (!otherPtr) {
 	    TRACE_ERROR(interp);
 	    goto gotError;
@@ -4764,7 +4896,9 @@ TEBCresume(
 	Tcl_Command cmd, origCmd;
 
     case INST_RESOLVE_COMMAND:
+	DECACHE_STACK_INFO();
 	cmd = Tcl_GetCommandFromObj(interp, OBJ_AT_TOS);
+	CACHE_STACK_INFO();
 	TclNewObj(objResultPtr);
 	if (cmd != NULL) {
 	    Tcl_GetCommandFullName(interp, cmd, objResultPtr);
@@ -4774,7 +4908,9 @@ TEBCresume(
 
     case INST_ORIGIN_COMMAND:
 	TRACE(("\"%.30s\" => ", O2S(OBJ_AT_TOS)));
+	DECACHE_STACK_INFO();
 	cmd = Tcl_GetCommandFromObj(interp, OBJ_AT_TOS);
+	CACHE_STACK_INFO();
 	if (cmd == NULL) {
 	    Tcl_SetObjResult(interp, Tcl_ObjPrintf(
 		    "invalid command name \"%s\"", TclGetString(OBJ_AT_TOS)));
@@ -7821,8 +7957,10 @@ TEBCresume(
 	    TclDecrRefCount(keysPtr);
 	    goto gotError;
 	}
+	DECACHE_STACK_INFO();
 	varPtr = TclObjLookupVarEx(interp, varNamePtr, NULL,
 		TCL_LEAVE_ERR_MSG, "set", 1, 1, &arrayPtr);
+	CACHE_STACK_INFO();
 	if (varPtr == NULL) {
 	    TRACE_ERROR(interp);
 	    TclDecrRefCount(keysPtr);
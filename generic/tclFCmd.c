@@ -1471,6 +1471,7 @@ TclFileTemporaryCmd(
 
   makeTemporary:
     chan = TclpOpenTemporaryFile(tempDirObj,tempBaseObj,tempExtObj, nameObj);
+    TclFSInvalidateStatCache();
 
     /*
      * If we created pieces of template, get rid of them now.
@@ -4658,35 +4658,29 @@ Tcl_GetsObj(
 	 */
 
 	if (inEofChar != '\0') {
-	    for (eol = dst; eol < dstEnd; eol++) {
-		if (*eol == inEofChar) {
-		    dstEnd = eol;
-		    eof = eol;
-		    break;
-		}
+	    eol = (char *) memchr(dst, inEofChar, dstEnd - dst);
+	    if (eol != NULL) {
+		dstEnd = eol;
+		eof = eol;
 	    }
 	}
 
 	/*
 	 * On EOL, leave current file position pointing after the EOL, but
-	 * don't store the EOL in the output string.
+	 * don't store the EOL in the output string. Single character EOLs
+	 * are searched for with memchr, which scans a word or more at a
+	 * time.
 	 */
 
 	switch (statePtr->inputTranslation) {
 	case TCL_TRANSLATE_LF:
-	    for (eol = dst; eol < dstEnd; eol++) {
-		if (*eol == '\n') {
-		    skip = 1;
-		    goto gotEOL;
-		}
-	    }
-	    break;
 	case TCL_TRANSLATE_CR:
-	    for (eol = dst; eol < dstEnd; eol++) {
-		if (*eol == '\r') {
-		    skip = 1;
-		    goto gotEOL;
-		}
+	    eol = (char *) memchr(dst,
+		    (statePtr->inputTranslation == TCL_TRANSLATE_LF)
+		    ? '\n' : '\r', dstEnd - dst);
+	    if (eol != NULL) {
+		skip = 1;
+		goto gotEOL;
 	    }
 	    break;
 	case TCL_TRANSLATE_CRLF:
@@ -5058,12 +5052,10 @@ TclGetsObjBinary(
 	 */
 
 	if (inEofChar != '\0') {
-	    for (eol = dst; eol < dstEnd; eol++) {
-		if (*eol == inEofChar) {
-		    dstEnd = eol;
-		    eof = eol;
-		    break;
-		}
+	    eol = (unsigned char *) memchr(dst, inEofChar, dstEnd - dst);
+	    if (eol != NULL) {
+		dstEnd = eol;
+		eof = eol;
 	    }
 	}
 
@@ -5072,11 +5064,10 @@ TclGetsObjBinary(
 	 * don't store the EOL in the output string.
 	 */
 
-	for (eol = dst; eol < dstEnd; eol++) {
-	    if (*eol == eolChar) {
-		skip = 1;
-		goto gotEOL;
-	    }
+	eol = (unsigned char *) memchr(dst, eolChar, dstEnd - dst);
+	if (eol != NULL) {
+	    skip = 1;
+	    goto gotEOL;
 	}
 	if (eof != NULL) {
 	    /*
@@ -39,6 +39,9 @@ static Tcl_ThreadDataKey dataKey;
 static void		FinalizeIOCmdTSD(ClientData clientData);
 static void		AcceptCallbackProc(ClientData callbackData,
 			    Tcl_Channel chan, char *address, int port);
+static int		GetLines(Tcl_Interp *interp, Tcl_Channel chan,
+			    Tcl_Obj *chanObjPtr, int maxLines,
+			    Tcl_Obj *varNamePtr);
 static int		ChanPendingObjCmd(ClientData unused,
 			    Tcl_Interp *interp, int objc,
 			    Tcl_Obj *const objv[]);
@@ -302,11 +305,26 @@ Tcl_GetsObjCmd(
     Tcl_Channel chan;		/* The channel to read from. */
     int lineLen;		/* Length of line just read. */
     int mode;			/* Mode in which channel is opened. */
+    int maxLines = 0;		/* Number of lines to read with -lines, 0 if
+				 * not given. */
     Tcl_Obj *linePtr, *chanObjPtr;
     int code = TCL_OK;
 
-    if ((objc != 2) && (objc != 3)) {
-	Tcl_WrongNumArgs(interp, 1, objv, "channelId ?varName?");
+    if (((objc == 4) || (objc == 5))
+	    && (strcmp(TclGetString(objv[1]), "-lines") == 0)) {
+	if (TclGetIntFromObj(interp, objv[2], &maxLines) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+	if (maxLines <= 0) {
+	    Tcl_SetObjResult(interp, Tcl_NewStringObj(
+		    "number of lines must be positive", -1));
+	    Tcl_SetErrorCode(interp, "TCL", "VALUE", "NUMBER", NULL);
+	    return TCL_ERROR;
+	}
+	objc -= 2;
+	objv += 2;
+    } else if ((objc != 2) && (objc != 3)) {
+	Tcl_WrongNumArgs(interp, 1, objv, "?-lines count? channelId ?varName?");
 	return TCL_ERROR;
     }
     chanObjPtr = objv[1];
@@ -321,6 +339,11 @@ Tcl_GetsObjCmd(
     }
 
     TclChannelPreserve(chan);
+    if (maxLines > 0) {
+	code = GetLines(interp, chan, chanObjPtr, maxLines,
+		(objc == 3) ? objv[2] : NULL);
+	goto done;
+    }
     TclNewObj(linePtr);
     lineLen = Tcl_GetsObj(chan, linePtr);
     if (lineLen < 0) {
@@ -359,6 +382,71 @@ Tcl_GetsObjCmd(
     return code;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetLines --
+ *
+ *	Helper for Tcl_GetsObjCmd, implements "gets -lines": reads up to
+ *	maxLines lines in one call, saving the interpreter overhead of one
+ *	command per line. End of file, or in non-blocking mode the lack of a
+ *	complete line, stops early. So does an error, which is only reported
+ *	when no line was read; otherwise the next read runs into it again.
+ *
+ * Results:
+ *	A standard Tcl result. The list of lines is the result, or is stored
+ *	in varNamePtr and the number of lines is the result, -1 when there
+ *	are none.
+ *
+ * Side effects:
+ *	May consume input from channel.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+GetLines(
+    Tcl_Interp *interp,		/* Current interpreter. */
+    Tcl_Channel chan,		/* The channel to read from. */
+    Tcl_Obj *chanObjPtr,	/* Its name, for error messages. */
+    int maxLines,		/* Maximum number of lines to read. */
+    Tcl_Obj *varNamePtr)	/* Variable to store the lines in, or NULL. */
+{
+    Tcl_Obj *listPtr, *linePtr;
+    int numLines = 0;
+
+    listPtr = Tcl_NewListObj(0, NULL);
+    while (numLines < maxLines) {
+	TclNewObj(linePtr);
+	if (Tcl_GetsObj(chan, linePtr) < 0) {
+	    Tcl_DecrRefCount(linePtr);
+	    if ((numLines == 0) && !Tcl_Eof(chan) && !Tcl_InputBlocked(chan)) {
+		Tcl_DecrRefCount(listPtr);
+		if (!TclChanCaughtErrorBypass(interp, chan)) {
+		    Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+			    "error reading \"%s\": %s",
+			    TclGetString(chanObjPtr), Tcl_PosixError(interp)));
+		}
+		return TCL_ERROR;
+	    }
+	    break;
+	}
+	Tcl_ListObjAppendElement(NULL, listPtr, linePtr);
+	numLines++;
+    }
+
+    if (varNamePtr == NULL) {
+	Tcl_SetObjResult(interp, listPtr);
+	return TCL_OK;
+    }
+    if (Tcl_ObjSetVar2(interp, varNamePtr, NULL, listPtr,
+	    TCL_LEAVE_ERR_MSG) == NULL) {
+	return TCL_ERROR;
+    }
+    Tcl_SetObjResult(interp, Tcl_NewIntObj((numLines > 0) ? numLines : -1));
+    return TCL_OK;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -1473,12 +1561,13 @@ Tcl_SocketObjCmd(
     Tcl_Obj *const objv[])	/* Argument objects. */
 {
     static const char *const socketOptions[] = {
-	"-async", "-myaddr", "-myport", "-server", NULL
+	"-async", "-myaddr", "-myport", "-reuseport", "-server", NULL
     };
     enum socketOptions {
-	SKT_ASYNC, SKT_MYADDR, SKT_MYPORT, SKT_SERVER
+	SKT_ASYNC, SKT_MYADDR, SKT_MYPORT, SKT_REUSEPORT, SKT_SERVER
     };
     int optionIndex, a, server = 0, port, myport = 0, async = 0;
+    int reuseport = 0;
     const char *host, *script = NULL, *myaddr = NULL;
     Tcl_Channel chan;
 
@@ -1529,6 +1618,17 @@ Tcl_SocketObjCmd(
 	    }
 	    break;
 	}
+	case SKT_REUSEPORT:
+	    a++;
+	    if (a >= objc) {
+		Tcl_SetObjResult(interp, Tcl_NewStringObj(
+			"no argument given for -reuseport option", -1));
+		return TCL_ERROR;
+	    }
+	    if (Tcl_GetBooleanFromObj(interp, objv[a], &reuseport) != TCL_OK) {
+		return TCL_ERROR;
+	    }
+	    break;
 	case SKT_SERVER:
 	    if (async == 1) {
 		Tcl_SetObjResult(interp, Tcl_NewStringObj(
@@ -1555,6 +1655,10 @@ Tcl_SocketObjCmd(
 		    "option -myport is not valid for servers", -1));
 	    return TCL_ERROR;
 	}
+    } else if (reuseport) {
+	Tcl_SetObjResult(interp, Tcl_NewStringObj(
+		"option -reuseport is only valid for servers", -1));
+	return TCL_ERROR;
     } else if (a < objc) {
 	host = TclGetString(objv[a]);
 	a++;
@@ -1567,7 +1671,7 @@ Tcl_SocketObjCmd(
 		"?-myaddr addr? ?-myport myport? ?-async? host port");
 	iPtr->flags |= INTERP_ALTERNATE_WRONG_ARGS;
 	Tcl_WrongNumArgs(interp, 1, objv,
-		"-server command ?-myaddr addr? port");
+		"-server command ?-reuseport boolean? ?-myaddr addr? port");
 	return TCL_ERROR;
     }
 
@@ -1589,7 +1693,8 @@ Tcl_SocketObjCmd(
 	memcpy(copyScript, script, len);
 	acceptCallbackPtr->script = copyScript;
 	acceptCallbackPtr->interp = interp;
-	chan = Tcl_OpenTcpServer(interp, port, host, AcceptCallbackProc,
+	chan = TclOpenTcpServerEx(interp, port, host,
+		reuseport ? TCL_TCPSERVER_REUSEPORT : 0, AcceptCallbackProc,
 		acceptCallbackPtr);
 	if (chan == NULL) {
 	    ckfree(copyScript);
@@ -112,6 +112,40 @@ typedef struct {
 
     int dead;			/* Boolean signal that some operations
 				 * should no longer be attempted. */
+    int methodMask;		/* Bitmask of the methods the handler
+				 * supports. */
+    int batch;			/* Boolean flag, forward operations from other
+				 * threads in batches (chan create -batch). */
+#ifdef TCL_THREADS
+
+    /*
+     * State of batched forwarding. The read-ahead buffer and the watch mask
+     * belong to the thread owning the channel, the write queue is protected
+     * by rcForwardMutex.
+     */
+
+    char *readBuf;		/* Data read ahead from the handler, or
+				 * NULL. */
+    int readStart;		/* Offset of the first unconsumed byte. */
+    int readLen;		/* Number of unconsumed bytes. */
+    Tcl_TimerToken readTimer;	/* Posts readable events while read-ahead
+				 * data waits. */
+    int watchMask;		/* Interest last forwarded to the handler
+				 * thread. */
+    char *writeBuf;		/* Data waiting for the handler thread to take
+				 * it, or NULL. */
+    int writeLen;		/* Number of bytes in writeBuf. */
+    int writeMax;		/* Allocated size of writeBuf. */
+    int writePending;		/* Number of bytes queued or being written by
+				 * the handler thread. */
+    int writeQueued;		/* Boolean flag, an event for taking writeBuf
+				 * is queued. */
+    int writeCode;		/* Failure of a write, as in ForwardParamBase,
+				 * not yet reported to the owner. */
+    char *writeMsg;		/* Message of that failure, or NULL. */
+    Tcl_Condition writeDone;	/* Signalled whenever the handler thread
+				 * completes writes. */
+#endif
 
     /*
      * Note regarding the usage of timers.
@@ -303,6 +337,26 @@ typedef union ForwardParam {
     struct ForwardParamGetOpt getOpt;
 } ForwardParam;
 
+/*
+ * Event used by batched channels to forward writes and watch masks without
+ * waiting for the handler thread. The event holds a Tcl_Preserve reference
+ * to the channel instance.
+ */
+
+typedef struct ForwardAsyncEvent {
+    Tcl_Event event;		/* Basic event data, has to be first item */
+    ReflectedChannel *rcPtr;	/* Channel instance */
+    int mask;			/* Interest to forward, for watch events */
+} ForwardAsyncEvent;
+
+/*
+ * Size of the reads of batched channels, and the number of bytes they can
+ * have queued for writing before writers wait for the handler thread.
+ */
+
+#define READ_AHEAD_SIZE		(64 * 1024)
+#define WRITE_BEHIND_LIMIT	(1024 * 1024)
+
 /*
  * Forward declaration.
  */
@@ -409,6 +463,19 @@ static void		SrcExitProc(void *clientData);
 
 static void		ForwardSetObjError(ForwardParam *p, Tcl_Obj *objPtr);
 
+static int		TakeReadAhead(ReflectedChannel *rcPtr, char *buf,
+			    int toRead);
+static void		TimerKill(ReflectedChannel *rcPtr);
+static void		TimerSetup(ReflectedChannel *rcPtr);
+static void		TimerRun(void *clientData);
+static int		QueueWrite(ReflectedChannel *rcPtr, const char *buf,
+			    int toWrite, int *errorCodePtr);
+static void		QueueWatch(ReflectedChannel *rcPtr, int mask);
+static void		WaitWrites(ReflectedChannel *rcPtr);
+static int		WriteEventProc(Tcl_Event *evPtr, int mask);
+static int		WatchEventProc(Tcl_Event *evPtr, int mask);
+static int		AsyncEventDelete(Tcl_Event *evPtr, void *clientData);
+
 static ReflectedChannelMap *	GetThreadReflectedChannelMap(void);
 static Tcl_ExitProc	DeleteThreadReflectedChannelMap;
 
@@ -508,25 +575,28 @@ TclChanCreateObjCmd(
 				 * this interp. */
     Tcl_HashEntry *hPtr;	/* Entry in the above map */
     int isNew;			/* Placeholder. */
+    int batch = 0;		/* Boolean flag, -batch was given. */
     (void)dummy;
 
     /*
-     * Syntax:   chan create MODE CMDPREFIX
-     *           [0]  [1]    [2]  [3]
+     * Syntax:   chan create ?-batch? MODE CMDPREFIX
+     *           [0]  [1]    [2]      [3]  [4]
      *
-     * Actually: rCreate MODE CMDPREFIX
-     *           [0]     [1]  [2]
+     * Actually: rCreate ?-batch? MODE CMDPREFIX
+     *           [0]     [1]      [2]  [3]
      */
 
-#define MODE	(1)
-#define CMD	(2)
+#define MODE	(objc - 2)
+#define CMD	(objc - 1)
 
     /*
      * Number of arguments...
      */
 
-    if (objc != 3) {
-	Tcl_WrongNumArgs(interp, 1, objv, "mode cmdprefix");
+    if (objc == 4 && strcmp(TclGetString(objv[1]), "-batch") == 0) {
+	batch = 1;
+    } else if (objc != 3) {
+	Tcl_WrongNumArgs(interp, 1, objv, "?-batch? mode cmdprefix");
 	return TCL_ERROR;
     }
 
@@ -657,6 +727,8 @@ TclChanCreateObjCmd(
     }
 
     Tcl_ResetResult(interp);
+    rcPtr->methodMask = methods;
+    rcPtr->batch = batch;
 
     /*
      * Everything is fine now.
@@ -1182,6 +1254,7 @@ ReflectClose(
      */
 
 #ifdef TCL_THREADS
+    TimerKill(rcPtr);
     if (rcPtr->thread != Tcl_GetCurrentThread()) {
 	ForwardParam p;
 
@@ -1197,6 +1270,23 @@ ReflectClose(
 	if (result != TCL_OK) {
 	    PassReceivedErrorInterp(interp, &p);
 	}
+
+	/*
+	 * The handler thread ran the queued writes of a batched channel
+	 * before the close. Report a failure of the last of them, as a
+	 * failing flush on close would be.
+	 */
+
+	Tcl_MutexLock(&rcForwardMutex);
+	if ((rcPtr->writeCode != TCL_OK) && (result == TCL_OK)) {
+	    result = TCL_ERROR;
+	    if ((interp != NULL) && (rcPtr->writeMsg != NULL)) {
+		Tcl_SetChannelErrorInterp(interp,
+			Tcl_NewStringObj(rcPtr->writeMsg, -1));
+	    }
+	}
+	rcPtr->writeCode = TCL_OK;
+	Tcl_MutexUnlock(&rcForwardMutex);
     } else {
 #endif
 	result = InvokeTclMethod(rcPtr, METH_FINAL, NULL, NULL, &resObj);
@@ -1292,11 +1382,30 @@ ReflectInput(
      */
 
 #ifdef TCL_THREADS
+    if (rcPtr->readLen > 0) {
+	*errorCodePtr = EOK;
+	return TakeReadAhead(rcPtr, buf, toRead);
+    }
     if (rcPtr->thread != Tcl_GetCurrentThread()) {
 	ForwardParam p;
+	int readAhead = rcPtr->batch && !HAS(rcPtr->methodMask, METH_SEEK)
+		&& (toRead < READ_AHEAD_SIZE);
+
+	/*
+	 * Batched channels which cannot seek ask the handler for more than
+	 * requested, and keep the rest for the next reads.
+	 */
 
-	p.input.buf = buf;
-	p.input.toRead = toRead;
+	if (readAhead) {
+	    if (rcPtr->readBuf == NULL) {
+		rcPtr->readBuf = (char *)ckalloc(READ_AHEAD_SIZE);
+	    }
+	    p.input.buf = rcPtr->readBuf;
+	    p.input.toRead = READ_AHEAD_SIZE;
+	} else {
+	    p.input.buf = buf;
+	    p.input.toRead = toRead;
+	}
 
 	ForwardOpToHandlerThread(rcPtr, ForwardedInput, &p);
 
@@ -1314,6 +1423,11 @@ ReflectInput(
 	    p.input.toRead = -1;
 	} else {
 	    *errorCodePtr = EOK;
+	    if (readAhead) {
+		rcPtr->readStart = 0;
+		rcPtr->readLen = p.input.toRead;
+		return TakeReadAhead(rcPtr, buf, toRead);
+	    }
 	}
 
 	return p.input.toRead;
@@ -1401,6 +1515,16 @@ ReflectOutput(
     if (rcPtr->thread != Tcl_GetCurrentThread()) {
 	ForwardParam p;
 
+	/*
+	 * Batched channels in blocking mode queue the data and return without
+	 * waiting for the handler thread.
+	 */
+
+	if (rcPtr->batch && !(((Channel *) rcPtr->chan)->state->flags
+		& CHANNEL_NONBLOCKING)) {
+	    return QueueWrite(rcPtr, buf, toWrite, errorCodePtr);
+	}
+
 	p.output.buf = buf;
 	p.output.toWrite = toWrite;
 
@@ -1637,6 +1761,13 @@ ReflectWatch(
 
     mask &= rcPtr->mode;
 
+#ifdef TCL_THREADS
+    if (rcPtr->batch && (rcPtr->thread != Tcl_GetCurrentThread())) {
+	QueueWatch(rcPtr, mask);
+	return;
+    }
+#endif
+
     if (mask == rcPtr->interest) {
 	/*
 	 * Same old, same old, why should we do something?
@@ -1772,6 +1903,14 @@ ReflectThread(
 	rcPtr->owner = Tcl_GetCurrentThread();
 	break;
     case TCL_CHANNEL_THREAD_REMOVE:
+	/*
+	 * The read-ahead timer belongs to this thread. Queued writes must not
+	 * be overtaken by writes from the next owner, should that be the
+	 * handler thread itself.
+	 */
+
+	TimerKill(rcPtr);
+	WaitWrites(rcPtr);
 	rcPtr->owner = NULL;
 	break;
     default:
@@ -2150,8 +2289,23 @@ NewReflectedChannel(
     rcPtr->chan = NULL;
     rcPtr->interp = interp;
     rcPtr->dead = 0;
+    rcPtr->methodMask = 0;
+    rcPtr->batch = 0;
 #ifdef TCL_THREADS
     rcPtr->thread = Tcl_GetCurrentThread();
+    rcPtr->readBuf = NULL;
+    rcPtr->readStart = 0;
+    rcPtr->readLen = 0;
+    rcPtr->readTimer = NULL;
+    rcPtr->watchMask = 0;
+    rcPtr->writeBuf = NULL;
+    rcPtr->writeLen = 0;
+    rcPtr->writeMax = 0;
+    rcPtr->writePending = 0;
+    rcPtr->writeQueued = 0;
+    rcPtr->writeCode = TCL_OK;
+    rcPtr->writeMsg = NULL;
+    rcPtr->writeDone = NULL;
 #endif
     rcPtr->mode = mode;
     rcPtr->interest = 0;		/* Initially no interest registered */
@@ -2242,6 +2396,18 @@ FreeReflectedChannel(
 
     TclChannelRelease((Tcl_Channel)chanPtr);
     CleanRefChannelInstance(rcPtr);
+#ifdef TCL_THREADS
+    if (rcPtr->readBuf) {
+	ckfree(rcPtr->readBuf);
+    }
+    if (rcPtr->writeBuf) {
+	ckfree(rcPtr->writeBuf);
+    }
+    if (rcPtr->writeMsg) {
+	ckfree(rcPtr->writeMsg);
+    }
+    Tcl_ConditionFinalize(&rcPtr->writeDone);
+#endif
     ckfree(rcPtr);
 }
 
@@ -2513,6 +2679,16 @@ MarkDead(
     }
     CleanRefChannelInstance(rcPtr);
     rcPtr->dead = 1;
+#ifdef TCL_THREADS
+
+    /*
+     * Wake up owners waiting for queued writes, they will not complete.
+     */
+
+    Tcl_MutexLock(&rcForwardMutex);
+    Tcl_ConditionNotify(&rcPtr->writeDone);
+    Tcl_MutexUnlock(&rcForwardMutex);
+#endif
 }
 
 static void
@@ -2793,6 +2969,14 @@ DeleteThreadReflectedChannelMap(
 	Tcl_DeleteHashEntry(hPtr);
     }
     ckfree(rcmPtr);
+
+    /*
+     * Drop the writes and watch masks batched channels queued for this
+     * thread, with their references to the channel instances. This comes
+     * last, as releasing a reference may free the instance.
+     */
+
+    Tcl_DeleteEvents(AsyncEventDelete, NULL);
 }
 
 static void
@@ -3329,6 +3513,402 @@ ForwardSetObjError(
     ForwardSetDynamicError(paramPtr, ckalloc(len));
     memcpy(paramPtr->base.msgStr, msgStr, len);
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TakeReadAhead --
+ *
+ *	Hands out data a batched channel read ahead from its handler.
+ *
+ * Results:
+ *	The number of bytes copied to buf.
+ *
+ * Side effects:
+ *	Keeps a timer posting readable events while data remains and the
+ *	owner is interested in them, as nothing else would tell it that more
+ *	can be read.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+TakeReadAhead(
+    ReflectedChannel *rcPtr,
+    char *buf,
+    int toRead)
+{
+    int n = (toRead < rcPtr->readLen) ? toRead : rcPtr->readLen;
+
+    if (n > 0) {
+	memcpy(buf, rcPtr->readBuf + rcPtr->readStart, n);
+	rcPtr->readStart += n;
+	rcPtr->readLen -= n;
+    }
+    if ((rcPtr->readLen == 0) || !(rcPtr->watchMask & TCL_READABLE)) {
+	TimerKill(rcPtr);
+    } else {
+	TimerSetup(rcPtr);
+    }
+    return n;
+}
+
+static void
+TimerKill(
+    ReflectedChannel *rcPtr)
+{
+    if (rcPtr->readTimer == NULL) {
+	return;
+    }
+    Tcl_DeleteTimerHandler(rcPtr->readTimer);
+    rcPtr->readTimer = NULL;
+}
+
+static void
+TimerSetup(
+    ReflectedChannel *rcPtr)
+{
+    if (rcPtr->readTimer != NULL) {
+	return;
+    }
+    rcPtr->readTimer = Tcl_CreateTimerHandler(SYNTHETIC_EVENT_TIME,
+	    TimerRun, rcPtr);
+}
+
+static void
+TimerRun(
+    void *clientData)
+{
+    ReflectedChannel *rcPtr = (ReflectedChannel *)clientData;
+
+    rcPtr->readTimer = NULL;
+    Tcl_NotifyChannel(rcPtr->chan, TCL_READABLE);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * QueueWrite --
+ *
+ *	OWNER thread. Queues data written to a batched channel for the
+ *	handler thread. Data written while the handler thread has not taken
+ *	the queue yet is appended to it, so that the handler sees few large
+ *	writes instead of many small ones. Waits while the queue is full.
+ *
+ * Results:
+ *	The number of bytes taken, or -1 with an error code when the channel
+ *	is dead or an earlier queued write failed.
+ *
+ * Side effects:
+ *	May queue an event for the handler thread.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+QueueWrite(
+    ReflectedChannel *rcPtr,
+    const char *buf,
+    int toWrite,
+    int *errorCodePtr)
+{
+    ForwardAsyncEvent *evPtr;
+
+    Tcl_MutexLock(&rcForwardMutex);
+    while (!rcPtr->dead && (rcPtr->writeCode == TCL_OK)
+	    && (rcPtr->writePending >= WRITE_BEHIND_LIMIT)) {
+	Tcl_ConditionWait(&rcPtr->writeDone, &rcForwardMutex, NULL);
+    }
+    if (rcPtr->dead) {
+	Tcl_MutexUnlock(&rcForwardMutex);
+	SetChannelErrorStr(rcPtr->chan, msg_send_dstlost);
+	*errorCodePtr = EINVAL;
+	return -1;
+    }
+    if (rcPtr->writeCode != TCL_OK) {
+	if (rcPtr->writeCode < 0) {
+	    /*
+	     * No error message, this is an errno signal.
+	     */
+
+	    *errorCodePtr = -rcPtr->writeCode;
+	} else {
+	    SetChannelErrorStr(rcPtr->chan, rcPtr->writeMsg);
+	    *errorCodePtr = EINVAL;
+	}
+	if (rcPtr->writeMsg != NULL) {
+	    ckfree(rcPtr->writeMsg);
+	    rcPtr->writeMsg = NULL;
+	}
+	rcPtr->writeCode = TCL_OK;
+	Tcl_MutexUnlock(&rcForwardMutex);
+	return -1;
+    }
+
+    if (rcPtr->writeLen + toWrite > rcPtr->writeMax) {
+	rcPtr->writeMax = 2 * (rcPtr->writeLen + toWrite);
+	rcPtr->writeBuf = (char *)ckrealloc(rcPtr->writeBuf, rcPtr->writeMax);
+    }
+    memcpy(rcPtr->writeBuf + rcPtr->writeLen, buf, toWrite);
+    rcPtr->writeLen += toWrite;
+    rcPtr->writePending += toWrite;
+
+    if (!rcPtr->writeQueued) {
+	rcPtr->writeQueued = 1;
+	evPtr = (ForwardAsyncEvent *)ckalloc(sizeof(ForwardAsyncEvent));
+	evPtr->event.proc = WriteEventProc;
+	evPtr->rcPtr = rcPtr;
+	evPtr->mask = 0;
+	Tcl_Preserve(rcPtr);
+	Tcl_ThreadQueueEvent(rcPtr->thread, (Tcl_Event *) evPtr,
+		TCL_QUEUE_TAIL);
+	Tcl_ThreadAlert(rcPtr->thread);
+    }
+    Tcl_MutexUnlock(&rcForwardMutex);
+
+    *errorCodePtr = EOK;
+    return toWrite;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * QueueWatch --
+ *
+ *	OWNER thread. Forwards the interest of a batched channel to the
+ *	handler thread without waiting for it. Watch failures are ignored in
+ *	any case, and later operations are queued behind the change.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	May queue an event for the handler thread. Manages the read-ahead
+ *	timer.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+QueueWatch(
+    ReflectedChannel *rcPtr,
+    int mask)
+{
+    ForwardAsyncEvent *evPtr;
+
+    if (!(mask & TCL_READABLE) || (rcPtr->readLen == 0)) {
+	TimerKill(rcPtr);
+    } else {
+	TimerSetup(rcPtr);
+    }
+    if (mask == rcPtr->watchMask) {
+	return;
+    }
+    rcPtr->watchMask = mask;
+
+    Tcl_MutexLock(&rcForwardMutex);
+    if (!rcPtr->dead) {
+	evPtr = (ForwardAsyncEvent *)ckalloc(sizeof(ForwardAsyncEvent));
+	evPtr->event.proc = WatchEventProc;
+	evPtr->rcPtr = rcPtr;
+	evPtr->mask = mask;
+	Tcl_Preserve(rcPtr);
+	Tcl_ThreadQueueEvent(rcPtr->thread, (Tcl_Event *) evPtr,
+		TCL_QUEUE_TAIL);
+	Tcl_ThreadAlert(rcPtr->thread);
+    }
+    Tcl_MutexUnlock(&rcForwardMutex);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * WaitWrites --
+ *
+ *	OWNER thread. Waits until the handler thread has completed all writes
+ *	queued for a batched channel.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+WaitWrites(
+    ReflectedChannel *rcPtr)
+{
+    if (rcPtr->thread == Tcl_GetCurrentThread()) {
+	return;
+    }
+    Tcl_MutexLock(&rcForwardMutex);
+    while (!rcPtr->dead && (rcPtr->writePending > 0)) {
+	Tcl_ConditionWait(&rcPtr->writeDone, &rcForwardMutex, NULL);
+    }
+    Tcl_MutexUnlock(&rcForwardMutex);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * WriteEventProc, WatchEventProc --
+ *
+ *	HANDLER thread. The receivers of the events queued by QueueWrite and
+ *	QueueWatch. WriteEventProc takes all data queued so far and calls the
+ *	'write' method until the handler has taken it all or fails. A failure
+ *	is kept for the owner to report, and the rest of the data is dropped.
+ *
+ * Results:
+ *	1, the event is done.
+ *
+ * Side effects:
+ *	Arbitrary, as they call upon a Tcl script.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+WriteEventProc(
+    Tcl_Event *evGPtr,
+    int mask)
+{
+    ForwardAsyncEvent *evPtr = (ForwardAsyncEvent *) evGPtr;
+    ReflectedChannel *rcPtr = evPtr->rcPtr;
+    char *data;
+    int len, offset = 0, written, code = TCL_OK;
+    char *msgStr = NULL;
+    Tcl_Obj *bufObj, *resObj;
+    ForwardParam p;
+    (void)mask;
+
+    Tcl_MutexLock(&rcForwardMutex);
+    data = rcPtr->writeBuf;
+    len = rcPtr->writeLen;
+    rcPtr->writeBuf = NULL;
+    rcPtr->writeLen = 0;
+    rcPtr->writeMax = 0;
+    rcPtr->writeQueued = 0;
+    Tcl_MutexUnlock(&rcForwardMutex);
+
+    while ((offset < len) && (code == TCL_OK)) {
+	bufObj = Tcl_NewByteArrayObj((unsigned char *) data + offset,
+		len - offset);
+	Tcl_IncrRefCount(bufObj);
+	p.base.code = TCL_OK;
+	p.base.msgStr = NULL;
+	p.base.mustFree = 0;
+
+	if (InvokeTclMethod(rcPtr, METH_WRITE, bufObj, NULL,
+		&resObj) != TCL_OK) {
+	    int errCode = ErrnoReturn(rcPtr, resObj);
+
+	    if (errCode < 0) {
+		p.base.code = errCode;
+	    } else {
+		ForwardSetObjError(&p, resObj);
+	    }
+	} else if (Tcl_GetIntFromObj(rcPtr->interp, resObj,
+		&written) != TCL_OK) {
+	    Tcl_DecrRefCount(resObj);
+	    resObj = MarshallError(rcPtr->interp);
+	    Tcl_IncrRefCount(resObj);
+	    ForwardSetObjError(&p, resObj);
+	} else if (written == 0) {
+	    ForwardSetStaticError(&p, msg_write_nothing);
+	} else if ((written < 0) || (written > len - offset)) {
+	    ForwardSetStaticError(&p, msg_write_toomuch);
+	} else {
+	    offset += written;
+	}
+	Tcl_DecrRefCount(resObj);
+	Tcl_DecrRefCount(bufObj);
+
+	code = p.base.code;
+	if ((code > 0) && (p.base.msgStr != NULL)) {
+	    if (p.base.mustFree) {
+		msgStr = p.base.msgStr;
+	    } else {
+		msgStr = (char *)ckalloc(strlen(p.base.msgStr) + 1);
+		strcpy(msgStr, p.base.msgStr);
+	    }
+	}
+    }
+    if (data != NULL) {
+	ckfree(data);
+    }
+
+    Tcl_MutexLock(&rcForwardMutex);
+    rcPtr->writePending -= len;
+    if ((code != TCL_OK) && (rcPtr->writeCode == TCL_OK)) {
+	rcPtr->writeCode = code;
+	rcPtr->writeMsg = msgStr;
+	msgStr = NULL;
+    }
+    Tcl_ConditionNotify(&rcPtr->writeDone);
+    Tcl_MutexUnlock(&rcForwardMutex);
+
+    if (msgStr != NULL) {
+	ckfree(msgStr);
+    }
+    Tcl_Release(rcPtr);
+    return 1;
+}
+
+static int
+WatchEventProc(
+    Tcl_Event *evGPtr,
+    int mask)
+{
+    ForwardAsyncEvent *evPtr = (ForwardAsyncEvent *) evGPtr;
+    ReflectedChannel *rcPtr = evPtr->rcPtr;
+    Tcl_Obj *maskObj;
+    (void)mask;
+
+    if (!rcPtr->dead) {
+	rcPtr->interest = evPtr->mask;
+	maskObj = DecodeEventMask(evPtr->mask);
+	(void) InvokeTclMethod(rcPtr, METH_WATCH, maskObj, NULL, NULL);
+	Tcl_DecrRefCount(maskObj);
+    }
+    Tcl_Release(rcPtr);
+    return 1;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * AsyncEventDelete --
+ *
+ *	HANDLER thread. Removes the events of batched channels from the queue
+ *	of an exiting thread, see DeleteThreadReflectedChannelMap. Their
+ *	channels are dead by then, so the queued data does not matter any
+ *	more; owners waiting for it were woken up by MarkDead.
+ *
+ * Results:
+ *	1 for the events to remove.
+ *
+ * Side effects:
+ *	Releases the channel instances the events refer to.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+AsyncEventDelete(
+    Tcl_Event *evGPtr,
+    void *clientData)
+{
+    (void)clientData;
+
+    if ((evGPtr->proc != WriteEventProc) && (evGPtr->proc != WatchEventProc)) {
+	return 0;
+    }
+    Tcl_Release(((ForwardAsyncEvent *) evGPtr)->rcPtr);
+    return 1;
+}
 #endif
 
 /*
@@ -135,6 +135,49 @@ TclSockMinimumBuffers(
     return TCL_OK;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclGetSocketFamily --
+ *
+ *	This function determines the address family that host names are
+ *	resolved to for an interpreter.
+ *
+ * Results:
+ *	AF_INET or AF_INET6 if the interpreter demands a certain family,
+ *	AF_UNSPEC otherwise.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclGetSocketFamily(
+    Tcl_Interp *interp)			/* Interpreter for querying the
+					 * desired socket family; can be NULL. */
+{
+    const char *family;
+
+    /*
+     * Magic variable to enforce a certain address family - to be superseded
+     * by a TIP that adds explicit switches to [socket]
+     */
+
+    if (interp != NULL) {
+	family = Tcl_GetVar(interp, "::tcl::unsupported::socketAF", 0);
+	if (family != NULL) {
+	    if (strcmp(family, "inet") == 0) {
+		return AF_INET;
+	    } else if (strcmp(family, "inet6") == 0) {
+		return AF_INET6;
+	    }
+	}
+    }
+    return AF_UNSPEC;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -169,7 +212,6 @@ TclCreateSocketAddress(
     struct addrinfo *v4head = NULL, *v4ptr = NULL;
     struct addrinfo *v6head = NULL, *v6ptr = NULL;
     char *native = NULL, portbuf[TCL_INTEGER_SPACE], *portstring;
-    const char *family = NULL;
     Tcl_DString ds;
     int result;
 
@@ -189,24 +231,7 @@ TclCreateSocketAddress(
     }
 
     (void) memset(&hints, 0, sizeof(hints));
-    hints.ai_family = AF_UNSPEC;
-
-    /*
-     * Magic variable to enforce a certain address family - to be superseded
-     * by a TIP that adds explicit switches to [socket]
-     */
-
-    if (interp != NULL) {
-        family = Tcl_GetVar(interp, "::tcl::unsupported::socketAF", 0);
-        if (family != NULL) {
-            if (strcmp(family, "inet") == 0) {
-                hints.ai_family = AF_INET;
-            } else if (strcmp(family, "inet6") == 0) {
-                hints.ai_family = AF_INET6;
-            }
-        }
-    }
-
+    hints.ai_family = TclGetSocketFamily(interp);
     hints.ai_socktype = SOCK_STREAM;
 
 #if 0
@@ -65,8 +65,47 @@ typedef struct ThreadSpecificData {
     ClientData cwdClientData;
     FilesystemRecord *filesystemList;
     size_t claims;
+    int statCacheTtl;		/* Lifetime of stat cache entries in
+				 * milliseconds; 0 if the cache is off. */
+    int statCacheInit;		/* Set once statCache is initialized. */
+    size_t statCacheEpoch;	/* Value of theStatCacheEpoch when statCache
+				 * was last known to be valid. */
+    size_t statCacheFsEpoch;	/* Value of theFilesystemEpoch at the same
+				 * time. */
+    Tcl_HashTable statCache;	/* Maps normalized native paths to
+				 * StatCacheEntry's. */
+    Tcl_WideInt statCacheHits;	/* Number of calls answered by the cache. */
+    Tcl_WideInt statCacheMisses;/* Number of calls that went to the system
+				 * while the cache was on. */
 } ThreadSpecificData;
 
+/*
+ * Tcl_FSStat and Tcl_FSAccess can answer from a per-thread cache of what
+ * they found out about native paths recently (see the statcache command
+ * below). Only facts that writing to a file cannot change are kept: that a
+ * path does not exist, that it exists, and the full stat of a directory.
+ * Entries expire after the thread's TTL; any change made through Tcl's
+ * filesystem layer, in any thread, drops all of them.
+ */
+
+typedef struct StatCacheEntry {
+    int kind;			/* One of the STAT_* values below. */
+    int errorCode;		/* The errno for STAT_MISSING. */
+    Tcl_WideInt expires;	/* When the entry goes stale, in milliseconds
+				 * since the epoch. */
+    Tcl_StatBuf buf;		/* The stat of a STAT_DIRECTORY. */
+} StatCacheEntry;
+
+#define STAT_MISSING	1	/* No such file. */
+#define STAT_EXISTS	2	/* The file exists. */
+#define STAT_DIRECTORY	3	/* The file is a directory. */
+
+/*
+ * Caches that grow larger than this are flushed instead.
+ */
+
+#define STAT_CACHE_MAX	4096
+
 /*
  * Prototypes for functions defined later in this file.
  */
@@ -82,6 +121,13 @@ static void		FsUpdateCwd(Tcl_Obj *cwdObj, ClientData clientData);
 static void		FsRecacheFilesystemList(void);
 static void		Claim(void);
 static void		Disclaim(void);
+static void		StatCacheFlush(ThreadSpecificData *tsdPtr);
+static void		StatCacheHit(void);
+static Tcl_HashEntry *	StatCacheLookup(Tcl_Obj *pathPtr,
+			    const Tcl_Filesystem *fsPtr,
+			    StatCacheEntry **entryPtrPtr);
+static void		StatCacheRecord(Tcl_HashEntry *hPtr, int kind,
+			    int errorCode, const Tcl_StatBuf *bufPtr);
 
 static void *		DivertFindSymbol(Tcl_Interp *interp,
 			    Tcl_LoadHandle loadHandle, const char *symbol);
@@ -235,6 +281,15 @@ TCL_DECLARE_MUTEX(cwdMutex)
 
 static Tcl_ThreadDataKey fsDataKey;
 
+/*
+ * This is incremented each time Tcl changes something in a filesystem. All
+ * threads' stat caches are flushed when it changes. It is read and written
+ * under statCacheMutex.
+ */
+
+static size_t theStatCacheEpoch = 1;
+TCL_DECLARE_MUTEX(statCacheMutex)
+
 /*
  * One of these structures is used each time we successfully load a file from
  * a file system by way of making a temporary copy of the file on the native
@@ -461,6 +516,17 @@ FsThrExitProc(
 	fsRecPtr = tmpFsRecPtr;
     }
     tsdPtr->filesystemList = NULL;
+
+    /*
+     * Trash the stat cache.
+     */
+
+    if (tsdPtr->statCacheInit) {
+	StatCacheFlush(tsdPtr);
+	Tcl_DeleteHashTable(&tsdPtr->statCache);
+	tsdPtr->statCacheInit = 0;
+    }
+    tsdPtr->statCacheTtl = 0;
     tsdPtr->initialized = 0;
 }
 
@@ -2124,7 +2190,33 @@ Tcl_FSStat(
     const Tcl_Filesystem *fsPtr = Tcl_FSGetFileSystemForPath(pathPtr);
 
     if (fsPtr != NULL && fsPtr->statProc != NULL) {
-	return fsPtr->statProc(pathPtr, buf);
+	StatCacheEntry *entryPtr;
+	Tcl_HashEntry *hPtr = StatCacheLookup(pathPtr, fsPtr, &entryPtr);
+	int result;
+
+	if (entryPtr != NULL) {
+	    if (entryPtr->kind == STAT_MISSING) {
+		StatCacheHit();
+		Tcl_SetErrno(entryPtr->errorCode);
+		return -1;
+	    }
+	    if (entryPtr->kind == STAT_DIRECTORY) {
+		StatCacheHit();
+		*buf = entryPtr->buf;
+		return 0;
+	    }
+	}
+	result = fsPtr->statProc(pathPtr, buf);
+	if (hPtr != NULL) {
+	    if (result != 0) {
+		StatCacheRecord(hPtr, STAT_MISSING, Tcl_GetErrno(), NULL);
+	    } else if (S_ISDIR(buf->st_mode)) {
+		StatCacheRecord(hPtr, STAT_DIRECTORY, 0, buf);
+	    } else {
+		StatCacheRecord(hPtr, STAT_EXISTS, 0, NULL);
+	    }
+	}
+	return result;
     }
     Tcl_SetErrno(ENOENT);
     return -1;
@@ -2193,12 +2285,329 @@ Tcl_FSAccess(
     const Tcl_Filesystem *fsPtr = Tcl_FSGetFileSystemForPath(pathPtr);
 
     if (fsPtr != NULL && fsPtr->accessProc != NULL) {
-	return fsPtr->accessProc(pathPtr, mode);
+	StatCacheEntry *entryPtr;
+	Tcl_HashEntry *hPtr = StatCacheLookup(pathPtr, fsPtr, &entryPtr);
+	int result;
+
+	if (entryPtr != NULL) {
+	    if (entryPtr->kind == STAT_MISSING) {
+		StatCacheHit();
+		Tcl_SetErrno(entryPtr->errorCode);
+		return -1;
+	    }
+	    if (mode == F_OK) {
+		StatCacheHit();
+		return 0;
+	    }
+	}
+	result = fsPtr->accessProc(pathPtr, mode);
+	if (hPtr != NULL) {
+	    if (result != 0) {
+		StatCacheRecord(hPtr, STAT_MISSING, Tcl_GetErrno(), NULL);
+	    } else if (entryPtr == NULL) {
+		StatCacheRecord(hPtr, STAT_EXISTS, 0, NULL);
+	    } else {
+		StatCacheRecord(hPtr, 0, 0, NULL);
+	    }
+	}
+	return result;
     }
     Tcl_SetErrno(ENOENT);
     return -1;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * StatCacheLookup --
+ *
+ *	Looks up a path in the calling thread's stat cache.
+ *
+ * Results:
+ *	NULL if the cache is off or does not apply to the path (it only holds
+ *	native paths). Otherwise the hash entry for the path, which the
+ *	caller passes to StatCacheRecord once it has asked the system; in
+ *	that case *entryPtrPtr is set to the live cache entry for the path,
+ *	or NULL if there is none.
+ *
+ * Side effects:
+ *	Flushes the cache if anything was changed through Tcl since it was
+ *	last used.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_HashEntry *
+StatCacheLookup(
+    Tcl_Obj *pathPtr,
+    const Tcl_Filesystem *fsPtr,
+    StatCacheEntry **entryPtrPtr)
+{
+    ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&fsDataKey);
+    StatCacheEntry *entryPtr;
+    Tcl_HashEntry *hPtr;
+    Tcl_Obj *normPtr;
+    Tcl_Time now;
+    size_t epoch;
+    int isNew;
+
+    *entryPtrPtr = NULL;
+    if (tsdPtr->statCacheTtl == 0 || fsPtr != &tclNativeFilesystem) {
+	return NULL;
+    }
+    normPtr = Tcl_FSGetNormalizedPath(NULL, pathPtr);
+    if (normPtr == NULL) {
+	return NULL;
+    }
+    Tcl_MutexLock(&statCacheMutex);
+    epoch = theStatCacheEpoch;
+    Tcl_MutexUnlock(&statCacheMutex);
+    if (tsdPtr->statCacheEpoch != epoch
+	    || tsdPtr->statCacheFsEpoch != theFilesystemEpoch
+	    || tsdPtr->statCache.numEntries >= STAT_CACHE_MAX) {
+	StatCacheFlush(tsdPtr);
+	tsdPtr->statCacheEpoch = epoch;
+	tsdPtr->statCacheFsEpoch = theFilesystemEpoch;
+    }
+
+    hPtr = Tcl_CreateHashEntry(&tsdPtr->statCache, TclGetString(normPtr),
+	    &isNew);
+    entryPtr = (StatCacheEntry *)Tcl_GetHashValue(hPtr);
+    if (entryPtr != NULL) {
+	Tcl_GetTime(&now);
+	if (entryPtr->expires > (Tcl_WideInt) now.sec * 1000
+		+ now.usec / 1000) {
+	    *entryPtrPtr = entryPtr;
+	}
+    }
+    return hPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * StatCacheHit --
+ *
+ *	Counts a call answered from the stat cache, without asking the
+ *	system.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Counts a cache hit.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+StatCacheHit(void)
+{
+    ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&fsDataKey);
+
+    tsdPtr->statCacheHits++;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * StatCacheRecord --
+ *
+ *	Records what the system said about a path looked up with
+ *	StatCacheLookup. A kind of 0 records nothing new.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Updates the cache entry and counts a cache miss. Errors other than
+ *	the file not existing are not cached.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+StatCacheRecord(
+    Tcl_HashEntry *hPtr,
+    int kind,
+    int errorCode,
+    const Tcl_StatBuf *bufPtr)
+{
+    ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&fsDataKey);
+    StatCacheEntry *entryPtr = (StatCacheEntry *)Tcl_GetHashValue(hPtr);
+    Tcl_Time now;
+
+    tsdPtr->statCacheMisses++;
+    if (kind == STAT_MISSING && errorCode != ENOENT && errorCode != ENOTDIR) {
+	kind = 0;
+    }
+    if (kind == 0) {
+	if (entryPtr == NULL) {
+	    Tcl_DeleteHashEntry(hPtr);
+	}
+	return;
+    }
+    if (entryPtr == NULL) {
+	entryPtr = (StatCacheEntry *)ckalloc(sizeof(StatCacheEntry));
+	Tcl_SetHashValue(hPtr, entryPtr);
+    }
+    Tcl_GetTime(&now);
+    entryPtr->kind = kind;
+    entryPtr->errorCode = errorCode;
+    entryPtr->expires = (Tcl_WideInt) now.sec * 1000 + now.usec / 1000
+	    + tsdPtr->statCacheTtl;
+    if (bufPtr != NULL) {
+	entryPtr->buf = *bufPtr;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * StatCacheFlush, TclFSInvalidateStatCache --
+ *
+ *	StatCacheFlush empties a thread's stat cache. TclFSInvalidateStatCache
+ *	is called whenever Tcl changes something in a filesystem, and makes
+ *	all threads flush their stat caches before they next use them.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	As above.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+StatCacheFlush(
+    ThreadSpecificData *tsdPtr)
+{
+    Tcl_HashEntry *hPtr;
+    Tcl_HashSearch search;
+
+    for (hPtr = Tcl_FirstHashEntry(&tsdPtr->statCache, &search);
+	    hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+	ckfree(Tcl_GetHashValue(hPtr));
+	Tcl_DeleteHashEntry(hPtr);
+    }
+}
+
+void
+TclFSInvalidateStatCache(void)
+{
+    Tcl_MutexLock(&statCacheMutex);
+    if (++theStatCacheEpoch == 0) {
+	++theStatCacheEpoch;
+    }
+    Tcl_MutexUnlock(&statCacheMutex);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclStatCacheObjCmd --
+ *
+ *	Implementation of the "::tcl::unsupported::statcache" command, which
+ *	controls the calling thread's cache of stat and access results:
+ *
+ *	    statcache flush
+ *		Empties the cache.
+ *	    statcache info
+ *		Returns a dictionary with the TTL, the number of cached
+ *		paths, and how many stat/access calls the cache answered
+ *		(hits) or passed on to the system (misses).
+ *	    statcache ttl ?milliseconds?
+ *		Returns or sets how long cached results stay valid. 0, the
+ *		default, turns the cache off.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	See above.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclStatCacheObjCmd(
+    ClientData clientData,
+    Tcl_Interp *interp,
+    int objc,
+    Tcl_Obj *const objv[])
+{
+    static const char *const options[] = {"flush", "info", "ttl", NULL};
+    enum options {STAT_FLUSH, STAT_INFO, STAT_TTL};
+    ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&fsDataKey);
+    Tcl_Obj *resultObj;
+    int index, ttl;
+
+    if (objc < 2) {
+	Tcl_WrongNumArgs(interp, 1, objv, "option ?arg?");
+	return TCL_ERROR;
+    }
+    if (Tcl_GetIndexFromObj(interp, objv[1], options, "option", 0,
+	    &index) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    if ((enum options) index != STAT_TTL && objc != 2) {
+	Tcl_WrongNumArgs(interp, 2, objv, NULL);
+	return TCL_ERROR;
+    }
+
+    switch ((enum options) index) {
+    case STAT_FLUSH:
+	if (tsdPtr->statCacheInit) {
+	    StatCacheFlush(tsdPtr);
+	}
+	break;
+    case STAT_INFO:
+	TclNewObj(resultObj);
+	TclDictPut(NULL, resultObj, "ttl",
+		Tcl_NewIntObj(tsdPtr->statCacheTtl));
+	TclDictPut(NULL, resultObj, "entries", Tcl_NewIntObj(
+		tsdPtr->statCacheInit ? tsdPtr->statCache.numEntries : 0));
+	TclDictPut(NULL, resultObj, "hits",
+		Tcl_NewWideIntObj(tsdPtr->statCacheHits));
+	TclDictPut(NULL, resultObj, "misses",
+		Tcl_NewWideIntObj(tsdPtr->statCacheMisses));
+	Tcl_SetObjResult(interp, resultObj);
+	break;
+    case STAT_TTL:
+	if (objc > 3) {
+	    Tcl_WrongNumArgs(interp, 2, objv, "?milliseconds?");
+	    return TCL_ERROR;
+	}
+	if (objc == 3) {
+	    if (TclGetIntFromObj(interp, objv[2], &ttl) != TCL_OK) {
+		return TCL_ERROR;
+	    }
+	    if (ttl < 0) {
+		Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+			"bad TTL \"%s\": must be non-negative",
+			TclGetString(objv[2])));
+		Tcl_SetErrorCode(interp, "TCL", "VALUE", "TTL", NULL);
+		return TCL_ERROR;
+	    }
+	    if (!tsdPtr->statCacheInit) {
+		Tcl_InitHashTable(&tsdPtr->statCache, TCL_STRING_KEYS);
+		tsdPtr->statCacheEpoch = theStatCacheEpoch;
+		tsdPtr->statCacheInit = 1;
+		if (tsdPtr->initialized == 0) {
+		    Tcl_CreateThreadExitHandler(FsThrExitProc, tsdPtr);
+		    tsdPtr->initialized = 1;
+		}
+	    }
+	    StatCacheFlush(tsdPtr);
+	    tsdPtr->statCacheTtl = ttl;
+	}
+	Tcl_SetObjResult(interp, Tcl_NewIntObj(tsdPtr->statCacheTtl));
+	break;
+    }
+    return TCL_OK;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -2259,6 +2668,9 @@ Tcl_FSOpenFileChannel(
 
 	retVal = fsPtr->openFileChannelProc(interp, pathPtr, mode,
 		permissions);
+	if (mode & O_CREAT) {
+	    TclFSInvalidateStatCache();
+	}
 	if (retVal == NULL) {
 	    return NULL;
 	}
@@ -2322,7 +2734,10 @@ Tcl_FSUtime(
     const Tcl_Filesystem *fsPtr = Tcl_FSGetFileSystemForPath(pathPtr);
 
     if (fsPtr != NULL && fsPtr->utimeProc != NULL) {
-	return fsPtr->utimeProc(pathPtr, tval);
+	int result = fsPtr->utimeProc(pathPtr, tval);
+
+	TclFSInvalidateStatCache();
+	return result;
     }
     /* TODO: set errno here? Tcl_SetErrno(ENOENT); */
     return -1;
@@ -2597,7 +3012,10 @@ Tcl_FSFileAttrsSet(
     const Tcl_Filesystem *fsPtr = Tcl_FSGetFileSystemForPath(pathPtr);
 
     if (fsPtr != NULL && fsPtr->fileAttrsSetProc != NULL) {
-	return fsPtr->fileAttrsSetProc(interp, index, pathPtr, objPtr);
+	int result = fsPtr->fileAttrsSetProc(interp, index, pathPtr, objPtr);
+
+	TclFSInvalidateStatCache();
+	return result;
     }
     Tcl_SetErrno(ENOENT);
     return -1;
@@ -3733,7 +4151,12 @@ Tcl_FSLink(
     const Tcl_Filesystem *fsPtr = Tcl_FSGetFileSystemForPath(pathPtr);
 
     if (fsPtr != NULL && fsPtr->linkProc != NULL) {
-	return fsPtr->linkProc(pathPtr, toPtr, linkAction);
+	Tcl_Obj *resultPtr = fsPtr->linkProc(pathPtr, toPtr, linkAction);
+
+	if (toPtr != NULL) {
+	    TclFSInvalidateStatCache();
+	}
+	return resultPtr;
     }
 
     /*
@@ -4185,6 +4608,7 @@ Tcl_FSRenameFile(
     if ((fsPtr == fsPtr2) && (fsPtr != NULL)
 	    && (fsPtr->renameFileProc != NULL)) {
 	retVal = fsPtr->renameFileProc(srcPathPtr, destPathPtr);
+	TclFSInvalidateStatCache();
     }
     if (retVal == -1) {
 	Tcl_SetErrno(EXDEV);
@@ -4227,6 +4651,7 @@ Tcl_FSCopyFile(
 
     if (fsPtr == fsPtr2 && fsPtr != NULL && fsPtr->copyFileProc != NULL) {
 	retVal = fsPtr->copyFileProc(srcPathPtr, destPathPtr);
+	TclFSInvalidateStatCache();
     }
     if (retVal == -1) {
 	Tcl_SetErrno(EXDEV);
@@ -4336,7 +4761,10 @@ Tcl_FSDeleteFile(
     const Tcl_Filesystem *fsPtr = Tcl_FSGetFileSystemForPath(pathPtr);
 
     if (fsPtr != NULL && fsPtr->deleteFileProc != NULL) {
-	return fsPtr->deleteFileProc(pathPtr);
+	int result = fsPtr->deleteFileProc(pathPtr);
+
+	TclFSInvalidateStatCache();
+	return result;
     }
     Tcl_SetErrno(ENOENT);
     return -1;
@@ -4366,7 +4794,10 @@ Tcl_FSCreateDirectory(
     const Tcl_Filesystem *fsPtr = Tcl_FSGetFileSystemForPath(pathPtr);
 
     if (fsPtr != NULL && fsPtr->createDirectoryProc != NULL) {
-	return fsPtr->createDirectoryProc(pathPtr);
+	int result = fsPtr->createDirectoryProc(pathPtr);
+
+	TclFSInvalidateStatCache();
+	return result;
     }
     Tcl_SetErrno(ENOENT);
     return -1;
@@ -4407,6 +4838,7 @@ Tcl_FSCopyDirectory(
 
     if (fsPtr == fsPtr2 && fsPtr != NULL && fsPtr->copyDirectoryProc != NULL){
 	retVal = fsPtr->copyDirectoryProc(srcPathPtr, destPathPtr, errorPtr);
+	TclFSInvalidateStatCache();
     }
     if (retVal == -1) {
 	Tcl_SetErrno(EXDEV);
@@ -4443,6 +4875,7 @@ Tcl_FSRemoveDirectory(
 				 * error, with refCount 1. */
 {
     const Tcl_Filesystem *fsPtr = Tcl_FSGetFileSystemForPath(pathPtr);
+    int result;
 
     if (fsPtr == NULL || fsPtr->removeDirectoryProc == NULL) {
 	Tcl_SetErrno(ENOENT);
@@ -4482,7 +4915,9 @@ Tcl_FSRemoveDirectory(
 	    Tcl_DecrRefCount(cwdPtr);
 	}
     }
-    return fsPtr->removeDirectoryProc(pathPtr, recursive, errorPtr);
+    result = fsPtr->removeDirectoryProc(pathPtr, recursive, errorPtr);
+    TclFSInvalidateStatCache();
+    return result;
 }
 
 /*
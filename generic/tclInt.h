@@ -343,6 +343,10 @@ typedef struct Namespace {
 				 * start of the deletion process, so there is
 				 * a chance for code to do stuff inside the
 				 * namespace before deletion completes. */
+    int cmdCreateEpoch;		/* Incremented whenever a command is added to
+				 * this namespace's command table. Used to
+				 * validate cached negative command lookups
+				 * (names that resolved to no command). */
 } Namespace;
 
 /*
@@ -1463,6 +1467,8 @@ typedef struct ExecEnv {
 				/* Top callback in NRE's stack. */
     struct CoroutineData *corPtr;
     int rewind;
+    struct ExecEnv *nextPtr;	/* Next in the interpreter's pool of unused
+				 * execution environments. */
 } ExecEnv;
 
 #define COR_IS_SUSPENDED(corPtr) \
@@ -1966,8 +1972,9 @@ typedef struct Interp {
     struct {
 	int active;		/* Flag values defining which limits have been
 				 * set. */
-	int granularityTicker;	/* Counter used to determine how often to
-				 * check the limits. */
+	int granularityTicker;	/* Number of limit checkpoints left until the
+				 * limits are checked, reloaded from their
+				 * granularities by Tcl_LimitCheck. */
 	int exceeded;		/* Which limits have been exceeded, described
 				 * as flag values the same as the 'active'
 				 * field. */
@@ -1990,7 +1997,6 @@ typedef struct Interp {
 	Tcl_TimerToken timeEvent;
 				/* Handle for a timer callback that will occur
 				 * when the time-limit is exceeded. */
-
 	Tcl_HashTable callbacks;/* Mapping from (interp,type) pair to data
 				 * used to install a limit handler callback to
 				 * run in _this_ interp when the limit is
@@ -2145,6 +2151,26 @@ typedef struct Interp {
     Tcl_Obj *innerContext;	/* cached list for fast reallocation */
     int resetErrorStack;        /* controls cleaning up of ::errorStack */
 
+    /*
+     * Execution environments of finished coroutines, kept for reuse by new
+     * coroutines. See TclAcquireExecEnv in tclExecute.c.
+     */
+
+    struct ExecEnv *execEnvPool;/* First unused execution environment. */
+    int execEnvPoolSize;	/* Number of environments in the pool. */
+
+    /*
+     * More resource limiting framework support (TIP#143), kept out of the
+     * limit structure above so that its layout does not change.
+     */
+
+    struct LimitTimer *limitTimerPtr;
+				/* Registration of the time limit with the
+				 * timer thread, see tclInterp.c, or NULL. */
+    int limitPending;		/* Limits to check at the next call of
+				 * Tcl_LimitCheck whatever their granularity,
+				 * as flag values. */
+
 #ifdef TCL_COMPILE_STATS
     /*
      * Statistical information about the bytecode compiler and interpreter's
@@ -2261,6 +2287,9 @@ typedef struct Interp {
  *			script in progress has been canceled thereby allowing
  *			the evaluation stack for the interp to be fully
  *			unwound.
+ * SHARED_LITERALS:	Non-zero means that new literals are taken from the
+ *			literal pool shared by all interpreters of the thread
+ *			that have this flag set (see tclLiteral.c).
  *
  * WARNING: For the sake of some extensions that have made use of former
  * internal values, do not re-use the flag values 2 (formerly ERR_IN_PROGRESS)
@@ -2277,6 +2306,7 @@ typedef struct Interp {
 #define INTERP_ALTERNATE_WRONG_ARGS	 0x400
 #define ERR_LEGACY_COPY			 0x800
 #define CANCELED			0x1000
+#define SHARED_LITERALS			0x2000
 
 /*
  * Maximum number of levels of nesting permitted in Tcl commands (used to
@@ -2856,6 +2886,33 @@ struct Tcl_LoadHandle_ {
 #define TCL_DD_SHORTEST0		0x0
 				/* 'Shortest possible' after masking */
 
+/*
+ * The type of procedure called to release the bytes of a ByteArray object
+ * created by TclNewMappedByteArrayObj.
+ */
+
+typedef void (TclByteArrayReleaseProc)(ClientData clientData,
+	unsigned char *bytes, int length);
+
+/*
+ * Thread pools, see tclThreadPool.c. The work procedure of a task is called
+ * on a worker thread with the interpreter of that worker; the done procedure
+ * is called afterwards on the thread that submitted the task, from its event
+ * loop.
+ */
+
+typedef struct TclThreadPool TclThreadPool;
+typedef void (TclThreadPoolWorkProc)(Tcl_Interp *interp,
+	ClientData clientData);
+typedef void (TclThreadPoolDoneProc)(ClientData clientData);
+
+/*
+ * The type of procedure called by TclListObjVisitElements and
+ * TclDictObjVisitElements with the address of each element of a value.
+ */
+
+typedef void (TclObjSlotProc)(ClientData clientData, Tcl_Obj **slotPtr);
+
 /*
  *----------------------------------------------------------------
  * Procedures shared among Tcl modules but not used by the outside world:
@@ -2897,6 +2954,16 @@ MODULE_SCOPE int	TclChanCaughtErrorBypass(Tcl_Interp *interp,
 			    Tcl_Channel chan);
 MODULE_SCOPE Tcl_ObjCmdProc TclChannelNamesCmd;
 MODULE_SCOPE Tcl_NRPostProc TclClearRootEnsemble;
+MODULE_SCOPE Tcl_Interp *TclCloneInterp(Tcl_Interp *interp,
+			    Tcl_Interp *templateInterp, Tcl_Obj *pathPtr);
+MODULE_SCOPE int	TclCloneLoadedPackages(Tcl_Interp *srcInterp,
+			    Tcl_Interp *interp);
+MODULE_SCOPE int	TclCloneNamespaces(Tcl_Interp *srcInterp,
+			    Tcl_Interp *interp);
+MODULE_SCOPE int	TclCloneNamespaceVars(Tcl_Interp *interp,
+			    Namespace *srcNsPtr, Namespace *nsPtr);
+MODULE_SCOPE void	TclClonePackageState(Tcl_Interp *srcInterp,
+			    Tcl_Interp *interp);
 MODULE_SCOPE ContLineLoc *TclContinuationsEnter(Tcl_Obj *objPtr, int num,
 			    int *loc);
 MODULE_SCOPE void	TclContinuationsEnterDerived(Tcl_Obj *objPtr,
@@ -2914,6 +2981,7 @@ MODULE_SCOPE Tcl_Command TclCreateEnsembleInNs(Tcl_Interp *interp,
 			    const char *name, Tcl_Namespace *nameNamespacePtr,
 			    Tcl_Namespace *ensembleNamespacePtr, int flags);
 MODULE_SCOPE void	TclDeleteNamespaceVars(Namespace *nsPtr);
+MODULE_SCOPE Tcl_Obj *	TclDetachObj(Tcl_Obj *objPtr);
 MODULE_SCOPE int	TclFindDictElement(Tcl_Interp *interp,
 			    const char *dict, int dictLength,
 			    const char **elementPtr, const char **nextPtr,
@@ -2926,6 +2994,8 @@ MODULE_SCOPE int	TclDictPutString(Tcl_Interp *interp, Tcl_Obj *dictPtr,
 			    const char *key, const char *value);
 MODULE_SCOPE int	TclDictRemove(Tcl_Interp *interp, Tcl_Obj *dictPtr,
 			    const char *key);
+MODULE_SCOPE int	TclDictObjVisitElements(Tcl_Obj *dictPtr,
+			    TclObjSlotProc *visitProc, ClientData clientData);
 /* TIP #280 - Modified token based evaluation, with line information. */
 MODULE_SCOPE int	TclEvalEx(Tcl_Interp *interp, const char *script,
 			    int numBytes, int flags, int line,
@@ -2977,6 +3047,7 @@ MODULE_SCOPE double	TclFloor(const mp_int *a);
 MODULE_SCOPE void	TclFormatNaN(double value, char *buffer);
 MODULE_SCOPE int	TclFSFileAttrIndex(Tcl_Obj *pathPtr,
 			    const char *attributeName, int *indexPtr);
+MODULE_SCOPE void	TclFSInvalidateStatCache(void);
 MODULE_SCOPE Tcl_Command TclNRCreateCommandInNs(Tcl_Interp *interp,
 			    const char *cmdName, Tcl_Namespace *nsPtr,
 			    Tcl_ObjCmdProc *proc, Tcl_ObjCmdProc *nreProc,
@@ -3029,6 +3100,7 @@ MODULE_SCOPE int	TclIsBareword(int byte);
 MODULE_SCOPE Tcl_Obj *	TclJoinPath(int elements, Tcl_Obj * const objv[],
 			    int forceRelative);
 MODULE_SCOPE int	TclJoinThread(Tcl_ThreadId id, int *result);
+MODULE_SCOPE Tcl_ObjCmdProc TclLazyEnsembleObjCmd;
 MODULE_SCOPE void	TclLimitRemoveAllHandlers(Tcl_Interp *interp);
 MODULE_SCOPE Tcl_Obj *	TclLindexList(Tcl_Interp *interp,
 			    Tcl_Obj *listPtr, Tcl_Obj *argPtr);
@@ -3038,6 +3110,8 @@ MODULE_SCOPE Tcl_Obj *	TclLindexFlat(Tcl_Interp *interp, Tcl_Obj *listPtr,
 MODULE_SCOPE void	TclListLines(Tcl_Obj *listObj, int line, int n,
 			    int *lines, Tcl_Obj *const *elems);
 MODULE_SCOPE Tcl_Obj *	TclListObjCopy(Tcl_Interp *interp, Tcl_Obj *listPtr);
+MODULE_SCOPE void	TclListObjVisitElements(Tcl_Obj *listPtr,
+			    TclObjSlotProc *visitProc, ClientData clientData);
 MODULE_SCOPE Tcl_Obj *	TclLsetList(Tcl_Interp *interp, Tcl_Obj *listPtr,
 			    Tcl_Obj *indexPtr, Tcl_Obj *valuePtr);
 MODULE_SCOPE Tcl_Obj *	TclLsetFlat(Tcl_Interp *interp, Tcl_Obj *listPtr,
@@ -3045,6 +3119,11 @@ MODULE_SCOPE Tcl_Obj *	TclLsetFlat(Tcl_Interp *interp, Tcl_Obj *listPtr,
 			    Tcl_Obj *valuePtr);
 MODULE_SCOPE Tcl_Command TclMakeEnsemble(Tcl_Interp *interp, const char *name,
 			    const EnsembleImplMap map[]);
+MODULE_SCOPE Command *	TclMaterializeEnsemble(Tcl_Interp *interp,
+			    Command *cmdPtr);
+MODULE_SCOPE Namespace *TclMaterializeEnsembleNs(Tcl_Interp *interp,
+			    Namespace *parentPtr, const char *name);
+MODULE_SCOPE void	TclMaterializeEnsembles(Tcl_Interp *interp);
 MODULE_SCOPE int	TclMaxListLength(const char *bytes, int numBytes,
 			    const char **endPtr);
 MODULE_SCOPE int	TclMergeReturnOptions(Tcl_Interp *interp, int objc,
@@ -3073,20 +3152,35 @@ MODULE_SCOPE int	TclParseAllWhiteSpace(const char *src, int numBytes);
 MODULE_SCOPE int	TclProcessReturn(Tcl_Interp *interp,
 			    int code, int level, Tcl_Obj *returnOpts);
 MODULE_SCOPE int	TclpObjLstat(Tcl_Obj *pathPtr, Tcl_StatBuf *buf);
+MODULE_SCOPE int	TclpMapFile(Tcl_Obj *pathPtr, Tcl_WideInt offset,
+			    Tcl_WideInt length, unsigned char **bytesPtr,
+			    int *lengthPtr, ClientData *clientDataPtr);
+MODULE_SCOPE void	TclpUnmapFile(ClientData clientData,
+			    unsigned char *bytes, int length);
 MODULE_SCOPE Tcl_Obj *	TclpTempFileName(void);
 MODULE_SCOPE Tcl_Obj *  TclpTempFileNameForLibrary(Tcl_Interp *interp, Tcl_Obj* pathPtr);
 MODULE_SCOPE Tcl_Obj *	TclNewFSPathObj(Tcl_Obj *dirPtr, const char *addStrRep,
 			    int len);
+MODULE_SCOPE Tcl_Obj *	TclNewMappedByteArrayObj(unsigned char *bytes,
+			    int length, TclByteArrayReleaseProc *releaseProc,
+			    ClientData clientData);
+MODULE_SCOPE void	TclUnmapByteArrayObj(Tcl_Obj *objPtr);
 MODULE_SCOPE int	TclpDeleteFile(const void *path);
 MODULE_SCOPE void	TclpFinalizeCondition(Tcl_Condition *condPtr);
 MODULE_SCOPE void	TclpFinalizeMutex(Tcl_Mutex *mutexPtr);
 MODULE_SCOPE void	TclpFinalizePipes(void);
 MODULE_SCOPE void	TclpFinalizeSockets(void);
 struct addrinfo; /* forward declaration, needed for TclCreateSocketAddress */
+#define TCL_TCPSERVER_REUSEPORT	(1<<0)	/* Flag for TclOpenTcpServerEx. */
 MODULE_SCOPE int	TclCreateSocketAddress(Tcl_Interp *interp,
 			    struct addrinfo **addrlist,
 			    const char *host, int port, int willBind,
 			    const char **errorMsgPtr);
+MODULE_SCOPE int	TclGetSocketFamily(Tcl_Interp *interp);
+MODULE_SCOPE Tcl_Channel TclOpenTcpServerEx(Tcl_Interp *interp, int port,
+			    const char *host, unsigned int flags,
+			    Tcl_TcpAcceptProc *acceptProc,
+			    void *acceptProcData);
 MODULE_SCOPE int	TclpThreadCreate(Tcl_ThreadId *idPtr,
 			    Tcl_ThreadCreateProc *proc, ClientData clientData,
 			    int stackSize, int flags);
@@ -3126,6 +3220,13 @@ MODULE_SCOPE void	TclpSetVariables(Tcl_Interp *interp);
 MODULE_SCOPE void *	TclThreadStorageKeyGet(Tcl_ThreadDataKey *keyPtr);
 MODULE_SCOPE void	TclThreadStorageKeySet(Tcl_ThreadDataKey *keyPtr,
 			    void *data);
+MODULE_SCOPE TclThreadPool *TclThreadPoolCreate(Tcl_Interp *interp,
+			    int numWorkers, const char *setupScript);
+MODULE_SCOPE void	TclThreadPoolDelete(TclThreadPool *poolPtr);
+MODULE_SCOPE void	TclThreadPoolSubmit(TclThreadPool *poolPtr,
+			    TclThreadPoolWorkProc *workProc,
+			    TclThreadPoolDoneProc *doneProc,
+			    ClientData clientData);
 MODULE_SCOPE void	TCL_NORETURN TclpThreadExit(int status);
 MODULE_SCOPE void	TclRememberCondition(Tcl_Condition *mutex);
 MODULE_SCOPE void	TclRememberJoinableThread(Tcl_ThreadId id);
@@ -3348,6 +3449,7 @@ MODULE_SCOPE Tcl_ObjCmdProc Tcl_OpenObjCmd;
 MODULE_SCOPE Tcl_ObjCmdProc Tcl_PackageObjCmd;
 MODULE_SCOPE Tcl_ObjCmdProc Tcl_PidObjCmd;
 MODULE_SCOPE Tcl_Command TclInitPrefixCmd(Tcl_Interp *interp);
+MODULE_SCOPE Tcl_Command TclInitThreadPoolCmd(Tcl_Interp *interp);
 MODULE_SCOPE Tcl_ObjCmdProc Tcl_PutsObjCmd;
 MODULE_SCOPE Tcl_ObjCmdProc Tcl_PwdObjCmd;
 MODULE_SCOPE Tcl_ObjCmdProc Tcl_ReadObjCmd;
@@ -3355,6 +3457,9 @@ MODULE_SCOPE Tcl_ObjCmdProc Tcl_RegexpObjCmd;
 MODULE_SCOPE Tcl_ObjCmdProc Tcl_RegsubObjCmd;
 MODULE_SCOPE Tcl_ObjCmdProc Tcl_RenameObjCmd;
 MODULE_SCOPE Tcl_ObjCmdProc Tcl_RepresentationCmd;
+MODULE_SCOPE Tcl_ObjCmdProc TclResolveCacheObjCmd;
+MODULE_SCOPE Tcl_ObjCmdProc TclSharedLiteralsObjCmd;
+MODULE_SCOPE Tcl_ObjCmdProc TclStatCacheObjCmd;
 MODULE_SCOPE Tcl_ObjCmdProc Tcl_ReturnObjCmd;
 MODULE_SCOPE Tcl_ObjCmdProc Tcl_ScanObjCmd;
 MODULE_SCOPE Tcl_ObjCmdProc Tcl_SeekObjCmd;
@@ -3568,6 +3673,8 @@ MODULE_SCOPE int	TclPtrUnsetVarIdx(Tcl_Interp *interp, Var *varPtr,
 			    Var *arrayPtr, Tcl_Obj *part1Ptr,
 			    Tcl_Obj *part2Ptr, int flags,
 			    int index);
+MODULE_SCOPE void	TclInvalidateNsCmdAdded(Namespace *nsPtr,
+			    const char *cmdName);
 MODULE_SCOPE void	TclInvalidateNsPath(Namespace *nsPtr);
 MODULE_SCOPE void	TclFindArrayPtrElements(Var *arrayPtr,
 			    Tcl_HashTable *tablePtr);
@@ -3720,6 +3827,8 @@ MODULE_SCOPE Tcl_Obj *	TclThreadAllocObj(void);
 MODULE_SCOPE void	TclThreadFreeObj(Tcl_Obj *);
 MODULE_SCOPE Tcl_Mutex *TclpNewAllocMutex(void);
 MODULE_SCOPE void	TclFreeAllocCache(void *);
+MODULE_SCOPE void	TclFlushAllocCache(void);
+MODULE_SCOPE Tcl_ObjCmdProc TclAllocCacheObjCmd;
 MODULE_SCOPE void *	TclpGetAllocCache(void);
 MODULE_SCOPE void	TclpSetAllocCache(void *);
 MODULE_SCOPE void	TclpFreeAllocMutex(Tcl_Mutex *mutex);
@@ -4100,6 +4209,20 @@ MODULE_SCOPE void	TclDbInitNewObj(Tcl_Obj *objPtr, const char *file,
 	(nsPtr)->cmdRefEpoch++;			\
     }
 
+/*
+ *----------------------------------------------------------------
+ * Macro used by the Tcl core to test whether a command is the placeholder
+ * for a core ensemble that has not been built yet (see
+ * TclMaterializeEnsemble). The ANSI C "prototype" for this macro is:
+ *
+ * MODULE_SCOPE int	TclIsLazyEnsemble(Command *cmdPtr);
+ *----------------------------------------------------------------
+ */
+
+#define TclIsLazyEnsemble(cmdPtr) \
+    (((cmdPtr)->objProc == TclLazyEnsembleObjCmd)	\
+	    && ((cmdPtr)->objClientData != NULL))
+
 /*
  *----------------------------------------------------------------------
  *
@@ -4351,25 +4474,14 @@ MODULE_SCOPE Tcl_PackageInitProc Procbodytest_SafeInit;
 /*
  *----------------------------------------------------------------
  * Inline versions of Tcl_LimitReady() and Tcl_LimitExceeded to limit number
- * of calls out of the critical path. Note that this code isn't particularly
- * readable; the non-inline version (in tclInterp.c) is much easier to
- * understand. Note also that these macros takes different args (iPtr->limit)
- * to the non-inline version.
+ * of calls out of the critical path. Note also that these macros takes
+ * different args (iPtr->limit) to the non-inline version.
  */
 
 #define TclLimitExceeded(limit) ((limit).exceeded != 0)
 
 #define TclLimitReady(limit)						\
-    (((limit).active == 0) ? 0 :					\
-    (++(limit).granularityTicker,					\
-    ((((limit).active & TCL_LIMIT_COMMANDS) &&				\
-	    (((limit).cmdGranularity == 1) ||				\
-	    ((limit).granularityTicker % (limit).cmdGranularity == 0)))	\
-	    ? 1 :							\
-    (((limit).active & TCL_LIMIT_TIME) &&				\
-	    (((limit).timeGranularity == 1) ||				\
-	    ((limit).granularityTicker % (limit).timeGranularity == 0)))\
-	    ? 1 : 0)))
+    (((limit).active != 0) && (--(limit).granularityTicker <= 0))
 
 /*
  * Compile-time assertions: these produce a compile time error if the
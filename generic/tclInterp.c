@@ -207,6 +207,37 @@ struct LimitHandler {
 #define LIMIT_HANDLER_ACTIVE    0x01
 #define LIMIT_HANDLER_DELETED   0x02
 
+/*
+ * In threaded builds, time limits are not polled for by the interpreter but
+ * watched over by a single timer thread shared by all interpreters. When a
+ * time limit expires, the timer thread marks an async handler of the limited
+ * interpreter, which makes the next Tcl_LimitReady in that interpreter's
+ * thread succeed. This keeps calls of Tcl_GetTime out of tight loops.
+ */
+
+#ifdef TCL_THREADS
+typedef struct LimitTimer {
+    Interp *iPtr;		/* The interpreter with the time limit. */
+    Tcl_AsyncHandler async;	/* Handler marked by the timer thread when the
+				 * limit expires. Created in, and only to be
+				 * deleted from, the interpreter's thread. */
+    Tcl_Time deadline;		/* When to mark the handler. */
+    int armed;			/* Whether this is in the timer thread's list.
+				 * Guarded by limitTimerMutex. */
+    struct LimitTimer *nextPtr;	/* Next in the timer thread's list. Guarded
+				 * by limitTimerMutex. */
+} LimitTimer;
+
+static struct {
+    LimitTimer *firstPtr;	/* Timers waiting for their deadline. */
+    Tcl_ThreadId thread;	/* The timer thread. */
+    int running;		/* Whether the timer thread is running. */
+    int stop;			/* Set at exit to make the thread finish. */
+    Tcl_Condition cond;		/* Wakes the thread when the list changes. */
+} limitTimers;
+TCL_DECLARE_MUTEX(limitTimerMutex)
+#endif /* TCL_THREADS */
+
 
 
 /*
@@ -227,6 +258,7 @@ static int		AliasObjCmd(ClientData dummy,
 			    Tcl_Obj *const objv[]);
 static Tcl_ObjCmdProc		AliasNRCmd;
 static Tcl_CmdDeleteProc	AliasObjCmdDeleteProc;
+static int		AliasRefersTo(Alias *aliasPtr, Tcl_Interp *interp);
 static Tcl_Interp *	GetInterp(Tcl_Interp *interp, Tcl_Obj *pathPtr);
 static Tcl_Interp *	GetInterp2(Tcl_Interp *interp, int objc,
 			    Tcl_Obj *const objv[]);
@@ -235,7 +267,7 @@ static int		ChildBgerror(Tcl_Interp *interp,
 			    Tcl_Interp *childInterp, int objc,
 			    Tcl_Obj *const objv[]);
 static Tcl_Interp *	ChildCreate(Tcl_Interp *interp, Tcl_Obj *pathPtr,
-			    int safe);
+			    int safe, Tcl_Interp *templateInterp);
 static int		ChildDebugCmd(Tcl_Interp *interp,
 			    Tcl_Interp *childInterp,
 			    int objc, Tcl_Obj *const objv[]);
@@ -266,8 +298,11 @@ static int		ChildCommandLimitCmd(Tcl_Interp *interp,
 static int		ChildTimeLimitCmd(Tcl_Interp *interp,
 			    Tcl_Interp *childInterp, int consumedObjc,
 			    int objc, Tcl_Obj *const objv[]);
+static int		CloneAliases(Tcl_Interp *templateInterp,
+			    Tcl_Interp *childInterp);
 static void		InheritLimitsFromParent(Tcl_Interp *childInterp,
 			    Tcl_Interp *parentInterp);
+static Tcl_Obj *	NewChildName(Tcl_Interp *interp);
 static void		SetScriptLimitCallback(Tcl_Interp *interp, int type,
 			    Tcl_Interp *targetInterp, Tcl_Obj *scriptObj);
 static void		CallScriptLimitCallback(ClientData clientData,
@@ -276,6 +311,14 @@ static void		DeleteScriptLimitCallback(ClientData clientData);
 static void		RunLimitHandlers(LimitHandler *handlerPtr,
 			    Tcl_Interp *interp);
 static void		TimeLimitCallback(ClientData clientData);
+static void		LimitResetCountdown(Interp *iPtr);
+static void		LimitTimerUpdate(Interp *iPtr);
+#ifdef TCL_THREADS
+static Tcl_AsyncProc	LimitTimerAsyncProc;
+static Tcl_ExitProc	LimitTimerFinalize;
+static Tcl_ThreadCreateType LimitTimerThread(ClientData clientData);
+static void		LimitTimerFree(Interp *iPtr);
+#endif
 
 /* NRE enabling */
 static Tcl_NRPostProc	NRPostInvokeHidden;
@@ -608,8 +651,8 @@ NRInterpCmd(
     int index;
     static const char *const options[] = {
 	"alias",	"aliases",	"bgerror",	"cancel",
-	"children",	"create",	"debug",	"delete",
-	"eval",		"exists",	"expose",
+	"children",	"clone",	"create",	"debug",
+	"delete",	"eval",		"exists",	"expose",
 	"hide",		"hidden",	"issafe",
 	"invokehidden",	"limit",	"marktrusted",	"recursionlimit",
 	"slaves",	"share",	"target",	"transfer",
@@ -617,8 +660,8 @@ NRInterpCmd(
     };
     enum interpOptionEnum {
 	OPT_ALIAS,	OPT_ALIASES,	OPT_BGERROR,	OPT_CANCEL,
-	OPT_CHILDREN,	OPT_CREATE,	OPT_DEBUG,	OPT_DELETE,
-	OPT_EVAL,	OPT_EXISTS,	OPT_EXPOSE,
+	OPT_CHILDREN,	OPT_CLONE,	OPT_CREATE,	OPT_DEBUG,
+	OPT_DELETE,	OPT_EVAL,	OPT_EXISTS,	OPT_EXPOSE,
 	OPT_HIDE,	OPT_HIDDEN,	OPT_ISSAFE,
 	OPT_INVOKEHID,	OPT_LIMIT,	OPT_MARKTRUSTED,OPT_RECLIMIT,
 	OPT_SLAVES,	OPT_SHARE,	OPT_TARGET,	OPT_TRANSFER
@@ -751,10 +794,35 @@ NRInterpCmd(
 
 	return Tcl_CancelEval(childInterp, resultObjPtr, 0, flags);
     }
+    case OPT_CLONE: {
+	Tcl_Interp *templateInterp;
+	Tcl_Obj *childPtr;
+
+	if ((objc != 3) && (objc != 4)) {
+	    Tcl_WrongNumArgs(interp, 2, objv, "templatePath ?path?");
+	    return TCL_ERROR;
+	}
+	templateInterp = GetInterp(interp, objv[2]);
+	if (templateInterp == NULL) {
+	    return TCL_ERROR;
+	}
+	if (objc == 4) {
+	    childPtr = objv[3];
+	} else {
+	    childPtr = NewChildName(interp);
+	}
+	if (TclCloneInterp(interp, templateInterp, childPtr) == NULL) {
+	    if (objc == 3) {
+		Tcl_DecrRefCount(childPtr);
+	    }
+	    return TCL_ERROR;
+	}
+	Tcl_SetObjResult(interp, childPtr);
+	return TCL_OK;
+    }
     case OPT_CREATE: {
-	int i, last, safe;
+	int i, last, safe, anonymous;
 	Tcl_Obj *childPtr;
-	char buf[16 + TCL_INTEGER_SPACE];
 	static const char *const createOptions[] = {
 	    "-safe",	"--", NULL
 	};
@@ -791,27 +859,12 @@ NRInterpCmd(
 		childPtr = objv[i];
 	    }
 	}
-	buf[0] = '\0';
-	if (childPtr == NULL) {
-	    /*
-	     * Create an anonymous interpreter -- we choose its name and the
-	     * name of the command. We check that the command name that we use
-	     * for the interpreter does not collide with an existing command
-	     * in the parent interpreter.
-	     */
-
-	    for (i = 0; ; i++) {
-		Tcl_CmdInfo cmdInfo;
-
-		snprintf(buf, sizeof(buf), "interp%d", i);
-		if (Tcl_GetCommandInfo(interp, buf, &cmdInfo) == 0) {
-		    break;
-		}
-	    }
-	    childPtr = Tcl_NewStringObj(buf, -1);
+	anonymous = (childPtr == NULL);
+	if (anonymous) {
+	    childPtr = NewChildName(interp);
 	}
-	if (ChildCreate(interp, childPtr, safe) == NULL) {
-	    if (buf[0] != '\0') {
+	if (ChildCreate(interp, childPtr, safe, NULL) == NULL) {
+	    if (anonymous) {
 		Tcl_DecrRefCount(childPtr);
 	    }
 	    return TCL_ERROR;
@@ -2008,7 +2061,7 @@ Tcl_CreateChild(
     Tcl_Interp *childInterp;
 
     pathPtr = Tcl_NewStringObj(childPath, -1);
-    childInterp = ChildCreate(interp, pathPtr, isSafe);
+    childInterp = ChildCreate(interp, pathPtr, isSafe, NULL);
     Tcl_DecrRefCount(pathPtr);
 
     return childInterp;
@@ -2295,7 +2348,8 @@ ChildBgerror(
  *
  *	Helper function to do the actual work of creating a child interp and
  *	new object command. Also optionally makes the new child interpreter
- *	"safe".
+ *	"safe". If a template interpreter is given, the child is populated by
+ *	copying the template's state instead of running Tcl_Init.
  *
  * Results:
  *	Returns the new Tcl_Interp * if successful or NULL if not. If failed,
@@ -2311,7 +2365,8 @@ static Tcl_Interp *
 ChildCreate(
     Tcl_Interp *interp,		/* Interp. to start search from. */
     Tcl_Obj *pathPtr,		/* Path (name) of child to create. */
-    int safe)			/* Should we make it "safe"? */
+    int safe,			/* Should we make it "safe"? */
+    Tcl_Interp *templateInterp)	/* Interp. to clone, or NULL. */
 {
     Tcl_Interp *parentInterp, *childInterp;
     Child *childPtr;
@@ -2370,12 +2425,19 @@ ChildCreate(
     ((Interp *) childInterp)->maxNestingDepth =
 	    ((Interp *) parentInterp)->maxNestingDepth;
 
+    /*
+     * Inherit the use of the thread's shared literal pool.
+     */
+
+    ((Interp *) childInterp)->flags |=
+	    ((Interp *) parentInterp)->flags & SHARED_LITERALS;
+
     if (safe) {
 	if (Tcl_MakeSafe(childInterp) == TCL_ERROR) {
 	    goto error;
 	}
     } else {
-	if (Tcl_Init(childInterp) == TCL_ERROR) {
+	if ((templateInterp == NULL) && (Tcl_Init(childInterp) == TCL_ERROR)) {
 	    goto error;
 	}
 
@@ -2413,6 +2475,21 @@ ChildCreate(
 	}
     }
 
+    /*
+     * Copy the template's state last, so that anything it has already been
+     * given above (such as the [clock] alias) is kept.
+     */
+
+    if (templateInterp != NULL) {
+	if ((TclCloneLoadedPackages(templateInterp, childInterp) != TCL_OK)
+		|| (TclCloneNamespaces(templateInterp, childInterp) != TCL_OK)
+		|| (CloneAliases(templateInterp, childInterp) != TCL_OK)) {
+	    goto error;
+	}
+	TclClonePackageState(templateInterp, childInterp);
+	Tcl_ResetResult(childInterp);
+    }
+
     return childInterp;
 
   error:
@@ -2423,6 +2500,216 @@ ChildCreate(
     return NULL;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclCloneInterp --
+ *
+ *	Creates a child interpreter whose state is copied from a template
+ *	interpreter rather than built by Tcl_Init: the packages loaded into
+ *	the template, its namespaces, variables, procedures, aliases and
+ *	package database. This is much cheaper than initialising a new
+ *	interpreter and re-sourcing the packages a worker needs. The clone is
+ *	safe if the template is.
+ *
+ * Results:
+ *	Returns the new Tcl_Interp * if successful or NULL if not. If failed,
+ *	the result of the invoking interpreter contains an error message.
+ *
+ * Side effects:
+ *	Creates a new child interpreter and a new object command.
+ *
+ *----------------------------------------------------------------------
+ */
+
+Tcl_Interp *
+TclCloneInterp(
+    Tcl_Interp *interp,		/* Interp. to start search from. */
+    Tcl_Interp *templateInterp,	/* Interp. whose state to copy. */
+    Tcl_Obj *pathPtr)		/* Path (name) of child to create. */
+{
+    Tcl_Interp *childInterp;
+
+    if (Tcl_InterpDeleted(templateInterp)) {
+	Tcl_SetObjResult(interp, Tcl_NewStringObj(
+		"cannot clone a deleted interpreter", -1));
+	Tcl_SetErrorCode(interp, "TCL", "OPERATION", "INTERP", "DELETED",
+		(char *)NULL);
+	return NULL;
+    }
+
+    Tcl_Preserve(templateInterp);
+    childInterp = ChildCreate(interp, pathPtr, Tcl_IsSafe(templateInterp),
+	    templateInterp);
+    Tcl_Release(templateInterp);
+    return childInterp;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * AliasRefersTo --
+ *
+ *	Checks whether an alias passes the path of an interpreter, as seen
+ *	from the alias's target interpreter, as one of its prefix arguments.
+ *
+ * Results:
+ *	1 if some word of the prefix names the interpreter, 0 otherwise.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+AliasRefersTo(
+    Alias *aliasPtr,		/* Alias whose prefix to examine. */
+    Tcl_Interp *interp)		/* Interp. to look for. */
+{
+    Tcl_Interp *targetInterp = aliasPtr->targetInterp;
+    Tcl_InterpState state;
+    const char *path;
+    int i, found = 0;
+
+    state = Tcl_SaveInterpState(targetInterp, TCL_OK);
+    if (Tcl_GetInterpPath(targetInterp, interp) == TCL_OK) {
+	path = Tcl_GetStringResult(targetInterp);
+	for (i = 1; i < aliasPtr->objc && !found; i++) {
+	    found = (*path != '\0')
+		    && !strcmp(TclGetString((&aliasPtr->objPtr)[i]), path);
+	}
+    }
+    Tcl_RestoreInterpState(targetInterp, state);
+    return found;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * CloneAliases --
+ *
+ *	Recreates the visible aliases of a template interpreter in its clone,
+ *	with the same target interpreter and prefix. Aliases that target the
+ *	template itself are retargeted to the clone. Aliases that target
+ *	another interpreter but pass the template's path in their prefix (as
+ *	the safe base does) would act on the template's state from the clone,
+ *	so they are refused.
+ *
+ * Results:
+ *	A standard Tcl result. Errors are left in the clone.
+ *
+ * Side effects:
+ *	Creates alias commands in the clone.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+CloneAliases(
+    Tcl_Interp *templateInterp,	/* Interp. whose aliases to copy. */
+    Tcl_Interp *childInterp)	/* Interp. to create them in. */
+{
+    Child *templatePtr, *childPtr;
+    Tcl_HashEntry *hPtr;
+    Tcl_HashSearch search;
+    Tcl_HashTable *hiddenTablePtr;
+    Alias *aliasPtr;
+    Command *cmdPtr;
+    Tcl_Interp *targetInterp;
+    Tcl_Obj *namePtr, *prefixPtr, **prefv;
+    int prefc, result;
+
+    templatePtr = &((InterpInfo *) ((Interp *) templateInterp)->interpInfo)->child;
+    childPtr = &((InterpInfo *) ((Interp *) childInterp)->interpInfo)->child;
+    hiddenTablePtr = ((Interp *) templateInterp)->hiddenCmdTablePtr;
+
+    for (hPtr = Tcl_FirstHashEntry(&templatePtr->aliasTable, &search);
+	    hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+	aliasPtr = (Alias *)Tcl_GetHashValue(hPtr);
+	cmdPtr = (Command *) aliasPtr->childCmd;
+	if ((cmdPtr->hPtr == NULL) || (cmdPtr->hPtr->tablePtr == hiddenTablePtr)
+		|| (Tcl_FindHashEntry(&childPtr->aliasTable,
+		TclGetString(aliasPtr->token)) != NULL)) {
+	    continue;
+	}
+
+	/*
+	 * Keep the token as the name unless the alias has been renamed since
+	 * it was created.
+	 */
+
+	if (Tcl_FindCommand(templateInterp, TclGetString(aliasPtr->token),
+		NULL, TCL_GLOBAL_ONLY) == aliasPtr->childCmd) {
+	    namePtr = aliasPtr->token;
+	} else {
+	    TclNewObj(namePtr);
+	    Tcl_GetCommandFullName(templateInterp, aliasPtr->childCmd,
+		    namePtr);
+	}
+	Tcl_IncrRefCount(namePtr);
+
+	targetInterp = aliasPtr->targetInterp;
+	if (targetInterp == templateInterp) {
+	    targetInterp = childInterp;
+	} else if (AliasRefersTo(aliasPtr, templateInterp)) {
+	    Tcl_SetObjResult(childInterp, Tcl_ObjPrintf(
+		    "can't clone alias \"%s\": it refers to the template"
+		    " interpreter", TclGetString(namePtr)));
+	    Tcl_SetErrorCode(childInterp, "TCL", "OPERATION", "INTERP",
+		    "CLONE", (char *)NULL);
+	    Tcl_DecrRefCount(namePtr);
+	    return TCL_ERROR;
+	}
+	prefixPtr = Tcl_NewListObj(aliasPtr->objc, &aliasPtr->objPtr);
+	Tcl_IncrRefCount(prefixPtr);
+	TclListObjGetElements(NULL, prefixPtr, &prefc, &prefv);
+	result = AliasCreate(childInterp, childInterp, targetInterp, namePtr,
+		prefv[0], prefc - 1, prefv + 1);
+	Tcl_DecrRefCount(prefixPtr);
+	Tcl_DecrRefCount(namePtr);
+	if (result != TCL_OK) {
+	    return TCL_ERROR;
+	}
+    }
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * NewChildName --
+ *
+ *	Chooses the name of an anonymous child interpreter, making sure that
+ *	it does not collide with an existing command in the parent.
+ *
+ * Results:
+ *	A new, unshared Tcl_Obj holding the name.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_Obj *
+NewChildName(
+    Tcl_Interp *interp)		/* Interp. to create the child in. */
+{
+    char buf[16 + TCL_INTEGER_SPACE];
+    int i;
+
+    for (i = 0; ; i++) {
+	Tcl_CmdInfo cmdInfo;
+
+	snprintf(buf, sizeof(buf), "interp%d", i);
+	if (Tcl_GetCommandInfo(interp, buf, &cmdInfo) == 0) {
+	    break;
+	}
+    }
+    return Tcl_NewStringObj(buf, -1);
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -3291,14 +3578,14 @@ Tcl_LimitExceeded(
  * Tcl_LimitReady --
  *
  *	Find out whether any limit has been set on the interpreter, and if so
- *	check whether the granularity of that limit is such that the full
- *	limit check should be carried out.
+ *	check whether the granularity of the limits (or an expired time limit)
+ *	is such that the full limit check should be carried out.
  *
  * Results:
  *	A boolean value that indicates whether to call Tcl_LimitCheck.
  *
  * Side effects:
- *	Increments the limit granularity counter.
+ *	Decrements the countdown to the next limit check.
  *
  * Notes:
  *	If you change this function, you MUST also update TclLimitReady() in
@@ -3313,23 +3600,10 @@ Tcl_LimitReady(
 {
     Interp *iPtr = (Interp *) interp;
 
-    if (iPtr->limit.active != 0) {
-	int ticker = ++iPtr->limit.granularityTicker;
-
-	if ((iPtr->limit.active & TCL_LIMIT_COMMANDS) &&
-		((iPtr->limit.cmdGranularity == 1) ||
-		    (ticker % iPtr->limit.cmdGranularity == 0))) {
-	    return 1;
-	}
-	if ((iPtr->limit.active & TCL_LIMIT_TIME) &&
-		((iPtr->limit.timeGranularity == 1) ||
-		    (ticker % iPtr->limit.timeGranularity == 0))) {
-	    return 1;
-	}
-    }
-    return 0;
+    return (iPtr->limit.active != 0)
+	    && (--iPtr->limit.granularityTicker <= 0);
 }
-
+
 /*
  *----------------------------------------------------------------------
  *
@@ -3358,15 +3632,30 @@ Tcl_LimitCheck(
     Tcl_Interp *interp)
 {
     Interp *iPtr = (Interp *) interp;
-    int ticker = iPtr->limit.granularityTicker;
+    int due = iPtr->limitPending | iPtr->limit.exceeded;
 
     if (Tcl_InterpDeleted(interp)) {
 	return TCL_OK;
     }
 
-    if ((iPtr->limit.active & TCL_LIMIT_COMMANDS) &&
-	    ((iPtr->limit.cmdGranularity == 1) ||
-		    (ticker % iPtr->limit.cmdGranularity == 0)) &&
+    /*
+     * Work out which limits are due for checking. When the countdown has run
+     * out, that is the command limit and (unless the timer thread is
+     * watching it) the time limit; other callers get only the limits that
+     * have been flagged as pending or are already exceeded.
+     */
+
+    iPtr->limitPending = 0;
+    if (iPtr->limit.granularityTicker <= 0) {
+	due |= TCL_LIMIT_COMMANDS;
+	if (iPtr->limitTimerPtr == NULL) {
+	    due |= TCL_LIMIT_TIME;
+	}
+	LimitResetCountdown(iPtr);
+    }
+    due &= iPtr->limit.active;
+
+    if ((due & TCL_LIMIT_COMMANDS) &&
 	    (iPtr->limit.cmdCount < iPtr->cmdCount)) {
 	iPtr->limit.exceeded |= TCL_LIMIT_COMMANDS;
 	Tcl_Preserve(interp);
@@ -3383,9 +3672,7 @@ Tcl_LimitCheck(
 	Tcl_Release(interp);
     }
 
-    if ((iPtr->limit.active & TCL_LIMIT_TIME) &&
-	    ((iPtr->limit.timeGranularity == 1) ||
-		(ticker % iPtr->limit.timeGranularity == 0))) {
+    if (due & TCL_LIMIT_TIME) {
 	Tcl_Time now;
 
 	Tcl_GetTime(&now);
@@ -3408,6 +3695,13 @@ Tcl_LimitCheck(
 	    }
 	    Tcl_Release(interp);
 	}
+
+	/*
+	 * Not expired (any more), so the timer thread must watch the limit
+	 * again.
+	 */
+
+	LimitTimerUpdate(iPtr);
     }
 
     return TCL_OK;
@@ -3755,6 +4049,15 @@ TclLimitRemoveAllHandlers(
 	Tcl_DeleteTimerHandler(iPtr->limit.timeEvent);
 	iPtr->limit.timeEvent = NULL;
     }
+
+    /*
+     * ...and the registration with the timer thread that traps them in tight
+     * loops.
+     */
+
+#ifdef TCL_THREADS
+    LimitTimerFree(iPtr);
+#endif
 }
 
 /*
@@ -3836,6 +4139,8 @@ Tcl_LimitTypeSet(
     Interp *iPtr = (Interp *) interp;
 
     iPtr->limit.active |= type;
+    LimitTimerUpdate(iPtr);
+    LimitResetCountdown(iPtr);
 }
 
 /*
@@ -3866,6 +4171,8 @@ Tcl_LimitTypeReset(
 
     iPtr->limit.active &= ~type;
     iPtr->limit.exceeded &= ~type;
+    LimitTimerUpdate(iPtr);
+    LimitResetCountdown(iPtr);
 }
 
 /*
@@ -3963,6 +4270,7 @@ Tcl_LimitSetTime(
     iPtr->limit.timeEvent = TclCreateAbsoluteTimerHandler(&nextMoment,
 	    TimeLimitCallback, interp);
     iPtr->limit.exceeded &= ~TCL_LIMIT_TIME;
+    LimitTimerUpdate(iPtr);
 }
 
 /*
@@ -3995,12 +4303,12 @@ TimeLimitCallback(
     iPtr->limit.timeEvent = NULL;
 
     /*
-     * Must reset the granularity ticker here to force an immediate full
-     * check. This is OK because we're swallowing the cost in the overall cost
-     * of the event loop. [Bug 2891362]
+     * Must force a check of the time limit here whatever its granularity.
+     * This is OK because we're swallowing the cost in the overall cost of the
+     * event loop. [Bug 2891362]
      */
 
-    iPtr->limit.granularityTicker = 0;
+    iPtr->limitPending |= TCL_LIMIT_TIME;
 
     code = Tcl_LimitCheck(interp);
     if (code != TCL_OK) {
@@ -4010,6 +4318,321 @@ TimeLimitCallback(
     Tcl_Release(interp);
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * LimitResetCountdown --
+ *
+ *	Reload the countdown to the next full limit check of an interpreter
+ *	from the granularities of its active limits. A time limit that the
+ *	timer thread watches over does not need to be polled for, so its
+ *	granularity is left out then.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Sets the countdown.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+LimitResetCountdown(
+    Interp *iPtr)
+{
+    int countdown = INT_MAX;
+
+    if (iPtr->limit.active & TCL_LIMIT_COMMANDS) {
+	countdown = iPtr->limit.cmdGranularity;
+    }
+    if ((iPtr->limit.active & TCL_LIMIT_TIME)
+	    && (iPtr->limitTimerPtr == NULL)
+	    && (iPtr->limit.timeGranularity < countdown)) {
+	countdown = iPtr->limit.timeGranularity;
+    }
+    iPtr->limit.granularityTicker = countdown;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * LimitTimerUpdate --
+ *
+ *	Bring the registration of an interpreter's time limit with the timer
+ *	thread in line with the limit: watch for the current limit if a time
+ *	limit is active and not exceeded, and stop watching otherwise. Without
+ *	thread support, the time limit is polled for at its granularity
+ *	instead.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	May start the timer thread. May change what the timer thread waits
+ *	for.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+LimitTimerUpdate(
+    Interp *iPtr)
+{
+#ifdef TCL_THREADS
+    LimitTimer *timerPtr = iPtr->limitTimerPtr;
+    LimitTimer **nextPtrPtr;
+    int watch = (iPtr->limit.active & TCL_LIMIT_TIME)
+	    && !(iPtr->limit.exceeded & TCL_LIMIT_TIME)
+	    && !(iPtr->flags & DELETED);
+
+    if (!watch && timerPtr == NULL) {
+	return;
+    }
+    if (timerPtr == NULL) {
+	timerPtr = (LimitTimer *)ckalloc(sizeof(LimitTimer));
+	timerPtr->iPtr = iPtr;
+	timerPtr->async = Tcl_AsyncCreate(LimitTimerAsyncProc, iPtr);
+	timerPtr->armed = 0;
+	timerPtr->nextPtr = NULL;
+	iPtr->limitTimerPtr = timerPtr;
+	LimitResetCountdown(iPtr);
+    }
+
+    Tcl_MutexLock(&limitTimerMutex);
+    if (timerPtr->armed) {
+	for (nextPtrPtr = &limitTimers.firstPtr; *nextPtrPtr != timerPtr;
+		nextPtrPtr = &(*nextPtrPtr)->nextPtr) {
+	    /* Empty loop body. */
+	}
+	*nextPtrPtr = timerPtr->nextPtr;
+	timerPtr->armed = 0;
+    }
+    if (watch && !limitTimers.stop) {
+	if (!limitTimers.running) {
+	    if (Tcl_CreateThread(&limitTimers.thread, LimitTimerThread, NULL,
+		    TCL_THREAD_STACK_DEFAULT, TCL_THREAD_JOINABLE) != TCL_OK) {
+		/*
+		 * No timer thread, so fall back to polling.
+		 */
+
+		Tcl_MutexUnlock(&limitTimerMutex);
+		LimitTimerFree(iPtr);
+		return;
+	    }
+	    if (limitTimers.running++ == 0) {
+		Tcl_CreateExitHandler(LimitTimerFinalize, NULL);
+	    }
+	}
+
+	/*
+	 * Same slack as for the time limit's timer handler.
+	 */
+
+	timerPtr->deadline.sec = iPtr->limit.time.sec;
+	timerPtr->deadline.usec = iPtr->limit.time.usec + 10;
+	if (timerPtr->deadline.usec >= 1000000) {
+	    timerPtr->deadline.sec++;
+	    timerPtr->deadline.usec -= 1000000;
+	}
+	timerPtr->nextPtr = limitTimers.firstPtr;
+	limitTimers.firstPtr = timerPtr;
+	timerPtr->armed = 1;
+	Tcl_ConditionNotify(&limitTimers.cond);
+    }
+    Tcl_MutexUnlock(&limitTimerMutex);
+#else
+    (void) iPtr;
+#endif /* TCL_THREADS */
+}
+
+#ifdef TCL_THREADS
+/*
+ *----------------------------------------------------------------------
+ *
+ * LimitTimerFree --
+ *
+ *	Withdraw an interpreter's time limit from the timer thread for good.
+ *	Must be called in the interpreter's thread.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The time limit is polled for at its granularity from now on.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+LimitTimerFree(
+    Interp *iPtr)
+{
+    LimitTimer *timerPtr = iPtr->limitTimerPtr;
+    LimitTimer **nextPtrPtr;
+
+    if (timerPtr == NULL) {
+	return;
+    }
+
+    /*
+     * Once out of the list, the timer thread no longer marks the async
+     * handler, so it can be deleted without holding the mutex.
+     */
+
+    Tcl_MutexLock(&limitTimerMutex);
+    if (timerPtr->armed) {
+	for (nextPtrPtr = &limitTimers.firstPtr; *nextPtrPtr != timerPtr;
+		nextPtrPtr = &(*nextPtrPtr)->nextPtr) {
+	    /* Empty loop body. */
+	}
+	*nextPtrPtr = timerPtr->nextPtr;
+	timerPtr->armed = 0;
+    }
+    Tcl_MutexUnlock(&limitTimerMutex);
+
+    Tcl_AsyncDelete(timerPtr->async);
+    ckfree(timerPtr);
+    iPtr->limitTimerPtr = NULL;
+    LimitResetCountdown(iPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * LimitTimerAsyncProc --
+ *
+ *	Async handler marked by the timer thread when an interpreter's time
+ *	limit has expired.
+ *
+ * Results:
+ *	The code passed in, unchanged.
+ *
+ * Side effects:
+ *	Makes the next limit checkpoint of the interpreter check its time
+ *	limit.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+LimitTimerAsyncProc(
+    ClientData clientData,
+    Tcl_Interp *dummy,
+    int code)
+{
+    Interp *iPtr = (Interp *)clientData;
+    (void)dummy;
+
+    iPtr->limitPending |= TCL_LIMIT_TIME;
+    iPtr->limit.granularityTicker = 0;
+    return code;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * LimitTimerThread --
+ *
+ *	The timer thread. Sleeps until the earliest deadline in its list,
+ *	then takes the timers that are due off the list and marks their async
+ *	handlers.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Marks async handlers.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_ThreadCreateType
+LimitTimerThread(
+    ClientData dummy)
+{
+    LimitTimer *timerPtr, **nextPtrPtr;
+    Tcl_Time now, wait, *waitPtr;
+    (void)dummy;
+
+    Tcl_MutexLock(&limitTimerMutex);
+    while (!limitTimers.stop) {
+	Tcl_GetTime(&now);
+	waitPtr = NULL;
+	for (nextPtrPtr = &limitTimers.firstPtr; *nextPtrPtr != NULL; ) {
+	    timerPtr = *nextPtrPtr;
+	    if (now.sec > timerPtr->deadline.sec
+		    || (now.sec == timerPtr->deadline.sec
+		    && now.usec >= timerPtr->deadline.usec)) {
+		*nextPtrPtr = timerPtr->nextPtr;
+		timerPtr->armed = 0;
+		Tcl_AsyncMark(timerPtr->async);
+		continue;
+	    }
+	    if (waitPtr == NULL || timerPtr->deadline.sec < wait.sec
+		    || (timerPtr->deadline.sec == wait.sec
+		    && timerPtr->deadline.usec < wait.usec)) {
+		wait = timerPtr->deadline;
+		waitPtr = &wait;
+	    }
+	    nextPtrPtr = &timerPtr->nextPtr;
+	}
+	if (waitPtr != NULL) {
+	    wait.sec -= now.sec;
+	    wait.usec -= now.usec;
+	    if (wait.usec < 0) {
+		wait.sec--;
+		wait.usec += 1000000;
+	    }
+	}
+	Tcl_ConditionWait(&limitTimers.cond, &limitTimerMutex, waitPtr);
+    }
+    Tcl_MutexUnlock(&limitTimerMutex);
+    Tcl_ExitThread(TCL_OK);
+    TCL_THREAD_CREATE_RETURN;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * LimitTimerFinalize --
+ *
+ *	Exit handler that stops the timer thread.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Joins the timer thread. Time limits are polled for from now on.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+LimitTimerFinalize(
+    ClientData dummy)
+{
+    LimitTimer *timerPtr;
+    int result;
+    (void)dummy;
+
+    Tcl_MutexLock(&limitTimerMutex);
+    limitTimers.stop = 1;
+    for (timerPtr = limitTimers.firstPtr; timerPtr != NULL;
+	    timerPtr = timerPtr->nextPtr) {
+	timerPtr->armed = 0;
+    }
+    limitTimers.firstPtr = NULL;
+    Tcl_ConditionNotify(&limitTimers.cond);
+    Tcl_MutexUnlock(&limitTimerMutex);
+
+    Tcl_JoinThread(limitTimers.thread, &result);
+    Tcl_ConditionFinalize(&limitTimers.cond);
+    limitTimers.running = 0;
+    limitTimers.stop = 0;
+}
+#endif /* TCL_THREADS */
+
 /*
  *----------------------------------------------------------------------
  *
@@ -4068,9 +4691,11 @@ Tcl_LimitSetGranularity(
     switch (type) {
     case TCL_LIMIT_COMMANDS:
 	iPtr->limit.cmdGranularity = granularity;
+	LimitResetCountdown(iPtr);
 	return;
     case TCL_LIMIT_TIME:
 	iPtr->limit.timeGranularity = granularity;
+	LimitResetCountdown(iPtr);
 	return;
     }
     Tcl_Panic("unknown type of resource limit");
@@ -4321,6 +4946,8 @@ TclInitLimitSupport(
     iPtr->limit.timeHandlers = NULL;
     iPtr->limit.timeEvent = NULL;
     iPtr->limit.timeGranularity = 10;
+    iPtr->limitTimerPtr = NULL;
+    iPtr->limitPending = 0;
     Tcl_InitHashTable(&iPtr->limit.callbacks,
 	    sizeof(ScriptLimitCallbackKey)/sizeof(int));
 }
@@ -4363,7 +4990,9 @@ InheritLimitsFromParent(
 	memcpy(&childPtr->limit.time, &parentPtr->limit.time,
 		sizeof(Tcl_Time));
 	childPtr->limit.timeGranularity = parentPtr->limit.timeGranularity;
+	LimitTimerUpdate(childPtr);
     }
+    LimitResetCountdown(childPtr);
 }
 
 /*
@@ -393,6 +393,56 @@ TclListObjCopy(
     return copyPtr;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclListObjVisitElements --
+ *
+ *	Calls 'visitProc' with the address of each element slot of the list
+ *	'listPtr', after giving the list an internal representation of its own
+ *	if it shares one with other values. The callback may then replace an
+ *	element by an equal value.
+ *
+ * Value
+ *
+ *	None.
+ *
+ * Effect
+ *
+ *	The internal representation of 'listPtr' may be copied. 'listPtr' must
+ *	be a list.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclListObjVisitElements(
+    Tcl_Obj *listPtr,		/* List object whose elements to visit. */
+    TclObjSlotProc *visitProc,	/* Called for each element slot. */
+    ClientData clientData)	/* Passed to visitProc. */
+{
+    List *listRepPtr = ListRepPtr(listPtr);
+    Tcl_Obj **elemPtrs;
+    int i;
+
+    if (listRepPtr->elemCount == 0) {
+	return;
+    }
+    if (listRepPtr->refCount > 1) {
+	List *copyRepPtr = NewListInternalRep(listRepPtr->elemCount,
+		&listRepPtr->elements, 1);
+
+	copyRepPtr->canonicalFlag = listRepPtr->canonicalFlag;
+	listRepPtr->refCount--;
+	ListSetInternalRep(listPtr, copyRepPtr);
+	listRepPtr = copyRepPtr;
+    }
+    elemPtrs = &listRepPtr->elements;
+    for (i = 0;  i < listRepPtr->elemCount;  i++) {
+	visitProc(clientData, &elemPtrs[i]);
+    }
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -24,6 +24,34 @@
 
 #define REBUILD_MULTIPLIER	3
 
+/*
+ * The smallest number of entries the per-thread shared literal pool holds
+ * before it is first swept for literals no longer used by any interpreter.
+ */
+
+#define SHARED_LITERAL_SWEEP	512
+
+/*
+ * Interpreters with the SHARED_LITERALS flag set take the objects for new
+ * literals from a pool shared by all such interpreters of a thread, so that
+ * the same code loaded into several interpreters does not duplicate every
+ * literal. Tcl_Obj's cannot be shared between threads, hence one pool per
+ * thread. The pool holds a reference to each of its literals and drops the
+ * ones nobody else refers to whenever it has doubled in size.
+ */
+
+typedef struct ThreadSpecificData {
+    int initialized;		/* Set once sharedLiterals is initialized. */
+    Tcl_HashTable sharedLiterals;
+				/* The pool of shared literals; keys are the
+				 * literal objects themselves, values are
+				 * unused. */
+    int sweepSize;		/* Number of entries at which the pool is next
+				 * swept for unused literals. */
+} ThreadSpecificData;
+
+static Tcl_ThreadDataKey dataKey;
+
 /*
  * Function prototypes for static functions in this file:
  */
@@ -37,6 +65,8 @@ static LiteralEntry *	LookupLiteralEntry(Tcl_Interp *interp,
 			    Tcl_Obj *objPtr);
 #endif
 static void		RebuildLiteralTable(LiteralTable *tablePtr);
+static Tcl_Obj *	GetSharedLiteral(char *bytes, int length, int flags);
+static void		FreeSharedLiterals(ClientData clientData);
 
 /*
  *----------------------------------------------------------------------
@@ -241,15 +271,21 @@ TclCreateLiteral(
 
     /*
      * The literal is new to the interpreter. Add it to the global literal
-     * table.
+     * table, reusing the value from the thread's shared literal pool if the
+     * interpreter has opted in.
      */
 
-    TclNewObj(objPtr);
-    if ((flags & LITERAL_ON_HEAP)) {
-	objPtr->bytes = bytes;
-	objPtr->length = length;
+    if ((iPtr->flags & SHARED_LITERALS) && (nsPtr == NULL)
+	    && !(flags & LITERAL_UNSHARED)) {
+	objPtr = GetSharedLiteral(bytes, length, flags);
     } else {
-	TclInitStringRep(objPtr, bytes, length);
+	TclNewObj(objPtr);
+	if ((flags & LITERAL_ON_HEAP)) {
+	    objPtr->bytes = bytes;
+	    objPtr->length = length;
+	} else {
+	    TclInitStringRep(objPtr, bytes, length);
+	}
     }
 
     if ((flags & LITERAL_UNSHARED)) {
@@ -323,6 +359,169 @@ TclCreateLiteral(
     return objPtr;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetSharedLiteral --
+ *
+ *	Find, or if necessary create, the object in the calling thread's
+ *	shared literal pool whose string representation matches the argument
+ *	string.
+ *
+ * Results:
+ *	The pooled literal object. The pool holds a reference to it.
+ *
+ * Side effects:
+ *	May initialize the pool or sweep it for unused literals. If
+ *	LITERAL_ON_HEAP is set in flags, the function takes ownership of the
+ *	string, as TclCreateLiteral does.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_Obj *
+GetSharedLiteral(
+    char *bytes,		/* The start of the string. Note that this is
+				 * not a NUL-terminated string. */
+    int length,			/* Number of bytes in the string. */
+    int flags)			/* LITERAL_ON_HEAP or 0. */
+{
+    ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
+    Tcl_HashEntry *hPtr;
+    Tcl_Obj *objPtr;
+    int isNew;
+
+    if (!tsdPtr->initialized) {
+	tsdPtr->initialized = 1;
+	Tcl_InitObjHashTable(&tsdPtr->sharedLiterals);
+	tsdPtr->sweepSize = SHARED_LITERAL_SWEEP;
+	Tcl_CreateThreadExitHandler(FreeSharedLiterals, NULL);
+    }
+
+    /*
+     * Create the object first: the string comparison of object keys relies
+     * on the terminating NUL, which the source string lacks.
+     */
+
+    TclNewObj(objPtr);
+    if ((flags & LITERAL_ON_HEAP)) {
+	objPtr->bytes = bytes;
+	objPtr->length = length;
+    } else {
+	TclInitStringRep(objPtr, bytes, length);
+    }
+    hPtr = Tcl_FindHashEntry(&tsdPtr->sharedLiterals, (char *) objPtr);
+    if (hPtr != NULL) {
+	Tcl_IncrRefCount(objPtr);
+	Tcl_DecrRefCount(objPtr);
+	return (Tcl_Obj *) Tcl_GetHashKey(&tsdPtr->sharedLiterals, hPtr);
+    }
+
+    /*
+     * Before growing the pool past its sweep size, drop the literals that
+     * only the pool still refers to, so that code compiled once and thrown
+     * away does not accumulate.
+     */
+
+    if (tsdPtr->sharedLiterals.numEntries >= tsdPtr->sweepSize) {
+	Tcl_HashSearch search;
+	Tcl_Obj *poolObjPtr;
+
+	for (hPtr = Tcl_FirstHashEntry(&tsdPtr->sharedLiterals, &search);
+		hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+	    poolObjPtr = (Tcl_Obj *)
+		    Tcl_GetHashKey(&tsdPtr->sharedLiterals, hPtr);
+	    if (poolObjPtr->refCount == 1) {
+		Tcl_DeleteHashEntry(hPtr);
+	    }
+	}
+	tsdPtr->sweepSize = 2 * tsdPtr->sharedLiterals.numEntries;
+	if (tsdPtr->sweepSize < SHARED_LITERAL_SWEEP) {
+	    tsdPtr->sweepSize = SHARED_LITERAL_SWEEP;
+	}
+    }
+
+    Tcl_CreateHashEntry(&tsdPtr->sharedLiterals, (char *) objPtr, &isNew);
+    return objPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FreeSharedLiterals --
+ *
+ *	Thread exit handler that releases the thread's shared literal pool.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Drops the pool's references to its literals.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+FreeSharedLiterals(
+    ClientData clientData)	/* Not used. */
+{
+    ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
+
+    if (tsdPtr->initialized) {
+	Tcl_DeleteHashTable(&tsdPtr->sharedLiterals);
+	tsdPtr->initialized = 0;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclSharedLiteralsObjCmd --
+ *
+ *	Implementation of the "::tcl::unsupported::sharedliterals" command,
+ *	which queries or sets whether the interpreter takes new literals from
+ *	its thread's shared literal pool. Child interpreters inherit the
+ *	setting when they are created.
+ *
+ * Results:
+ *	A standard Tcl result; the (new) setting as a boolean.
+ *
+ * Side effects:
+ *	May change the SHARED_LITERALS flag of the interpreter. Literals the
+ *	interpreter already has are not affected.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclSharedLiteralsObjCmd(
+    ClientData clientData,
+    Tcl_Interp *interp,
+    int objc,
+    Tcl_Obj *const objv[])
+{
+    Interp *iPtr = (Interp *) interp;
+    int enable;
+
+    if (objc > 2) {
+	Tcl_WrongNumArgs(interp, 1, objv, "?boolean?");
+	return TCL_ERROR;
+    }
+    if (objc == 2) {
+	if (Tcl_GetBooleanFromObj(interp, objv[1], &enable) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+	if (enable) {
+	    iPtr->flags |= SHARED_LITERALS;
+	} else {
+	    iPtr->flags &= ~SHARED_LITERALS;
+	}
+    }
+    Tcl_SetObjResult(interp,
+	    Tcl_NewBooleanObj(iPtr->flags & SHARED_LITERALS));
+    return TCL_OK;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -1084,6 +1084,100 @@ TclGetLoadedPackages(
     return TCL_OK;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclCloneLoadedPackages --
+ *
+ *	Incorporates every package that has been loaded into one interpreter
+ *	into another one as well, in the order in which they were originally
+ *	loaded, by calling their initialization functions. This is the part of
+ *	[interp clone] that cannot be done by copying script-level state.
+ *
+ * Results:
+ *	A standard Tcl result. Errors are left in the target interpreter.
+ *
+ * Side effects:
+ *	Whatever the packages' initialization functions do.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclCloneLoadedPackages(
+    Tcl_Interp *srcInterp,	/* Interpreter whose packages to copy. */
+    Tcl_Interp *interp)		/* Interpreter to load the packages into. */
+{
+    InterpPackage *ipPtr, *ipFirstPtr;
+    LoadedPackage *pkgPtr, **pkgv;
+    Tcl_PackageInitProc *initProc;
+    int i, pkgc, safe = Tcl_IsSafe(interp), code = TCL_OK;
+
+    pkgc = 0;
+    for (ipPtr = Tcl_GetAssocData(srcInterp, "tclLoad", NULL);
+	    ipPtr != NULL; ipPtr = ipPtr->nextPtr) {
+	pkgc++;
+    }
+    if (pkgc == 0) {
+	return TCL_OK;
+    }
+
+    /*
+     * The list is kept most recently loaded first; packages are initialised
+     * oldest first in case later ones depend on earlier ones.
+     */
+
+    pkgv = ckalloc(pkgc * sizeof(LoadedPackage *));
+    i = pkgc;
+    for (ipPtr = Tcl_GetAssocData(srcInterp, "tclLoad", NULL);
+	    ipPtr != NULL; ipPtr = ipPtr->nextPtr) {
+	pkgv[--i] = ipPtr->pkgPtr;
+    }
+
+    for (i = 0; i < pkgc; i++) {
+	pkgPtr = pkgv[i];
+	ipFirstPtr = Tcl_GetAssocData(interp, "tclLoad", NULL);
+	for (ipPtr = ipFirstPtr; ipPtr != NULL; ipPtr = ipPtr->nextPtr) {
+	    if (ipPtr->pkgPtr == pkgPtr) {
+		break;
+	    }
+	}
+	if (ipPtr != NULL) {
+	    continue;
+	}
+
+	initProc = safe ? pkgPtr->safeInitProc : pkgPtr->initProc;
+	if (initProc == NULL) {
+	    Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+		    "can't attach package to interpreter: no %s_%s procedure",
+		    pkgPtr->packageName, safe ? "SafeInit" : "Init"));
+	    Tcl_SetErrorCode(interp, "TCL", "OPERATION", "LOAD",
+		    safe ? "UNSAFE" : "ENTRYPOINT", (char *)NULL);
+	    code = TCL_ERROR;
+	    break;
+	}
+	code = initProc(interp);
+	if (code != TCL_OK) {
+	    break;
+	}
+
+	Tcl_MutexLock(&packageMutex);
+	if (safe) {
+	    pkgPtr->safeInterpRefCount++;
+	} else {
+	    pkgPtr->interpRefCount++;
+	}
+	Tcl_MutexUnlock(&packageMutex);
+
+	ipPtr = ckalloc(sizeof(InterpPackage));
+	ipPtr->pkgPtr = pkgPtr;
+	ipPtr->nextPtr = Tcl_GetAssocData(interp, "tclLoad", NULL);
+	Tcl_SetAssocData(interp, "tclLoad", LoadCleanupProc, ipPtr);
+    }
+    ckfree(pkgv);
+    return code;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -70,6 +70,10 @@ typedef struct ResolvedNsName {
  * Declarations for functions local to this file:
  */
 
+static int		CloneNamespaceContents(Tcl_Interp *interp,
+			    Namespace *srcNsPtr, Namespace *nsPtr);
+static int		CloneNamespaceLinks(Tcl_Interp *interp,
+			    Namespace *srcNsPtr, Namespace *nsPtr);
 static void		DeleteImportedCmd(ClientData clientData);
 static int		DoImport(Tcl_Interp *interp,
 			    Namespace *nsPtr, Tcl_HashEntry *hPtr,
@@ -114,6 +118,8 @@ static Tcl_ObjCmdProc	NamespaceUpvarCmd;
 static Tcl_ObjCmdProc	NamespaceUnknownCmd;
 static Tcl_ObjCmdProc	NamespaceWhichCmd;
 static int		SetNsNameFromAny(Tcl_Interp *interp, Tcl_Obj *objPtr);
+static int		NsPathHasCommand(Namespace *nsPtr,
+			    const char *cmdName, Namespace *skipNsPtr);
 static void		UnlinkNsPath(Namespace *nsPtr);
 
 static Tcl_NRPostProc NsEval_Callback;
@@ -785,6 +791,7 @@ Tcl_CreateNamespace(
     nsPtr->commandPathArray = NULL;
     nsPtr->commandPathSourceList = NULL;
     nsPtr->earlyDeleteProc = NULL;
+    nsPtr->cmdCreateEpoch = 0;
 
     if (parentPtr != NULL) {
 	entryPtr = Tcl_CreateHashEntry(
@@ -2192,7 +2199,7 @@ TclGetNamespaceForQualName(
 {
     Interp *iPtr = (Interp *) interp;
     Namespace *nsPtr = cxtNsPtr, *lastNsPtr = NULL, *lastAltNsPtr = NULL;
-    Namespace *altNsPtr;
+    Namespace *altNsPtr, *childPtr;
     Namespace *globalNsPtr = iPtr->globalNsPtr;
     const char *start, *end;
     const char *nsName;
@@ -2319,6 +2326,9 @@ TclGetNamespaceForQualName(
 #endif
 	    if (entryPtr != NULL) {
 		nsPtr = (Namespace *)Tcl_GetHashValue(entryPtr);
+	    } else if ((childPtr = TclMaterializeEnsembleNs(interp, nsPtr,
+		    nsName)) != NULL) {
+		nsPtr = childPtr;
 	    } else if (flags & TCL_CREATE_NS_IF_UNKNOWN) {
 		Tcl_CallFrame *framePtr;
 
@@ -2358,6 +2368,9 @@ TclGetNamespaceForQualName(
 #endif
 	    if (entryPtr != NULL) {
 		altNsPtr = (Namespace *)Tcl_GetHashValue(entryPtr);
+	    } else if ((childPtr = TclMaterializeEnsembleNs(interp, altNsPtr,
+		    nsName)) != NULL) {
+		altNsPtr = childPtr;
 	    } else {
 		/* Remember last found in alternate path */
 		lastAltNsPtr = altNsPtr;
@@ -2685,6 +2698,9 @@ Tcl_FindCommand(
 	}
     }
 
+    if ((cmdPtr != NULL) && TclIsLazyEnsemble(cmdPtr)) {
+	cmdPtr = TclMaterializeEnsemble(interp, cmdPtr);
+    }
     if (cmdPtr != NULL) {
 	cmdPtr->flags  &= ~CMD_VIA_RESOLVER;
 	return (Tcl_Command) cmdPtr;
@@ -2763,6 +2779,13 @@ TclResetShadowedCmdRefs(
      * cmdName.
      */
 
+    /*
+     * Any cached negative lookup that consulted the namespace of the new
+     * command might now succeed.
+     */
+
+    newCmdPtr->nsPtr->cmdCreateEpoch++;
+
     cmdName = (char *)Tcl_GetHashKey(newCmdPtr->hPtr->tablePtr, newCmdPtr->hPtr);
     for (nsPtr=newCmdPtr->nsPtr ; (nsPtr!=NULL) && (nsPtr!=globalNsPtr) ;
 	    nsPtr=nsPtr->parentPtr) {
@@ -3024,6 +3047,15 @@ NamespaceChildrenCmd(
 	}
     }
 
+    /*
+     * The implementation namespaces of the lazily built core ensembles are
+     * listed whether or not anything has needed them yet.
+     */
+
+    if ((nsPtr->parentPtr == globalNsPtr) && !strcmp(nsPtr->name, "tcl")) {
+	TclMaterializeEnsembles(interp);
+    }
+
     /*
      * Create a list containing the full names of all child namespaces whose
      * names match the specified pattern, if any.
@@ -4200,6 +4232,112 @@ TclInvalidateNsPath(
     }
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclInvalidateNsCmdAdded --
+ *
+ *	Invalidate the name resolution caches that might be affected by a
+ *	command called cmdName having been added to the given namespace. This
+ *	is a finer-grained alternative to calling TclInvalidateNsCmdLookup
+ *	and TclInvalidateNsPath: cached references are only discarded in
+ *	namespaces where the new command can actually shadow another command
+ *	of the same name, so defining unrelated commands in a namespace that
+ *	is on some other namespace's path keeps that namespace's cache warm.
+ *
+ * Results:
+ *	nothing
+ *
+ * Side effects:
+ *	May increment the export epoch of the namespace and the command
+ *	reference epoch of the namespace and of any namespace whose path
+ *	includes it.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclInvalidateNsCmdAdded(
+    Namespace *nsPtr,
+    const char *cmdName)
+{
+    Namespace *globalNsPtr = ((Interp *) nsPtr->interp)->globalNsPtr;
+    NamespacePathEntry *nsPathPtr;
+
+    if (nsPtr->numExportPatterns) {
+	nsPtr->exportLookupEpoch++;
+    }
+
+    /*
+     * The new command takes precedence over anything of the same name found
+     * along the namespace's own path.
+     */
+
+    if (nsPtr->commandPathLength
+	    && NsPathHasCommand(nsPtr, cmdName, nsPtr)) {
+	nsPtr->cmdRefEpoch++;
+    }
+
+    /*
+     * Namespaces with this namespace on their path might have resolved the
+     * name to a command found later on their path or in the global
+     * namespace. If the name resolved to nothing at all, there is no cached
+     * reference to discard; cached negative lookups are validated through
+     * the cmdCreateEpoch instead.
+     */
+
+    for (nsPathPtr = nsPtr->commandPathSourceList; nsPathPtr != NULL;
+	    nsPathPtr = nsPathPtr->nextPtr) {
+	Namespace *creatorNsPtr = nsPathPtr->creatorNsPtr;
+
+	if ((nsPathPtr->nsPtr == NULL) || (creatorNsPtr == NULL)) {
+	    continue;
+	}
+	if (NsPathHasCommand(creatorNsPtr, cmdName, nsPtr)
+		|| ((creatorNsPtr != globalNsPtr) && (nsPtr != globalNsPtr)
+		&& Tcl_FindHashEntry(&globalNsPtr->cmdTable, cmdName))) {
+	    creatorNsPtr->cmdRefEpoch++;
+	}
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * NsPathHasCommand --
+ *
+ *	Helper for TclInvalidateNsCmdAdded that checks whether any namespace
+ *	on the command path of nsPtr, other than skipNsPtr, contains a command
+ *	called cmdName.
+ *
+ * Results:
+ *	1 if such a command exists, 0 otherwise.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+NsPathHasCommand(
+    Namespace *nsPtr,
+    const char *cmdName,
+    Namespace *skipNsPtr)
+{
+    int i;
+
+    for (i = 0; i < nsPtr->commandPathLength; i++) {
+	Namespace *pathNsPtr = nsPtr->commandPathArray[i].nsPtr;
+
+	if ((pathNsPtr != NULL) && (pathNsPtr != skipNsPtr)
+		&& Tcl_FindHashEntry(&pathNsPtr->cmdTable, cmdName)) {
+	    return 1;
+	}
+    }
+    return 0;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -4874,6 +5012,291 @@ TclGetNamespaceChildTable(
 #endif
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclCloneNamespaces --
+ *
+ *	Reproduces the script-level namespace state of one interpreter in
+ *	another, as part of [interp clone]: the tree of namespaces, their
+ *	variables, procedures, export lists, unknown handlers, command paths,
+ *	imports and ensembles. Procedures are recreated from their argument
+ *	lists and body strings and compile on first use in the target.
+ *
+ *	Commands implemented in C are not copied; the target either has them
+ *	already or gets them from TclCloneLoadedPackages. Where the target
+ *	already has a command that is not a procedure, it is kept. Namespaces
+ *	owned by C code (those with a deletion callback, such as the
+ *	namespaces of TclOO objects) are skipped along with their children.
+ *
+ * Results:
+ *	A standard Tcl result. Errors are left in the target interpreter.
+ *
+ * Side effects:
+ *	Creates namespaces, variables and commands in the target interpreter.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclCloneNamespaces(
+    Tcl_Interp *srcInterp,	/* Interpreter to copy the namespaces from. */
+    Tcl_Interp *interp)		/* Interpreter to copy them into. */
+{
+    Namespace *srcGlobalNsPtr = ((Interp *) srcInterp)->globalNsPtr;
+    Namespace *globalNsPtr = ((Interp *) interp)->globalNsPtr;
+
+    /*
+     * Two passes: the first creates everything that lives inside one
+     * namespace, the second everything that refers to other namespaces and
+     * so needs the whole tree to be in place.
+     */
+
+    if (CloneNamespaceContents(interp, srcGlobalNsPtr, globalNsPtr)
+	    != TCL_OK) {
+	return TCL_ERROR;
+    }
+    return CloneNamespaceLinks(interp, srcGlobalNsPtr, globalNsPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * CloneNamespaceContents, CloneNamespaceLinks --
+ *
+ *	The two recursive passes of TclCloneNamespaces. The first creates the
+ *	namespaces and copies variables, procedures, export patterns and the
+ *	unknown handler; the second sets up command paths, imports and
+ *	ensembles.
+ *
+ * Results:
+ *	A standard Tcl result. Errors are left in interp.
+ *
+ * Side effects:
+ *	See TclCloneNamespaces.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+CloneNamespaceContents(
+    Tcl_Interp *interp,		/* Interpreter receiving the copy. */
+    Namespace *srcNsPtr,	/* Namespace to copy. */
+    Namespace *nsPtr)		/* Its counterpart in interp. */
+{
+    Tcl_HashSearch search;
+    Tcl_HashEntry *hPtr;
+    Command *cmdPtr;
+    Proc *procPtr;
+    CompiledLocal *localPtr;
+    Namespace *srcChildPtr, *childPtr;
+    Tcl_Obj *objv[4], *argPtr;
+    int i, result;
+
+    if (TclCloneNamespaceVars(interp, srcNsPtr, nsPtr) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    for (i = 0; i < srcNsPtr->numExportPatterns; i++) {
+	if (Tcl_Export(interp, (Tcl_Namespace *) nsPtr,
+		srcNsPtr->exportArrayPtr[i], 0) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+    }
+    if (srcNsPtr->unknownHandlerPtr != NULL) {
+	if (Tcl_SetNamespaceUnknownHandler(interp, (Tcl_Namespace *) nsPtr,
+		srcNsPtr->unknownHandlerPtr) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+    }
+
+    for (hPtr = Tcl_FirstHashEntry(&srcNsPtr->cmdTable, &search);
+	    hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+	cmdPtr = (Command *)Tcl_GetHashValue(hPtr);
+	if (cmdPtr->deleteProc == DeleteImportedCmd) {
+	    continue;
+	}
+	procPtr = TclIsProc(cmdPtr);
+	if ((procPtr == NULL) || (procPtr->bodyPtr->bytes == NULL)) {
+	    continue;
+	}
+
+	/*
+	 * A procedure that replaced a C command in the template (such as a
+	 * wrapper around [puts]) replaces it in the copy too: [proc] deletes
+	 * whatever command has the name already.
+	 */
+
+	TclNewObj(objv[2]);
+	for (localPtr = procPtr->firstLocalPtr; localPtr != NULL;
+		localPtr = localPtr->nextPtr) {
+	    if (!TclIsVarArgument(localPtr)) {
+		continue;
+	    }
+	    argPtr = Tcl_NewStringObj(localPtr->name, localPtr->nameLength);
+	    if (localPtr->defValuePtr != NULL) {
+		argPtr = Tcl_NewListObj(1, &argPtr);
+		Tcl_ListObjAppendElement(NULL, argPtr, localPtr->defValuePtr);
+	    }
+	    Tcl_ListObjAppendElement(NULL, objv[2], argPtr);
+	}
+	TclNewLiteralStringObj(objv[0], "proc");
+	objv[1] = Tcl_ObjPrintf("%s::%s",
+		(nsPtr->parentPtr == NULL) ? "" : nsPtr->fullName,
+		(char *) Tcl_GetHashKey(&srcNsPtr->cmdTable, hPtr));
+	objv[3] = Tcl_NewStringObj(procPtr->bodyPtr->bytes,
+		procPtr->bodyPtr->length);
+	for (i = 0; i < 4; i++) {
+	    Tcl_IncrRefCount(objv[i]);
+	}
+	result = Tcl_ProcObjCmd(NULL, interp, 4, objv);
+	for (i = 0; i < 4; i++) {
+	    Tcl_DecrRefCount(objv[i]);
+	}
+	if (result != TCL_OK) {
+	    return TCL_ERROR;
+	}
+    }
+
+    for (hPtr = Tcl_FirstHashEntry(
+	    TclGetNamespaceChildTable((Tcl_Namespace *) srcNsPtr), &search);
+	    hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+	srcChildPtr = (Namespace *)Tcl_GetHashValue(hPtr);
+	if ((srcChildPtr->flags & NS_DYING)
+		|| (srcChildPtr->deleteProc != NULL)) {
+	    continue;
+	}
+	childPtr = (Namespace *) Tcl_FindNamespace(interp,
+		srcChildPtr->fullName, NULL, TCL_GLOBAL_ONLY);
+	if (childPtr == NULL) {
+	    childPtr = (Namespace *) Tcl_CreateNamespace(interp,
+		    srcChildPtr->fullName, NULL, NULL);
+	    if (childPtr == NULL) {
+		return TCL_ERROR;
+	    }
+	} else if (childPtr->deleteProc != NULL) {
+	    continue;
+	}
+	if (CloneNamespaceContents(interp, srcChildPtr, childPtr) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+    }
+    return TCL_OK;
+}
+
+static int
+CloneNamespaceLinks(
+    Tcl_Interp *interp,		/* Interpreter receiving the copy. */
+    Namespace *srcNsPtr,	/* Namespace to copy. */
+    Namespace *nsPtr)		/* Its counterpart in interp. */
+{
+    Tcl_HashSearch search;
+    Tcl_HashEntry *hPtr, *realPtr;
+    Command *cmdPtr, *realCmdPtr;
+    Namespace *srcChildPtr, *childPtr, *realNsPtr, *ensNsPtr;
+    Tcl_Namespace *srcEnsNsPtr, **pathAry;
+    Tcl_Command token;
+    Tcl_Obj *objPtr, *nameObj;
+    const char *cmdName;
+    int i, pathLength, flags;
+
+    if (srcNsPtr->commandPathLength > 0) {
+	pathAry = (Tcl_Namespace **)TclStackAlloc(interp,
+		sizeof(Tcl_Namespace *) * srcNsPtr->commandPathLength);
+	pathLength = 0;
+	for (i = 0; i < srcNsPtr->commandPathLength; i++) {
+	    if (srcNsPtr->commandPathArray[i].nsPtr == NULL) {
+		continue;
+	    }
+	    pathAry[pathLength] = Tcl_FindNamespace(interp,
+		    srcNsPtr->commandPathArray[i].nsPtr->fullName, NULL,
+		    TCL_GLOBAL_ONLY);
+	    if (pathAry[pathLength] != NULL) {
+		pathLength++;
+	    }
+	}
+	TclSetNsPath(nsPtr, pathLength, pathAry);
+	TclStackFree(interp, pathAry);
+    }
+
+    for (hPtr = Tcl_FirstHashEntry(&srcNsPtr->cmdTable, &search);
+	    hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+	cmdName = (const char *) Tcl_GetHashKey(&srcNsPtr->cmdTable, hPtr);
+	if (Tcl_FindHashEntry(&nsPtr->cmdTable, cmdName) != NULL) {
+	    continue;
+	}
+	cmdPtr = (Command *)Tcl_GetHashValue(hPtr);
+
+	if (cmdPtr->deleteProc == DeleteImportedCmd) {
+	    /*
+	     * Recreate the import from the counterpart of the command it
+	     * refers to, provided that exists under the same name.
+	     */
+
+	    realCmdPtr = ((ImportedCmdData *) cmdPtr->objClientData)->realCmdPtr;
+	    if ((realCmdPtr->hPtr == NULL) || strcmp(cmdName,
+		    Tcl_GetHashKey(&realCmdPtr->nsPtr->cmdTable,
+		    realCmdPtr->hPtr)) != 0) {
+		continue;
+	    }
+	    realNsPtr = (Namespace *) Tcl_FindNamespace(interp,
+		    realCmdPtr->nsPtr->fullName, NULL, TCL_GLOBAL_ONLY);
+	    if (realNsPtr == NULL) {
+		continue;
+	    }
+	    realPtr = Tcl_FindHashEntry(&realNsPtr->cmdTable, cmdName);
+	    if ((realPtr != NULL) && (DoImport(interp, nsPtr, realPtr,
+		    cmdName, cmdName, realNsPtr, 0) != TCL_OK)) {
+		return TCL_ERROR;
+	    }
+	} else if (Tcl_IsEnsemble((Tcl_Command) cmdPtr)) {
+	    Tcl_GetEnsembleNamespace(NULL, (Tcl_Command) cmdPtr, &srcEnsNsPtr);
+	    ensNsPtr = (Namespace *) Tcl_FindNamespace(interp,
+		    srcEnsNsPtr->fullName, NULL, TCL_GLOBAL_ONLY);
+	    if (ensNsPtr == NULL) {
+		continue;
+	    }
+	    Tcl_GetEnsembleFlags(NULL, (Tcl_Command) cmdPtr, &flags);
+	    nameObj = Tcl_ObjPrintf("%s::%s",
+		    (nsPtr->parentPtr == NULL) ? "" : nsPtr->fullName, cmdName);
+	    token = Tcl_CreateEnsemble(interp, TclGetString(nameObj),
+		    (Tcl_Namespace *) ensNsPtr, flags);
+	    Tcl_DecrRefCount(nameObj);
+
+	    Tcl_GetEnsembleSubcommandList(NULL, (Tcl_Command) cmdPtr,
+		    &objPtr);
+	    Tcl_SetEnsembleSubcommandList(interp, token, objPtr);
+	    Tcl_GetEnsembleMappingDict(NULL, (Tcl_Command) cmdPtr,
+		    &objPtr);
+	    Tcl_SetEnsembleMappingDict(interp, token, objPtr);
+	    Tcl_GetEnsembleUnknownHandler(NULL, (Tcl_Command) cmdPtr,
+		    &objPtr);
+	    Tcl_SetEnsembleUnknownHandler(interp, token, objPtr);
+	    Tcl_GetEnsembleParameterList(NULL, (Tcl_Command) cmdPtr,
+		    &objPtr);
+	    Tcl_SetEnsembleParameterList(interp, token, objPtr);
+	}
+    }
+
+    for (hPtr = Tcl_FirstHashEntry(
+	    TclGetNamespaceChildTable((Tcl_Namespace *) srcNsPtr), &search);
+	    hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+	srcChildPtr = (Namespace *)Tcl_GetHashValue(hPtr);
+	if ((srcChildPtr->flags & NS_DYING)
+		|| (srcChildPtr->deleteProc != NULL)) {
+	    continue;
+	}
+	childPtr = (Namespace *) Tcl_FindNamespace(interp,
+		srcChildPtr->fullName, NULL, TCL_GLOBAL_ONLY);
+	if ((childPtr == NULL) || (childPtr->deleteProc != NULL)) {
+	    continue;
+	}
+	if (CloneNamespaceLinks(interp, srcChildPtr, childPtr) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+    }
+    return TCL_OK;
+}
+
 /*
  *----------------------------------------------------------------------
  *
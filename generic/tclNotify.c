@@ -26,6 +26,40 @@ Tcl_NotifierProcs tclNotifierHooks = {
     NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL
 };
 
+/*
+ * Events queued at the tail of another thread's queue are not linked into
+ * that queue directly. Instead, producers push them onto a lock-free LIFO
+ * (pendingEventPtr) with a compare-and-swap, and whoever next holds the
+ * queueMutex takes the whole LIFO in one exchange and appends it, in FIFO
+ * order, to the queue proper. Producers therefore never contend with the
+ * consumer thread for its queueMutex while it is walking the queue. This
+ * needs atomic primitives; where none are known the lock-based path is used
+ * for every event.
+ */
+
+#if defined(TCL_THREADS) && defined(__GNUC__) && defined(__ATOMIC_SEQ_CST)
+#   define NOTIFY_LOCKFREE 1
+#   define NotifyCasPtr(ptr, old, new) \
+	__sync_bool_compare_and_swap((ptr), (old), (new))
+#   define NotifySwapPtr(ptr, new) \
+	__atomic_exchange_n((ptr), (new), __ATOMIC_SEQ_CST)
+#   define NotifyCasLong(ptr, old, new) \
+	__sync_bool_compare_and_swap((ptr), (old), (new))
+#   define NotifySwapLong(ptr, new) \
+	__atomic_exchange_n((ptr), (new), __ATOMIC_SEQ_CST)
+#elif defined(TCL_THREADS) && defined(_WIN32)
+#   define NOTIFY_LOCKFREE 1
+#   define NotifyCasPtr(ptr, old, new) \
+	(InterlockedCompareExchangePointer((PVOID volatile *)(ptr), \
+		(new), (old)) == (old))
+#   define NotifySwapPtr(ptr, new) \
+	InterlockedExchangePointer((PVOID volatile *)(ptr), (new))
+#   define NotifyCasLong(ptr, old, new) \
+	(InterlockedCompareExchange((ptr), (new), (old)) == (old))
+#   define NotifySwapLong(ptr, new) \
+	InterlockedExchange((ptr), (new))
+#endif
+
 /*
  * For each event source (created with Tcl_CreateEventSource) there is a
  * structure of the following type:
@@ -49,6 +83,16 @@ typedef struct EventSource {
  * grab in Tk). These elements are protected by the queueMutex so that any
  * thread can queue an event on any notifier. Note that all of the values in
  * this structure will be initialized to 0.
+ *
+ * The pendingEventPtr and alertPending fields are only ever accessed with
+ * the atomic primitives above. alertPending is set by the Tcl_ThreadAlert
+ * that actually wakes the notifier, and the alerts that follow are skipped
+ * until the thread clears it again at the start of Tcl_ServiceEvent. Every
+ * skipped alert was thus made for something that happened before the clear,
+ * and Tcl_ServiceEvent looks for asynchronous handlers and pending events,
+ * and Tcl_DoOneEvent asks the event sources, after the clear and before the
+ * thread waits again. So a batch of events queued from other threads costs
+ * one wakeup.
  */
 
 typedef struct ThreadSpecificData {
@@ -58,6 +102,15 @@ typedef struct ThreadSpecificData {
 				 * if none. */
     Tcl_Mutex queueMutex;	/* Mutex to protect access to the previous
 				 * three fields. */
+#ifdef NOTIFY_LOCKFREE
+    Tcl_Event *volatile pendingEventPtr;
+				/* Most recent event queued at the tail by
+				 * another thread and not yet moved to the
+				 * queue proper, linked in LIFO order. */
+    volatile long alertPending;	/* 1 if the notifier has been alerted and
+				 * the thread has not yet looked for what it
+				 * was alerted for, see above. */
+#endif
     int serviceMode;		/* One of TCL_SERVICE_NONE or
 				 * TCL_SERVICE_ALL. */
     int blockTimeSet;		/* 0 means there is no maximum block time:
@@ -96,6 +149,13 @@ TCL_DECLARE_MUTEX(listLock)
 
 static void		QueueEvent(ThreadSpecificData *tsdPtr,
 			    Tcl_Event *evPtr, Tcl_QueuePosition position);
+#ifdef NOTIFY_LOCKFREE
+static void		PushPendingEvent(ThreadSpecificData *tsdPtr,
+			    Tcl_Event *evPtr);
+static void		TakePendingEvents(ThreadSpecificData *tsdPtr);
+#else
+#define TakePendingEvents(tsdPtr)
+#endif
 
 /*
  *----------------------------------------------------------------------
@@ -178,6 +238,7 @@ TclFinalizeNotifier(void)
     }
 
     Tcl_MutexLock(&(tsdPtr->queueMutex));
+    TakePendingEvents(tsdPtr);
     for (evPtr = tsdPtr->firstEventPtr; evPtr != NULL; ) {
 	hold = evPtr;
 	evPtr = evPtr->nextPtr;
@@ -407,9 +468,16 @@ Tcl_ThreadQueueEvent(
 
     /*
      * Queue the event if there was a notifier associated with the thread.
+     * Events for the tail of another thread's queue take the lock-free path.
      */
 
     if (tsdPtr) {
+#ifdef NOTIFY_LOCKFREE
+	if (position == TCL_QUEUE_TAIL
+		&& threadId != Tcl_GetCurrentThread()) {
+	    PushPendingEvent(tsdPtr, evPtr);
+	} else
+#endif
 	QueueEvent(tsdPtr, evPtr, position);
     } else {
 	ckfree(evPtr);
@@ -451,6 +519,13 @@ QueueEvent(
 				 * TCL_QUEUE_MARK. */
 {
     Tcl_MutexLock(&(tsdPtr->queueMutex));
+
+    /*
+     * Pick up events other threads have queued at the tail first, so that
+     * they keep their place relative to this one.
+     */
+
+    TakePendingEvents(tsdPtr);
     if (position == TCL_QUEUE_TAIL) {
 	/*
 	 * Append the event on the end of the queue.
@@ -494,6 +569,93 @@ QueueEvent(
     Tcl_MutexUnlock(&(tsdPtr->queueMutex));
 }
 
+#ifdef NOTIFY_LOCKFREE
+/*
+ *----------------------------------------------------------------------
+ *
+ * PushPendingEvent --
+ *
+ *	Queue an event at the tail of another thread's event queue without
+ *	taking its queueMutex, by pushing it onto the pending LIFO of the
+ *	notifier. The caller must hold listLock so that the notifier cannot
+ *	go away.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+PushPendingEvent(
+    ThreadSpecificData *tsdPtr,	/* Notifier of the thread to queue on. */
+    Tcl_Event *evPtr)		/* Event to add to queue. */
+{
+    Tcl_Event *headPtr;
+
+    do {
+	headPtr = tsdPtr->pendingEventPtr;
+	evPtr->nextPtr = headPtr;
+    } while (!NotifyCasPtr(&tsdPtr->pendingEventPtr, headPtr, evPtr));
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TakePendingEvents --
+ *
+ *	Move all events on the pending LIFO of a notifier to the tail of its
+ *	event queue, oldest first. The caller must hold the queueMutex of the
+ *	notifier.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Empties the pending LIFO.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+TakePendingEvents(
+    ThreadSpecificData *tsdPtr)	/* Notifier whose events to take. */
+{
+    Tcl_Event *evPtr, *nextPtr, *firstPtr, *lastPtr;
+
+    if (tsdPtr->pendingEventPtr == NULL) {
+	return;
+    }
+    evPtr = NotifySwapPtr(&tsdPtr->pendingEventPtr, NULL);
+
+    /*
+     * Reverse the LIFO; its head, the newest event, becomes the last one.
+     */
+
+    lastPtr = evPtr;
+    firstPtr = NULL;
+    while (evPtr != NULL) {
+	nextPtr = evPtr->nextPtr;
+	evPtr->nextPtr = firstPtr;
+	firstPtr = evPtr;
+	evPtr = nextPtr;
+    }
+    if (firstPtr == NULL) {
+	return;
+    }
+
+    if (tsdPtr->firstEventPtr == NULL) {
+	tsdPtr->firstEventPtr = firstPtr;
+    } else {
+	tsdPtr->lastEventPtr->nextPtr = firstPtr;
+    }
+    tsdPtr->lastEventPtr = lastPtr;
+}
+#endif /* NOTIFY_LOCKFREE */
+
 /*
  *----------------------------------------------------------------------
  *
@@ -526,6 +688,7 @@ Tcl_DeleteEvents(
     ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
 
     Tcl_MutexLock(&(tsdPtr->queueMutex));
+    TakePendingEvents(tsdPtr);
 
     /*
      * Walk the queue of events for the thread, applying 'proc' to each to
@@ -610,6 +773,15 @@ Tcl_ServiceEvent(
     int result;
     ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
 
+#ifdef NOTIFY_LOCKFREE
+    /*
+     * Let the next Tcl_ThreadAlert wake the notifier again: whatever the
+     * alerts skipped until now were made for is looked at below.
+     */
+
+    NotifySwapLong(&tsdPtr->alertPending, 0);
+#endif
+
     /*
      * Asynchronous event handlers are considered to be the highest priority
      * events, and so must be invoked before we process events on the event
@@ -635,6 +807,7 @@ Tcl_ServiceEvent(
      */
 
     Tcl_MutexLock(&(tsdPtr->queueMutex));
+    TakePendingEvents(tsdPtr);
     for (evPtr = tsdPtr->firstEventPtr; evPtr != NULL;
 	    evPtr = evPtr->nextPtr) {
 	/*
@@ -1099,7 +1272,9 @@ Tcl_ServiceAll(void)
  * Tcl_ThreadAlert --
  *
  *	This function wakes up the notifier associated with the specified
- *	thread (if there is one).
+ *	thread (if there is one). Alerts are coalesced: while the notifier has
+ *	been woken and the thread has not yet serviced its events, further
+ *	alerts are skipped.
  *
  * Results:
  *	None.
@@ -1125,6 +1300,11 @@ Tcl_ThreadAlert(
     Tcl_MutexLock(&listLock);
     for (tsdPtr = firstNotifierPtr; tsdPtr; tsdPtr = tsdPtr->nextPtr) {
 	if (tsdPtr->threadId == threadId) {
+#ifdef NOTIFY_LOCKFREE
+	    if (!NotifyCasLong(&tsdPtr->alertPending, 0, 1)) {
+		break;
+	    }
+#endif
 	    Tcl_AlertNotifier(tsdPtr->clientData);
 	    break;
 	}
@@ -235,6 +235,22 @@ static void		DupCmdNameInternalRep(Tcl_Obj *objPtr,
 			    Tcl_Obj *copyPtr);
 static void		FreeCmdNameInternalRep(Tcl_Obj *objPtr);
 static int		SetCmdNameFromAny(Tcl_Interp *interp, Tcl_Obj *objPtr);
+static unsigned int	CmdNameCreateEpoch(Interp *iPtr, Namespace *nsPtr);
+
+/*
+ * Values still to be visited by TclDetachObj, as the addresses of the slots
+ * that refer to them.
+ */
+
+typedef struct DetachStack {
+    Tcl_Obj ***slots;		/* Slots to visit; staticSlots at first. */
+    int numSlots;		/* Number of slots on the stack. */
+    int maxSlots;		/* Room in slots. */
+    Tcl_Obj **staticSlots[32];
+} DetachStack;
+
+static void		PushDetachSlot(ClientData clientData,
+			    Tcl_Obj **slotPtr);
 
 /*
  * The structures below defines the Tcl object types defined in this file by
@@ -340,7 +356,10 @@ Tcl_ObjType tclCmdNameType = {
  */
 
 typedef struct ResolvedCmdName {
-    Command *cmdPtr;		/* A cached Command pointer. */
+    Command *cmdPtr;		/* A cached Command pointer. NULL if this is a
+				 * cached negative lookup: the (unqualified)
+				 * name did not resolve to any command in
+				 * refNsPtr. */
     Namespace *refNsPtr;	/* Points to the namespace containing the
 				 * reference (not the namespace that contains
 				 * the referenced command). NULL if the name
@@ -361,6 +380,12 @@ typedef struct ResolvedCmdName {
 				 * incremented; if so, the cmd was renamed,
 				 * deleted, hidden, or exposed, and so the
 				 * pointer is invalid. */
+    unsigned int createEpoch;	/* Only used by negative lookups. Sum of the
+				 * cmdCreateEpoch counters of every namespace
+				 * consulted by the failed lookup when it was
+				 * cached. If a command has since been added
+				 * to any of them, the sum differs and the
+				 * lookup must be retried. */
     int refCount;		/* Reference count: 1 for each cmdName object
 				 * that has a pointer to this ResolvedCmdName
 				 * structure as its internal rep. This
@@ -1603,6 +1628,123 @@ TclSetDuplicateObj(
     SetDuplicateObj(dupPtr, objPtr);
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclDetachObj --
+ *
+ *	Prepare a value to be handed over to another thread. Takes over one
+ *	reference to objPtr from the caller and returns a value equal to it
+ *	that neither refers to nor is referred to by anything else in the
+ *	current thread, holding a single reference for the caller to pass on.
+ *
+ *	Parts of the value that are not shared are kept as they are: an
+ *	unshared list of unshared elements is returned itself, after one pass
+ *	over its elements, so that moving a large list or dictionary does not
+ *	cost converting it to a string and parsing it again. Shared parts are
+ *	copied. Internal representations other than those of plain values
+ *	(numbers, strings, byte arrays, lists and dictionaries) may refer to
+ *	things that belong to the thread, such as commands or compiled code,
+ *	and are replaced by the string representation. Byte arrays that refer
+ *	to the pages of a mapped file get a copy of the bytes of their own.
+ *
+ *	The memory of the value needs no special treatment: the allocators
+ *	accept blocks and objects freed by any thread.
+ *
+ * Results:
+ *	The value to hand over.
+ *
+ * Side effects:
+ *	May modify objPtr and the values it contains, without changing what
+ *	they represent.
+ *
+ *----------------------------------------------------------------------
+ */
+
+Tcl_Obj *
+TclDetachObj(
+    Tcl_Obj *objPtr)		/* Value to detach; one reference to it is
+				 * taken over. */
+{
+    DetachStack stack;
+    Tcl_Obj **slotPtr, *valuePtr, *copyPtr;
+    const Tcl_ObjType *typePtr;
+
+    stack.slots = stack.staticSlots;
+    stack.numSlots = 0;
+    stack.maxSlots = sizeof(stack.staticSlots) / sizeof(Tcl_Obj **);
+    PushDetachSlot(&stack, &objPtr);
+
+    while (stack.numSlots > 0) {
+	slotPtr = stack.slots[--stack.numSlots];
+	valuePtr = *slotPtr;
+
+	/*
+	 * The slot holds one of the references to a shared value; give it a
+	 * copy of its own instead. Lists and dictionaries are copied
+	 * shallowly here, their elements are copied as they are visited.
+	 */
+
+	if (valuePtr->refCount > 1) {
+	    copyPtr = Tcl_DuplicateObj(valuePtr);
+	    Tcl_IncrRefCount(copyPtr);
+	    Tcl_DecrRefCount(valuePtr);
+	    *slotPtr = valuePtr = copyPtr;
+	}
+
+	typePtr = valuePtr->typePtr;
+	if (typePtr == &tclByteArrayType) {
+	    TclUnmapByteArrayObj(valuePtr);
+	    continue;
+	}
+	if (typePtr == NULL || typePtr == &tclIntType
+		|| typePtr == &tclDoubleType || typePtr == &tclBooleanType
+#ifndef TCL_WIDE_INT_IS_LONG
+		|| typePtr == &tclWideIntType
+#endif
+		|| typePtr == &tclBignumType || typePtr == &tclStringType) {
+	    continue;
+	}
+	if (typePtr == &tclListType) {
+	    TclListObjVisitElements(valuePtr, PushDetachSlot, &stack);
+	    continue;
+	}
+	if (typePtr == &tclDictType && TclDictObjVisitElements(valuePtr,
+		PushDetachSlot, &stack) == TCL_OK) {
+	    continue;
+	}
+	(void) TclGetString(valuePtr);
+	TclFreeIntRep(valuePtr);
+    }
+
+    if (stack.slots != stack.staticSlots) {
+	ckfree(stack.slots);
+    }
+    return objPtr;
+}
+
+static void
+PushDetachSlot(
+    ClientData clientData,
+    Tcl_Obj **slotPtr)
+{
+    DetachStack *stackPtr = (DetachStack *)clientData;
+
+    if (stackPtr->numSlots == stackPtr->maxSlots) {
+	stackPtr->maxSlots *= 2;
+	if (stackPtr->slots == stackPtr->staticSlots) {
+	    stackPtr->slots = (Tcl_Obj ***)ckalloc(
+		    stackPtr->maxSlots * sizeof(Tcl_Obj **));
+	    memcpy(stackPtr->slots, stackPtr->staticSlots,
+		    sizeof(stackPtr->staticSlots));
+	} else {
+	    stackPtr->slots = (Tcl_Obj ***)ckrealloc(stackPtr->slots,
+		    stackPtr->maxSlots * sizeof(Tcl_Obj **));
+	}
+    }
+    stackPtr->slots[stackPtr->numSlots++] = slotPtr;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -4171,7 +4313,24 @@ Tcl_GetCommandFromObj(
     if ((objPtr->typePtr == &tclCmdNameType) && (resPtr != NULL)) {
 	Command *cmdPtr = resPtr->cmdPtr;
 
-	if ((cmdPtr->cmdEpoch == resPtr->cmdEpoch)
+	if (cmdPtr == NULL) {
+	    /*
+	     * A cached negative lookup. It stays valid as long as the
+	     * resolution rules of the referencing namespace are unchanged and
+	     * no command was added to any namespace the lookup consulted.
+	     */
+
+	    Namespace *refNsPtr = (Namespace *)
+		    TclGetCurrentNamespace(interp);
+
+	    if ((refNsPtr == resPtr->refNsPtr)
+		    && (resPtr->refNsId == refNsPtr->nsId)
+		    && (resPtr->refNsCmdEpoch == refNsPtr->cmdRefEpoch)
+		    && (resPtr->createEpoch ==
+			    CmdNameCreateEpoch((Interp *) interp, refNsPtr))) {
+		return NULL;
+	    }
+	} else if ((cmdPtr->cmdEpoch == resPtr->cmdEpoch)
 		&& !(cmdPtr->flags & CMD_IS_DELETED)
 		&& (interp == cmdPtr->nsPtr->interp)
 		&& !(cmdPtr->nsPtr->flags & NS_DYING)) {
@@ -4316,7 +4475,9 @@ FreeCmdNameInternalRep(
 
 	    Command *cmdPtr = resPtr->cmdPtr;
 
-	    TclCleanupCommandMacro(cmdPtr);
+	    if (cmdPtr != NULL) {
+		TclCleanupCommandMacro(cmdPtr);
+	    }
 	    ckfree(resPtr);
 	}
     }
@@ -4423,7 +4584,7 @@ SetCmdNameFromAny(
 
 	    Command *oldCmdPtr = resPtr->cmdPtr;
 
-	    if (--oldCmdPtr->refCount == 0) {
+	    if ((oldCmdPtr != NULL) && (--oldCmdPtr->refCount == 0)) {
 		TclCleanupCommandMacro(oldCmdPtr);
 	    }
 	} else {
@@ -4454,6 +4615,39 @@ SetCmdNameFromAny(
 	    resPtr->refNsId = currNsPtr->nsId;
 	    resPtr->refNsCmdEpoch = currNsPtr->cmdRefEpoch;
 	}
+    } else if ((strstr(name, "::") == NULL) && (iPtr->resolverPtr == NULL)
+	    && (iPtr->varFramePtr->nsPtr->cmdResProc == NULL)) {
+	/*
+	 * An unqualified name that resolved to nothing without the help of
+	 * any command resolver. Cache the negative result so that repeated
+	 * lookups (e.g., of words dispatched through [unknown]) need not walk
+	 * the namespace path again until a command gets defined somewhere
+	 * the lookup would have looked.
+	 */
+
+	currNsPtr = iPtr->varFramePtr->nsPtr;
+	resPtr = (ResolvedCmdName *)objPtr->internalRep.twoPtrValue.ptr1;
+	if ((objPtr->typePtr == &tclCmdNameType)
+		&& resPtr && (resPtr->refCount == 1)) {
+	    Command *oldCmdPtr = resPtr->cmdPtr;
+
+	    if ((oldCmdPtr != NULL) && (--oldCmdPtr->refCount == 0)) {
+		TclCleanupCommandMacro(oldCmdPtr);
+	    }
+	} else {
+	    TclFreeIntRep(objPtr);
+	    resPtr = (ResolvedCmdName *)ckalloc(sizeof(ResolvedCmdName));
+	    resPtr->refCount = 1;
+	    objPtr->internalRep.twoPtrValue.ptr1 = resPtr;
+	    objPtr->internalRep.twoPtrValue.ptr2 = NULL;
+	    objPtr->typePtr = &tclCmdNameType;
+	}
+	resPtr->cmdPtr = NULL;
+	resPtr->cmdEpoch = 0;
+	resPtr->refNsPtr = currNsPtr;
+	resPtr->refNsId = currNsPtr->nsId;
+	resPtr->refNsCmdEpoch = currNsPtr->cmdRefEpoch;
+	resPtr->createEpoch = CmdNameCreateEpoch(iPtr, currNsPtr);
     } else {
 	TclFreeIntRep(objPtr);
 	objPtr->internalRep.twoPtrValue.ptr1 = NULL;
@@ -4462,6 +4656,50 @@ SetCmdNameFromAny(
     }
     return TCL_OK;
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * CmdNameCreateEpoch --
+ *
+ *	Computes the value used to validate a cached negative lookup of an
+ *	unqualified command name in a namespace: the sum of the command
+ *	creation epochs of the namespace itself, of each namespace on its
+ *	command path and of the global namespace. These are exactly the
+ *	namespaces that Tcl_FindCommand consults for such a name. Since each
+ *	epoch only ever grows, the sum changes whenever a command is added to
+ *	any of them; changes to the path itself bump the namespace's
+ *	cmdRefEpoch instead.
+ *
+ * Results:
+ *	The combined epoch.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static unsigned int
+CmdNameCreateEpoch(
+    Interp *iPtr,
+    Namespace *nsPtr)
+{
+    unsigned int epoch = (unsigned int) nsPtr->cmdCreateEpoch;
+    int i;
+
+    if (nsPtr != iPtr->globalNsPtr) {
+	epoch += (unsigned int) iPtr->globalNsPtr->cmdCreateEpoch;
+    }
+    for (i = 0; i < nsPtr->commandPathLength; i++) {
+	Namespace *pathNsPtr = nsPtr->commandPathArray[i].nsPtr;
+
+	if (pathNsPtr != NULL) {
+	    epoch += (unsigned int) pathNsPtr->cmdCreateEpoch;
+	}
+    }
+    return epoch;
+}
 
 /*
  *----------------------------------------------------------------------
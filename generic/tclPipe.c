@@ -141,6 +141,9 @@ FileForRedirect(
 	}
 	file = TclpOpenFile(name, flags);
 	Tcl_DStringFree(&nameString);
+	if (flags & O_CREAT) {
+	    TclFSInvalidateStatCache();
+	}
 	if (file == NULL) {
 	    Tcl_SetObjResult(interp, Tcl_ObjPrintf(
 		    "couldn't %s file \"%s\": %s",
@@ -1345,6 +1345,75 @@ FindPackage(
     return pkgPtr;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclClonePackageState --
+ *
+ *	Copies the package database of one interpreter into another, as part
+ *	of [interp clone]: provided versions, "package ifneeded" scripts, the
+ *	"package unknown" handler and the "package prefer" mode. Entries the
+ *	target already has are left alone, so packages that the target got by
+ *	other means (e.g. by loading a library) keep their own state.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Adds package records to the target interpreter.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclClonePackageState(
+    Tcl_Interp *srcInterp,	/* Interpreter to copy the database from. */
+    Tcl_Interp *interp)		/* Interpreter to copy it into. */
+{
+    Interp *srcPtr = (Interp *) srcInterp;
+    Interp *iPtr = (Interp *) interp;
+    Package *srcPkgPtr, *pkgPtr;
+    PkgAvail *srcAvailPtr, *availPtr, **lastPtrPtr;
+    Tcl_HashSearch search;
+    Tcl_HashEntry *hPtr;
+
+    for (hPtr = Tcl_FirstHashEntry(&srcPtr->packageTable, &search);
+	    hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+	srcPkgPtr = Tcl_GetHashValue(hPtr);
+	pkgPtr = FindPackage(interp,
+		Tcl_GetHashKey(&srcPtr->packageTable, hPtr));
+
+	if ((srcPkgPtr->version != NULL) && (pkgPtr->version == NULL)) {
+	    pkgPtr->version = srcPkgPtr->version;
+	    Tcl_IncrRefCount(pkgPtr->version);
+	    pkgPtr->clientData = srcPkgPtr->clientData;
+	}
+
+	for (srcAvailPtr = srcPkgPtr->availPtr; srcAvailPtr != NULL;
+		srcAvailPtr = srcAvailPtr->nextPtr) {
+	    for (lastPtrPtr = &pkgPtr->availPtr; *lastPtrPtr != NULL;
+		    lastPtrPtr = &(*lastPtrPtr)->nextPtr) {
+		if (strcmp((*lastPtrPtr)->version, srcAvailPtr->version) == 0) {
+		    break;
+		}
+	    }
+	    if (*lastPtrPtr != NULL) {
+		continue;
+	    }
+	    availPtr = ckalloc(sizeof(PkgAvail));
+	    DupString(availPtr->version, srcAvailPtr->version);
+	    DupString(availPtr->script, srcAvailPtr->script);
+	    availPtr->nextPtr = NULL;
+	    *lastPtrPtr = availPtr;
+	}
+    }
+
+    if ((srcPtr->packageUnknown != NULL) && (iPtr->packageUnknown == NULL)) {
+	DupString(iPtr->packageUnknown, srcPtr->packageUnknown);
+    }
+    iPtr->packagePrefer = srcPtr->packagePrefer;
+}
+
 /*
  *----------------------------------------------------------------------
  *
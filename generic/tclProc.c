@@ -1868,10 +1868,13 @@ InterpProcNR2(
 	/*
 	 * Now it _must_ be an error, so we need to log it as such. This means
 	 * filling out the error trace. Luckily, we just hand this off to the
-	 * function handed to us as an argument.
+	 * function handed to us as an argument. There is no point when a
+	 * coroutine is being wound down, see TEOV_Error.
 	 */
 
-	errorProc(interp, procNameObj);
+	if (!iPtr->execEnvPtr->rewind) {
+	    errorProc(interp, procNameObj);
+	}
     }
     goto done;
 }
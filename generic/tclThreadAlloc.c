@@ -110,6 +110,10 @@ typedef struct Cache {
     int numObjects;		/* Number of objects for thread */
     Tcl_Obj *lastPtr;		/* Last object in this cache */
     int totalAssigned;		/* Total space assigned to thread */
+    long totalObjects;		/* Number of Tcl_Obj's this thread allocated
+				 * from the system. Objects migrate between
+				 * caches, so only the sum over all caches is
+				 * meaningful. */
     Bucket buckets[NBUCKETS];	/* The buckets for this thread */
 } Cache;
 
@@ -130,6 +134,7 @@ static struct {
  */
 
 static Cache *	GetCache(void);
+static void	FlushCache(Cache *cachePtr);
 static void	LockBucket(Cache *cachePtr, int bucket);
 static void	UnlockBucket(Cache *cachePtr, int bucket);
 static void	PutBlocks(Cache *cachePtr, int bucket, int numMove);
@@ -240,7 +245,9 @@ GetCache(void)
  *
  * TclFreeAllocCache --
  *
- *	Flush and delete a cache, removing from list of caches.
+ *	Flush and delete a cache, removing from list of caches. The objects
+ *	it allocated are counted as allocated by the shared cache, which now
+ *	holds the free ones.
  *
  * Results:
  *	None.
@@ -257,6 +264,76 @@ TclFreeAllocCache(
 {
     Cache *cachePtr = arg;
     Cache **nextPtrPtr;
+
+    FlushCache(cachePtr);
+
+    /*
+     * Remove from pool list.
+     */
+
+    Tcl_MutexLock(listLockPtr);
+    nextPtrPtr = &firstCachePtr;
+    while (*nextPtrPtr != cachePtr) {
+	nextPtrPtr = &(*nextPtrPtr)->nextPtr;
+    }
+    *nextPtrPtr = cachePtr->nextPtr;
+    cachePtr->nextPtr = NULL;
+    sharedPtr->totalObjects += cachePtr->totalObjects;
+    Tcl_MutexUnlock(listLockPtr);
+    TclpSysFree(cachePtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclFlushAllocCache --
+ *
+ *	Return all free blocks and Tcl_Obj's held by the calling thread's
+ *	cache to the shared cache, one bulk move per bucket. Meant for
+ *	threads that serve bursts of work (e.g. one request per event) and
+ *	then go idle, so that memory freed at the end of a burst becomes
+ *	available to other threads without going through the system
+ *	allocator again.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The next allocations of this thread will refill its cache from the
+ *	shared cache.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclFlushAllocCache(void)
+{
+    Cache *cachePtr;
+
+    GETCACHE(cachePtr);
+    FlushCache(cachePtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FlushCache --
+ *
+ *	Move all free blocks and objects of a cache to the shared cache.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+FlushCache(
+    Cache *cachePtr)
+{
     unsigned int bucket;
 
     /*
@@ -276,22 +353,8 @@ TclFreeAllocCache(
     if (cachePtr->numObjects > 0) {
 	PutObjs(cachePtr, cachePtr->numObjects);
     }
-
-    /*
-     * Remove from pool list.
-     */
-
-    Tcl_MutexLock(listLockPtr);
-    nextPtrPtr = &firstCachePtr;
-    while (*nextPtrPtr != cachePtr) {
-	nextPtrPtr = &(*nextPtrPtr)->nextPtr;
-    }
-    *nextPtrPtr = cachePtr->nextPtr;
-    cachePtr->nextPtr = NULL;
-    Tcl_MutexUnlock(listLockPtr);
-    TclpSysFree(cachePtr);
 }
-
+
 /*
  *----------------------------------------------------------------------
  *
@@ -572,6 +635,7 @@ TclThreadAllocObj(void)
 	    Tcl_Obj *newObjsPtr;
 
 	    cachePtr->numObjects = numMove = NOBJALLOC;
+	    cachePtr->totalObjects += NOBJALLOC;
 	    newObjsPtr = TclpSysAlloc(sizeof(Tcl_Obj) * numMove, 0);
 	    if (newObjsPtr == NULL) {
 		Tcl_Panic("alloc: could not allocate %d new objects", numMove);
@@ -696,6 +760,99 @@ Tcl_GetMemoryInfo(
     Tcl_MutexUnlock(listLockPtr);
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclAllocCacheObjCmd --
+ *
+ *	Implementation of the "::tcl::unsupported::alloccache" command, which
+ *	gives scripts access to the caches of the threaded allocator:
+ *
+ *	    alloccache flush
+ *		Returns the free memory of the calling thread's cache to the
+ *		shared cache (see TclFlushAllocCache).
+ *	    alloccache info
+ *		Returns a dictionary of occupancy statistics. The "objects"
+ *		entry holds the number of Tcl_Obj's allocated from the system
+ *		by all threads, how many of them are currently free (in any
+ *		cache) and how many are free in the calling thread's cache.
+ *		The caches of other threads are read without synchronizing
+ *		with them, so while they allocate the numbers are only
+ *		approximate.
+ *		The "buckets" entry holds, for each bucket of the calling
+ *		thread, the block size, the number of free blocks and the
+ *		total space assigned.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	See above.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclAllocCacheObjCmd(
+    ClientData clientData,
+    Tcl_Interp *interp,
+    int objc,
+    Tcl_Obj *const objv[])
+{
+    static const char *const options[] = {"flush", "info", NULL};
+    enum options {ALLOC_FLUSH, ALLOC_INFO};
+    Cache *cachePtr, *ownPtr;
+    long totalObjects = 0, freeObjects = 0;
+    Tcl_Obj *resultObj, *listObj, *elemObjs[3];
+    unsigned int n;
+    int index;
+
+    if (objc != 2) {
+	Tcl_WrongNumArgs(interp, 1, objv, "option");
+	return TCL_ERROR;
+    }
+    if (Tcl_GetIndexFromObj(interp, objv[1], options, "option", 0,
+	    &index) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    if ((enum options) index == ALLOC_FLUSH) {
+	TclFlushAllocCache();
+	return TCL_OK;
+    }
+
+    GETCACHE(ownPtr);
+    Tcl_MutexLock(listLockPtr);
+    for (cachePtr = firstCachePtr; cachePtr != NULL;
+	    cachePtr = cachePtr->nextPtr) {
+	totalObjects += cachePtr->totalObjects;
+	if (cachePtr == sharedPtr) {
+	    Tcl_MutexLock(objLockPtr);
+	    freeObjects += cachePtr->numObjects;
+	    Tcl_MutexUnlock(objLockPtr);
+	} else {
+	    freeObjects += cachePtr->numObjects;
+	}
+    }
+    Tcl_MutexUnlock(listLockPtr);
+
+    TclNewObj(resultObj);
+    elemObjs[0] = Tcl_NewLongObj(totalObjects);
+    elemObjs[1] = Tcl_NewLongObj(freeObjects);
+    elemObjs[2] = Tcl_NewIntObj(ownPtr->numObjects);
+    TclDictPut(NULL, resultObj, "objects", Tcl_NewListObj(3, elemObjs));
+
+    TclNewObj(listObj);
+    for (n = 0; n < NBUCKETS; ++n) {
+	elemObjs[0] = Tcl_NewLongObj((long) bucketInfo[n].blockSize);
+	elemObjs[1] = Tcl_NewLongObj(ownPtr->buckets[n].numFree);
+	elemObjs[2] = Tcl_NewLongObj(ownPtr->buckets[n].totalAssigned);
+	Tcl_ListObjAppendElement(NULL, listObj, Tcl_NewListObj(3, elemObjs));
+    }
+    TclDictPut(NULL, resultObj, "buckets", listObj);
+    Tcl_SetObjResult(interp, resultObj);
+    return TCL_OK;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -0,0 +1,1255 @@
+/*
+ * tclThreadPool.c --
+ *
+ *	This file implements thread pools: a fixed set of worker threads, each
+ *	with its own interpreter initialized from a setup script, that run
+ *	work submitted from any thread. Each worker keeps a deque of work; it
+ *	takes work from the bottom of its own deque, then from the queue of
+ *	work submitted by threads outside the pool, and then steals from the
+ *	top of the other workers' deques. Work submitted from inside a worker
+ *	goes onto that worker's own deque, so that nested work stays local
+ *	while it can and spreads out when other workers run dry. Completion of
+ *	a piece of work is delivered as an event to the thread that submitted
+ *	it.
+ *
+ *	The script level interface is the [tcl::threadpool] command, which
+ *	creates pool commands whose [submit] returns futures.
+ *
+ * See the file "license.terms" for information on usage and redistribution of
+ * this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ */
+
+#include "tclInt.h"
+
+/*
+ * Number of workers of a pool when none is asked for.
+ */
+
+#define POOL_DEFAULT_WORKERS	4
+
+/*
+ * A piece of work, waiting on a deque or the pool's queue.
+ */
+
+typedef struct PoolTask {
+    TclThreadPoolWorkProc *workProc;
+				/* Function run on a worker. */
+    TclThreadPoolDoneProc *doneProc;
+				/* Function run on the submitting thread once
+				 * workProc has returned, or NULL. */
+    ClientData clientData;	/* Argument for both functions. */
+    Tcl_ThreadId owner;		/* Thread that submitted the work. */
+    struct PoolTask *nextPtr;	/* Next task on the pool's queue. */
+} PoolTask;
+
+/*
+ * The event that runs the doneProc of a task on the submitting thread.
+ */
+
+typedef struct PoolDoneEvent {
+    Tcl_Event header;		/* Standard event header. */
+    TclThreadPoolDoneProc *doneProc;
+    ClientData clientData;
+} PoolDoneEvent;
+
+/*
+ * One worker of a pool. The deque is a circular array of tasks: the owning
+ * worker pushes and pops at the bottom, thieves take from the top. It is
+ * protected by dequeMutex.
+ */
+
+typedef struct PoolWorker {
+    TclThreadPool *poolPtr;	/* Pool this worker belongs to. */
+    int index;			/* Position in the pool's worker array. */
+    Tcl_ThreadId threadId;	/* Thread of the worker, set by itself. */
+    Tcl_ThreadId joinId;	/* Thread of the worker, set by its creator
+				 * to join with. */
+    Tcl_Interp *interp;		/* Interpreter of the worker. */
+    Tcl_Mutex dequeMutex;	/* Protects the next three fields. */
+    PoolTask **tasks;		/* Circular array of tasks. */
+    int first;			/* Index of the top task. */
+    int count;			/* Number of tasks on the deque. */
+    int size;			/* Allocated size of the tasks array. */
+} PoolWorker;
+
+/*
+ * A thread pool. All fields but the workers' deques are protected by mutex.
+ */
+
+struct TclThreadPool {
+    Tcl_Mutex mutex;		/* Protects the fields below. */
+    Tcl_Condition workCond;	/* Signalled when there is work, or when the
+				 * pool shuts down. */
+    Tcl_Condition doneCond;	/* Signalled when a task completes, or when
+				 * there is work, for workers waiting on a
+				 * future. */
+    Tcl_Condition startCond;	/* Signalled when a worker has run its setup
+				 * script. */
+    PoolTask *firstTaskPtr;	/* Queue of work submitted from outside the
+				 * pool. */
+    PoolTask *lastTaskPtr;
+    int queued;			/* Tasks on the queue or any deque. */
+    int running;		/* Tasks being run by the workers. */
+    int idle;			/* Workers waiting on workCond. */
+    int waiting;		/* Workers waiting on doneCond. */
+    int started;		/* Workers that have run their setup script. */
+    int shutdown;		/* Set when the pool is being deleted. */
+    char *setupError;		/* Message of the first setup script to fail,
+				 * or NULL. */
+    char *setupScript;		/* Script run by each worker when it starts,
+				 * or NULL. */
+    char *cmdName;		/* Name of the pool command, created in every
+				 * worker interpreter too, or NULL. */
+    unsigned long completed;	/* Number of tasks run. */
+    unsigned long steals;	/* Number of tasks taken from another
+				 * worker's deque. */
+    int numWorkers;		/* Number of workers. */
+    PoolWorker *workers;	/* Array of numWorkers workers. */
+};
+
+/*
+ * The script level state of a pool command in one interpreter. The futures
+ * table maps future names to PoolFuture structures; it is only ever touched
+ * by the thread of the interpreter.
+ */
+
+typedef struct PoolCmd {
+    TclThreadPool *poolPtr;	/* The pool. */
+    Tcl_Interp *interp;		/* Interpreter the command lives in. */
+    Tcl_Command token;		/* Token of the command. */
+    int isOwner;		/* 1 if deleting the command deletes the pool,
+				 * 0 in the worker interpreters. */
+    Tcl_HashTable futures;	/* Outstanding futures by name. */
+    int nextId;			/* Number of the next future. */
+} PoolCmd;
+
+/*
+ * A script submitted to a pool. The worker fills in the result and then
+ * sets finished while holding the pool's mutex; everything else belongs to
+ * the submitting thread, which also holds both references: one for the
+ * entry in the futures table and one for the pending done event.
+ */
+
+typedef struct PoolFuture {
+    PoolCmd *cmdPtr;		/* Command the future belongs to, or NULL once
+				 * that command is gone. */
+    TclThreadPool *poolPtr;	/* Pool running the script. */
+    Tcl_Obj *nameObj;		/* Name of the future. */
+    Tcl_Obj *callbackObj;	/* Command prefix to call on completion, or
+				 * NULL. */
+    char *script;		/* Script to evaluate, owned. */
+    int finished;		/* Set when the result fields are valid. */
+    int code;			/* Completion code of the script. */
+    Tcl_Obj *resultObj;		/* Result of the script, detached from the
+				 * worker with TclDetachObj. */
+    Tcl_Obj *optionsObj;	/* Return options dictionary, likewise. */
+    int refCount;		/* Number of references, see above. */
+} PoolFuture;
+
+TCL_DECLARE_MUTEX(poolNameMutex)
+static int poolNameCounter = 0;
+
+/*
+ * Declarations for routines used only in this file.
+ */
+
+static TclThreadPool *	CreatePool(Tcl_Interp *interp, int numWorkers,
+			    const char *setupScript, const char *cmdName);
+static PoolTask *	TakeTask(PoolWorker *workerPtr);
+static void		RunTask(PoolWorker *workerPtr, PoolTask *taskPtr);
+static PoolWorker *	CurrentWorker(TclThreadPool *poolPtr);
+static Tcl_ThreadCreateType PoolWorkerThread(ClientData clientData);
+static int		PoolDoneEventProc(Tcl_Event *evPtr, int flags);
+static void		FreePool(TclThreadPool *poolPtr);
+static PoolCmd *	CreatePoolCmd(Tcl_Interp *interp,
+			    TclThreadPool *poolPtr, const char *name,
+			    int isOwner);
+static int		PoolObjCmd(ClientData clientData, Tcl_Interp *interp,
+			    int objc, Tcl_Obj *const objv[]);
+static void		PoolCmdDeleted(ClientData clientData);
+static int		DeleteFutureEvent(Tcl_Event *evPtr,
+			    ClientData clientData);
+static int		PoolWait(Tcl_Interp *interp, PoolCmd *cmdPtr,
+			    PoolFuture *futurePtr);
+static void		FutureWork(Tcl_Interp *interp, ClientData clientData);
+static void		FutureDone(ClientData clientData);
+static void		FutureForget(PoolCmd *cmdPtr, PoolFuture *futurePtr);
+static void		FutureRelease(PoolFuture *futurePtr);
+static int		ThreadPoolObjCmd(ClientData clientData,
+			    Tcl_Interp *interp, int objc,
+			    Tcl_Obj *const objv[]);
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclThreadPoolCreate --
+ *
+ *	Create a thread pool and start its workers. Each worker creates an
+ *	interpreter, runs Tcl_Init and then the setup script in it.
+ *
+ * Results:
+ *	The new pool, or NULL if a worker could not be started or its setup
+ *	failed; an error message is left in interp if that is not NULL.
+ *
+ * Side effects:
+ *	Starts numWorkers threads, or POOL_DEFAULT_WORKERS if that is not
+ *	positive.
+ *
+ *----------------------------------------------------------------------
+ */
+
+TclThreadPool *
+TclThreadPoolCreate(
+    Tcl_Interp *interp,		/* For error messages, may be NULL. */
+    int numWorkers,		/* Number of worker threads. */
+    const char *setupScript)	/* Script to run in each worker interpreter
+				 * when it starts, may be NULL. */
+{
+    return CreatePool(interp, numWorkers, setupScript, NULL);
+}
+
+/*
+ * CreatePool does the work of TclThreadPoolCreate; pools created for the
+ * [tcl::threadpool] command also get their pool command in every worker
+ * interpreter, so that scripts running there can submit nested work.
+ */
+
+static TclThreadPool *
+CreatePool(
+    Tcl_Interp *interp,		/* For error messages, may be NULL. */
+    int numWorkers,		/* Number of worker threads. */
+    const char *setupScript,	/* Script to run in each worker interpreter
+				 * when it starts, may be NULL. */
+    const char *cmdName)	/* Name of a pool command to create in each
+				 * worker interpreter, may be NULL. */
+{
+    TclThreadPool *poolPtr;
+    PoolWorker *workerPtr;
+    int i;
+
+    if (numWorkers <= 0) {
+	numWorkers = POOL_DEFAULT_WORKERS;
+    }
+    poolPtr = ckalloc(sizeof(TclThreadPool));
+    memset(poolPtr, 0, sizeof(TclThreadPool));
+    if (setupScript != NULL) {
+	poolPtr->setupScript = ckalloc(strlen(setupScript) + 1);
+	strcpy(poolPtr->setupScript, setupScript);
+    }
+    if (cmdName != NULL) {
+	poolPtr->cmdName = ckalloc(strlen(cmdName) + 1);
+	strcpy(poolPtr->cmdName, cmdName);
+    }
+    poolPtr->workers = ckalloc(numWorkers * sizeof(PoolWorker));
+    memset(poolPtr->workers, 0, numWorkers * sizeof(PoolWorker));
+
+    for (i = 0 ; i < numWorkers ; i++) {
+	workerPtr = &poolPtr->workers[i];
+	workerPtr->poolPtr = poolPtr;
+	workerPtr->index = i;
+	if (Tcl_CreateThread(&workerPtr->joinId, PoolWorkerThread, workerPtr,
+		TCL_THREAD_STACK_DEFAULT, TCL_THREAD_JOINABLE) != TCL_OK) {
+	    break;
+	}
+	poolPtr->numWorkers++;
+    }
+
+    /*
+     * Wait for the workers to get through their setup, so that the pool is
+     * usable once we return and setup errors can be reported.
+     */
+
+    Tcl_MutexLock(&poolPtr->mutex);
+    while (poolPtr->started < poolPtr->numWorkers) {
+	Tcl_ConditionWait(&poolPtr->startCond, &poolPtr->mutex, NULL);
+    }
+    Tcl_MutexUnlock(&poolPtr->mutex);
+
+    if (poolPtr->numWorkers < numWorkers || poolPtr->setupError) {
+	if (interp != NULL) {
+	    if (poolPtr->setupError) {
+		Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+			"error in thread pool setup script: %s",
+			poolPtr->setupError));
+		Tcl_SetErrorCode(interp, "TCL", "THREADPOOL", "SETUP",
+			(char *)NULL);
+	    } else {
+		Tcl_SetObjResult(interp, Tcl_NewStringObj(
+			"can't create worker thread", -1));
+		Tcl_SetErrorCode(interp, "TCL", "THREADPOOL", "THREAD",
+			(char *)NULL);
+	    }
+	}
+	TclThreadPoolDelete(poolPtr);
+	return NULL;
+    }
+    return poolPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclThreadPoolSubmit --
+ *
+ *	Submit work to a pool. The workProc is called on one of the workers
+ *	with its interpreter; afterwards the doneProc, if any, is called on
+ *	the submitting thread from its event loop.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Wakes up an idle worker, if there is one.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclThreadPoolSubmit(
+    TclThreadPool *poolPtr,	/* Pool to run the work on. */
+    TclThreadPoolWorkProc *workProc,
+				/* Function to run on a worker. */
+    TclThreadPoolDoneProc *doneProc,
+				/* Function to run on this thread when
+				 * workProc has returned, or NULL. */
+    ClientData clientData)	/* Argument for both functions. */
+{
+    PoolTask *taskPtr = ckalloc(sizeof(PoolTask));
+    PoolWorker *workerPtr = CurrentWorker(poolPtr);
+
+    taskPtr->workProc = workProc;
+    taskPtr->doneProc = doneProc;
+    taskPtr->clientData = clientData;
+    taskPtr->owner = Tcl_GetCurrentThread();
+    taskPtr->nextPtr = NULL;
+
+    if (workerPtr != NULL) {
+	/*
+	 * Nested work goes on the bottom of our own deque.
+	 */
+
+	Tcl_MutexLock(&workerPtr->dequeMutex);
+	if (workerPtr->count == workerPtr->size) {
+	    PoolTask **tasks;
+	    int i, size = workerPtr->size ? 2 * workerPtr->size : 16;
+
+	    tasks = ckalloc(size * sizeof(PoolTask *));
+	    for (i = 0 ; i < workerPtr->count ; i++) {
+		tasks[i] = workerPtr->tasks[
+			(workerPtr->first + i) % workerPtr->size];
+	    }
+	    if (workerPtr->tasks) {
+		ckfree(workerPtr->tasks);
+	    }
+	    workerPtr->tasks = tasks;
+	    workerPtr->first = 0;
+	    workerPtr->size = size;
+	}
+	workerPtr->tasks[(workerPtr->first + workerPtr->count++)
+		% workerPtr->size] = taskPtr;
+	Tcl_MutexUnlock(&workerPtr->dequeMutex);
+	Tcl_MutexLock(&poolPtr->mutex);
+    } else {
+	Tcl_MutexLock(&poolPtr->mutex);
+	if (poolPtr->lastTaskPtr) {
+	    poolPtr->lastTaskPtr->nextPtr = taskPtr;
+	} else {
+	    poolPtr->firstTaskPtr = taskPtr;
+	}
+	poolPtr->lastTaskPtr = taskPtr;
+    }
+    poolPtr->queued++;
+    if (poolPtr->idle) {
+	Tcl_ConditionNotify(&poolPtr->workCond);
+    }
+    if (poolPtr->waiting) {
+	Tcl_ConditionNotify(&poolPtr->doneCond);
+    }
+    Tcl_MutexUnlock(&poolPtr->mutex);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclThreadPoolDelete --
+ *
+ *	Shut down a pool. All work submitted so far is run to completion
+ *	first; the done events of that work may still be pending afterwards.
+ *	Must not be called from one of the pool's workers.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Joins the worker threads and frees the pool.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclThreadPoolDelete(
+    TclThreadPool *poolPtr)	/* Pool to delete. */
+{
+    int i, result;
+
+    Tcl_MutexLock(&poolPtr->mutex);
+    poolPtr->shutdown = 1;
+    Tcl_ConditionNotify(&poolPtr->workCond);
+    Tcl_ConditionNotify(&poolPtr->doneCond);
+    Tcl_MutexUnlock(&poolPtr->mutex);
+
+    for (i = 0 ; i < poolPtr->numWorkers ; i++) {
+	Tcl_JoinThread(poolPtr->workers[i].joinId, &result);
+    }
+    FreePool(poolPtr);
+}
+
+static void
+FreePool(
+    TclThreadPool *poolPtr)
+{
+    int i;
+
+    for (i = 0 ; i < poolPtr->numWorkers ; i++) {
+	if (poolPtr->workers[i].tasks) {
+	    ckfree(poolPtr->workers[i].tasks);
+	}
+	Tcl_MutexFinalize(&poolPtr->workers[i].dequeMutex);
+    }
+    ckfree(poolPtr->workers);
+    if (poolPtr->setupScript) {
+	ckfree(poolPtr->setupScript);
+    }
+    if (poolPtr->setupError) {
+	ckfree(poolPtr->setupError);
+    }
+    if (poolPtr->cmdName) {
+	ckfree(poolPtr->cmdName);
+    }
+    Tcl_ConditionFinalize(&poolPtr->workCond);
+    Tcl_ConditionFinalize(&poolPtr->doneCond);
+    Tcl_ConditionFinalize(&poolPtr->startCond);
+    Tcl_MutexFinalize(&poolPtr->mutex);
+    ckfree(poolPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * CurrentWorker --
+ *
+ *	Find out whether the current thread is one of the workers of a pool.
+ *
+ * Results:
+ *	The worker, or NULL.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static PoolWorker *
+CurrentWorker(
+    TclThreadPool *poolPtr)
+{
+    Tcl_ThreadId self = Tcl_GetCurrentThread();
+    int i;
+
+    for (i = 0 ; i < poolPtr->numWorkers ; i++) {
+	if (poolPtr->workers[i].threadId == self) {
+	    return &poolPtr->workers[i];
+	}
+    }
+    return NULL;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TakeTask --
+ *
+ *	Find the next task for a worker: the bottom of its own deque, else
+ *	the head of the pool's queue, else the top of another worker's deque.
+ *
+ * Results:
+ *	The task, or NULL if there is no work anywhere.
+ *
+ * Side effects:
+ *	Moves the task from queued to running.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static PoolTask *
+TakeTask(
+    PoolWorker *workerPtr)	/* Worker looking for work. */
+{
+    TclThreadPool *poolPtr = workerPtr->poolPtr;
+    PoolTask *taskPtr = NULL;
+    PoolWorker *victimPtr;
+    int i, stolen = 0;
+
+    Tcl_MutexLock(&workerPtr->dequeMutex);
+    if (workerPtr->count > 0) {
+	workerPtr->count--;
+	taskPtr = workerPtr->tasks[
+		(workerPtr->first + workerPtr->count) % workerPtr->size];
+    }
+    Tcl_MutexUnlock(&workerPtr->dequeMutex);
+
+    if (taskPtr == NULL) {
+	Tcl_MutexLock(&poolPtr->mutex);
+	taskPtr = poolPtr->firstTaskPtr;
+	if (taskPtr != NULL) {
+	    poolPtr->firstTaskPtr = taskPtr->nextPtr;
+	    if (poolPtr->firstTaskPtr == NULL) {
+		poolPtr->lastTaskPtr = NULL;
+	    }
+	    poolPtr->queued--;
+	    poolPtr->running++;
+	}
+	Tcl_MutexUnlock(&poolPtr->mutex);
+	if (taskPtr != NULL) {
+	    return taskPtr;
+	}
+    }
+
+    for (i = 1 ; taskPtr == NULL && i < poolPtr->numWorkers ; i++) {
+	victimPtr = &poolPtr->workers[
+		(workerPtr->index + i) % poolPtr->numWorkers];
+	Tcl_MutexLock(&victimPtr->dequeMutex);
+	if (victimPtr->count > 0) {
+	    taskPtr = victimPtr->tasks[victimPtr->first];
+	    victimPtr->first = (victimPtr->first + 1) % victimPtr->size;
+	    victimPtr->count--;
+	    stolen = 1;
+	}
+	Tcl_MutexUnlock(&victimPtr->dequeMutex);
+    }
+
+    if (taskPtr != NULL) {
+	Tcl_MutexLock(&poolPtr->mutex);
+	poolPtr->queued--;
+	poolPtr->running++;
+	poolPtr->steals += stolen;
+	Tcl_MutexUnlock(&poolPtr->mutex);
+    }
+    return taskPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RunTask --
+ *
+ *	Run a task on a worker and send its done event to the thread that
+ *	submitted it.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Whatever the task does. Frees the task.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+RunTask(
+    PoolWorker *workerPtr,	/* Worker running the task. */
+    PoolTask *taskPtr)		/* Task taken by TakeTask. */
+{
+    TclThreadPool *poolPtr = workerPtr->poolPtr;
+
+    taskPtr->workProc(workerPtr->interp, taskPtr->clientData);
+
+    if (taskPtr->doneProc != NULL) {
+	PoolDoneEvent *eventPtr = ckalloc(sizeof(PoolDoneEvent));
+
+	eventPtr->header.proc = PoolDoneEventProc;
+	eventPtr->doneProc = taskPtr->doneProc;
+	eventPtr->clientData = taskPtr->clientData;
+	Tcl_ThreadQueueEvent(taskPtr->owner, (Tcl_Event *) eventPtr,
+		TCL_QUEUE_TAIL);
+	Tcl_ThreadAlert(taskPtr->owner);
+    }
+    ckfree(taskPtr);
+
+    /*
+     * The event is queued before running drops, so that a worker leaving at
+     * shutdown finds the done events of the work it submitted.
+     */
+
+    Tcl_MutexLock(&poolPtr->mutex);
+    poolPtr->running--;
+    poolPtr->completed++;
+    if (poolPtr->waiting) {
+	Tcl_ConditionNotify(&poolPtr->doneCond);
+    }
+    if (poolPtr->shutdown && poolPtr->running == 0) {
+	Tcl_ConditionNotify(&poolPtr->workCond);
+    }
+    Tcl_MutexUnlock(&poolPtr->mutex);
+}
+
+static int
+PoolDoneEventProc(
+    Tcl_Event *evPtr,
+    int flags)
+{
+    PoolDoneEvent *eventPtr = (PoolDoneEvent *) evPtr;
+
+    (void)flags;
+
+    eventPtr->doneProc(eventPtr->clientData);
+    return 1;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * PoolWorkerThread --
+ *
+ *	The main function of a worker thread: set up the interpreter, then
+ *	run tasks until the pool shuts down and all work has been done.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Runs tasks.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_ThreadCreateType
+PoolWorkerThread(
+    ClientData clientData)
+{
+    PoolWorker *workerPtr = (PoolWorker *)clientData;
+    TclThreadPool *poolPtr = workerPtr->poolPtr;
+    Tcl_Interp *interp;
+    PoolTask *taskPtr;
+    int code;
+
+    workerPtr->threadId = Tcl_GetCurrentThread();
+    interp = workerPtr->interp = Tcl_CreateInterp();
+    code = Tcl_Init(interp);
+    if (code == TCL_OK && poolPtr->cmdName != NULL) {
+	CreatePoolCmd(interp, poolPtr, poolPtr->cmdName, 0);
+    }
+    if (code == TCL_OK && poolPtr->setupScript != NULL) {
+	code = Tcl_EvalEx(interp, poolPtr->setupScript, -1,
+		TCL_EVAL_GLOBAL);
+    }
+
+    Tcl_MutexLock(&poolPtr->mutex);
+    if (code != TCL_OK && poolPtr->setupError == NULL) {
+	const char *msg = Tcl_GetStringResult(interp);
+
+	poolPtr->setupError = ckalloc(strlen(msg) + 1);
+	strcpy(poolPtr->setupError, msg);
+    }
+    poolPtr->started++;
+    Tcl_ConditionNotify(&poolPtr->startCond);
+    Tcl_MutexUnlock(&poolPtr->mutex);
+    Tcl_ResetResult(interp);
+
+    while (1) {
+	taskPtr = TakeTask(workerPtr);
+	if (taskPtr != NULL) {
+	    RunTask(workerPtr, taskPtr);
+
+	    /*
+	     * Run the callbacks of work this worker submitted itself.
+	     */
+
+	    while (Tcl_DoOneEvent(TCL_ALL_EVENTS|TCL_DONT_WAIT)) {
+		/* Empty loop body. */
+	    }
+	    continue;
+	}
+
+	Tcl_MutexLock(&poolPtr->mutex);
+	if (poolPtr->queued == 0) {
+	    if (poolPtr->shutdown && poolPtr->running == 0) {
+		Tcl_MutexUnlock(&poolPtr->mutex);
+		break;
+	    }
+	    poolPtr->idle++;
+	    Tcl_ConditionWait(&poolPtr->workCond, &poolPtr->mutex, NULL);
+	    poolPtr->idle--;
+	}
+	Tcl_MutexUnlock(&poolPtr->mutex);
+    }
+
+    while (Tcl_DoOneEvent(TCL_ALL_EVENTS|TCL_DONT_WAIT)) {
+	/* Empty loop body. */
+    }
+    Tcl_DeleteInterp(interp);
+    Tcl_ExitThread(TCL_OK);
+    TCL_THREAD_CREATE_RETURN;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclInitThreadPoolCmd --
+ *
+ *	Create the [tcl::threadpool] command.
+ *
+ * Results:
+ *	The token of the command.
+ *
+ * Side effects:
+ *	Creates a command.
+ *
+ *----------------------------------------------------------------------
+ */
+
+Tcl_Command
+TclInitThreadPoolCmd(
+    Tcl_Interp *interp)
+{
+    return Tcl_CreateObjCommand(interp, "::tcl::threadpool",
+	    ThreadPoolObjCmd, NULL, NULL);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ThreadPoolObjCmd --
+ *
+ *	Implements [tcl::threadpool create ?-workers count? ?-setup script?],
+ *	which creates a pool and a command to use it.
+ *
+ * Results:
+ *	A standard Tcl result: the name of the pool command.
+ *
+ * Side effects:
+ *	Starts the worker threads.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ThreadPoolObjCmd(
+    ClientData clientData,
+    Tcl_Interp *interp,
+    int objc,
+    Tcl_Obj *const objv[])
+{
+    static const char *const subcmds[] = {"create", NULL};
+    static const char *const options[] = {"-setup", "-workers", NULL};
+    enum options {OPT_SETUP, OPT_WORKERS};
+    TclThreadPool *poolPtr;
+    const char *setupScript = NULL;
+    int idx, i, numWorkers = 0;
+    char name[TCL_INTEGER_SPACE + 24];
+
+    (void)clientData;
+
+    if (objc < 2 || (objc & 1)) {
+	Tcl_WrongNumArgs(interp, 1, objv,
+		"create ?-workers count? ?-setup script?");
+	return TCL_ERROR;
+    }
+    if (Tcl_GetIndexFromObj(interp, objv[1], subcmds, "subcommand", 0,
+	    &idx) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    for (i = 2 ; i < objc ; i += 2) {
+	if (Tcl_GetIndexFromObj(interp, objv[i], options, "option", 0,
+		&idx) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+	switch ((enum options) idx) {
+	case OPT_SETUP:
+	    setupScript = TclGetString(objv[i+1]);
+	    break;
+	case OPT_WORKERS:
+	    if (TclGetIntFromObj(interp, objv[i+1], &numWorkers) != TCL_OK) {
+		return TCL_ERROR;
+	    }
+	    if (numWorkers < 1) {
+		Tcl_SetObjResult(interp, Tcl_NewStringObj(
+			"number of workers must be positive", -1));
+		Tcl_SetErrorCode(interp, "TCL", "VALUE", "THREADPOOL",
+			(char *)NULL);
+		return TCL_ERROR;
+	    }
+	    break;
+	}
+    }
+
+    Tcl_MutexLock(&poolNameMutex);
+    sprintf(name, "::tcl::threadpool::pool%d", ++poolNameCounter);
+    Tcl_MutexUnlock(&poolNameMutex);
+
+    poolPtr = CreatePool(interp, numWorkers, setupScript, name);
+    if (poolPtr == NULL) {
+	return TCL_ERROR;
+    }
+    CreatePoolCmd(interp, poolPtr, name, 1);
+    Tcl_SetObjResult(interp, Tcl_NewStringObj(name, -1));
+    return TCL_OK;
+}
+
+static PoolCmd *
+CreatePoolCmd(
+    Tcl_Interp *interp,
+    TclThreadPool *poolPtr,
+    const char *name,
+    int isOwner)
+{
+    PoolCmd *cmdPtr = ckalloc(sizeof(PoolCmd));
+
+    cmdPtr->poolPtr = poolPtr;
+    cmdPtr->interp = interp;
+    cmdPtr->isOwner = isOwner;
+    cmdPtr->nextId = 0;
+    Tcl_InitHashTable(&cmdPtr->futures, TCL_STRING_KEYS);
+    cmdPtr->token = Tcl_CreateObjCommand(interp, name, PoolObjCmd, cmdPtr,
+	    PoolCmdDeleted);
+    return cmdPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * PoolObjCmd --
+ *
+ *	Implements the pool commands:
+ *	    $pool submit ?-command cmdPrefix? script
+ *	    $pool get future
+ *	    $pool ready future
+ *	    $pool stats
+ *	    $pool destroy
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	See the user documentation.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+PoolObjCmd(
+    ClientData clientData,
+    Tcl_Interp *interp,
+    int objc,
+    Tcl_Obj *const objv[])
+{
+    PoolCmd *cmdPtr = (PoolCmd *)clientData;
+    TclThreadPool *poolPtr = cmdPtr->poolPtr;
+    static const char *const subcmds[] = {
+	"destroy", "get", "ready", "stats", "submit", NULL
+    };
+    enum subcmds {
+	POOL_DESTROY, POOL_GET, POOL_READY, POOL_STATS, POOL_SUBMIT
+    };
+    PoolFuture *futurePtr;
+    Tcl_HashEntry *hPtr;
+    Tcl_Obj *resultObj;
+    int idx, isNew, finished;
+
+    if (objc < 2) {
+	Tcl_WrongNumArgs(interp, 1, objv, "subcommand ?arg ...?");
+	return TCL_ERROR;
+    }
+    if (Tcl_GetIndexFromObj(interp, objv[1], subcmds, "subcommand", 0,
+	    &idx) != TCL_OK) {
+	return TCL_ERROR;
+    }
+
+    switch ((enum subcmds) idx) {
+    case POOL_SUBMIT:
+	if (objc == 5 && strcmp(TclGetString(objv[2]), "-command") == 0) {
+	    futurePtr = ckalloc(sizeof(PoolFuture));
+	    futurePtr->callbackObj = objv[3];
+	    Tcl_IncrRefCount(objv[3]);
+	} else if (objc == 3) {
+	    futurePtr = ckalloc(sizeof(PoolFuture));
+	    futurePtr->callbackObj = NULL;
+	} else {
+	    Tcl_WrongNumArgs(interp, 2, objv, "?-command cmdPrefix? script");
+	    return TCL_ERROR;
+	}
+	futurePtr->cmdPtr = cmdPtr;
+	futurePtr->poolPtr = poolPtr;
+	futurePtr->nameObj = Tcl_ObjPrintf("future%d", ++cmdPtr->nextId);
+	Tcl_IncrRefCount(futurePtr->nameObj);
+	futurePtr->script = ckalloc(strlen(TclGetString(objv[objc-1])) + 1);
+	strcpy(futurePtr->script, TclGetString(objv[objc-1]));
+	futurePtr->finished = 0;
+	futurePtr->code = TCL_OK;
+	futurePtr->resultObj = NULL;
+	futurePtr->optionsObj = NULL;
+	futurePtr->refCount = 2;
+	hPtr = Tcl_CreateHashEntry(&cmdPtr->futures,
+		TclGetString(futurePtr->nameObj), &isNew);
+	Tcl_SetHashValue(hPtr, futurePtr);
+	TclThreadPoolSubmit(poolPtr, FutureWork, FutureDone, futurePtr);
+	Tcl_SetObjResult(interp, futurePtr->nameObj);
+	return TCL_OK;
+
+    case POOL_GET:
+    case POOL_READY:
+	if (objc != 3) {
+	    Tcl_WrongNumArgs(interp, 2, objv, "future");
+	    return TCL_ERROR;
+	}
+	hPtr = Tcl_FindHashEntry(&cmdPtr->futures, TclGetString(objv[2]));
+	if (hPtr == NULL) {
+	    Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+		    "no such future \"%s\"", TclGetString(objv[2])));
+	    Tcl_SetErrorCode(interp, "TCL", "LOOKUP", "FUTURE",
+		    TclGetString(objv[2]), (char *)NULL);
+	    return TCL_ERROR;
+	}
+	futurePtr = (PoolFuture *)Tcl_GetHashValue(hPtr);
+	if (idx == POOL_READY) {
+	    Tcl_MutexLock(&poolPtr->mutex);
+	    finished = futurePtr->finished;
+	    Tcl_MutexUnlock(&poolPtr->mutex);
+	    Tcl_SetObjResult(interp, Tcl_NewBooleanObj(finished));
+	    return TCL_OK;
+	}
+	return PoolWait(interp, cmdPtr, futurePtr);
+
+    case POOL_STATS:
+	if (objc != 2) {
+	    Tcl_WrongNumArgs(interp, 2, objv, NULL);
+	    return TCL_ERROR;
+	}
+	resultObj = Tcl_NewObj();
+	Tcl_MutexLock(&poolPtr->mutex);
+	TclDictPut(NULL, resultObj, "workers",
+		Tcl_NewIntObj(poolPtr->numWorkers));
+	TclDictPut(NULL, resultObj, "queued", Tcl_NewIntObj(poolPtr->queued));
+	TclDictPut(NULL, resultObj, "running",
+		Tcl_NewIntObj(poolPtr->running));
+	TclDictPut(NULL, resultObj, "completed",
+		Tcl_NewWideIntObj((Tcl_WideInt) poolPtr->completed));
+	TclDictPut(NULL, resultObj, "steals",
+		Tcl_NewWideIntObj((Tcl_WideInt) poolPtr->steals));
+	Tcl_MutexUnlock(&poolPtr->mutex);
+	Tcl_SetObjResult(interp, resultObj);
+	return TCL_OK;
+
+    case POOL_DESTROY:
+	if (objc != 2) {
+	    Tcl_WrongNumArgs(interp, 2, objv, NULL);
+	    return TCL_ERROR;
+	}
+	if (!cmdPtr->isOwner) {
+	    Tcl_SetObjResult(interp, Tcl_NewStringObj(
+		    "can't destroy a thread pool from one of its workers",
+		    -1));
+	    Tcl_SetErrorCode(interp, "TCL", "THREADPOOL", "WORKER",
+		    (char *)NULL);
+	    return TCL_ERROR;
+	}
+	Tcl_DeleteCommandFromToken(interp, cmdPtr->token);
+	return TCL_OK;
+    }
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * PoolWait --
+ *
+ *	Wait for a future to finish and return its result. Outside the pool
+ *	this services the event loop while waiting; on a worker it runs other
+ *	work instead, so that waiting on nested work cannot starve the pool.
+ *
+ * Results:
+ *	The completion code and result of the script of the future.
+ *
+ * Side effects:
+ *	Forgets the future.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+PoolWait(
+    Tcl_Interp *interp,
+    PoolCmd *cmdPtr,
+    PoolFuture *futurePtr)
+{
+    TclThreadPool *poolPtr = cmdPtr->poolPtr;
+    PoolWorker *workerPtr = CurrentWorker(poolPtr);
+    PoolTask *taskPtr;
+    int code, finished;
+
+    /*
+     * Hold a reference: the event loop may run a callback that gets the
+     * same future.
+     */
+
+    futurePtr->refCount++;
+    while (futurePtr->cmdPtr != NULL) {
+	Tcl_MutexLock(&poolPtr->mutex);
+	finished = futurePtr->finished;
+	Tcl_MutexUnlock(&poolPtr->mutex);
+	if (finished) {
+	    break;
+	}
+	if (workerPtr == NULL) {
+	    Tcl_DoOneEvent(TCL_ALL_EVENTS);
+	    continue;
+	}
+	taskPtr = TakeTask(workerPtr);
+	if (taskPtr != NULL) {
+	    RunTask(workerPtr, taskPtr);
+	    continue;
+	}
+	Tcl_MutexLock(&poolPtr->mutex);
+	if (!futurePtr->finished && poolPtr->queued == 0) {
+	    poolPtr->waiting++;
+	    Tcl_ConditionWait(&poolPtr->doneCond, &poolPtr->mutex, NULL);
+	    poolPtr->waiting--;
+	}
+	Tcl_MutexUnlock(&poolPtr->mutex);
+    }
+
+    /*
+     * A callback run while we were servicing events may have destroyed the
+     * pool, and with it this command.
+     */
+
+    if (futurePtr->cmdPtr == NULL) {
+	FutureRelease(futurePtr);
+	Tcl_SetObjResult(interp, Tcl_NewStringObj(
+		"thread pool deleted while waiting", -1));
+	Tcl_SetErrorCode(interp, "TCL", "THREADPOOL", "DELETED",
+		(char *)NULL);
+	return TCL_ERROR;
+    }
+    FutureForget(cmdPtr, futurePtr);
+
+    /*
+     * Hand the references of the future over, so that the result is not
+     * shared when the done event still holds on to the future.
+     */
+
+    Tcl_SetObjResult(interp, futurePtr->resultObj);
+    Tcl_DecrRefCount(futurePtr->resultObj);
+    futurePtr->resultObj = NULL;
+    code = Tcl_SetReturnOptions(interp, futurePtr->optionsObj);
+    Tcl_DecrRefCount(futurePtr->optionsObj);
+    futurePtr->optionsObj = NULL;
+    FutureRelease(futurePtr);
+    return code;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FutureWork, FutureDone --
+ *
+ *	The work and done functions of the futures of pool commands. The
+ *	first evaluates the script on a worker and detaches the result from
+ *	it, the second calls the -command callback on the submitting thread,
+ *	and then forgets the future: nothing refers to it after that.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Whatever the script and the callback do.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+FutureWork(
+    Tcl_Interp *interp,
+    ClientData clientData)
+{
+    PoolFuture *futurePtr = (PoolFuture *)clientData;
+    TclThreadPool *poolPtr = futurePtr->poolPtr;
+    Tcl_Obj *resultObj, *optionsObj;
+    int code;
+
+    /*
+     * Drop the references of the interpreter before detaching, so that a
+     * result that nothing else refers to is handed over as it is.
+     */
+
+    code = Tcl_EvalEx(interp, futurePtr->script, -1, TCL_EVAL_GLOBAL);
+    resultObj = Tcl_GetObjResult(interp);
+    Tcl_IncrRefCount(resultObj);
+    optionsObj = Tcl_GetReturnOptions(interp, code);
+    Tcl_IncrRefCount(optionsObj);
+    Tcl_ResetResult(interp);
+    futurePtr->resultObj = TclDetachObj(resultObj);
+    futurePtr->optionsObj = TclDetachObj(optionsObj);
+
+    Tcl_MutexLock(&poolPtr->mutex);
+    futurePtr->code = code;
+    futurePtr->finished = 1;
+    Tcl_MutexUnlock(&poolPtr->mutex);
+}
+
+static void
+FutureDone(
+    ClientData clientData)
+{
+    PoolFuture *futurePtr = (PoolFuture *)clientData;
+    Tcl_Interp *interp;
+    Tcl_Obj *cmdObj;
+    int code;
+
+    if (futurePtr->cmdPtr != NULL && futurePtr->callbackObj != NULL) {
+	interp = futurePtr->cmdPtr->interp;
+	cmdObj = Tcl_DuplicateObj(futurePtr->callbackObj);
+	Tcl_IncrRefCount(cmdObj);
+	Tcl_ListObjAppendElement(NULL, cmdObj, futurePtr->nameObj);
+	Tcl_Preserve(interp);
+	code = Tcl_EvalObjEx(interp, cmdObj, TCL_EVAL_GLOBAL);
+	if (code != TCL_OK) {
+	    Tcl_BackgroundException(interp, code);
+	}
+	Tcl_Release(interp);
+	Tcl_DecrRefCount(cmdObj);
+
+	/*
+	 * The callback may have deleted the pool command.
+	 */
+
+	if (futurePtr->cmdPtr != NULL) {
+	    FutureForget(futurePtr->cmdPtr, futurePtr);
+	}
+    }
+    FutureRelease(futurePtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FutureForget, FutureRelease --
+ *
+ *	FutureForget removes a future from the futures table of its command,
+ *	if it is still there, and drops the reference of the table.
+ *	FutureRelease drops a reference to a future and frees it with the
+ *	last one.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	May free the future.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+FutureForget(
+    PoolCmd *cmdPtr,
+    PoolFuture *futurePtr)
+{
+    Tcl_HashEntry *hPtr = Tcl_FindHashEntry(&cmdPtr->futures,
+	    TclGetString(futurePtr->nameObj));
+
+    if (hPtr != NULL && Tcl_GetHashValue(hPtr) == futurePtr) {
+	Tcl_DeleteHashEntry(hPtr);
+	FutureRelease(futurePtr);
+    }
+}
+
+static void
+FutureRelease(
+    PoolFuture *futurePtr)
+{
+    if (--futurePtr->refCount > 0) {
+	return;
+    }
+    Tcl_DecrRefCount(futurePtr->nameObj);
+    if (futurePtr->callbackObj) {
+	Tcl_DecrRefCount(futurePtr->callbackObj);
+    }
+    ckfree(futurePtr->script);
+    if (futurePtr->resultObj) {
+	Tcl_DecrRefCount(futurePtr->resultObj);
+    }
+    if (futurePtr->optionsObj) {
+	Tcl_DecrRefCount(futurePtr->optionsObj);
+    }
+    ckfree(futurePtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * PoolCmdDeleted --
+ *
+ *	Called when a pool command is deleted. Forgets the outstanding
+ *	futures of the command, including those whose done events are still
+ *	queued, and, for the command that created the pool, deletes the pool.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	May wait for the pool's outstanding work and join its workers.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+PoolCmdDeleted(
+    ClientData clientData)
+{
+    PoolCmd *cmdPtr = (PoolCmd *)clientData;
+    Tcl_HashEntry *hPtr;
+    Tcl_HashSearch search;
+    PoolFuture *futurePtr;
+
+    if (cmdPtr->isOwner) {
+	TclThreadPoolDelete(cmdPtr->poolPtr);
+    }
+    Tcl_DeleteEvents(DeleteFutureEvent, cmdPtr);
+    for (hPtr = Tcl_FirstHashEntry(&cmdPtr->futures, &search);
+	    hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+	futurePtr = (PoolFuture *)Tcl_GetHashValue(hPtr);
+	futurePtr->cmdPtr = NULL;
+	FutureRelease(futurePtr);
+    }
+    Tcl_DeleteHashTable(&cmdPtr->futures);
+    ckfree(cmdPtr);
+}
+
+static int
+DeleteFutureEvent(
+    Tcl_Event *evPtr,
+    ClientData clientData)	/* The PoolCmd being deleted. */
+{
+    PoolDoneEvent *eventPtr = (PoolDoneEvent *) evPtr;
+    PoolFuture *futurePtr;
+
+    if (evPtr->proc != PoolDoneEventProc
+	    || eventPtr->doneProc != FutureDone) {
+	return 0;
+    }
+    futurePtr = (PoolFuture *)eventPtr->clientData;
+    if (futurePtr->cmdPtr != (PoolCmd *)clientData) {
+	return 0;
+    }
+    FutureRelease(futurePtr);
+    return 1;
+}
+
+/*
+ * Local Variables:
+ * mode: c
+ * c-basic-offset: 4
+ * fill-column: 78
+ * End:
+ */
@@ -1039,7 +1039,7 @@ AfterDelay(
 	}
 	if (iPtr->limit.timeEvent != NULL
 		&& TCL_TIME_BEFORE(iPtr->limit.time, now)) {
-	    iPtr->limit.granularityTicker = 0;
+	    iPtr->limitPending |= TCL_LIMIT_TIME;
 	    if (Tcl_LimitCheck(interp) != TCL_OK) {
 		return TCL_ERROR;
 	    }
@@ -1087,6 +1087,7 @@ AfterDelay(
 	    if (Tcl_Canceled(interp, TCL_LEAVE_ERR_MSG) == TCL_ERROR) {
 		return TCL_ERROR;
 	    }
+	    iPtr->limitPending |= TCL_LIMIT_TIME;
 	    if (Tcl_LimitCheck(interp) != TCL_OK) {
 		return TCL_ERROR;
 	    }
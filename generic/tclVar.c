@@ -5747,6 +5747,101 @@ ObjFindNamespaceVar(
     return (Tcl_Var) varPtr;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclCloneNamespaceVars --
+ *
+ *	Copies the variables of a namespace in one interpreter into the
+ *	corresponding namespace of another interpreter, as part of [interp
+ *	clone]. Scalars and arrays are copied by sharing their value objects;
+ *	links, traced variables and variables that are declared but unset are
+ *	skipped, as their meaning is tied to the source interpreter.
+ *
+ * Results:
+ *	A standard Tcl result. Errors are left in the target interpreter.
+ *
+ * Side effects:
+ *	Creates or overwrites variables in the target namespace.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclCloneNamespaceVars(
+    Tcl_Interp *interp,		/* Interpreter receiving the variables. */
+    Namespace *srcNsPtr,	/* Namespace to copy the variables from. */
+    Namespace *nsPtr)		/* Namespace in interp to copy them into. */
+{
+    Tcl_HashSearch search, elemSearch;
+    Var *varPtr, *elemPtr, *newVarPtr;
+    Tcl_Obj *nameObj, *objv[3];
+    const char *errMsg = NULL;
+    int index, result = TCL_OK;
+
+    for (varPtr = VarHashFirstVar(&srcNsPtr->varTable, &search);
+	    varPtr != NULL; varPtr = VarHashNextVar(&search)) {
+	if (TclIsVarLink(varPtr) || TclIsVarTraced(varPtr)
+		|| TclIsVarDeadHash(varPtr)) {
+	    continue;
+	}
+	if (!TclIsVarArray(varPtr) && TclIsVarUndefined(varPtr)) {
+	    continue;
+	}
+
+	nameObj = Tcl_ObjPrintf("%s::%s",
+		(nsPtr->parentPtr == NULL) ? "" : nsPtr->fullName,
+		TclGetString(VarHashGetKey(varPtr)));
+	Tcl_IncrRefCount(nameObj);
+
+	if (!TclIsVarArray(varPtr)) {
+	    /*
+	     * Look the scalar up by its exact name: a name containing
+	     * parentheses must not be taken for an array element.
+	     */
+
+	    newVarPtr = TclLookupSimpleVar(interp, nameObj,
+		    TCL_GLOBAL_ONLY|TCL_AVOID_RESOLVERS, 1, &errMsg, &index);
+	    if (newVarPtr == NULL) {
+		TclObjVarErrMsg(interp, nameObj, NULL, "set", errMsg, -1);
+		Tcl_SetErrorCode(interp, "TCL", "LOOKUP", "VARNAME",
+			TclGetString(nameObj), (char *)NULL);
+		result = TCL_ERROR;
+	    } else if (TclPtrSetVarIdx(interp, newVarPtr, NULL, nameObj, NULL,
+		    varPtr->value.objPtr, TCL_LEAVE_ERR_MSG, -1) == NULL) {
+		result = TCL_ERROR;
+	    }
+	} else {
+	    /*
+	     * Hand the elements to [array set] so that empty arrays are
+	     * created as well.
+	     */
+
+	    TclNewObj(objv[2]);
+	    for (elemPtr = VarHashFirstVar(varPtr->value.tablePtr,
+		    &elemSearch); elemPtr != NULL;
+		    elemPtr = VarHashNextVar(&elemSearch)) {
+		if (TclIsVarUndefined(elemPtr) || TclIsVarTraced(elemPtr)) {
+		    continue;
+		}
+		Tcl_ListObjAppendElement(NULL, objv[2],
+			VarHashGetKey(elemPtr));
+		Tcl_ListObjAppendElement(NULL, objv[2],
+			elemPtr->value.objPtr);
+	    }
+	    Tcl_IncrRefCount(objv[2]);
+	    objv[0] = objv[1] = nameObj;
+	    result = ArraySetCmd(NULL, interp, 3, objv);
+	    Tcl_DecrRefCount(objv[2]);
+	}
+	Tcl_DecrRefCount(nameObj);
+	if (result != TCL_OK) {
+	    break;
+	}
+    }
+    return result;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -53,6 +53,68 @@ typedef struct {
     char nativeCommentBuf[MAX_COMMENT_LEN];
 } GzipHeader;
 
+/*
+ * Structures used for parallel compression. When a compressing stream or
+ * transform is allowed more than one thread, its input is cut into blocks
+ * that are deflated independently by a small pool of worker threads (with
+ * the calling thread taking a share of the work). Each block is primed with
+ * the 32kB of input that precedes it and is terminated on a byte boundary by
+ * a sync flush, so the compressed blocks can simply be concatenated. The
+ * zlib or gzip header and trailer are written around them, giving a single
+ * valid compressed stream.
+ */
+
+#define PARALLEL_BLOCK_SIZE	(128 * 1024)
+#define PARALLEL_WINDOW_SIZE	32768
+#define PARALLEL_BATCH_BLOCKS	4
+#define MAX_DEFLATE_THREADS	64
+
+typedef struct {
+    const unsigned char *inPtr;	/* The input for this block. The dictionary
+				 * bytes immediately precede it. */
+    int inLength;		/* Number of bytes of input. */
+    int dictLength;		/* Number of bytes of dictionary. */
+    int flush;			/* Z_SYNC_FLUSH, or Z_FINISH if this is the
+				 * last block of the whole stream. */
+    unsigned char *outPtr;	/* The compressed block, allocated by
+				 * whichever thread did the compression. */
+    int outLength;		/* Number of bytes of compressed output. */
+    uLong check;		/* Checksum of the input of the block. */
+    int code;			/* The zlib result code for the block. */
+} ParallelJob;
+
+typedef int (ParallelWriteProc)(void *clientData,
+	const unsigned char *bytes, int length);
+
+typedef struct {
+    int numThreads;		/* How many threads may compress at once,
+				 * including the calling thread. */
+    int level;			/* The compression level, 0-9 or -1. */
+    int format;			/* One of the TCL_ZLIB_FORMAT_* values. */
+    int headerDone;		/* Whether the header has been written. */
+    unsigned char *buffer;	/* The preceding window followed by the
+				 * input not yet compressed. */
+    int bufferSize;		/* Allocated size of the buffer. */
+    int windowLength;		/* Bytes of window at the buffer start. */
+    int pendingLength;		/* Bytes of pending input after that. */
+    uLong check;		/* Checksum of all input compressed so far. */
+    uLong totalIn;		/* Total input length (mod 2**32). */
+    z_stream callerStream;	/* Compressor for the calling thread. */
+    int callerStreamInit;	/* Whether callerStream is initialized. */
+    Tcl_ThreadId *workers;	/* The worker threads, once started. */
+    int numWorkers;		/* Number of worker threads running. */
+    Tcl_Mutex lock;		/* Guards the fields below. */
+    Tcl_Condition workCond;	/* Signalled when there are jobs to do, or
+				 * when the workers should stop. */
+    Tcl_Condition doneCond;	/* Signalled when the last job is done. */
+    ParallelJob *jobs;		/* The jobs of the current batch. */
+    int jobsAllocated;		/* Allocated size of the jobs array. */
+    int numJobs;		/* Number of jobs in the current batch. */
+    int nextJob;		/* Index of the next job to hand out. */
+    int jobsDone;		/* Number of jobs finished. */
+    int shutdown;		/* Whether the workers should exit. */
+} ParallelDeflate;
+
 /*
  * Structure used for the Tcl_ZlibStream* commands and [zlib stream ...]
  */
@@ -80,6 +142,9 @@ typedef struct {
     int flags;			/* Miscellaneous flag bits. */
     GzipHeader *gzHeaderPtr;	/* If we've allocated a gzip header
 				 * structure. */
+    ParallelDeflate *parallelPtr;
+				/* Parallel compression engine, or NULL if
+				 * compressing on the calling thread only. */
 } ZlibStreamHandle;
 
 #define DICT_TO_SET	0x1	/* If we need to set a compression dictionary
@@ -127,6 +192,9 @@ typedef struct {
     Tcl_Obj *compDictObj;	/* Byte-array object containing compression
 				 * dictionary (not dictObj!) to use if
 				 * necessary. */
+    ParallelDeflate *parallelPtr;
+				/* Parallel compression engine, or NULL if
+				 * compressing on the calling thread only. */
 } ZlibChannelData;
 
 /*
@@ -185,18 +253,47 @@ static inline int	Deflate(z_streamp strm, void *bufferPtr,
 static void		ExtractHeader(gz_header *headerPtr, Tcl_Obj *dictObj);
 static int		GenerateHeader(Tcl_Interp *interp, Tcl_Obj *dictObj,
 			    GzipHeader *headerPtr, int *extraSizePtr);
+static int		InflateGrowSize(int bufferSize, uLong totalIn,
+			    uLong totalOut, uInt availIn);
+static int		InflateSizeHint(int format,
+			    const unsigned char *inData, int inLen);
+static int		ParallelDeflateBatch(ParallelDeflate *pdPtr,
+			    int flush, ParallelWriteProc *writeProc,
+			    void *clientData);
+static void		ParallelDeflateBlock(ParallelDeflate *pdPtr,
+			    z_streamp strm, int *initPtr, ParallelJob *jobPtr);
+static uLong		ParallelDeflateChecksum(ParallelDeflate *pdPtr);
+static ParallelDeflate *ParallelDeflateCreate(int numThreads, int level,
+			    int format);
+static void		ParallelDeflateFree(ParallelDeflate *pdPtr);
+static int		ParallelDeflatePut(ParallelDeflate *pdPtr,
+			    z_streamp headerStrm, const unsigned char *bytes,
+			    int length, int flush,
+			    ParallelWriteProc *writeProc, void *clientData);
+static void		ParallelDeflateReset(ParallelDeflate *pdPtr);
+static int		ParallelDeflateSetDictionary(ParallelDeflate *pdPtr,
+			    Tcl_Obj *compDictObj, ParallelWriteProc *writeProc,
+			    void *clientData);
+static ParallelWriteProc	ParallelChannelWrite;
+static ParallelWriteProc	ParallelStreamWrite;
+static int		ZlibStreamPutParallel(ZlibStreamHandle *zshPtr,
+			    const unsigned char *bytes, int size, int flush);
+#ifdef TCL_THREADS
+static Tcl_ThreadCreateType ParallelDeflateWorker(ClientData clientData);
+#endif
 static int		ZlibPushSubcmd(Tcl_Interp *interp, int objc,
 			    Tcl_Obj *const objv[]);
 static int		ResultDecompress(ZlibChannelData *cd, char *buf,
 			    int toRead, int flush, int *errorCodePtr);
 static Tcl_Channel	ZlibStackChannelTransform(Tcl_Interp *interp,
 			    int mode, int format, int level, int limit,
-			    Tcl_Channel channel, Tcl_Obj *gzipHeaderDictPtr,
+			    int threads, Tcl_Channel channel, Tcl_Obj *gzipHeaderDictPtr,
 			    Tcl_Obj *compDictObj);
 static void		ZlibStreamCleanup(ZlibStreamHandle *zshPtr);
 static int		ZlibStreamSubcmd(Tcl_Interp *interp, int objc,
 			    Tcl_Obj *const objv[]);
 static inline void	ZlibTransformEventTimerKill(ZlibChannelData *cd);
+static inline void	ZlibTransformGrowOutBuffer(ZlibChannelData *cd);
 static void		ZlibTransformTimerRun(ClientData clientData);
 
 /*
@@ -655,6 +752,566 @@ AppendByteArray(
 	Tcl_ListObjAppendElement(NULL, listObj, baObj);
     }
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ParallelDeflateCreate, ParallelDeflateReset, ParallelDeflateFree --
+ *
+ *	Construct, restart and destroy the engine used for compressing a
+ *	stream on several threads at once. The worker threads are only
+ *	started when there is first enough data to keep them busy.
+ *
+ * Results:
+ *	ParallelDeflateCreate returns the new engine.
+ *
+ * Side effects:
+ *	Allocates or releases memory; ParallelDeflateFree stops and joins any
+ *	worker threads.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static ParallelDeflate *
+ParallelDeflateCreate(
+    int numThreads,		/* Threads to use, including the caller. */
+    int level,			/* 0-9 or Z_DEFAULT_COMPRESSION. */
+    int format)			/* One of the TCL_ZLIB_FORMAT_* values. */
+{
+    ParallelDeflate *pdPtr = (ParallelDeflate *)
+	    ckalloc(sizeof(ParallelDeflate));
+
+    memset(pdPtr, 0, sizeof(ParallelDeflate));
+    pdPtr->numThreads = numThreads;
+    pdPtr->level = level;
+    pdPtr->format = format;
+    ParallelDeflateReset(pdPtr);
+    return pdPtr;
+}
+
+static void
+ParallelDeflateReset(
+    ParallelDeflate *pdPtr)
+{
+    pdPtr->headerDone = 0;
+    pdPtr->windowLength = 0;
+    pdPtr->pendingLength = 0;
+    pdPtr->totalIn = 0;
+    if (pdPtr->format == TCL_ZLIB_FORMAT_GZIP) {
+	pdPtr->check = crc32(0, NULL, 0);
+    } else {
+	pdPtr->check = adler32(0, NULL, 0);
+    }
+}
+
+static void
+ParallelDeflateFree(
+    ParallelDeflate *pdPtr)
+{
+    int i, result;
+
+    if (pdPtr->numWorkers > 0) {
+	Tcl_MutexLock(&pdPtr->lock);
+	pdPtr->shutdown = 1;
+	Tcl_ConditionNotify(&pdPtr->workCond);
+	Tcl_MutexUnlock(&pdPtr->lock);
+	for (i=0 ; i<pdPtr->numWorkers ; i++) {
+	    Tcl_JoinThread(pdPtr->workers[i], &result);
+	}
+    }
+    if (pdPtr->workers) {
+	ckfree(pdPtr->workers);
+    }
+    if (pdPtr->callerStreamInit) {
+	deflateEnd(&pdPtr->callerStream);
+    }
+    if (pdPtr->jobs) {
+	ckfree(pdPtr->jobs);
+    }
+    if (pdPtr->buffer) {
+	ckfree(pdPtr->buffer);
+    }
+    Tcl_ConditionFinalize(&pdPtr->workCond);
+    Tcl_ConditionFinalize(&pdPtr->doneCond);
+    Tcl_MutexFinalize(&pdPtr->lock);
+    ckfree(pdPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ParallelDeflatePut --
+ *
+ *	Feed data into a parallel compression engine. Data is accumulated
+ *	until there are enough blocks to give every thread several of them,
+ *	or until a flush is requested, and is then compressed as a batch. The
+ *	compressed bytes are passed to writeProc in stream order.
+ *
+ * Results:
+ *	A zlib result code; Z_OK on success. Z_ERRNO means that writeProc
+ *	failed.
+ *
+ * Side effects:
+ *	May write the stream header using headerStrm, which must be a
+ *	compressor configured for the stream's format and header but which
+ *	has not yet produced any output. Z_FINISH writes the stream trailer.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ParallelDeflatePut(
+    ParallelDeflate *pdPtr,
+    z_streamp headerStrm,	/* Serial compressor used for the header. */
+    const unsigned char *bytes,	/* Data to compress. */
+    int length,			/* Length of the data. */
+    int flush,			/* Z_NO_FLUSH, Z_SYNC_FLUSH, Z_FULL_FLUSH or
+				 * Z_FINISH. */
+    ParallelWriteProc *writeProc,
+    void *clientData)
+{
+    int batchSize = pdPtr->numThreads * PARALLEL_BATCH_BLOCKS
+	    * PARALLEL_BLOCK_SIZE;
+    int e, toCopy;
+
+    if (!pdPtr->headerDone) {
+	unsigned char header[512];
+	int written;
+
+	/*
+	 * A Z_BLOCK flush with no input makes zlib produce just the header
+	 * for the configured format (with the dictionary id, or the gzip
+	 * name and comment, as appropriate) and nothing else.
+	 */
+
+	headerStrm->next_in = NULL;
+	headerStrm->avail_in = 0;
+	do {
+	    e = Deflate(headerStrm, header, sizeof(header), Z_BLOCK,
+		    &written);
+	    if (e != Z_OK && e != Z_BUF_ERROR) {
+		return e;
+	    }
+	    if (written > 0 && writeProc(clientData, header, written) != 0) {
+		return Z_ERRNO;
+	    }
+	} while (headerStrm->avail_out == 0);
+	pdPtr->headerDone = 1;
+    }
+
+    if (pdPtr->buffer == NULL) {
+	pdPtr->bufferSize = PARALLEL_WINDOW_SIZE + batchSize;
+	pdPtr->buffer = (unsigned char *)ckalloc(pdPtr->bufferSize);
+    }
+
+    while (length > 0) {
+	toCopy = batchSize - pdPtr->pendingLength;
+	if (toCopy > length) {
+	    toCopy = length;
+	}
+	memcpy(pdPtr->buffer + pdPtr->windowLength + pdPtr->pendingLength,
+		bytes, toCopy);
+	pdPtr->pendingLength += toCopy;
+	bytes += toCopy;
+	length -= toCopy;
+	if (pdPtr->pendingLength >= batchSize) {
+	    e = ParallelDeflateBatch(pdPtr, Z_NO_FLUSH, writeProc, clientData);
+	    if (e != Z_OK) {
+		return e;
+	    }
+	}
+    }
+
+    if (flush != Z_NO_FLUSH) {
+	return ParallelDeflateBatch(pdPtr, flush, writeProc, clientData);
+    }
+    return Z_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ParallelDeflateSetDictionary --
+ *
+ *	Make the given bytes the dictionary for the data that follows. Any
+ *	data already given to the engine is flushed out first so that it is
+ *	not compressed against the new dictionary.
+ *
+ * Results:
+ *	A zlib result code; Z_OK on success.
+ *
+ * Side effects:
+ *	Replaces the window of preceding data.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ParallelDeflateSetDictionary(
+    ParallelDeflate *pdPtr,
+    Tcl_Obj *compDictObj,
+    ParallelWriteProc *writeProc,
+    void *clientData)
+{
+    unsigned char *bytes;
+    int length, e;
+
+    if (pdPtr->pendingLength > 0) {
+	e = ParallelDeflateBatch(pdPtr, Z_SYNC_FLUSH, writeProc, clientData);
+	if (e != Z_OK) {
+	    return e;
+	}
+    }
+    bytes = Tcl_GetByteArrayFromObj(compDictObj, &length);
+    if (length > PARALLEL_WINDOW_SIZE) {
+	bytes += length - PARALLEL_WINDOW_SIZE;
+	length = PARALLEL_WINDOW_SIZE;
+    }
+    if (pdPtr->buffer == NULL) {
+	pdPtr->bufferSize = PARALLEL_WINDOW_SIZE + pdPtr->numThreads
+		* PARALLEL_BATCH_BLOCKS * PARALLEL_BLOCK_SIZE;
+	pdPtr->buffer = (unsigned char *)ckalloc(pdPtr->bufferSize);
+    }
+    memcpy(pdPtr->buffer, bytes, length);
+    pdPtr->windowLength = length;
+    return Z_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ParallelDeflateChecksum --
+ *
+ *	Return the checksum (Adler-32 or CRC-32 according to the format) of
+ *	all the data given to a parallel compression engine so far.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static uLong
+ParallelDeflateChecksum(
+    ParallelDeflate *pdPtr)
+{
+    const unsigned char *pending = pdPtr->buffer + pdPtr->windowLength;
+
+    if (pdPtr->pendingLength == 0) {
+	return pdPtr->check;
+    } else if (pdPtr->format == TCL_ZLIB_FORMAT_GZIP) {
+	return crc32(pdPtr->check, pending, pdPtr->pendingLength);
+    } else {
+	return adler32(pdPtr->check, pending, pdPtr->pendingLength);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ParallelDeflateBatch --
+ *
+ *	Compress the pending input of a parallel compression engine as a
+ *	batch of blocks shared out between the worker threads and the calling
+ *	thread, then write the compressed blocks out in order. Without a
+ *	flush, only whole blocks are compressed and any tail is kept for the
+ *	next batch.
+ *
+ * Results:
+ *	A zlib result code; Z_OK on success.
+ *
+ * Side effects:
+ *	Starts the worker threads if they are not yet running. Writes the
+ *	stream trailer if flush is Z_FINISH.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ParallelDeflateBatch(
+    ParallelDeflate *pdPtr,
+    int flush,
+    ParallelWriteProc *writeProc,
+    void *clientData)
+{
+    int i, numJobs, offset, consumed = 0, keep, e = Z_OK;
+    ParallelJob *jobPtr;
+
+    numJobs = pdPtr->pendingLength / PARALLEL_BLOCK_SIZE;
+    if (flush != Z_NO_FLUSH && (numJobs == 0
+	    || pdPtr->pendingLength % PARALLEL_BLOCK_SIZE)) {
+	numJobs++;
+    }
+    if (numJobs == 0) {
+	return Z_OK;
+    }
+
+    /*
+     * Describe the jobs. Each block is primed with the (up to) 32kB that
+     * precedes it, which is always in the buffer because the window from
+     * the previous batch sits in front of the pending input.
+     */
+
+    if (numJobs > pdPtr->jobsAllocated) {
+	pdPtr->jobsAllocated = numJobs;
+	pdPtr->jobs = (ParallelJob *)ckrealloc(pdPtr->jobs,
+		numJobs * sizeof(ParallelJob));
+    }
+    offset = pdPtr->windowLength;
+    for (i=0 ; i<numJobs ; i++) {
+	jobPtr = &pdPtr->jobs[i];
+	jobPtr->inPtr = pdPtr->buffer + offset;
+	jobPtr->inLength = pdPtr->pendingLength - consumed;
+	if (jobPtr->inLength > PARALLEL_BLOCK_SIZE) {
+	    jobPtr->inLength = PARALLEL_BLOCK_SIZE;
+	}
+	jobPtr->dictLength = (offset < PARALLEL_WINDOW_SIZE)
+		? offset : PARALLEL_WINDOW_SIZE;
+	jobPtr->flush = (flush == Z_FINISH && i == numJobs-1)
+		? Z_FINISH : Z_SYNC_FLUSH;
+	jobPtr->outPtr = NULL;
+	jobPtr->outLength = 0;
+	jobPtr->code = Z_OK;
+	offset += jobPtr->inLength;
+	consumed += jobPtr->inLength;
+    }
+
+#ifdef TCL_THREADS
+    if (numJobs > 1 && pdPtr->workers == NULL) {
+	Tcl_ThreadId id;
+
+	pdPtr->workers = (Tcl_ThreadId *)ckalloc(
+		(pdPtr->numThreads - 1) * sizeof(Tcl_ThreadId));
+	for (i=1 ; i<pdPtr->numThreads ; i++) {
+	    if (Tcl_CreateThread(&id, ParallelDeflateWorker, pdPtr,
+		    TCL_THREAD_STACK_DEFAULT, TCL_THREAD_JOINABLE) != TCL_OK) {
+		break;
+	    }
+	    pdPtr->workers[pdPtr->numWorkers++] = id;
+	}
+    }
+#endif /* TCL_THREADS */
+
+    /*
+     * Hand out the batch, and work on it ourselves too until every job has
+     * been taken; then wait for the workers to finish theirs.
+     */
+
+    Tcl_MutexLock(&pdPtr->lock);
+    pdPtr->numJobs = numJobs;
+    pdPtr->nextJob = 0;
+    pdPtr->jobsDone = 0;
+    if (numJobs > 1 && pdPtr->numWorkers > 0) {
+	Tcl_ConditionNotify(&pdPtr->workCond);
+    }
+    while (pdPtr->nextJob < pdPtr->numJobs) {
+	jobPtr = &pdPtr->jobs[pdPtr->nextJob++];
+	Tcl_MutexUnlock(&pdPtr->lock);
+	ParallelDeflateBlock(pdPtr, &pdPtr->callerStream,
+		&pdPtr->callerStreamInit, jobPtr);
+	Tcl_MutexLock(&pdPtr->lock);
+	pdPtr->jobsDone++;
+    }
+    while (pdPtr->jobsDone < pdPtr->numJobs) {
+	Tcl_ConditionWait(&pdPtr->doneCond, &pdPtr->lock, NULL);
+    }
+    Tcl_MutexUnlock(&pdPtr->lock);
+
+    /*
+     * Stitch the results together in order.
+     */
+
+    for (i=0 ; i<numJobs ; i++) {
+	jobPtr = &pdPtr->jobs[i];
+	if (e == Z_OK && jobPtr->code != Z_OK) {
+	    e = jobPtr->code;
+	}
+	if (e == Z_OK) {
+	    if (pdPtr->format == TCL_ZLIB_FORMAT_GZIP) {
+		pdPtr->check = crc32_combine(pdPtr->check, jobPtr->check,
+			jobPtr->inLength);
+	    } else if (pdPtr->format == TCL_ZLIB_FORMAT_ZLIB) {
+		pdPtr->check = adler32_combine(pdPtr->check, jobPtr->check,
+			jobPtr->inLength);
+	    }
+	    pdPtr->totalIn += jobPtr->inLength;
+	    if (writeProc(clientData, jobPtr->outPtr,
+		    jobPtr->outLength) != 0) {
+		e = Z_ERRNO;
+	    }
+	}
+	if (jobPtr->outPtr) {
+	    ckfree(jobPtr->outPtr);
+	}
+    }
+    if (e != Z_OK) {
+	return e;
+    }
+
+    if (flush == Z_FINISH && pdPtr->format != TCL_ZLIB_FORMAT_RAW) {
+	unsigned char trailer[8];
+	uLong check = pdPtr->check & 0xFFFFFFFF;
+	uLong size = pdPtr->totalIn & 0xFFFFFFFF;
+
+	if (pdPtr->format == TCL_ZLIB_FORMAT_ZLIB) {
+	    trailer[0] = (unsigned char) (check >> 24);
+	    trailer[1] = (unsigned char) (check >> 16);
+	    trailer[2] = (unsigned char) (check >> 8);
+	    trailer[3] = (unsigned char) check;
+	    e = writeProc(clientData, trailer, 4);
+	} else {
+	    trailer[0] = (unsigned char) check;
+	    trailer[1] = (unsigned char) (check >> 8);
+	    trailer[2] = (unsigned char) (check >> 16);
+	    trailer[3] = (unsigned char) (check >> 24);
+	    trailer[4] = (unsigned char) size;
+	    trailer[5] = (unsigned char) (size >> 8);
+	    trailer[6] = (unsigned char) (size >> 16);
+	    trailer[7] = (unsigned char) (size >> 24);
+	    e = writeProc(clientData, trailer, 8);
+	}
+	if (e != 0) {
+	    return Z_ERRNO;
+	}
+    }
+
+    /*
+     * Slide the last 32kB of compressed input to the front of the buffer to
+     * become the window for the next batch, followed by any input that was
+     * not compressed. A full flush (or the end of the stream) means that
+     * nothing after it may refer back, so it leaves no window.
+     */
+
+    offset = pdPtr->windowLength + consumed;
+    keep = 0;
+    if (flush != Z_FULL_FLUSH && flush != Z_FINISH) {
+	keep = (offset < PARALLEL_WINDOW_SIZE) ? offset : PARALLEL_WINDOW_SIZE;
+    }
+    memmove(pdPtr->buffer, pdPtr->buffer + offset - keep,
+	    keep + pdPtr->pendingLength - consumed);
+    pdPtr->windowLength = keep;
+    pdPtr->pendingLength -= consumed;
+    return Z_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ParallelDeflateBlock --
+ *
+ *	Compress one block of a batch as raw deflate data that ends on a byte
+ *	boundary, and compute the checksum of its input. Called on whichever
+ *	thread picked up the job, with that thread's own compressor.
+ *
+ * Results:
+ *	None; the outcome is recorded in the job.
+ *
+ * Side effects:
+ *	Initializes the compressor on first use. Allocates the job's output.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+ParallelDeflateBlock(
+    ParallelDeflate *pdPtr,
+    z_streamp strm,		/* The compressor of the current thread. */
+    int *initPtr,		/* Whether that compressor is initialized. */
+    ParallelJob *jobPtr)
+{
+    int e, outSize, written;
+
+    if (*initPtr) {
+	e = deflateReset(strm);
+    } else {
+	memset(strm, 0, sizeof(z_stream));
+	e = deflateInit2(strm, pdPtr->level, Z_DEFLATED, WBITS_RAW,
+		MAX_MEM_LEVEL, Z_DEFAULT_STRATEGY);
+	*initPtr = (e == Z_OK);
+    }
+    if (e == Z_OK && jobPtr->dictLength > 0) {
+	e = deflateSetDictionary(strm, jobPtr->inPtr - jobPtr->dictLength,
+		jobPtr->dictLength);
+    }
+    if (e != Z_OK) {
+	jobPtr->code = e;
+	return;
+    }
+
+    /*
+     * The bound allows for stored blocks but not for the sync flush marker,
+     * hence the extra. The loop is for safety only.
+     */
+
+    outSize = deflateBound(strm, jobPtr->inLength) + 16;
+    jobPtr->outPtr = (unsigned char *)ckalloc(outSize);
+    strm->next_in = (Bytef *) jobPtr->inPtr;
+    strm->avail_in = jobPtr->inLength;
+    while (1) {
+	e = Deflate(strm, jobPtr->outPtr + jobPtr->outLength,
+		outSize - jobPtr->outLength, jobPtr->flush, &written);
+	jobPtr->outLength += written;
+	if (e == Z_STREAM_END || (e == Z_OK && strm->avail_out > 0
+		&& jobPtr->flush != Z_FINISH)) {
+	    break;
+	}
+	if (e != Z_OK && e != Z_BUF_ERROR) {
+	    jobPtr->code = e;
+	    return;
+	}
+	outSize *= 2;
+	jobPtr->outPtr = (unsigned char *)ckrealloc(jobPtr->outPtr, outSize);
+    }
+
+    if (pdPtr->format == TCL_ZLIB_FORMAT_GZIP) {
+	jobPtr->check = crc32(0, jobPtr->inPtr, jobPtr->inLength);
+    } else if (pdPtr->format == TCL_ZLIB_FORMAT_ZLIB) {
+	jobPtr->check = adler32(1, jobPtr->inPtr, jobPtr->inLength);
+    }
+}
+
+#ifdef TCL_THREADS
+/*
+ *----------------------------------------------------------------------
+ *
+ * ParallelDeflateWorker --
+ *
+ *	Body of a worker thread of a parallel compression engine. Takes jobs
+ *	from the current batch until told to stop.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tcl_ThreadCreateType
+ParallelDeflateWorker(
+    ClientData clientData)
+{
+    ParallelDeflate *pdPtr = (ParallelDeflate *)clientData;
+    z_stream strm;
+    int strmInit = 0;
+    ParallelJob *jobPtr;
+
+    Tcl_MutexLock(&pdPtr->lock);
+    while (1) {
+	while (!pdPtr->shutdown && pdPtr->nextJob >= pdPtr->numJobs) {
+	    Tcl_ConditionWait(&pdPtr->workCond, &pdPtr->lock, NULL);
+	}
+	if (pdPtr->shutdown) {
+	    break;
+	}
+	jobPtr = &pdPtr->jobs[pdPtr->nextJob++];
+	Tcl_MutexUnlock(&pdPtr->lock);
+	ParallelDeflateBlock(pdPtr, &strm, &strmInit, jobPtr);
+	Tcl_MutexLock(&pdPtr->lock);
+	if (++pdPtr->jobsDone == pdPtr->numJobs) {
+	    Tcl_ConditionNotify(&pdPtr->doneCond);
+	}
+    }
+    Tcl_MutexUnlock(&pdPtr->lock);
+    if (strmInit) {
+	deflateEnd(&strm);
+    }
+    Tcl_ExitThread(TCL_OK);
+    TCL_THREAD_CREATE_RETURN;
+}
+#endif /* TCL_THREADS */
 
 /*
  *----------------------------------------------------------------------
@@ -780,6 +1437,7 @@ Tcl_ZlibStreamInit(
     zshPtr->compDictObj = NULL;
     zshPtr->flags = 0;
     zshPtr->gzHeaderPtr = gzHeaderPtr;
+    zshPtr->parallelPtr = NULL;
     memset(&zshPtr->stream, 0, sizeof(z_stream));
     zshPtr->stream.adler = 1;
 
@@ -984,6 +1642,9 @@ ZlibStreamCleanup(
     if (zshPtr->gzHeaderPtr) {
 	ckfree(zshPtr->gzHeaderPtr);
     }
+    if (zshPtr->parallelPtr) {
+	ParallelDeflateFree(zshPtr->parallelPtr);
+    }
 
     ckfree(zshPtr);
 }
@@ -1033,6 +1694,12 @@ Tcl_ZlibStreamReset(
      * No output buffer available yet.
      */
 
+    if (zshPtr->parallelPtr) {
+	ParallelDeflateReset(zshPtr->parallelPtr);
+	if (zshPtr->compDictObj) {
+	    zshPtr->flags |= DICT_TO_SET;
+	}
+    }
     if (zshPtr->mode == TCL_ZLIB_STREAM_DEFLATE) {
 	e = deflateInit2(&zshPtr->stream, zshPtr->level, Z_DEFLATED,
 		zshPtr->wbits, MAX_MEM_LEVEL, Z_DEFAULT_STRATEGY);
@@ -1140,6 +1807,9 @@ Tcl_ZlibStreamChecksum(
 {
     ZlibStreamHandle *zshPtr = (ZlibStreamHandle *) zshandle;
 
+    if (zshPtr->parallelPtr) {
+	return ParallelDeflateChecksum(zshPtr->parallelPtr);
+    }
     return zshPtr->stream.adler;
 }
 
@@ -1224,6 +1894,11 @@ Tcl_ZlibStreamPut(
 	    return TCL_OK;
 	}
 
+	if (zshPtr->parallelPtr) {
+	    return ZlibStreamPutParallel(zshPtr, zshPtr->stream.next_in, size,
+		    flush);
+	}
+
 	if (HaveDictToSet(zshPtr)) {
 	    e = SetDeflateDictionary(&zshPtr->stream, zshPtr->compDictObj);
 	    if (e != Z_OK) {
@@ -1305,6 +1980,65 @@ Tcl_ZlibStreamPut(
     return TCL_OK;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * ZlibStreamPutParallel --
+ *
+ *	Compress data for a stream that has a parallel compression engine.
+ *	The compression dictionary, if any, primes the first block (and is
+ *	announced in the zlib header).
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ZlibStreamPutParallel(
+    ZlibStreamHandle *zshPtr,
+    const unsigned char *bytes,
+    int size,
+    int flush)
+{
+    ParallelDeflate *pdPtr = zshPtr->parallelPtr;
+    int e;
+
+    if (HaveDictToSet(zshPtr)) {
+	e = Z_OK;
+	if (!pdPtr->headerDone) {
+	    e = SetDeflateDictionary(&zshPtr->stream, zshPtr->compDictObj);
+	}
+	if (e == Z_OK) {
+	    e = ParallelDeflateSetDictionary(pdPtr, zshPtr->compDictObj,
+		    ParallelStreamWrite, zshPtr);
+	}
+	if (e != Z_OK) {
+	    ConvertError(zshPtr->interp, e, zshPtr->stream.adler);
+	    return TCL_ERROR;
+	}
+	zshPtr->flags &= ~DICT_TO_SET;
+    }
+
+    e = ParallelDeflatePut(pdPtr, &zshPtr->stream, bytes, size, flush,
+	    ParallelStreamWrite, zshPtr);
+    if (e != Z_OK) {
+	ConvertError(zshPtr->interp, e, zshPtr->stream.adler);
+	return TCL_ERROR;
+    }
+    return TCL_OK;
+}
+
+static int
+ParallelStreamWrite(
+    void *clientData,
+    const unsigned char *bytes,
+    int length)
+{
+    ZlibStreamHandle *zshPtr = (ZlibStreamHandle *)clientData;
+
+    AppendByteArray(zshPtr->outData, (void *) bytes, length);
+    return 0;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -1707,6 +2441,90 @@ Tcl_ZlibDeflate(
     return TCL_ERROR;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * InflateSizeHint, InflateGrowSize --
+ *
+ *	Estimate how large a buffer Tcl_ZlibInflate needs. A gzip stream
+ *	records the length of its uncompressed data (modulo 2**32) in its last
+ *	four bytes, which is exact for the usual single-member stream; the
+ *	value is only trusted if it is achievable from the input length
+ *	(deflate cannot expand data by more than a factor of about 1032).
+ *	Otherwise, start at a multiple of the input length and, when that is
+ *	not enough, extrapolate from the ratio achieved so far.
+ *
+ * Results:
+ *	A buffer size in bytes.
+ *
+ *----------------------------------------------------------------------
+ */
+
+#define MAX_INFLATE_RATIO	1032
+#define MAX_INFLATE_BUFFER	(INT_MAX - 1024)
+
+static int
+InflateSizeHint(
+    int format,
+    const unsigned char *inData,
+    int inLen)
+{
+    if ((format == TCL_ZLIB_FORMAT_GZIP || format == TCL_ZLIB_FORMAT_AUTO)
+	    && inLen >= 18 && inData[0] == 0x1f && inData[1] == 0x8b) {
+	const unsigned char *p = inData + inLen - 4;
+	unsigned long isize = p[0] | (p[1] << 8) | (p[2] << 16)
+		| ((unsigned long) p[3] << 24);
+
+	if (isize > 0 && isize < MAX_INFLATE_BUFFER
+		&& isize / MAX_INFLATE_RATIO <= (unsigned long) inLen) {
+	    /*
+	     * Plus one so that zlib sees room left over and can report the
+	     * end of the stream without another round trip.
+	     */
+
+	    return (int) isize + 1;
+	}
+    }
+
+    /*
+     * Start with a buffer (up to) 3 times the size of the input data.
+     */
+
+    if (inLen < 32*1024*1024) {
+	return 3*inLen;
+    } else if (inLen < 256*1024*1024) {
+	return 2*inLen;
+    }
+    return inLen;
+}
+
+static int
+InflateGrowSize(
+    int bufferSize,		/* The current size of the buffer. */
+    uLong totalIn,		/* Compressed bytes consumed so far. */
+    uLong totalOut,		/* Uncompressed bytes produced so far. */
+    uInt availIn)		/* Compressed bytes not yet consumed. */
+{
+    double estimate = (double) bufferSize * 1.5;
+
+    if (totalIn > 0) {
+	double projected = (double) totalOut
+		+ (double) availIn * ((double) totalOut / (double) totalIn)
+		+ 1024;
+
+	if (projected > estimate) {
+	    estimate = projected;
+	}
+    }
+    if (estimate < (double) bufferSize + 1024) {
+	estimate = (double) bufferSize + 1024;
+    }
+    if (estimate > (double) MAX_INFLATE_BUFFER) {
+	estimate = (double) MAX_INFLATE_BUFFER;
+    }
+    return (int) estimate;
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -1776,17 +2594,7 @@ Tcl_ZlibInflate(
 
     inData = Tcl_GetByteArrayFromObj(data, &inLen);
     if (bufferSize < 1) {
-	/*
-	 * Start with a buffer (up to) 3 times the size of the input data.
-	 */
-
-	if (inLen < 32*1024*1024) {
-	    bufferSize = 3*inLen;
-	} else if (inLen < 256*1024*1024) {
-	    bufferSize = 2*inLen;
-	} else {
-	    bufferSize = inLen;
-	}
+	bufferSize = InflateSizeHint(format, inData, inLen);
     }
 
     TclNewObj(obj);
@@ -1825,19 +2633,23 @@ Tcl_ZlibInflate(
 	}
 
 	/*
-	 * Not enough room in the output buffer. Increase it by five times the
-	 * bytes still in the input buffer. (Because 3 times didn't do the
-	 * trick before, 5 times is what we do next.) Further optimization
-	 * should be done by the user, specify the decompressed size!
+	 * Not enough room in the output buffer. Estimate what the remaining
+	 * input will expand to from the compression ratio seen so far, but
+	 * always grow the buffer by at least half again so that the number
+	 * of reallocations stays logarithmic in the size of the output.
+	 * Further optimization should be done by the user, specify the
+	 * decompressed size!
 	 */
 
 	if ((stream.avail_in == 0) && (stream.avail_out > 0)) {
 	    e = Z_STREAM_ERROR;
 	    break;
 	}
-	newBufferSize = bufferSize + 5 * stream.avail_in;
-	if (newBufferSize == bufferSize) {
-	    newBufferSize = bufferSize+1000;
+	newBufferSize = InflateGrowSize(bufferSize, stream.total_in,
+		stream.total_out, stream.avail_in);
+	if (newBufferSize <= bufferSize) {
+	    e = Z_MEM_ERROR;
+	    break;
 	}
 	newOutData = Tcl_SetByteArrayLength(obj, newBufferSize);
 
@@ -2217,17 +3029,19 @@ ZlibStreamSubcmd(
 	FMT_COMPRESS, FMT_DECOMPRESS, FMT_DEFLATE, FMT_GUNZIP, FMT_GZIP,
 	FMT_INFLATE
     };
-    int i, format, mode = 0, option, level;
+    int i, format, mode = 0, option, level, threads;
     enum objIndices {
 	OPT_COMPRESSION_DICTIONARY = 0,
 	OPT_GZIP_HEADER = 1,
 	OPT_COMPRESSION_LEVEL = 2,
+	OPT_COMPRESSION_THREADS = 3,
 	OPT_END = -1
     };
-    Tcl_Obj *obj[3] = { NULL, NULL, NULL };
+    Tcl_Obj *obj[4] = { NULL, NULL, NULL, NULL };
 #define compDictObj	obj[OPT_COMPRESSION_DICTIONARY]
 #define gzipHeaderObj	obj[OPT_GZIP_HEADER]
 #define levelObj	obj[OPT_COMPRESSION_LEVEL]
+#define threadsObj	obj[OPT_COMPRESSION_THREADS]
     typedef struct {
 	const char *name;
 	enum objIndices offset;
@@ -2235,11 +3049,13 @@ ZlibStreamSubcmd(
     static const OptDescriptor compressionOpts[] = {
 	{ "-dictionary", OPT_COMPRESSION_DICTIONARY },
 	{ "-level",	 OPT_COMPRESSION_LEVEL },
+	{ "-threads",	 OPT_COMPRESSION_THREADS },
 	{ NULL, OPT_END }
     };
     static const OptDescriptor gzipOpts[] = {
 	{ "-header",	 OPT_GZIP_HEADER },
 	{ "-level",	 OPT_COMPRESSION_LEVEL },
+	{ "-threads",	 OPT_COMPRESSION_THREADS },
 	{ NULL, OPT_END }
     };
     static const OptDescriptor expansionOpts[] = {
@@ -2329,6 +3145,23 @@ ZlibStreamSubcmd(
 	return TCL_ERROR;
     }
 
+    /*
+     * If a thread count was given, parse it too. More than one thread means
+     * using the parallel compression engine.
+     */
+
+    if (threadsObj == NULL) {
+	threads = 1;
+    } else if (Tcl_GetIntFromObj(interp, threadsObj, &threads) != TCL_OK) {
+	return TCL_ERROR;
+    } else if (threads < 1 || threads > MAX_DEFLATE_THREADS) {
+	Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+		"thread count must be 1 to %d", MAX_DEFLATE_THREADS));
+	Tcl_SetErrorCode(interp, "TCL", "VALUE", "THREADCOUNT", (char *)NULL);
+	Tcl_AddErrorInfo(interp, "\n    (in -threads option)");
+	return TCL_ERROR;
+    }
+
     /*
      * Construct the stream now we know its configuration.
      */
@@ -2340,11 +3173,16 @@ ZlibStreamSubcmd(
     if (compDictObj != NULL) {
 	Tcl_ZlibStreamSetCompressionDictionary(zh, compDictObj);
     }
+    if (threads > 1) {
+	((ZlibStreamHandle *) zh)->parallelPtr =
+		ParallelDeflateCreate(threads, level, format);
+    }
     Tcl_SetObjResult(interp, Tcl_ZlibStreamGetCommandName(zh));
     return TCL_OK;
 #undef compDictObj
 #undef gzipHeaderObj
 #undef levelObj
+#undef threadsObj
 }
 
 /*
@@ -2374,15 +3212,22 @@ ZlibPushSubcmd(
     Tcl_Channel chan;
     int chanMode, format, mode = 0, level, i, option;
     static const char *const pushCompressOptions[] = {
-	"-dictionary", "-header", "-level", NULL
+	"-dictionary", "-header", "-level", "-threads", NULL
     };
     static const char *const pushDecompressOptions[] = {
 	"-dictionary", "-header", "-level", "-limit", NULL
     };
+    enum pushOptionsEnum {poDictionary, poHeader, poLevel, poLimit, poThreads};
+    static const enum pushOptionsEnum pushCompressCodes[] = {
+	poDictionary, poHeader, poLevel, poThreads
+    };
+    static const enum pushOptionsEnum pushDecompressCodes[] = {
+	poDictionary, poHeader, poLevel, poLimit
+    };
     const char *const *pushOptions = pushDecompressOptions;
-    enum pushOptionsEnum {poDictionary, poHeader, poLevel, poLimit};
+    const enum pushOptionsEnum *pushCodes = pushDecompressCodes;
     Tcl_Obj *headerObj = NULL, *compDictObj = NULL;
-    int limit = DEFAULT_BUFFER_SIZE;
+    int limit = DEFAULT_BUFFER_SIZE, threads = 1;
     int dummy;
 
     if (objc < 4) {
@@ -2399,6 +3244,7 @@ ZlibPushSubcmd(
 	mode = TCL_ZLIB_STREAM_DEFLATE;
 	format = TCL_ZLIB_FORMAT_RAW;
 	pushOptions = pushCompressOptions;
+	pushCodes = pushCompressCodes;
 	break;
     case FMT_INFLATE:
 	mode = TCL_ZLIB_STREAM_INFLATE;
@@ -2408,6 +3254,7 @@ ZlibPushSubcmd(
 	mode = TCL_ZLIB_STREAM_DEFLATE;
 	format = TCL_ZLIB_FORMAT_ZLIB;
 	pushOptions = pushCompressOptions;
+	pushCodes = pushCompressCodes;
 	break;
     case FMT_DECOMPRESS:
 	mode = TCL_ZLIB_STREAM_INFLATE;
@@ -2417,6 +3264,7 @@ ZlibPushSubcmd(
 	mode = TCL_ZLIB_STREAM_DEFLATE;
 	format = TCL_ZLIB_FORMAT_GZIP;
 	pushOptions = pushCompressOptions;
+	pushCodes = pushCompressCodes;
 	break;
     case FMT_GUNZIP:
 	mode = TCL_ZLIB_STREAM_INFLATE;
@@ -2463,7 +3311,7 @@ ZlibPushSubcmd(
 	    Tcl_SetErrorCode(interp, "TCL", "ZIP", "NOVAL", (char *)NULL);
 	    return TCL_ERROR;
 	}
-	switch ((enum pushOptionsEnum) option) {
+	switch (pushCodes[option]) {
 	case poHeader:
 	    headerObj = objv[i];
 	    if (Tcl_DictObjSize(interp, headerObj, &dummy) != TCL_OK) {
@@ -2504,11 +3352,23 @@ ZlibPushSubcmd(
 	    }
 	    compDictObj = objv[i];
 	    break;
+	case poThreads:
+	    if (Tcl_GetIntFromObj(interp, objv[i], &threads) != TCL_OK) {
+		goto genericOptionError;
+	    }
+	    if (threads < 1 || threads > MAX_DEFLATE_THREADS) {
+		Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+			"thread count must be 1 to %d", MAX_DEFLATE_THREADS));
+		Tcl_SetErrorCode(interp, "TCL", "VALUE", "THREADCOUNT",
+			(char *)NULL);
+		goto genericOptionError;
+	    }
+	    break;
 	}
     }
 
-    if (ZlibStackChannelTransform(interp, mode, format, level, limit, chan,
-	    headerObj, compDictObj) == NULL) {
+    if (ZlibStackChannelTransform(interp, mode, format, level, limit,
+	    threads, chan, headerObj, compDictObj) == NULL) {
 	return TCL_ERROR;
     }
     Tcl_SetObjResult(interp, objv[3]);
@@ -2928,7 +3788,25 @@ ZlibTransformClose(
      * Flush any data waiting to be compressed.
      */
 
-    if (cd->mode == TCL_ZLIB_STREAM_DEFLATE) {
+    if (cd->mode == TCL_ZLIB_STREAM_DEFLATE && cd->parallelPtr) {
+	e = ParallelDeflatePut(cd->parallelPtr, &cd->outStream, NULL, 0,
+		Z_FINISH, ParallelChannelWrite, cd);
+	if (e != Z_OK && !TclInThreadExit() && interp) {
+	    if (e == Z_ERRNO) {
+		Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+			"error while finalizing file: %s",
+			Tcl_PosixError(interp)));
+	    } else {
+		ConvertError(interp, e, cd->outStream.adler);
+	    }
+	}
+	if (e != Z_OK) {
+	    result = TCL_ERROR;
+	}
+	ParallelDeflateFree(cd->parallelPtr);
+	cd->parallelPtr = NULL;
+	(void) deflateEnd(&cd->outStream);
+    } else if (cd->mode == TCL_ZLIB_STREAM_DEFLATE) {
 	cd->outStream.avail_in = 0;
 	do {
 	    e = Deflate(&cd->outStream, cd->outBuffer, cd->outAllocated,
@@ -2963,6 +3841,9 @@ ZlibTransformClose(
 		result = TCL_ERROR;
 		break;
 	    }
+	    if (written == cd->outAllocated) {
+		ZlibTransformGrowOutBuffer(cd);
+	    }
 	} while (e != Z_STREAM_END);
 	(void) deflateEnd(&cd->outStream);
     } else {
@@ -3171,6 +4052,19 @@ ZlibTransformOutput(
 	return 0;
     }
 
+    if (cd->parallelPtr) {
+	e = ParallelDeflatePut(cd->parallelPtr, &cd->outStream,
+		(const unsigned char *) buf, toWrite, Z_NO_FLUSH,
+		ParallelChannelWrite, cd);
+	if (e == Z_OK) {
+	    return toWrite;
+	} else if (e == Z_ERRNO) {
+	    *errorCodePtr = Tcl_GetErrno();
+	    return -1;
+	}
+	goto zlibError;
+    }
+
     cd->outStream.next_in = (Bytef *) buf;
     cd->outStream.avail_in = toWrite;
     while (cd->outStream.avail_in > 0) {
@@ -3184,12 +4078,16 @@ ZlibTransformOutput(
 	    *errorCodePtr = Tcl_GetErrno();
 	    return -1;
 	}
+	if (produced == cd->outAllocated) {
+	    ZlibTransformGrowOutBuffer(cd);
+	}
     }
 
     if (e == Z_OK) {
 	return toWrite - cd->outStream.avail_in;
     }
 
+  zlibError:
     errObj = Tcl_NewListObj(0, NULL);
     Tcl_ListObjAppendElement(NULL, errObj, Tcl_NewStringObj("-errorcode",-1));
     Tcl_ListObjAppendElement(NULL, errObj,
@@ -3201,6 +4099,33 @@ ZlibTransformOutput(
     return -1;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * ZlibTransformGrowOutBuffer --
+ *
+ *	Called when the compressor has filled the whole output buffer of a
+ *	compressing transform, which means that it has more output ready than
+ *	the buffer holds. The buffer is doubled (up to a limit) so that bulk
+ *	writes reach the underlying channel in fewer, larger pieces, while
+ *	transforms that only ever see small writes keep a small buffer.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static inline void
+ZlibTransformGrowOutBuffer(
+    ZlibChannelData *cd)
+{
+    if (cd->outAllocated < MAX_BUFFER_SIZE) {
+	cd->outAllocated *= 2;
+	if (cd->outAllocated > MAX_BUFFER_SIZE) {
+	    cd->outAllocated = MAX_BUFFER_SIZE;
+	}
+	cd->outBuffer = (char *)ckrealloc(cd->outBuffer, cd->outAllocated);
+    }
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -3220,6 +4145,21 @@ ZlibTransformFlush(
     int e;
     int len;
 
+    if (cd->parallelPtr) {
+	e = ParallelDeflatePut(cd->parallelPtr, &cd->outStream, NULL, 0,
+		flushType, ParallelChannelWrite, cd);
+	if (e == Z_ERRNO) {
+	    Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+		    "problem flushing channel: %s",
+		    Tcl_PosixError(interp)));
+	    return TCL_ERROR;
+	} else if (e != Z_OK) {
+	    ConvertError(interp, e, cd->outStream.adler);
+	    return TCL_ERROR;
+	}
+	return TCL_OK;
+    }
+
     cd->outStream.avail_in = 0;
     do {
 	/*
@@ -3243,6 +4183,9 @@ ZlibTransformFlush(
 		    Tcl_PosixError(interp)));
 	    return TCL_ERROR;
 	}
+	if (len == cd->outAllocated) {
+	    ZlibTransformGrowOutBuffer(cd);
+	}
 
 	/*
 	 * If we get to this point, either we're in the Z_OK or the
@@ -3256,6 +4199,32 @@ ZlibTransformFlush(
     } while (len > 0 && e == Z_BUF_ERROR);
     return TCL_OK;
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ParallelChannelWrite --
+ *
+ *	Pass bytes produced by parallel compression to the next layer of a
+ *	compressing transform.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ParallelChannelWrite(
+    void *clientData,
+    const unsigned char *bytes,
+    int length)
+{
+    ZlibChannelData *cd = (ZlibChannelData *)clientData;
+
+    if (length > 0 && Tcl_WriteRaw(cd->parent, (const char *) bytes,
+	    length) < 0) {
+	return -1;
+    }
+    return 0;
+}
 
 /*
  *----------------------------------------------------------------------
@@ -3296,7 +4265,19 @@ ZlibTransformSetOption(			/* not used */
 	}
 	cd->compDictObj = compDictObj;
 	code = Z_OK;
-	if (cd->mode == TCL_ZLIB_STREAM_DEFLATE) {
+	if (cd->mode == TCL_ZLIB_STREAM_DEFLATE && cd->parallelPtr) {
+	    if (!cd->parallelPtr->headerDone) {
+		code = SetDeflateDictionary(&cd->outStream, compDictObj);
+	    }
+	    if (code == Z_OK) {
+		code = ParallelDeflateSetDictionary(cd->parallelPtr,
+			compDictObj, ParallelChannelWrite, cd);
+	    }
+	    if (code != Z_OK) {
+		ConvertError(interp, code, cd->outStream.adler);
+		return TCL_ERROR;
+	    }
+	} else if (cd->mode == TCL_ZLIB_STREAM_DEFLATE) {
 	    code = SetDeflateDictionary(&cd->outStream, compDictObj);
 	    if (code != Z_OK) {
 		ConvertError(interp, code, cd->outStream.adler);
@@ -3405,7 +4386,9 @@ ZlibTransformGetOption(
 	uLong crc;
 	char buf[12];
 
-	if (cd->mode == TCL_ZLIB_STREAM_DEFLATE) {
+	if (cd->parallelPtr) {
+	    crc = ParallelDeflateChecksum(cd->parallelPtr);
+	} else if (cd->mode == TCL_ZLIB_STREAM_DEFLATE) {
 	    crc = cd->outStream.adler;
 	} else {
 	    crc = cd->inStream.adler;
@@ -3634,6 +4617,9 @@ ZlibStackChannelTransform(
 				 * decompressing transforms. */
     int limit,			/* The limit on the number of bytes to read
 				 * ahead; always at least 1. */
+    int threads,		/* How many threads may be used to compress;
+				 * more than 1 selects parallel compression.
+				 * Ignored for decompressing transforms. */
     Tcl_Channel channel,	/* The channel to attach to. */
     Tcl_Obj *gzipHeaderDictPtr,	/* A description of header to use, or NULL to
 				 * use a default. Ignored if not compressing
@@ -3733,6 +4719,13 @@ ZlibStackChannelTransform(
 		goto error;
 	    }
 	}
+	if (threads > 1) {
+	    cd->parallelPtr = ParallelDeflateCreate(threads, level, format);
+	    if (cd->compDictObj) {
+		ParallelDeflateSetDictionary(cd->parallelPtr, cd->compDictObj,
+			ParallelChannelWrite, cd);
+	    }
+	}
     }
 
     chan = Tcl_StackChannel(interp, &zlibChannelType, cd,
@@ -3757,6 +4750,9 @@ ZlibStackChannelTransform(
     if (cd->compDictObj) {
 	Tcl_DecrRefCount(cd->compDictObj);
     }
+    if (cd->parallelPtr) {
+	ParallelDeflateFree(cd->parallelPtr);
+    }
     ckfree(cd);
     return NULL;
 }
@@ -3896,7 +4892,11 @@ TclZlibInit(
      * commands.
      */
 
-    Tcl_EvalEx(interp, "namespace eval ::tcl::zlib {variable cmdcounter 0}", -1, 0);
+    if (Tcl_FindNamespace(interp, "::tcl::zlib", NULL, 0) == NULL) {
+	Tcl_CreateNamespace(interp, "::tcl::zlib", NULL, NULL);
+    }
+    Tcl_SetVar2Ex(interp, "::tcl::zlib::cmdcounter", NULL, Tcl_NewIntObj(0),
+	    TCL_GLOBAL_ONLY);
 
     /*
      * Create the public scripted interface to this file's functionality.
@@ -659,9 +659,13 @@ proc ::tcl::clock::Initialize {} {
 # The 'clock format' command formats times of day for output.  Refer to the
 # user documentation to see what it does.
 #
+# The command itself is implemented in C; it calls this procedure for the
+# format groups and time zones that it does not handle natively, and to
+# report errors.
+#
 #----------------------------------------------------------------------
 
-proc ::tcl::clock::format { args } {
+proc ::tcl::clock::FormatTcl { args } {
 
     variable FormatProc
     variable TZData
@@ -734,6 +738,37 @@ proc ::tcl::clock::ParseClockFormatFormat {procName format locale} {
     }
 }
 
+#----------------------------------------------------------------------
+#
+# GetFormatLocaleData --
+#
+#	Collects what the native [clock format] and [clock scan] need to
+#	know about a locale to handle a format string.
+#
+# Parameters:
+#	format - Format string supplied to [clock format] or [clock scan]
+#	locale - Name of the locale
+#
+# Results:
+#	Returns a list comprising the format with the locale-dependent
+#	composite groups mapped away, the abbreviated and full day and month
+#	names, the AM, PM, BCE and CE indicators, the locale's numerals and
+#	eras, and the Julian Day of its Gregorian changeover.
+#
+# Side effects:
+#	Loads the locale's message catalog if needed.
+#
+#----------------------------------------------------------------------
+
+proc ::tcl::clock::GetFormatLocaleData {format locale} {
+    EnterLocale $locale
+    list [LocalizeFormat $locale $format] \
+	[mc DAYS_OF_WEEK_ABBREV] [mc DAYS_OF_WEEK_FULL] \
+	[mc MONTHS_ABBREV] [mc MONTHS_FULL] \
+	[mc AM] [mc PM] [mc BCE] [mc CE] \
+	[mc LOCALE_NUMERALS] [mc LOCALE_ERAS] [mc GREGORIAN_CHANGE_DATE]
+}
+
 proc ::tcl::clock::ParseClockFormatFormat2 {format locale procName} {
     set didLocaleEra 0
     set didLocaleNumerals 0
@@ -1178,9 +1213,13 @@ proc ::tcl::clock::ParseClockFormatFormat2 {format locale procName} {
 # The 'clock scan' command scans times of day on input.  Refer to the user
 # documentation to see what it does.
 #
+# The command itself is implemented in C; it calls this procedure for
+# free-form scans, for the format groups that it does not handle natively,
+# and to report errors.
+#
 #----------------------------------------------------------------------
 
-proc ::tcl::clock::scan { args } {
+proc ::tcl::clock::ScanTcl { args } {
 
     set format {}
 
@@ -4513,6 +4552,7 @@ proc ::tcl::clock::ChangeCurrentLocale {args} {
 
     catch {array unset FormatProc *'current}
     set LocaleNumeralCache {}
+    ClearNativeCaches
 }
 
 #----------------------------------------------------------------------
@@ -4548,6 +4588,7 @@ proc ::tcl::clock::ClearCaches {} {
     catch {unset FormatProc}
     set LocaleNumeralCache {}
     catch {unset CachedSystemTimeZone}
+    ClearNativeCaches
     set TimeZoneBad {}
     InitTZData
 }
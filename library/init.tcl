@@ -180,7 +180,7 @@ if {[interp issafe]} {
     proc ::tcl::initClock {} {
 	# Auto-loading stubs for 'clock.tcl'
 
-	foreach cmd {add format scan} {
+	foreach cmd {add FormatTcl ScanTcl} {
 	    proc ::tcl::clock::$cmd args {
 		variable TclLibDir
 		source -encoding utf-8 [file join $TclLibDir clock.tcl]
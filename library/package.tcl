@@ -447,6 +447,197 @@ proc tclPkgSetup {dir pkg version files} {
     }
 }
 
+# ::tcl::Pkg::IndexCacheLoad --
+# ::tcl::Pkg::IndexCacheSave --
+# ::tcl::Pkg::IndexSource --
+# Support for an optional persistent cache of the package index files
+# sourced by tclPkgUnknown. When the environment variable
+# TCL_PKG_INDEX_CACHE names a file, IndexSource records the [package
+# ifneeded] registrations that each pkgIndex.tcl file makes and, as long as
+# the file's size and modification time stay the same, replays the ones for
+# the package being looked for the next time instead of sourcing the file.
+# The cache is read from the file the first time it is needed, dropping the
+# entries of index files that no longer exist, and written back when it has
+# changed. Only index files that run nothing but the commands IndexTrace
+# allows are cached, all others are always sourced.
+#
+# Arguments:
+# file -		Package index file to source, in the caller's scope
+#			(where $dir is set).
+# name -		Package being looked for; only its registrations are
+#			replayed from the cache.
+
+proc tcl::Pkg::IndexCacheLoad {} {
+    variable indexCache
+    variable indexCacheDirty
+    global env
+
+    if {[interp issafe] || ![info exists env(TCL_PKG_INDEX_CACHE)]} {
+	unset -nocomplain indexCache
+	return
+    }
+    if {[info exists indexCache]} {
+	return
+    }
+    set indexCache {}
+    set indexCacheDirty 0
+    catch {
+	set f [open $env(TCL_PKG_INDEX_CACHE)]
+	try {
+	    fconfigure $f -encoding utf-8
+	    lassign [read $f] tag cache
+	} finally {
+	    close $f
+	}
+	if {$tag eq [IndexCacheTag] && [dict size $cache] > 0} {
+	    set indexCache $cache
+	}
+    }
+    dict for {file entry} $indexCache {
+	if {![file exists $file]} {
+	    dict unset indexCache $file
+	    set indexCacheDirty 1
+	}
+    }
+}
+
+proc tcl::Pkg::IndexCacheSave {} {
+    variable indexCache
+    variable indexCacheDirty
+    global env
+
+    if {![info exists indexCache] || !$indexCacheDirty
+	    || ![info exists env(TCL_PKG_INDEX_CACHE)]} {
+	return
+    }
+    set indexCacheDirty 0
+
+    # Write a new file and rename it over the old one, so that other
+    # processes and threads never see a partial cache.
+
+    try {
+	set f [file tempfile tmp $env(TCL_PKG_INDEX_CACHE)]
+	try {
+	    fconfigure $f -encoding utf-8
+	    puts $f [list [IndexCacheTag] $indexCache]
+	} finally {
+	    close $f
+	}
+	file rename -force $tmp $env(TCL_PKG_INDEX_CACHE)
+    } on error {} {
+	if {[info exists tmp]} {
+	    catch {file delete $tmp}
+	}
+    }
+}
+
+# The cached results are only valid for the Tcl that produced them, as index
+# files commonly check the Tcl version or the platform.
+
+proc tcl::Pkg::IndexCacheTag {} {
+    global tcl_platform
+    list 3 [info patchlevel] [info sharedlibextension] \
+	    $tcl_platform(os) $tcl_platform(machine) $tcl_platform(pointerSize)
+}
+
+proc tcl::Pkg::IndexSource {file {name {}}} {
+    variable indexCache
+    variable indexCacheDirty
+    variable indexRecord
+
+    if {![info exists indexCache] || [catch {
+	file stat $file stat
+	list $stat(size) $stat(mtime)
+    } key]} {
+	return [uplevel 1 [list source -encoding utf-8 $file]]
+    }
+    if {[dict exists $indexCache $file]} {
+	lassign [dict get $indexCache $file] cachedKey registrations
+	if {$cachedKey eq $key} {
+	    foreach {pkg version script} $registrations {
+		if {$name eq "" || $pkg eq $name} {
+		    package ifneeded $pkg $version $script
+		}
+	    }
+	    return
+	}
+    }
+
+    set indexRecord {}
+    set trace [list ::tcl::Pkg::IndexTrace]
+    trace add execution ::source enterstep $trace
+    trace add variable ::env read $trace
+    set code [catch {uplevel 1 [list source -encoding utf-8 $file]} msg opts]
+    trace remove variable ::env read $trace
+    trace remove execution ::source enterstep $trace
+    if {$code == 0 && [info exists indexRecord]} {
+	dict set indexCache $file [list $key $indexRecord]
+	set indexCacheDirty 1
+    } elseif {[dict exists $indexCache $file]} {
+	dict unset indexCache $file
+	set indexCacheDirty 1
+    }
+    unset -nocomplain indexRecord
+    return -options $opts $msg
+}
+
+# ::tcl::Pkg::IndexTrace --
+# Trace used by IndexSource while a package index file is sourced. It sees
+# every command the file runs, records package registrations, and forgets the
+# recording when the file runs a command whose effects or result replaying the
+# registrations would not reproduce, or reads the environment. The only
+# queries of the package database allowed are those about Tcl itself, whose
+# answers are part of the cache tag.
+#
+# Arguments:
+# cmd -			The command being executed, or the name of the
+#			variable being read.
+# args -		"enterstep", or the rest of the arguments of a
+#			variable trace.
+
+proc tcl::Pkg::IndexTrace {cmd args} {
+    variable indexRecord
+
+    if {![info exists indexRecord]} {
+	return
+    }
+    if {[llength $args] == 1} {
+	switch -- [string trimleft [lindex $cmd 0] :] {
+	    if - list - return {
+		return
+	    }
+	    file {
+		if {[lindex $cmd 1] eq "join"} {
+		    return
+		}
+	    }
+	    package {
+		set sub [tcl::prefix match -error {} {
+		    forget ifneeded names prefer present provide require
+		    unknown vcompare versions vsatisfies
+		} [lindex $cmd 1]]
+		switch -- $sub {
+		    ifneeded {
+			if {[llength $cmd] == 5} {
+			    lappend indexRecord {*}[lrange $cmd 2 end]
+			    return
+			}
+		    }
+		    vcompare - vsatisfies {
+			return
+		    }
+		    provide {
+			if {[llength $cmd] == 3 && [lindex $cmd 2] eq "Tcl"} {
+			    return
+			}
+		    }
+		}
+	    }
+	}
+    }
+    unset indexRecord
+}
+
 # tclPkgUnknown --
 # This procedure provides the default for the "package unknown" function.  It
 # is invoked when a package that's needed can't be found.  It scans the
@@ -466,6 +657,8 @@ proc tclPkgUnknown {name args} {
     if {![info exists auto_path]} {
 	return
     }
+    ::tcl::Pkg::IndexCacheLoad
+
     # Cache the auto_path, because it may change while we run through the
     # first set of pkgIndex.tcl files
     set old_path [set use_path $auto_path]
@@ -491,7 +684,7 @@ proc tclPkgUnknown {name args} {
 		set dir [file dirname $file]
 		if {![info exists procdDirs($dir)]} {
 		    try {
-			source -encoding utf-8 $file
+			::tcl::Pkg::IndexSource $file $name
 		    } trap {POSIX EACCES} {} {
 			# $file was not readable; silently ignore
 			continue
@@ -509,7 +702,7 @@ proc tclPkgUnknown {name args} {
 	    # safe interps usually don't have "file exists",
 	    if {([interp issafe] || [file exists $file])} {
 		try {
-		    source -encoding utf-8 $file
+		    ::tcl::Pkg::IndexSource $file $name
 		} trap {POSIX EACCES} {} {
 		    # $file was not readable; silently ignore
 		    continue
@@ -551,6 +744,7 @@ proc tclPkgUnknown {name args} {
 	}
 	set old_path $auto_path
     }
+    ::tcl::Pkg::IndexCacheSave
 }
 
 # tcl::MacOSXPkgUnknown --
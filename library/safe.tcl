@@ -511,7 +511,7 @@ proc ::safe::InterpInit {
     }
     foreach subcommand {
 	atime attributes copy delete executable exists isdirectory isfile
-	link lstat mtime mkdir nativename normalize owned readable readlink
+	link lstat map mtime mkdir nativename normalize owned readable readlink
 	rename size stat tempfile type volumes writable
     } {
 	::interp alias $child ::tcl::file::$subcommand {} \
@@ -75,7 +75,107 @@ proc test-read-regress {{reptime {50000 10}}} {
   }
 }
 
+# file of 100000 log-like lines for the gets tests:
+proc _get_test_file {} {
+  set fn [file join [pwd] chan-perf-lines.txt]
+  set f [open $fn w]
+  fconfigure $f -translation lf -encoding utf-8
+  for {set i 0} {$i < 100000} {incr i} {
+    puts $f "2024-01-01 12:00:00 host service\[$i\]: message number $i"
+  }
+  close $f
+  return $fn
+}
+
+proc _gets_loop {fn args} {
+  set f [open $fn]
+  fconfigure $f {*}$args
+  set n 0
+  while {[gets $f line] >= 0} {incr n}
+  close $f
+  set n
+}
+
+proc _gets_lines {fn count args} {
+  set f [open $fn]
+  fconfigure $f {*}$args
+  set n 0
+  while {[gets -lines $count $f lines] > 0} {incr n [llength $lines]}
+  close $f
+  set n
+}
+
+proc test-gets {{reptime 1000}} {
+  set fn [_get_test_file]
+  _test_run $reptime [string map [list @fn@ [list $fn]] {
+    # gets line by line, utf-8:
+    {::tclTestPerf-Chan::_gets_loop @fn@ -translation lf -encoding utf-8}
+    # gets line by line, binary:
+    {::tclTestPerf-Chan::_gets_loop @fn@ -translation binary}
+    # gets -lines 1000, utf-8:
+    {::tclTestPerf-Chan::_gets_lines @fn@ 1000 -translation lf -encoding utf-8}
+    # gets -lines 1000, binary:
+    {::tclTestPerf-Chan::_gets_lines @fn@ 1000 -translation binary}
+  }]
+  file delete $fn
+}
+
+# read a file in nonblocking mode from the event loop:
+proc _event_read {fn args} {
+  set f [open $fn]
+  fconfigure $f -blocking 0 -translation binary {*}$args
+  set ::tclTestPerf-Chan::size 0
+  fileevent $f readable [list apply {{f} {
+    incr ::tclTestPerf-Chan::size [string length [read $f]]
+    if {[eof $f]} {set ::tclTestPerf-Chan::done 1}
+  }} $f]
+  vwait ::tclTestPerf-Chan::done
+  close $f
+  set ::tclTestPerf-Chan::size
+}
+
+# write a file in nonblocking mode from the event loop:
+proc _event_write {fn args} {
+  set f [open $fn w]
+  fconfigure $f -blocking 0 -translation binary {*}$args
+  set ::tclTestPerf-Chan::count 0
+  fileevent $f writable [list apply {{f} {
+    puts -nonewline $f [string repeat x 65536]
+    if {[incr ::tclTestPerf-Chan::count] == 100} {
+      fileevent $f writable {}
+      set ::tclTestPerf-Chan::done 1
+    }
+  }} $f]
+  vwait ::tclTestPerf-Chan::done
+  fconfigure $f -blocking 1
+  close $f
+}
+
+proc test-async {{reptime 1000}} {
+  set f [open [info script]]
+  set async [expr {![catch {fconfigure $f -async 1}] && [fconfigure $f -async]}]
+  close $f
+  if {!$async} {
+    puts "skipped test-async: io_uring is not available"
+    return
+  }
+  set fn [_get_test_file]
+  _test_run $reptime [string map [list @fn@ [list $fn]] {
+    # nonblocking event-driven read, readiness-based:
+    {::tclTestPerf-Chan::_event_read @fn@}
+    # nonblocking event-driven read, io_uring:
+    {::tclTestPerf-Chan::_event_read @fn@ -async 1}
+    # nonblocking event-driven write of 6.5MB, readiness-based:
+    {::tclTestPerf-Chan::_event_write @fn@.w}
+    # nonblocking event-driven write of 6.5MB, io_uring:
+    {::tclTestPerf-Chan::_event_write @fn@.w -async 1}
+  }]
+  file delete $fn $fn.w
+}
+
 proc test {{reptime 1000}} {
+  test-gets $reptime
+  test-async $reptime
   test-read-regress
 
   puts \n**OK**
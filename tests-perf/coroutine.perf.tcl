@@ -0,0 +1,106 @@
+#!/usr/bin/tclsh
+
+# ------------------------------------------------------------------------
+#
+# coroutine.perf.tcl --
+#
+#  This file provides performance tests for comparison of tcl-speed
+#  of coroutines: generator-style yield/resume and coroutine creation.
+#
+# ------------------------------------------------------------------------
+#
+# See the file "license.terms" for information on usage and redistribution
+# of this file.
+#
+
+
+if {![namespace exists ::tclTestPerf]} {
+  source -encoding utf-8 [file join [file dirname [info script]] test-performance.tcl]
+}
+
+
+namespace eval ::tclTestPerf-Coroutine {
+
+namespace path {::tclTestPerf}
+
+proc gen {} {
+  yield [info coroutine]
+  for {set i 0} 1 {incr i} {
+    yield $i
+  }
+}
+
+proc genlist {l} {
+  yield [info coroutine]
+  foreach v $l {
+    yield $v
+  }
+  return -code break
+}
+
+proc consume {coro n} {
+  set s 0
+  for {set i 0} {$i < $n} {incr i} {
+    incr s [$coro]
+  }
+  set s
+}
+
+proc drain {coro} {
+  set n 0
+  while 1 {
+    $coro
+    incr n
+  }
+  set n
+}
+
+proc body {} {
+  yield
+}
+
+proc test-yield {{reptime 1000}} {
+  _test_run $reptime {
+    setup {coroutine ::tclTestPerf-Coroutine::g ::tclTestPerf-Coroutine::gen}
+    # resume a generator and take 100000 values from it:
+    {::tclTestPerf-Coroutine::consume ::tclTestPerf-Coroutine::g 100000}
+    # the same, one value at a time:
+    {::tclTestPerf-Coroutine::g}
+    cleanup {rename ::tclTestPerf-Coroutine::g {}}
+  }
+  _test_run $reptime {
+    setup {set l [lrepeat 100000 x]; llength $l}
+    # run a generator over a list to its end:
+    {::tclTestPerf-Coroutine::drain [coroutine ::tclTestPerf-Coroutine::gl ::tclTestPerf-Coroutine::genlist $l]}
+    cleanup {unset l}
+  }
+}
+
+proc test-create {{reptime 1000}} {
+  _test_run $reptime {
+    # create a coroutine, resume it to its end:
+    {coroutine ::tclTestPerf-Coroutine::c ::tclTestPerf-Coroutine::body; ::tclTestPerf-Coroutine::c}
+    # create a coroutine and delete it while suspended:
+    {coroutine ::tclTestPerf-Coroutine::c ::tclTestPerf-Coroutine::body; rename ::tclTestPerf-Coroutine::c {}}
+    # create a coroutine of a lambda, resume it to its end:
+    {coroutine ::tclTestPerf-Coroutine::c apply {{} {yield}}; ::tclTestPerf-Coroutine::c}
+  }
+}
+
+proc test {{reptime 1000}} {
+  test-yield $reptime
+  test-create $reptime
+
+  puts \n**OK**
+}
+
+}; # end of ::tclTestPerf-Coroutine
+
+# ------------------------------------------------------------------------
+
+# if calling direct:
+if {[info exists ::argv0] && [file tail $::argv0] eq [file tail [info script]]} {
+  array set in {-time 500}
+  array set in $argv
+  ::tclTestPerf-Coroutine::test $in(-time)
+}
@@ -0,0 +1,65 @@
+#!/usr/bin/tclsh
+
+# ------------------------------------------------------------------------
+#
+# exec.perf.tcl --
+#
+#  This file provides performance tests for comparison of tcl-speed
+#  of process creation (exec, open |), in particular of its dependency
+#  on the size of the interpreter's heap.
+#
+# ------------------------------------------------------------------------
+#
+# See the file "license.terms" for information on usage and redistribution
+# of this file.
+#
+
+
+if {![namespace exists ::tclTestPerf]} {
+  source -encoding utf-8 [file join [file dirname [info script]] test-performance.tcl]
+}
+
+
+namespace eval ::tclTestPerf-Exec {
+
+namespace path {::tclTestPerf}
+
+# grow the heap of the process by about $mb megabytes of touched memory:
+proc _grow_heap {mb} {
+  variable heap
+  set heap [string repeat x [expr {$mb * 1048576}]]
+  string length $heap
+}
+
+proc test-exec {{reptime 1000} {sizes {0 256 1024}}} {
+  foreach mb $sizes {
+    puts "==== heap +${mb}MB"
+    _test_run $reptime [string map [list @mb@ $mb] {
+      setup {set true [auto_execok true]; ::tclTestPerf-Exec::_grow_heap @mb@}
+      # run a trivial program:
+      {exec {*}$true}
+      # run a trivial program with redirections:
+      {exec {*}$true < /dev/null 2>@1}
+      # open a command pipeline and close it:
+      {close [open |$true]}
+      cleanup {unset true; ::tclTestPerf-Exec::_grow_heap 0}
+    }]
+  }
+}
+
+proc test {{reptime 1000}} {
+  test-exec $reptime
+
+  puts \n**OK**
+}
+
+}; # end of ::tclTestPerf-Exec
+
+# ------------------------------------------------------------------------
+
+# if calling direct:
+if {[info exists ::argv0] && [file tail $::argv0] eq [file tail [info script]]} {
+  array set in {-time 500}
+  array set in $argv
+  ::tclTestPerf-Exec::test $in(-time)
+}
@@ -0,0 +1,113 @@
+#!/usr/bin/tclsh
+
+# ------------------------------------------------------------------------
+#
+# interp.perf.tcl --
+#
+#  This file provides performance tests for comparison of tcl-speed
+#  of interpreter creation and startup, and of the overhead of resource
+#  limits on the code running in an interpreter.
+#
+# ------------------------------------------------------------------------
+#
+# See the file "license.terms" for information on usage and redistribution
+# of this file.
+#
+
+
+if {![namespace exists ::tclTestPerf]} {
+  source -encoding utf-8 [file join [file dirname [info script]] test-performance.tcl]
+}
+
+
+namespace eval ::tclTestPerf-Interp {
+
+namespace path {::tclTestPerf}
+
+proc test-create {{reptime 1000}} {
+  _test_run $reptime {
+    # create and delete an interpreter:
+    {interp delete [interp create]}
+    # create and delete a safe interpreter:
+    {interp delete [interp create -safe]}
+    # create an interpreter and use a few of the core ensembles in it:
+    {set i [interp create]; $i eval {string length abc; dict create a 1; array size x}; interp delete $i}
+    # create an interpreter and use all of the core ensembles in it:
+    {set i [interp create]; $i eval {namespace children ::tcl}; interp delete $i}
+  }
+}
+
+proc test-clone {{reptime 1000}} {
+  _test_run $reptime {
+    setup {set tmpl [interp create]; $tmpl eval {proc p {} {string length abc}}}
+    # clone a warmed interpreter and delete it:
+    {interp delete [interp clone $tmpl]}
+    cleanup {interp delete $tmpl}
+  }
+}
+
+proc test-startup {{reptime 1000}} {
+  _test_run $reptime {
+    # start the shell with an empty script:
+    {exec [info nameofexecutable] << {}}
+  }
+}
+
+proc _limited_interp {args} {
+  set i [interp create -safe]
+  if {"commands" in $args} {
+    $i limit commands -value 1000000000
+  }
+  if {"time" in $args} {
+    $i limit time -seconds [expr {[clock seconds] + 3600}]
+  }
+  $i eval {
+    proc loop {n} {set s 0; for {set i 0} {$i < $n} {incr i} {incr s [string length $i]}; set s}
+    proc calls {n} {set s 0; for {set i 0} {$i < $n} {incr i} {incr s [f $i]}; set s}
+    proc f {x} {set x}
+  }
+  return $i
+}
+
+proc test-limits {{reptime 1000}} {
+  _test_run $reptime {
+    setup {set free [::tclTestPerf-Interp::_limited_interp]; set cmd [::tclTestPerf-Interp::_limited_interp commands]; set time [::tclTestPerf-Interp::_limited_interp time]; set both [::tclTestPerf-Interp::_limited_interp commands time]}
+    # tight loop in a safe interpreter without limits:
+    {$free eval {loop 10000}}
+    # tight loop with a command limit:
+    {$cmd eval {loop 10000}}
+    # tight loop with a time limit:
+    {$time eval {loop 10000}}
+    # tight loop with both limits:
+    {$both eval {loop 10000}}
+    # proc calls in a safe interpreter without limits:
+    {$free eval {calls 10000}}
+    # proc calls with a command limit:
+    {$cmd eval {calls 10000}}
+    # proc calls with a time limit:
+    {$time eval {calls 10000}}
+    # proc calls with both limits:
+    {$both eval {calls 10000}}
+    cleanup {foreach i [list $free $cmd $time $both] {interp delete $i}}
+  }
+}
+
+proc test {{reptime 1000}} {
+  test-create $reptime
+  test-clone $reptime
+  test-startup $reptime
+  test-limits $reptime
+
+  puts \n**OK**
+}
+
+}; # end of ::tclTestPerf-Interp
+
+# ------------------------------------------------------------------------
+
+# if calling direct:
+if {[info exists ::argv0] && [file tail $::argv0] eq [file tail [info script]]} {
+  array set in {-time 500}
+  array set in $argv
+  ::tclTestPerf-Interp::test $in(-time)
+}
@@ -0,0 +1,133 @@
+#!/usr/bin/tclsh
+
+# ------------------------------------------------------------------------
+#
+# notify.perf.tcl --
+#
+#  This file provides performance tests for comparison of tcl-speed
+#  of cross-thread event delivery (Tcl_ThreadQueueEvent/Tcl_ThreadAlert),
+#  in particular of the fan-in of many producer threads to one consumer,
+#  and of the cost of a burst of events to the producer.
+#  Needs the testthread command, so it must be run with tcltest.
+#
+# ------------------------------------------------------------------------
+#
+# See the file "license.terms" for information on usage and redistribution
+# of this file.
+#
+
+
+if {![namespace exists ::tclTestPerf]} {
+  source -encoding utf-8 [file join [file dirname [info script]] test-performance.tcl]
+}
+
+
+namespace eval ::tclTestPerf-Notify {
+
+namespace path {::tclTestPerf}
+
+variable producers {}
+
+proc _start_producers {count} {
+  variable producers
+  while {[llength $producers] < $count} {
+    lappend producers [testthread create]
+  }
+  lrange $producers 0 [expr {$count - 1}]
+}
+
+proc _stop_producers {} {
+  variable producers
+  foreach id $producers {
+    testthread send -async $id {testthread exit}
+  }
+  set producers {}
+}
+
+# let every producer post $events events to this thread and wait for all of them:
+proc _fan_in {count events} {
+  set ::tclTestPerf-Notify::got 0
+  set main [testthread id]
+  foreach id [_start_producers $count] {
+    testthread send -async $id [string map [list @main@ $main @events@ $events] {
+      for {set i 0} {$i < @events@} {incr i} {
+        testthread send -async @main@ {incr ::tclTestPerf-Notify::got}
+      }
+    }]
+  }
+  set total [expr {$count * $events}]
+  while {${::tclTestPerf-Notify::got} < $total} {
+    vwait ::tclTestPerf-Notify::got
+  }
+}
+
+proc test-fan-in {{reptime 1000}} {
+  _test_run -no-result $reptime {
+    # 1000 events from a single producer thread:
+    {::tclTestPerf-Notify::_fan_in 1 1000}
+    # 1000 events from each of 2, 4 and 8 producer threads:
+    {::tclTestPerf-Notify::_fan_in 2 1000}
+    {::tclTestPerf-Notify::_fan_in 4 1000}
+    {::tclTestPerf-Notify::_fan_in 8 1000}
+  }
+}
+
+# let one producer post $events events to this thread as fast as it can, and
+# return the time it took the producer per event (in microseconds); this is
+# where the cost of waking this thread's notifier is paid:
+proc _burst {events} {
+  set main [testthread id]
+  set id [lindex [_start_producers 1] 0]
+  set ::tclTestPerf-Notify::got 0
+  unset -nocomplain ::tclTestPerf-Notify::took
+  testthread send -async $id [string map [list @main@ $main @events@ $events] {
+    set start [clock microseconds]
+    for {set i 0} {$i < @events@} {incr i} {
+      testthread send -async @main@ {incr ::tclTestPerf-Notify::got}
+    }
+    set took [expr {[clock microseconds] - $start}]
+    testthread send -async @main@ [list set ::tclTestPerf-Notify::took $took]
+  }]
+  while {![info exists ::tclTestPerf-Notify::took]} {
+    vwait ::tclTestPerf-Notify::took
+  }
+  expr {double(${::tclTestPerf-Notify::took}) / $events}
+}
+
+proc test-burst {{reptime 1000}} {
+  set end [expr {[clock milliseconds] + $reptime}]
+  set runs {}
+  while {[llength $runs] < 3 || [clock milliseconds] < $end} {
+    lappend runs [_burst 10000]
+  }
+  set runs [lsort -real $runs]
+  puts [format "producer side of bursts of 10000 events: %.2f µs/event\
+      (median of %d runs)" [lindex $runs [expr {[llength $runs] / 2}]] \
+      [llength $runs]]
+}
+
+proc test {{reptime 1000}} {
+  if {[namespace which -command testthread] eq {}} {
+    catch {load {} Tcltest}
+  }
+  if {[namespace which -command testthread] eq {}} {
+    puts "skipped: the testthread command is not available (run with tcltest)"
+    return
+  }
+  test-fan-in $reptime
+  test-burst $reptime
+  _stop_producers
+
+  puts \n**OK**
+}
+
+}; # end of ::tclTestPerf-Notify
+
+# ------------------------------------------------------------------------
+
+# if calling direct:
+if {[info exists ::argv0] && [file tail $::argv0] eq [file tail [info script]]} {
+  array set in {-time 500}
+  array set in $argv
+  ::tclTestPerf-Notify::test $in(-time)
+}
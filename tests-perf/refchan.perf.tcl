@@ -0,0 +1,100 @@
+#!/usr/bin/tclsh
+
+# ------------------------------------------------------------------------
+#
+# refchan.perf.tcl --
+#
+#  This file provides performance tests for comparison of tcl-speed
+#  of reflected channels used from a thread other than the one running
+#  their handler, with and without batched forwarding (chan create -batch).
+#  Needs the testthread and testchannel commands, so it must be run with
+#  tcltest.
+#
+# ------------------------------------------------------------------------
+#
+# See the file "license.terms" for information on usage and redistribution
+# of this file.
+#
+
+
+if {![namespace exists ::tclTestPerf]} {
+  source -encoding utf-8 [file join [file dirname [info script]] test-performance.tcl]
+}
+
+
+namespace eval ::tclTestPerf-RefChan {
+
+namespace path {::tclTestPerf}
+
+variable line [string repeat x 60]
+
+# handler producing lines and swallowing writes:
+proc _handler {cmd chan args} {
+  variable line
+  switch -exact -- $cmd {
+    initialize {return {initialize finalize watch read write}}
+    read {
+      variable left
+      set n [expr {min([lindex $args 0], $left) / 61}]
+      if {$n == 0} {return {}}
+      incr left [expr {-61 * $n}]
+      return [string repeat $line\n $n]
+    }
+    write {return [string length [lindex $args 0]]}
+  }
+}
+
+# let a thread copy $count lines through a channel handled by this thread:
+proc _copy {count args} {
+  set ::tclTestPerf-RefChan::left [expr {61 * $count}]
+  set ::tclTestPerf-RefChan::done 0
+  set chan [chan create {*}$args {read write} ::tclTestPerf-RefChan::_handler]
+  testchannel cut $chan
+  testthread create [string map [list @main@ [testthread id] @chan@ $chan] {
+    testchannel splice @chan@
+    fconfigure @chan@ -buffering line
+    while {[gets @chan@ line] >= 0} {
+      puts @chan@ $line
+    }
+    close @chan@
+    testthread send -async @main@ {set ::tclTestPerf-RefChan::done 1}
+  }]
+  vwait ::tclTestPerf-RefChan::done
+}
+
+proc test-copy {{reptime 1000}} {
+  _test_run -no-result $reptime {
+    # copy 1000 lines, forwarding every read and write:
+    {::tclTestPerf-RefChan::_copy 1000}
+    # copy 1000 lines, batched:
+    {::tclTestPerf-RefChan::_copy 1000 -batch}
+    # copy 10000 lines, forwarding every read and write:
+    {::tclTestPerf-RefChan::_copy 10000}
+    # copy 10000 lines, batched:
+    {::tclTestPerf-RefChan::_copy 10000 -batch}
+  }
+}
+
+proc test {{reptime 1000}} {
+  if {[namespace which -command testthread] eq {}} {
+    catch {load {} Tcltest}
+  }
+  if {[namespace which -command testthread] eq {}} {
+    puts "skipped: the testthread command is not available (run with tcltest)"
+    return
+  }
+  test-copy $reptime
+
+  puts \n**OK**
+}
+
+}; # end of ::tclTestPerf-RefChan
+
+# ------------------------------------------------------------------------
+
+# if calling direct:
+if {[info exists ::argv0] && [file tail $::argv0] eq [file tail [info script]]} {
+  array set in {-time 500}
+  array set in $argv
+  ::tclTestPerf-RefChan::test $in(-time)
+}
@@ -0,0 +1,61 @@
+#!/usr/bin/tclsh
+
+# ------------------------------------------------------------------------
+#
+# threadpool.perf.tcl --
+#
+#  This file provides performance tests for comparison of tcl-speed
+#  of thread pools (tcl::threadpool), in particular of handing large
+#  results over from the workers.
+#
+# ------------------------------------------------------------------------
+#
+# See the file "license.terms" for information on usage and redistribution
+# of this file.
+#
+
+
+if {![namespace exists ::tclTestPerf]} {
+  source -encoding utf-8 [file join [file dirname [info script]] test-performance.tcl]
+}
+
+
+namespace eval ::tclTestPerf-ThreadPool {
+
+namespace path {::tclTestPerf}
+
+proc test-result {{reptime 1000}} {
+  set pool [tcl::threadpool create -workers 1 -setup {
+    proc mklist {n} {
+      set l {}
+      for {set i 0} {$i < $n} {incr i} {lappend l [list $i item-$i]}
+      set l
+    }
+  }]
+  _test_run $reptime [string map [list @pool@ $pool] {
+    # small result:
+    {@pool@ get [@pool@ submit {mklist 10}]}
+    # result list of 100000 pairs, handed over as a value:
+    {llength [@pool@ get [@pool@ submit {mklist 100000}]]}
+    # the same list as a string, as it has to be parsed again:
+    {llength [@pool@ get [@pool@ submit {string range [mklist 100000] 0 end}]]}
+  }]
+  $pool destroy
+}
+
+proc test {{reptime 1000}} {
+  test-result $reptime
+
+  puts \n**OK**
+}
+
+}; # end of ::tclTestPerf-ThreadPool
+
+# ------------------------------------------------------------------------
+
+# if calling direct:
+if {[info exists ::argv0] && [file tail $::argv0] eq [file tail [info script]]} {
+  array set in {-time 500}
+  array set in $argv
+  ::tclTestPerf-ThreadPool::test $in(-time)
+}
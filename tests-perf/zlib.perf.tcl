@@ -0,0 +1,99 @@
+#!/usr/bin/tclsh
+
+# ------------------------------------------------------------------------
+#
+# zlib.perf.tcl --
+#
+#  This file provides performance tests for comparison of tcl-speed
+#  of zlib compression, in particular of the scaling of parallel
+#  compression (-threads) with the number of cores.
+#
+# ------------------------------------------------------------------------
+#
+# See the file "license.terms" for information on usage and redistribution
+# of this file.
+#
+
+
+if {![namespace exists ::tclTestPerf]} {
+  source -encoding utf-8 [file join [file dirname [info script]] test-performance.tcl]
+}
+
+
+namespace eval ::tclTestPerf-Zlib {
+
+namespace path {::tclTestPerf}
+
+# generate about 16MB of log-like data (not too repetitive):
+proc _get_test_data {{size 16000000}} {
+  set lines {}
+  expr {srand(42)}
+  for {set i 0} {$i < 1000} {incr i} {
+    lappend lines "[clock format [expr {1700000000 + $i*37}] -gmt 1] host[expr {int(rand()*50)}] proc\[[expr {int(rand()*32768)}]\]: request [expr {int(rand()*1e9)}] took [expr {int(rand()*5000)}]ms status [lindex {200 200 200 304 404 500} [expr {int(rand()*6)}]]"
+  }
+  set block [join $lines \n]\n
+  encoding convertto utf-8 [string repeat $block [expr {$size / [string length $block] + 1}]]
+}
+
+proc _compress_stream {data args} {
+  set s [zlib stream gzip {*}$args]
+  for {set i 0} {$i < [string length $data]} {incr i 1048576} {
+    $s put [string range $data $i [expr {$i + 1048575}]]
+    $s get
+  }
+  $s put -finalize {}
+  $s get
+  $s close
+}
+
+proc _compress_push {data args} {
+  set f [file tempfile]
+  fconfigure $f -translation binary -buffersize 65536
+  zlib push gzip $f {*}$args
+  puts -nonewline $f $data
+  close $f
+}
+
+proc test-stream {{reptime {60000 3}}} {
+  _test_run -no-result $reptime {
+    setup {set data [::tclTestPerf-Zlib::_get_test_data]; string length $data}
+    # compress 16MB on the calling thread only:
+    {::tclTestPerf-Zlib::_compress_stream $data}
+    # compress 16MB with 2, 4 and 8 threads:
+    {::tclTestPerf-Zlib::_compress_stream $data -threads 2}
+    {::tclTestPerf-Zlib::_compress_stream $data -threads 4}
+    {::tclTestPerf-Zlib::_compress_stream $data -threads 8}
+    cleanup {unset data}
+  }
+}
+
+proc test-push {{reptime {60000 3}}} {
+  _test_run -no-result $reptime {
+    setup {set data [::tclTestPerf-Zlib::_get_test_data]; string length $data}
+    # compress 16MB through a channel transform on the calling thread only:
+    {::tclTestPerf-Zlib::_compress_push $data}
+    # compress 16MB through a channel transform with 2, 4 and 8 threads:
+    {::tclTestPerf-Zlib::_compress_push $data -threads 2}
+    {::tclTestPerf-Zlib::_compress_push $data -threads 4}
+    {::tclTestPerf-Zlib::_compress_push $data -threads 8}
+    cleanup {unset data}
+  }
+}
+
+proc test {{reptime {60000 3}}} {
+  test-stream $reptime
+  test-push $reptime
+
+  puts \n**OK**
+}
+
+}; # end of ::tclTestPerf-Zlib
+
+# ------------------------------------------------------------------------
+
+# if calling direct:
+if {[info exists ::argv0] && [file tail $::argv0] eq [file tail [info script]]} {
+  array set in {-time {60000 3}}
+  array set in $argv
+  ::tclTestPerf-Zlib::test $in(-time)
+}
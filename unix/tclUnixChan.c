@@ -48,6 +48,34 @@
 
 #endif	/* HAVE_TERMIOS_H */
 
+/*
+ * Nonblocking file channels can have their I/O done asynchronously with the
+ * io_uring interface of Linux, see the -async option. The system calls are
+ * used directly, the rings are simple enough that no library is needed.
+ *
+ * Sockets (tclUnixSock.c) deliberately keep their readiness-based driver.
+ * A nonblocking socket is only read or written once the notifier has seen
+ * it ready, so the system call never waits and io_uring would not make it
+ * any more asynchronous; what remains to gain is one io_uring_enter for many
+ * sockets instead of one recv/send/accept each. Getting that needs more than
+ * this file has: completions here are tied to FileState and at most one
+ * operation per channel, whereas a listening socket wants several accepts
+ * in flight, and the asynchronous connect, the -error and -connecting
+ * options and the handing over of sockets between threads would all have to
+ * learn about operations still owned by the kernel. That is a separate
+ * driver, not an option of this one.
+ */
+
+#ifdef HAVE_LINUX_IO_URING_H
+#   include <linux/io_uring.h>
+#   include <sys/eventfd.h>
+#   include <sys/mman.h>
+#   include <sys/syscall.h>
+#   if defined(__NR_io_uring_setup) && defined(IORING_FEAT_RW_CUR_POS)
+#	define USE_IO_URING 1
+#   endif
+#endif	/* HAVE_LINUX_IO_URING_H */
+
 /*
  * Helper macros to make parts of this file clearer. The macros do exactly
  * what they say on the tin. :-) They also only ever refer to their arguments
@@ -57,6 +85,81 @@
 #define SET_BITS(var, bits)	((var) |= (bits))
 #define CLEAR_BITS(var, bits)	((var) &= ~(bits))
 
+#ifdef USE_IO_URING
+/*
+ * The io_uring instance of a thread, shared by all its channels doing
+ * asynchronous I/O. Completions are reaped by the thread that submitted the
+ * operations, so the instance is per thread and needs no locking.
+ */
+
+#define URING_ENTRIES		64	/* Size of the submission ring. */
+#define URING_READ_SIZE		65536	/* Size of read-ahead blocks. */
+#define URING_WRITE_LIMIT	1048576	/* Output collected while a write is
+					 * going on before EAGAIN, or before
+					 * waiting for regular files. */
+
+typedef struct UringRing {
+    int fd;			/* The io_uring instance. */
+    int eventFd;		/* Signalled by the kernel on completions. */
+    int refCount;		/* Number of channels using the ring. */
+    unsigned queued;		/* Operations not yet handed to the kernel. */
+    unsigned *sqHead, *sqTail;	/* The submission ring, shared with the */
+    unsigned sqMask;		/* kernel. */
+    unsigned *sqArray;
+    unsigned sqEntries;
+    struct io_uring_sqe *sqes;
+    unsigned *cqHead, *cqTail;	/* The completion ring, shared with the */
+    unsigned cqMask;		/* kernel. */
+    struct io_uring_cqe *cqes;
+    void *sqRing, *cqRing;	/* The mappings of the rings, cqRing is NULL
+				 * if both are in one. */
+    size_t sqRingSize, cqRingSize, sqesSize;
+} UringRing;
+
+/*
+ * Values of the inFlight field below.
+ */
+
+#define IO_NONE		0
+#define IO_READ		1
+#define IO_WRITE	2
+
+/*
+ * The asynchronous I/O state of a file channel. There is at most one
+ * operation going on for a channel at any time, so that the kernel does not
+ * have to keep them in order.
+ */
+
+typedef struct FileAsync {
+    int requested;		/* Was -async set? */
+    int nonblocking;		/* Is the channel nonblocking? */
+    UringRing *ringPtr;		/* Ring of the thread, NULL if -async is not
+				 * set or io_uring is not available. */
+    int inFlight;		/* IO_READ or IO_WRITE if the kernel is busy
+				 * with an operation for the channel. */
+    int waiting;		/* No read-ahead while waiting for the end of
+				 * the operation. */
+    char *readBuf;		/* Data read ahead, readLen bytes starting at
+				 * readStart. */
+    int readStart, readLen;
+    int readEof;		/* End of file seen by the read-ahead. */
+    char *writeBuf;		/* Data being written, writeLen bytes starting
+				 * at writeStart, in a buffer of writeSize. */
+    int writeStart, writeLen, writeSize;
+    char *nextBuf;		/* Output collected while writing, written
+				 * next. */
+    int nextLen, nextSize;
+    int error;			/* Error of an operation, reported by the
+				 * next input or output. */
+    int watchMask;		/* Events the channel is interested in. */
+    Tcl_TimerToken timer;	/* For notifying the channel. */
+} FileAsync;
+
+#define ASYNC_ACTIVE(fsPtr) \
+    ((fsPtr)->async.requested && (fsPtr)->async.nonblocking \
+	    && ((fsPtr)->async.ringPtr != NULL))
+#endif	/* USE_IO_URING */
+
 /*
  * This structure describes per-instance state of a file based channel.
  */
@@ -67,8 +170,27 @@ typedef struct FileState {
     int validMask;		/* OR'ed combination of TCL_READABLE,
 				 * TCL_WRITABLE, or TCL_EXCEPTION: indicates
 				 * which operations are valid on the file. */
+#ifdef USE_IO_URING
+    FileAsync async;		/* Asynchronous I/O, see the -async option. */
+#endif
 } FileState;
 
+#ifdef USE_IO_URING
+typedef struct {
+    UringRing *ringPtr;		/* The io_uring instance of the thread, NULL
+				 * until a channel needs it. */
+} ThreadSpecificData;
+
+static Tcl_ThreadDataKey dataKey;
+
+/*
+ * Whether the kernel supports io_uring: -1 until checked.
+ */
+
+static int uringAvailable = -1;
+TCL_DECLARE_MUTEX(uringMutex)
+#endif	/* USE_IO_URING */
+
 #ifdef SUPPORTS_TTY
 
 /*
@@ -114,6 +236,40 @@ static int		FileTruncateProc(ClientData instanceData,
 static Tcl_WideInt	FileWideSeekProc(ClientData instanceData,
 			    Tcl_WideInt offset, int mode, int *errorCode);
 static void		FileWatchProc(ClientData instanceData, int mask);
+#ifdef USE_IO_URING
+static int		FileGetOptionProc(ClientData instanceData,
+			    Tcl_Interp *interp, const char *optionName,
+			    Tcl_DString *dsPtr);
+static int		FileSetOptionProc(ClientData instanceData,
+			    Tcl_Interp *interp, const char *optionName,
+			    const char *value);
+static void		FileThreadActionProc(ClientData instanceData,
+			    int action);
+static UringRing *	UringAttach(void);
+static int		UringAvailable(void);
+static void		UringCheckProc(ClientData clientData, int flags);
+static void		UringComplete(FileState *fsPtr, int result);
+static void		UringDetach(UringRing *ringPtr);
+static void		UringEnter(UringRing *ringPtr,
+			    unsigned minComplete);
+static void		UringEventProc(ClientData clientData, int mask);
+static void		UringFree(UringRing *ringPtr);
+static int		UringInput(FileState *fsPtr, char *buf, int toRead,
+			    int *errorCodePtr);
+static int		UringOutput(FileState *fsPtr, const char *buf,
+			    int toWrite, int *errorCodePtr);
+static void		UringQueue(UringRing *ringPtr, int opcode, int fd,
+			    void *addr, unsigned len, FileState *fsPtr);
+static void		UringReadAhead(FileState *fsPtr);
+static int		UringReady(FileState *fsPtr);
+static void		UringReap(UringRing *ringPtr);
+static void		UringSetupProc(ClientData clientData, int flags);
+static void		UringSync(FileState *fsPtr);
+static void		UringTimerProc(ClientData clientData);
+static void		UringTimerSetup(FileState *fsPtr);
+static void		UringUpdate(FileState *fsPtr, int wasActive);
+static void		UringWait(FileState *fsPtr);
+#endif	/* USE_IO_URING */
 #ifdef SUPPORTS_TTY
 static void		TtyGetAttributes(int fd, TtyAttrs *ttyPtr);
 static int		TtyGetOptionProc(ClientData instanceData,
@@ -142,8 +298,13 @@ static const Tcl_ChannelType fileChannelType = {
     FileInputProc,
     FileOutputProc,
     FileSeekProc,
+#ifdef USE_IO_URING
+    FileSetOptionProc,
+    FileGetOptionProc,
+#else
     NULL,			/* Set option proc. */
     NULL,			/* Get option proc. */
+#endif
     FileWatchProc,
     FileGetHandleProc,
     FileClose2Proc,
@@ -151,7 +312,11 @@ static const Tcl_ChannelType fileChannelType = {
     NULL,			/* Flush proc. */
     NULL,			/* Bubbled event handler proc. */
     FileWideSeekProc,
+#ifdef USE_IO_URING
+    FileThreadActionProc,
+#else
     NULL,			/* Thread action proc. */
+#endif
     FileTruncateProc
 };
 
@@ -207,9 +372,26 @@ FileBlockModeProc(
 {
     FileState *fsPtr = (FileState *)instanceData;
 
+#ifdef USE_IO_URING
+    int wasActive = ASYNC_ACTIVE(fsPtr);
+
+    fsPtr->async.nonblocking = (mode == TCL_MODE_NONBLOCKING);
+    if (ASYNC_ACTIVE(fsPtr)) {
+	/*
+	 * The kernel does the waiting, see UringUpdate.
+	 */
+
+	mode = TCL_MODE_BLOCKING;
+    }
     if (TclUnixSetBlockingMode(fsPtr->fd, mode) < 0) {
 	return errno;
     }
+    UringUpdate(fsPtr, wasActive);
+#else
+    if (TclUnixSetBlockingMode(fsPtr->fd, mode) < 0) {
+	return errno;
+    }
+#endif	/* USE_IO_URING */
 
     return 0;
 }
@@ -246,6 +428,17 @@ FileInputProc(
 
     *errorCodePtr = 0;
 
+#ifdef USE_IO_URING
+    if (fsPtr->async.error != 0) {
+	*errorCodePtr = fsPtr->async.error;
+	fsPtr->async.error = 0;
+	return -1;
+    }
+    if (ASYNC_ACTIVE(fsPtr) || (fsPtr->async.readLen > 0)) {
+	return UringInput(fsPtr, buf, toRead, errorCodePtr);
+    }
+#endif	/* USE_IO_URING */
+
     /*
      * Assume there is always enough input available. This will block
      * appropriately, and read will unblock as soon as a short read is
@@ -303,6 +496,17 @@ FileOutputProc(
 
 	return 0;
     }
+#ifdef USE_IO_URING
+    if (fsPtr->async.error != 0) {
+	*errorCodePtr = fsPtr->async.error;
+	fsPtr->async.error = 0;
+	return -1;
+    }
+    if (ASYNC_ACTIVE(fsPtr)) {
+	return UringOutput(fsPtr, buf, toWrite, errorCodePtr);
+    }
+    UringSync(fsPtr);
+#endif	/* USE_IO_URING */
     written = write(fsPtr->fd, buf, toWrite);
     if (written >= 0) {
 	return written;
@@ -338,13 +542,38 @@ FileCloseProc(
 
     Tcl_DeleteFileHandler(fsPtr->fd);
 
+#ifdef USE_IO_URING
+    /*
+     * Let output written in the background complete, and report its errors
+     * as errors of the close.
+     */
+
+    if (fsPtr->async.ringPtr != NULL) {
+	UringWait(fsPtr);
+	UringDetach(fsPtr->async.ringPtr);
+    }
+    if (fsPtr->async.timer != NULL) {
+	Tcl_DeleteTimerHandler(fsPtr->async.timer);
+    }
+    errorCode = fsPtr->async.error;
+    if (fsPtr->async.readBuf != NULL) {
+	ckfree(fsPtr->async.readBuf);
+    }
+    if (fsPtr->async.writeBuf != NULL) {
+	ckfree(fsPtr->async.writeBuf);
+    }
+    if (fsPtr->async.nextBuf != NULL) {
+	ckfree(fsPtr->async.nextBuf);
+    }
+#endif	/* USE_IO_URING */
+
     /*
      * Do not close standard channels while in thread-exit.
      */
 
     if (!TclInThreadExit()
 	    || ((fsPtr->fd != 0) && (fsPtr->fd != 1) && (fsPtr->fd != 2))) {
-	if (close(fsPtr->fd) < 0) {
+	if ((close(fsPtr->fd) < 0) && (errorCode == 0)) {
 	    errorCode = errno;
 	}
     }
@@ -393,6 +622,10 @@ FileSeekProc(
     FileState *fsPtr = (FileState *)instanceData;
     Tcl_WideInt oldLoc, newLoc;
 
+#ifdef USE_IO_URING
+    UringSync(fsPtr);
+#endif
+
     /*
      * Save our current place in case we need to roll-back the seek.
      */
@@ -454,6 +687,9 @@ FileWideSeekProc(
     FileState *fsPtr = (FileState *)instanceData;
     Tcl_WideInt newLoc;
 
+#ifdef USE_IO_URING
+    UringSync(fsPtr);
+#endif
     newLoc = TclOSseek(fsPtr->fd, (Tcl_SeekOffset) offset, mode);
 
     *errorCodePtr = (newLoc == -1) ? errno : 0;
@@ -505,6 +741,27 @@ FileWatchProc(
      */
 
     mask &= fsPtr->validMask;
+#ifdef USE_IO_URING
+    fsPtr->async.watchMask = mask;
+    if (ASYNC_ACTIVE(fsPtr)) {
+	/*
+	 * The descriptor is always ready, the completions tell when the
+	 * channel is.
+	 */
+
+	Tcl_DeleteFileHandler(fsPtr->fd);
+	if (mask & TCL_READABLE) {
+	    UringReadAhead(fsPtr);
+	}
+	if (mask & UringReady(fsPtr)) {
+	    UringTimerSetup(fsPtr);
+	}
+	return;
+    }
+    if ((mask & TCL_READABLE) && (fsPtr->async.readLen > 0)) {
+	UringTimerSetup(fsPtr);
+    }
+#endif	/* USE_IO_URING */
     if (mask) {
 	Tcl_CreateFileHandler(fsPtr->fd, mask,
 		FileWatchNotifyChannelWrapper, fsPtr->channel);
@@ -546,6 +803,912 @@ FileGetHandleProc(
     return TCL_ERROR;
 }
 
+#ifdef USE_IO_URING
+/*
+ *----------------------------------------------------------------------
+ *
+ * UringAvailable --
+ *
+ *	Checks once per process whether the kernel supports io_uring with the
+ *	operations used here. Kernels may lack it, or have it disabled.
+ *
+ * Results:
+ *	1 if io_uring can be used, 0 otherwise.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+UringAvailable(void)
+{
+    Tcl_MutexLock(&uringMutex);
+    if (uringAvailable < 0) {
+	struct io_uring_params params;
+	int fd;
+
+	memset(&params, 0, sizeof(params));
+	fd = syscall(__NR_io_uring_setup, 1, &params);
+	uringAvailable = (fd >= 0)
+		&& (params.features & IORING_FEAT_RW_CUR_POS);
+	if (fd >= 0) {
+	    close(fd);
+	}
+    }
+    Tcl_MutexUnlock(&uringMutex);
+    return uringAvailable;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * UringAttach, UringDetach --
+ *
+ *	Manage the io_uring instance of the current thread. UringAttach
+ *	creates it for the first channel using it, and UringDetach deletes it
+ *	with the last one. The rings are mapped into the process; operations
+ *	are queued in the submission ring and handed to the kernel in batches
+ *	by UringSetupProc, completions wake up the notifier through an
+ *	eventfd.
+ *
+ * Results:
+ *	UringAttach returns the ring, or NULL if io_uring is not available.
+ *
+ * Side effects:
+ *	Creates or deletes the ring, with its event source and file handler.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static UringRing *
+UringAttach(void)
+{
+    ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
+    struct io_uring_params params;
+    UringRing *ringPtr = tsdPtr->ringPtr;
+    char *sqRing, *cqRing;
+
+    if (ringPtr != NULL) {
+	ringPtr->refCount++;
+	return ringPtr;
+    }
+    if (!UringAvailable()) {
+	return NULL;
+    }
+
+    ringPtr = (UringRing *)ckalloc(sizeof(UringRing));
+    memset(ringPtr, 0, sizeof(UringRing));
+    ringPtr->eventFd = -1;
+    memset(&params, 0, sizeof(params));
+    ringPtr->fd = syscall(__NR_io_uring_setup, URING_ENTRIES, &params);
+    if (ringPtr->fd < 0) {
+	ckfree(ringPtr);
+	return NULL;
+    }
+
+    ringPtr->sqRingSize = params.sq_off.array
+	    + params.sq_entries * sizeof(unsigned);
+    ringPtr->cqRingSize = params.cq_off.cqes
+	    + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+	if (ringPtr->cqRingSize > ringPtr->sqRingSize) {
+	    ringPtr->sqRingSize = ringPtr->cqRingSize;
+	}
+	ringPtr->cqRingSize = 0;
+    }
+    ringPtr->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    sqRing = (char *)mmap(NULL, ringPtr->sqRingSize, PROT_READ|PROT_WRITE,
+	    MAP_SHARED|MAP_POPULATE, ringPtr->fd, IORING_OFF_SQ_RING);
+    if (sqRing == MAP_FAILED) {
+	goto error;
+    }
+    ringPtr->sqRing = sqRing;
+    if (ringPtr->cqRingSize == 0) {
+	cqRing = sqRing;
+    } else {
+	cqRing = (char *)mmap(NULL, ringPtr->cqRingSize,
+		PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, ringPtr->fd,
+		IORING_OFF_CQ_RING);
+	if (cqRing == MAP_FAILED) {
+	    goto error;
+	}
+	ringPtr->cqRing = cqRing;
+    }
+    ringPtr->sqes = (struct io_uring_sqe *)mmap(NULL, ringPtr->sqesSize,
+	    PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, ringPtr->fd,
+	    IORING_OFF_SQES);
+    if (ringPtr->sqes == MAP_FAILED) {
+	ringPtr->sqes = NULL;
+	goto error;
+    }
+
+    ringPtr->sqHead = (unsigned *)(sqRing + params.sq_off.head);
+    ringPtr->sqTail = (unsigned *)(sqRing + params.sq_off.tail);
+    ringPtr->sqMask = *(unsigned *)(sqRing + params.sq_off.ring_mask);
+    ringPtr->sqArray = (unsigned *)(sqRing + params.sq_off.array);
+    ringPtr->sqEntries = params.sq_entries;
+    ringPtr->cqHead = (unsigned *)(cqRing + params.cq_off.head);
+    ringPtr->cqTail = (unsigned *)(cqRing + params.cq_off.tail);
+    ringPtr->cqMask = *(unsigned *)(cqRing + params.cq_off.ring_mask);
+    ringPtr->cqes = (struct io_uring_cqe *)(cqRing + params.cq_off.cqes);
+
+    ringPtr->eventFd = eventfd(0, EFD_NONBLOCK|EFD_CLOEXEC);
+    if ((ringPtr->eventFd < 0) || (syscall(__NR_io_uring_register,
+	    ringPtr->fd, IORING_REGISTER_EVENTFD, &ringPtr->eventFd, 1) < 0)) {
+	goto error;
+    }
+    Tcl_CreateFileHandler(ringPtr->eventFd, TCL_READABLE, UringEventProc,
+	    ringPtr);
+    Tcl_CreateEventSource(UringSetupProc, UringCheckProc, ringPtr);
+
+    ringPtr->refCount = 1;
+    tsdPtr->ringPtr = ringPtr;
+    return ringPtr;
+
+  error:
+    UringFree(ringPtr);
+    return NULL;
+}
+
+static void
+UringDetach(
+    UringRing *ringPtr)
+{
+    ThreadSpecificData *tsdPtr = TCL_TSD_INIT(&dataKey);
+
+    if (--ringPtr->refCount > 0) {
+	return;
+    }
+    Tcl_DeleteEventSource(UringSetupProc, UringCheckProc, ringPtr);
+    Tcl_DeleteFileHandler(ringPtr->eventFd);
+    tsdPtr->ringPtr = NULL;
+    UringFree(ringPtr);
+}
+
+static void
+UringFree(
+    UringRing *ringPtr)
+{
+    if (ringPtr->eventFd >= 0) {
+	close(ringPtr->eventFd);
+    }
+    if (ringPtr->sqes != NULL) {
+	munmap(ringPtr->sqes, ringPtr->sqesSize);
+    }
+    if (ringPtr->cqRing != NULL) {
+	munmap(ringPtr->cqRing, ringPtr->cqRingSize);
+    }
+    if (ringPtr->sqRing != NULL) {
+	munmap(ringPtr->sqRing, ringPtr->sqRingSize);
+    }
+    close(ringPtr->fd);
+    ckfree(ringPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * UringQueue --
+ *
+ *	Queues an operation in the submission ring of a thread. It is handed
+ *	to the kernel by the next UringEnter.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Submits the queued operations first if the ring is full.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+UringQueue(
+    UringRing *ringPtr,
+    int opcode,
+    int fd,
+    void *addr,
+    unsigned len,
+    FileState *fsPtr)		/* Channel to notify of the completion, NULL
+				 * if it is not to be reported. */
+{
+    struct io_uring_sqe *sqePtr;
+    unsigned tail = *ringPtr->sqTail;
+
+    while (tail - __atomic_load_n(ringPtr->sqHead, __ATOMIC_ACQUIRE)
+	    >= ringPtr->sqEntries) {
+	UringEnter(ringPtr, 0);
+    }
+    sqePtr = &ringPtr->sqes[tail & ringPtr->sqMask];
+    memset(sqePtr, 0, sizeof(struct io_uring_sqe));
+    sqePtr->opcode = opcode;
+    sqePtr->fd = fd;
+    sqePtr->addr = (size_t) addr;
+    sqePtr->len = len;
+    sqePtr->off = (__u64) -1;		/* Use and advance the file position. */
+    sqePtr->user_data = (size_t) fsPtr;
+    ringPtr->sqArray[tail & ringPtr->sqMask] = tail & ringPtr->sqMask;
+    __atomic_store_n(ringPtr->sqTail, tail + 1, __ATOMIC_RELEASE);
+    ringPtr->queued++;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * UringEnter --
+ *
+ *	Hands the queued operations to the kernel, and waits for minComplete
+ *	completions.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Panics if the kernel refuses the ring, which would be a bug here.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+UringEnter(
+    UringRing *ringPtr,
+    unsigned minComplete)
+{
+    int n;
+
+    do {
+	n = syscall(__NR_io_uring_enter, ringPtr->fd, ringPtr->queued,
+		minComplete, minComplete ? IORING_ENTER_GETEVENTS : 0,
+		NULL, 0);
+    } while ((n < 0) && (errno == EINTR));
+
+    if (n >= 0) {
+	ringPtr->queued -= n;
+    } else if ((errno == EBUSY) || (errno == EAGAIN)) {
+	/*
+	 * Too many completions are waiting to be reaped.
+	 */
+
+	UringReap(ringPtr);
+    } else {
+	Tcl_Panic("io_uring_enter: %s", Tcl_ErrnoMsg(errno));
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * UringReap, UringComplete --
+ *
+ *	UringReap takes the completions from the ring of a thread and passes
+ *	them to UringComplete, which updates the state of their channel. A
+ *	read makes its data available, a write continues with the rest of its
+ *	data or with the data written meanwhile. Channels interested in the
+ *	result are notified through a timer, as the completions may be reaped
+ *	in the middle of operations on other channels.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	May queue more operations.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+UringReap(
+    UringRing *ringPtr)
+{
+    unsigned head = *ringPtr->cqHead;
+
+    while (head != __atomic_load_n(ringPtr->cqTail, __ATOMIC_ACQUIRE)) {
+	struct io_uring_cqe *cqePtr = &ringPtr->cqes[head & ringPtr->cqMask];
+	FileState *fsPtr = (FileState *)(size_t) cqePtr->user_data;
+	int result = cqePtr->res;
+
+	__atomic_store_n(ringPtr->cqHead, head + 1, __ATOMIC_RELEASE);
+	if (fsPtr != NULL) {
+	    UringComplete(fsPtr, result);
+	}
+	head = *ringPtr->cqHead;
+    }
+}
+
+static void
+UringComplete(
+    FileState *fsPtr,
+    int result)			/* Bytes transferred, or -errno. */
+{
+    FileAsync *asyncPtr = &fsPtr->async;
+
+    if (asyncPtr->inFlight == IO_READ) {
+	if (result > 0) {
+	    asyncPtr->readStart = 0;
+	    asyncPtr->readLen = result;
+	} else if (result == 0) {
+	    asyncPtr->readEof = 1;
+	} else if (result != -ECANCELED) {
+	    asyncPtr->error = -result;
+	}
+    } else {
+	char *buf;
+	int size;
+
+	if (result < 0) {
+	    asyncPtr->error = -result;
+	    asyncPtr->writeLen = asyncPtr->nextLen = 0;
+	} else if (result == 0) {
+	    asyncPtr->error = EIO;
+	    asyncPtr->writeLen = asyncPtr->nextLen = 0;
+	} else {
+	    asyncPtr->writeStart += result;
+	    asyncPtr->writeLen -= result;
+	}
+	if ((asyncPtr->writeLen == 0) && (asyncPtr->nextLen > 0)) {
+	    /*
+	     * Swap buffers and write what was collected meanwhile.
+	     */
+
+	    buf = asyncPtr->writeBuf;
+	    size = asyncPtr->writeSize;
+	    asyncPtr->writeBuf = asyncPtr->nextBuf;
+	    asyncPtr->writeSize = asyncPtr->nextSize;
+	    asyncPtr->writeStart = 0;
+	    asyncPtr->writeLen = asyncPtr->nextLen;
+	    asyncPtr->nextBuf = buf;
+	    asyncPtr->nextSize = size;
+	    asyncPtr->nextLen = 0;
+	}
+	if (asyncPtr->writeLen > 0) {
+	    UringQueue(asyncPtr->ringPtr, IORING_OP_WRITE, fsPtr->fd,
+		    asyncPtr->writeBuf + asyncPtr->writeStart,
+		    asyncPtr->writeLen, fsPtr);
+	    return;
+	}
+    }
+    asyncPtr->inFlight = IO_NONE;
+
+    if (asyncPtr->watchMask & TCL_READABLE) {
+	UringReadAhead(fsPtr);
+    }
+    if (asyncPtr->watchMask & UringReady(fsPtr)) {
+	UringTimerSetup(fsPtr);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * UringWait, UringSync --
+ *
+ *	UringWait waits until the kernel is done with the operation of a
+ *	channel. A read is cancelled, as it may wait for data indefinitely on
+ *	pipes. UringSync also moves the file position back over the data read
+ *	ahead but not consumed, which makes the position that of the channel
+ *	again, as needed before seeking or writing.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	May block.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+UringWait(
+    FileState *fsPtr)
+{
+    FileAsync *asyncPtr = &fsPtr->async;
+    UringRing *ringPtr = asyncPtr->ringPtr;
+
+    asyncPtr->waiting = 1;
+    if (asyncPtr->inFlight == IO_READ) {
+	UringQueue(ringPtr, IORING_OP_ASYNC_CANCEL, -1, fsPtr, 0, NULL);
+    }
+    while (asyncPtr->inFlight != IO_NONE) {
+	UringEnter(ringPtr, 1);
+	UringReap(ringPtr);
+    }
+    asyncPtr->waiting = 0;
+}
+
+static void
+UringSync(
+    FileState *fsPtr)
+{
+    FileAsync *asyncPtr = &fsPtr->async;
+
+    if (asyncPtr->inFlight != IO_NONE) {
+	UringWait(fsPtr);
+    }
+    asyncPtr->readEof = 0;
+    if ((asyncPtr->readLen > 0) && (TclOSseek(fsPtr->fd,
+	    -(Tcl_SeekOffset) asyncPtr->readLen, SEEK_CUR) != -1)) {
+	asyncPtr->readLen = 0;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * UringUpdate --
+ *
+ *	Starts or stops asynchronous I/O after a change of the -async option,
+ *	of the blocking mode or of the thread of a channel. It is done while
+ *	-async is set and the channel is nonblocking, and io_uring works.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	While asynchronous I/O is done, the descriptor itself is blocking:
+ *	the kernel then waits for data on pipes instead of failing.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+UringUpdate(
+    FileState *fsPtr,
+    int wasActive)		/* Was asynchronous I/O done before the
+				 * change? */
+{
+    FileAsync *asyncPtr = &fsPtr->async;
+
+    if (asyncPtr->requested && (asyncPtr->ringPtr == NULL)) {
+	asyncPtr->ringPtr = UringAttach();
+    }
+    if (wasActive && !ASYNC_ACTIVE(fsPtr)) {
+	UringWait(fsPtr);
+	asyncPtr->readEof = 0;
+    }
+    if (!asyncPtr->requested && (asyncPtr->ringPtr != NULL)) {
+	UringDetach(asyncPtr->ringPtr);
+	asyncPtr->ringPtr = NULL;
+    }
+    if (wasActive != ASYNC_ACTIVE(fsPtr)) {
+	TclUnixSetBlockingMode(fsPtr->fd,
+		(asyncPtr->nonblocking && !ASYNC_ACTIVE(fsPtr))
+		? TCL_MODE_NONBLOCKING : TCL_MODE_BLOCKING);
+	FileWatchProc(fsPtr, asyncPtr->watchMask);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * UringInput, UringOutput --
+ *
+ *	The asynchronous versions of FileInputProc and FileOutputProc. Input
+ *	is read ahead in large blocks; when none is there, a read is started
+ *	and EAGAIN returned. Output is copied and written in the background.
+ *	While a write is going on, further output is collected up to a limit,
+ *	and written as one block after it. Beyond the limit, output to regular
+ *	files waits for the write, other output fails with EAGAIN.
+ *
+ * Results:
+ *	As for FileInputProc and FileOutputProc.
+ *
+ * Side effects:
+ *	Queues operations.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+UringInput(
+    FileState *fsPtr,
+    char *buf,
+    int toRead,
+    int *errorCodePtr)
+{
+    FileAsync *asyncPtr = &fsPtr->async;
+    int n;
+
+    if ((asyncPtr->readLen == 0) && !asyncPtr->readEof) {
+	/*
+	 * Submit the read right away: data in the page cache is read
+	 * without waiting, and callers polling the channel make progress
+	 * without the event loop.
+	 */
+
+	UringReadAhead(fsPtr);
+	UringEnter(asyncPtr->ringPtr, 0);
+	UringReap(asyncPtr->ringPtr);
+	if (asyncPtr->error != 0) {
+	    *errorCodePtr = asyncPtr->error;
+	    asyncPtr->error = 0;
+	    return -1;
+	}
+    }
+
+    if (asyncPtr->readLen > 0) {
+	n = (toRead < asyncPtr->readLen) ? toRead : asyncPtr->readLen;
+	memcpy(buf, asyncPtr->readBuf + asyncPtr->readStart, n);
+	asyncPtr->readStart += n;
+	asyncPtr->readLen -= n;
+	if ((asyncPtr->readLen == 0) && ASYNC_ACTIVE(fsPtr)) {
+	    /*
+	     * Have the kernel read on while the data is being processed.
+	     */
+
+	    UringReadAhead(fsPtr);
+	}
+	return n;
+    }
+    if (asyncPtr->readEof) {
+	asyncPtr->readEof = 0;
+	return 0;
+    }
+    *errorCodePtr = EAGAIN;
+    return -1;
+}
+
+static int
+UringOutput(
+    FileState *fsPtr,
+    const char *buf,
+    int toWrite,
+    int *errorCodePtr)
+{
+    FileAsync *asyncPtr = &fsPtr->async;
+
+    UringReap(asyncPtr->ringPtr);
+    if (asyncPtr->error != 0) {
+	*errorCodePtr = asyncPtr->error;
+	asyncPtr->error = 0;
+	return -1;
+    }
+
+    if ((asyncPtr->inFlight == IO_WRITE)
+	    && (asyncPtr->nextLen + toWrite > URING_WRITE_LIMIT)) {
+	/*
+	 * Hand the write to the kernel now, without waiting for the event
+	 * loop to do it, it may well complete right away.
+	 */
+
+	UringEnter(asyncPtr->ringPtr, 0);
+	UringReap(asyncPtr->ringPtr);
+    }
+    if ((asyncPtr->inFlight == IO_WRITE)
+	    && (asyncPtr->nextLen + toWrite > URING_WRITE_LIMIT)) {
+	struct stat st;
+
+	if ((fstat(fsPtr->fd, &st) != 0) || !S_ISREG(st.st_mode)) {
+	    *errorCodePtr = EAGAIN;
+	    return -1;
+	}
+
+	/*
+	 * Writes to regular files never fail with EAGAIN, even on nonblocking
+	 * descriptors, and scripts rely on that: output left to a background
+	 * flush is lost at exit. Wait for the kernel to catch up instead.
+	 */
+
+	while ((asyncPtr->inFlight == IO_WRITE)
+		&& (asyncPtr->nextLen + toWrite > URING_WRITE_LIMIT)) {
+	    UringEnter(asyncPtr->ringPtr, 1);
+	    UringReap(asyncPtr->ringPtr);
+	}
+	if (asyncPtr->error != 0) {
+	    *errorCodePtr = asyncPtr->error;
+	    asyncPtr->error = 0;
+	    return -1;
+	}
+    }
+    if (asyncPtr->inFlight == IO_WRITE) {
+	if (asyncPtr->nextLen + toWrite > asyncPtr->nextSize) {
+	    asyncPtr->nextSize = 2 * (asyncPtr->nextLen + toWrite);
+	    asyncPtr->nextBuf = (char *)ckrealloc(asyncPtr->nextBuf,
+		    asyncPtr->nextSize);
+	}
+	memcpy(asyncPtr->nextBuf + asyncPtr->nextLen, buf, toWrite);
+	asyncPtr->nextLen += toWrite;
+	return toWrite;
+    }
+
+    /*
+     * Give up the data read ahead, the write goes where the channel is.
+     */
+
+    UringSync(fsPtr);
+
+    if (toWrite > asyncPtr->writeSize) {
+	asyncPtr->writeSize = toWrite;
+	asyncPtr->writeBuf = (char *)ckrealloc(asyncPtr->writeBuf, toWrite);
+    }
+    memcpy(asyncPtr->writeBuf, buf, toWrite);
+    asyncPtr->writeStart = 0;
+    asyncPtr->writeLen = toWrite;
+    asyncPtr->inFlight = IO_WRITE;
+    UringQueue(asyncPtr->ringPtr, IORING_OP_WRITE, fsPtr->fd,
+	    asyncPtr->writeBuf, toWrite, fsPtr);
+    return toWrite;
+}
+
+static void
+UringReadAhead(
+    FileState *fsPtr)
+{
+    FileAsync *asyncPtr = &fsPtr->async;
+
+    if ((asyncPtr->inFlight != IO_NONE) || asyncPtr->waiting
+	    || (asyncPtr->readLen > 0) || asyncPtr->readEof || (asyncPtr->error != 0)
+	    || !(fsPtr->validMask & TCL_READABLE)) {
+	return;
+    }
+    if (asyncPtr->readBuf == NULL) {
+	asyncPtr->readBuf = (char *)ckalloc(URING_READ_SIZE);
+    }
+    asyncPtr->inFlight = IO_READ;
+    UringQueue(asyncPtr->ringPtr, IORING_OP_READ, fsPtr->fd,
+	    asyncPtr->readBuf, URING_READ_SIZE, fsPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * UringReady --
+ *
+ *	Computes which operations of a channel doing asynchronous I/O would
+ *	not fail with EAGAIN.
+ *
+ * Results:
+ *	A mask of TCL_READABLE and TCL_WRITABLE.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+UringReady(
+    FileState *fsPtr)
+{
+    FileAsync *asyncPtr = &fsPtr->async;
+    int mask = 0;
+
+    if ((asyncPtr->readLen > 0) || asyncPtr->readEof
+	    || (asyncPtr->error != 0)) {
+	mask |= TCL_READABLE;
+    }
+    if ((asyncPtr->inFlight != IO_WRITE) || (asyncPtr->error != 0)
+	    || (asyncPtr->nextLen < URING_WRITE_LIMIT)) {
+	mask |= TCL_WRITABLE;
+    }
+    return mask;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * UringTimerSetup, UringTimerProc --
+ *
+ *	Notify a channel of the events it is interested in, from the event
+ *	loop. Asynchronous I/O has no descriptor the notifier could watch.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Calls Tcl_NotifyChannel, which may run arbitrary scripts.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+UringTimerSetup(
+    FileState *fsPtr)
+{
+    if (fsPtr->async.timer == NULL) {
+	fsPtr->async.timer = Tcl_CreateTimerHandler(0, UringTimerProc, fsPtr);
+    }
+}
+
+static void
+UringTimerProc(
+    ClientData clientData)
+{
+    FileState *fsPtr = (FileState *)clientData;
+    int mask;
+
+    fsPtr->async.timer = NULL;
+    mask = fsPtr->async.watchMask & UringReady(fsPtr);
+    if (mask) {
+	Tcl_NotifyChannel(fsPtr->channel, mask);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * UringSetupProc, UringCheckProc, UringEventProc --
+ *
+ *	The event source and file handler of the io_uring instance of a
+ *	thread. All operations queued since the notifier last waited are
+ *	submitted with a single system call just before it waits again;
+ *	completions are reaped when it wakes up.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Submits operations and reaps completions.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+UringSetupProc(
+    ClientData clientData,
+    int flags)
+{
+    UringRing *ringPtr = (UringRing *)clientData;
+
+    if (!(flags & TCL_FILE_EVENTS)) {
+	return;
+    }
+    if (ringPtr->queued > 0) {
+	UringEnter(ringPtr, 0);
+    }
+    if (*ringPtr->cqHead
+	    != __atomic_load_n(ringPtr->cqTail, __ATOMIC_ACQUIRE)) {
+	Tcl_Time blockTime = {0, 0};
+
+	Tcl_SetMaxBlockTime(&blockTime);
+    }
+}
+
+static void
+UringCheckProc(
+    ClientData clientData,
+    int flags)
+{
+    if (flags & TCL_FILE_EVENTS) {
+	UringReap((UringRing *)clientData);
+    }
+}
+
+static void
+UringEventProc(
+    ClientData clientData,
+    int mask)
+{
+    UringRing *ringPtr = (UringRing *)clientData;
+    __u64 count;
+    (void)mask;
+
+    if (read(ringPtr->eventFd, &count, sizeof(count)) < 0) {
+	/*
+	 * Nothing to clear, another thread may have been faster.
+	 */
+    }
+    UringReap(ringPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FileGetOptionProc, FileSetOptionProc --
+ *
+ *	Get and set the options of file channels. The only one is -async,
+ *	which has nonblocking I/O done asynchronously with io_uring. Where
+ *	io_uring is not available, it can be set but has no effect, and reads
+ *	as 0.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	May start or stop asynchronous I/O.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+FileGetOptionProc(
+    ClientData instanceData,	/* File state. */
+    Tcl_Interp *interp,		/* For error reporting, can be NULL. */
+    const char *optionName,	/* Option to get, or NULL for all. */
+    Tcl_DString *dsPtr)		/* Where to store the value(s). */
+{
+    FileState *fsPtr = (FileState *)instanceData;
+    size_t len = 0;
+
+    if (optionName != NULL) {
+	len = strlen(optionName);
+    }
+    if ((len == 0) || ((len > 1)
+	    && (strncmp(optionName, "-async", len) == 0))) {
+	if (len == 0) {
+	    Tcl_DStringAppendElement(dsPtr, "-async");
+	}
+	Tcl_DStringAppendElement(dsPtr, (fsPtr->async.requested
+		&& (fsPtr->async.ringPtr != NULL)) ? "1" : "0");
+	return TCL_OK;
+    }
+    return Tcl_BadChannelOption(interp, optionName, "async");
+}
+
+static int
+FileSetOptionProc(
+    ClientData instanceData,	/* File state. */
+    Tcl_Interp *interp,		/* For error reporting, can be NULL. */
+    const char *optionName,	/* Which option to set? */
+    const char *value)		/* New value for option. */
+{
+    FileState *fsPtr = (FileState *)instanceData;
+    size_t len = strlen(optionName);
+    int flag, wasActive;
+
+    if ((len > 1) && (strncmp(optionName, "-async", len) == 0)) {
+	if (Tcl_GetBoolean(interp, value, &flag) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+	wasActive = ASYNC_ACTIVE(fsPtr);
+	fsPtr->async.requested = flag;
+	UringUpdate(fsPtr, wasActive);
+	return TCL_OK;
+    }
+    return Tcl_BadChannelOption(interp, optionName, "async");
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FileThreadActionProc --
+ *
+ *	Moves the asynchronous I/O of a file channel to the thread the
+ *	channel is moved to, as completions are reaped by the thread that
+ *	submitted the operations.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Waits for the operation going on in the old thread.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+FileThreadActionProc(
+    ClientData instanceData,
+    int action)
+{
+    FileState *fsPtr = (FileState *)instanceData;
+    FileAsync *asyncPtr = &fsPtr->async;
+
+    if (action == TCL_CHANNEL_THREAD_INSERT) {
+	UringUpdate(fsPtr, 0);
+	return;
+    }
+    if (asyncPtr->ringPtr != NULL) {
+	int wasActive = ASYNC_ACTIVE(fsPtr);
+
+	if (asyncPtr->inFlight != IO_NONE) {
+	    UringWait(fsPtr);
+	}
+	UringDetach(asyncPtr->ringPtr);
+	asyncPtr->ringPtr = NULL;
+	if (wasActive && asyncPtr->nonblocking) {
+	    TclUnixSetBlockingMode(fsPtr->fd, TCL_MODE_NONBLOCKING);
+	}
+    }
+    if (asyncPtr->timer != NULL) {
+	Tcl_DeleteTimerHandler(asyncPtr->timer);
+	asyncPtr->timer = NULL;
+    }
+}
+#endif	/* USE_IO_URING */
+
 #ifdef SUPPORTS_TTY
 /*
  *----------------------------------------------------------------------
@@ -1476,6 +2639,7 @@ TclpOpenFileChannel(
     }
 
     fsPtr = (FileState *)ckalloc(sizeof(FileState));
+    memset(fsPtr, 0, sizeof(FileState));
     fsPtr->validMask = channelPermissions | TCL_EXCEPTION;
     fsPtr->fd = fd;
 
@@ -1556,6 +2720,7 @@ Tcl_MakeFileChannel(
     snprintf(channelName, sizeof(channelName), "file%d", fd);
 final:
     fsPtr = (FileState *)ckalloc(sizeof(FileState));
+    memset(fsPtr, 0, sizeof(FileState));
     fsPtr->fd = fd;
     fsPtr->validMask = mode | TCL_EXCEPTION;
     fsPtr->channel = Tcl_CreateChannel(channelTypePtr, channelName,
@@ -1938,6 +3103,10 @@ FileTruncateProc(
     FileState *fsPtr = (FileState *)instanceData;
     int result;
 
+#ifdef USE_IO_URING
+    UringSync(fsPtr);
+#endif
+
 #ifdef HAVE_TYPE_OFF64_T
     /*
      * We assume this goes with the type for now...
@@ -208,6 +208,58 @@ const TclFileAttrProcs tclpFileAttrProcs[] = {
 
 #define MAX_READDIR_UNLINK_THRESHOLD 130
 
+TCL_DECLARE_MUTEX(umaskMutex)
+
+#ifdef TCL_THREADS
+/*
+ * Recursive copies and deletions are spread over several threads, since on
+ * network filesystems most of their time is spent waiting for the server.
+ * Directories are queued as they are found and scanned by whichever thread
+ * is free; the scanning thread handles the plain files in the directory
+ * itself. A directory is finished (DOTREE_POSTD) by the thread that
+ * finishes the last of its subdirectories.
+ */
+
+#define TRAVERSE_MAX_THREADS	4
+
+typedef struct TraverseDir {
+    struct TraverseDir *parentPtr;
+				/* Directory containing this one, NULL for the
+				 * root of the traversal. */
+    struct TraverseDir *nextPtr;/* Next directory in the work queue. */
+    struct TraverseDir *allPtr;	/* Next directory allocated, so everything
+				 * can be freed at the end. */
+    int pending;		/* Number of subdirectories not yet finished,
+				 * plus one while this directory is still
+				 * being scanned. */
+    Tcl_StatBuf statBuf;	/* Stat info for the directory, if needed. */
+    Tcl_DString source;		/* Pathname of the directory (native). */
+    Tcl_DString target;		/* Corresponding target pathname (native). */
+} TraverseDir;
+
+typedef struct TraverseState {
+    TraversalProc *traverseProc;/* Function to call for every file and
+				 * directory. */
+    int hasTarget;		/* Whether there is a target hierarchy. */
+    int needStat;		/* Whether traverseProc needs the stat info of
+				 * plain files; deletion does not. */
+    Tcl_Mutex lock;		/* Protects all fields below. */
+    Tcl_Condition cond;		/* Notified when a directory is queued or the
+				 * traversal is over. */
+    TraverseDir *headPtr;	/* Queue of directories waiting to be */
+    TraverseDir *tailPtr;	/* scanned. */
+    TraverseDir *allPtr;	/* Every directory allocated. */
+    int numBusy;		/* Threads currently scanning a directory. */
+    int numIdle;		/* Threads waiting for a directory. */
+    int numWorkers;		/* Threads started besides the caller. */
+    Tcl_ThreadId workers[TRAVERSE_MAX_THREADS - 1];
+    int done;			/* Set once the traversal is over. */
+    char *errorFile;		/* UTF-8 name of the first file that failed,
+				 * or NULL. */
+    int errorNum;		/* Its errno. */
+} TraverseState;
+#endif /* TCL_THREADS */
+
 /*
  * Declarations for local procedures defined in this file:
  */
@@ -232,6 +284,26 @@ static int		TraversalDelete(Tcl_DString *srcPtr,
 static int		TraverseUnixTree(TraversalProc *traversalProc,
 			    Tcl_DString *sourcePtr, Tcl_DString *destPtr,
 			    Tcl_DString *errorPtr, int doRewind);
+#ifdef TCL_THREADS
+static int		ParallelTraverseUnixTree(TraversalProc *traversalProc,
+			    Tcl_DString *sourcePtr, Tcl_DString *destPtr,
+			    Tcl_DString *errorPtr, int doRewind);
+static void		TraverseFail(TraverseState *tsPtr,
+			    Tcl_DString *utfPtr, const char *nativeName);
+static void		TraverseFinishDir(TraverseState *tsPtr,
+			    TraverseDir *dirPtr);
+static void		TraverseQueueDir(TraverseState *tsPtr,
+			    TraverseDir *parentPtr, Tcl_DString *sourcePtr,
+			    Tcl_DString *targetPtr,
+			    const Tcl_StatBuf *statBufPtr);
+static void		TraverseScanDir(TraverseState *tsPtr,
+			    TraverseDir *dirPtr);
+static void		TraverseWork(TraverseState *tsPtr);
+static Tcl_ThreadCreateType TraverseWorker(ClientData clientData);
+#   define TraverseTree	ParallelTraverseUnixTree
+#else
+#   define TraverseTree	TraverseUnixTree
+#endif /* TCL_THREADS */
 
 #ifdef PURIFY
 /*
@@ -718,8 +790,15 @@ DoCreateDirectory(
 {
     mode_t mode;
 
+    /*
+     * Reading the umask means setting it, so keep other threads (such as
+     * those of a parallel directory copy) from seeing the temporary value.
+     */
+
+    Tcl_MutexLock(&umaskMutex);
     mode = umask(0);
     umask(mode);
+    Tcl_MutexUnlock(&umaskMutex);
 
     /*
      * umask return value is actually the inverse of the permissions.
@@ -783,7 +862,7 @@ TclpObjCopyDirectory(
 	Tcl_DecrRefCount(transPtr);
     }
 
-    ret = TraverseUnixTree(TraversalCopy, &srcString, &dstString, &ds, 0);
+    ret = TraverseTree(TraversalCopy, &srcString, &dstString, &ds, 0);
 
     Tcl_DStringFree(&srcString);
     Tcl_DStringFree(&dstString);
@@ -902,7 +981,7 @@ DoRemoveDirectory(
      */
 
     if (result == TCL_OK) {
-	result = TraverseUnixTree(TraversalDelete, pathPtr, NULL, errorPtr, 1);
+	result = TraverseTree(TraversalDelete, pathPtr, NULL, errorPtr, 1);
     }
 
     if ((result != TCL_OK) && (recursive != 0)) {
@@ -1153,6 +1232,448 @@ TraverseUnixTree(
     return result;
 }
 
+#ifdef TCL_THREADS
+/*
+ *---------------------------------------------------------------------------
+ *
+ * ParallelTraverseUnixTree --
+ *
+ *	Multithreaded version of TraverseUnixTree, with the same arguments and
+ *	results. Files within a directory are handled in the order they are
+ *	read, and a directory is handled (DOTREE_PRED) before anything in it
+ *	and finished (DOTREE_POSTD) after everything in it, but different
+ *	directories are worked on concurrently; traverseProc must therefore be
+ *	thread-safe.
+ *
+ * Results:
+ *	Standard Tcl result.
+ *
+ * Side effects:
+ *	May start up to TRAVERSE_MAX_THREADS-1 worker threads for the duration
+ *	of the traversal. If an error occurs, no further directories are
+ *	started, but those already being scanned are completed.
+ *
+ *---------------------------------------------------------------------------
+ */
+
+static int
+ParallelTraverseUnixTree(
+    TraversalProc *traverseProc,/* Function to call for every file and
+				 * directory in source hierarchy. */
+    Tcl_DString *sourcePtr,	/* Pathname of source directory to be
+				 * traversed (native). */
+    Tcl_DString *targetPtr,	/* Pathname of directory to traverse in
+				 * parallel with source directory (native). */
+    Tcl_DString *errorPtr,	/* If non-NULL, uninitialized or free DString
+				 * filled with UTF-8 name of file causing
+				 * error. */
+    int doRewind)		/* Set when traverseProc modifies the source
+				 * hierarchy, i.e. for deletion. Directories
+				 * are always read completely before anything
+				 * in them is processed, so there is no need
+				 * to rewind them. */
+{
+    TraverseState ts;
+    TraverseDir *dirPtr;
+    Tcl_StatBuf statBuf;
+    int i, result;
+
+    if (TclOSlstat(Tcl_DStringValue(sourcePtr), &statBuf) != 0
+	    || !S_ISDIR(statBuf.st_mode)) {		/* INTL: Native. */
+	/*
+	 * Nothing to do in parallel; let the serial code handle the file or
+	 * report the error.
+	 */
+
+	return TraverseUnixTree(traverseProc, sourcePtr, targetPtr, errorPtr,
+		doRewind);
+    }
+
+    memset(&ts, 0, sizeof(ts));
+    ts.traverseProc = traverseProc;
+    ts.hasTarget = (targetPtr != NULL);
+    ts.needStat = !doRewind;
+
+    TraverseQueueDir(&ts, NULL, sourcePtr, targetPtr, &statBuf);
+    TraverseWork(&ts);
+
+    for (i=0 ; i<ts.numWorkers ; i++) {
+	Tcl_JoinThread(ts.workers[i], &result);
+    }
+    while (ts.allPtr != NULL) {
+	dirPtr = ts.allPtr;
+	ts.allPtr = dirPtr->allPtr;
+	Tcl_DStringFree(&dirPtr->source);
+	Tcl_DStringFree(&dirPtr->target);
+	ckfree(dirPtr);
+    }
+    Tcl_ConditionFinalize(&ts.cond);
+    Tcl_MutexFinalize(&ts.lock);
+
+    if (ts.errorFile != NULL) {
+	if (errorPtr != NULL) {
+	    Tcl_DStringInit(errorPtr);
+	    Tcl_DStringAppend(errorPtr, ts.errorFile, -1);
+	}
+	ckfree(ts.errorFile);
+	errno = ts.errorNum;
+	return TCL_ERROR;
+    }
+    return TCL_OK;
+}
+
+/*
+ *---------------------------------------------------------------------------
+ *
+ * TraverseWork, TraverseWorker --
+ *
+ *	TraverseWork scans queued directories until the traversal is over; it
+ *	is run by the thread that started the traversal and by every worker
+ *	thread. TraverseWorker is the body of a worker thread.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Whatever the traversal does.
+ *
+ *---------------------------------------------------------------------------
+ */
+
+static void
+TraverseWork(
+    TraverseState *tsPtr)
+{
+    TraverseDir *dirPtr;
+
+    Tcl_MutexLock(&tsPtr->lock);
+    while (!tsPtr->done) {
+	if (tsPtr->errorFile == NULL && tsPtr->headPtr != NULL) {
+	    dirPtr = tsPtr->headPtr;
+	    tsPtr->headPtr = dirPtr->nextPtr;
+	    tsPtr->numBusy++;
+	    Tcl_MutexUnlock(&tsPtr->lock);
+	    TraverseScanDir(tsPtr, dirPtr);
+	    Tcl_MutexLock(&tsPtr->lock);
+	    tsPtr->numBusy--;
+	    if (tsPtr->errorFile != NULL && tsPtr->numBusy == 0) {
+		/*
+		 * Nobody is left to finish anything.
+		 */
+
+		tsPtr->done = 1;
+		Tcl_ConditionNotify(&tsPtr->cond);
+	    }
+	} else {
+	    tsPtr->numIdle++;
+	    Tcl_ConditionWait(&tsPtr->cond, &tsPtr->lock, NULL);
+	    tsPtr->numIdle--;
+	}
+    }
+    Tcl_MutexUnlock(&tsPtr->lock);
+}
+
+static Tcl_ThreadCreateType
+TraverseWorker(
+    ClientData clientData)
+{
+    TraverseWork((TraverseState *)clientData);
+    Tcl_ExitThread(TCL_OK);
+    TCL_THREAD_CREATE_RETURN;
+}
+
+/*
+ *---------------------------------------------------------------------------
+ *
+ * TraverseQueueDir --
+ *
+ *	Queues a directory to be scanned, starting another worker thread if
+ *	all are busy.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The directory counts as pending in its parent until it is finished.
+ *	Nothing is queued once the traversal has failed.
+ *
+ *---------------------------------------------------------------------------
+ */
+
+static void
+TraverseQueueDir(
+    TraverseState *tsPtr,
+    TraverseDir *parentPtr,	/* Directory containing the new one, or NULL
+				 * for the root. */
+    Tcl_DString *sourcePtr,	/* Pathname of the directory (native). */
+    Tcl_DString *targetPtr,	/* Target pathname, or NULL. */
+    const Tcl_StatBuf *statBufPtr)
+				/* Stat info for the directory, or NULL if
+				 * it was not needed. */
+{
+    TraverseDir *dirPtr = (TraverseDir *)ckalloc(sizeof(TraverseDir));
+    Tcl_ThreadId id;
+
+    dirPtr->parentPtr = parentPtr;
+    dirPtr->nextPtr = NULL;
+    dirPtr->pending = 1;
+    if (statBufPtr != NULL) {
+	dirPtr->statBuf = *statBufPtr;
+    } else {
+	memset(&dirPtr->statBuf, 0, sizeof(Tcl_StatBuf));
+    }
+    Tcl_DStringInit(&dirPtr->source);
+    Tcl_DStringAppend(&dirPtr->source, Tcl_DStringValue(sourcePtr),
+	    Tcl_DStringLength(sourcePtr));
+    Tcl_DStringInit(&dirPtr->target);
+    if (targetPtr != NULL) {
+	Tcl_DStringAppend(&dirPtr->target, Tcl_DStringValue(targetPtr),
+		Tcl_DStringLength(targetPtr));
+    }
+
+    Tcl_MutexLock(&tsPtr->lock);
+    dirPtr->allPtr = tsPtr->allPtr;
+    tsPtr->allPtr = dirPtr;
+    if (tsPtr->errorFile == NULL) {
+	if (parentPtr != NULL) {
+	    parentPtr->pending++;
+	}
+	if (tsPtr->headPtr == NULL) {
+	    tsPtr->headPtr = dirPtr;
+	} else {
+	    tsPtr->tailPtr->nextPtr = dirPtr;
+	}
+	tsPtr->tailPtr = dirPtr;
+	if (tsPtr->numIdle > 0) {
+	    Tcl_ConditionNotify(&tsPtr->cond);
+	} else if (parentPtr != NULL
+		&& tsPtr->numWorkers < TRAVERSE_MAX_THREADS - 1
+		&& Tcl_CreateThread(&id, TraverseWorker, tsPtr,
+			TCL_THREAD_STACK_DEFAULT, TCL_THREAD_JOINABLE) == TCL_OK) {
+	    tsPtr->workers[tsPtr->numWorkers++] = id;
+	}
+    }
+    Tcl_MutexUnlock(&tsPtr->lock);
+}
+
+/*
+ *---------------------------------------------------------------------------
+ *
+ * TraverseScanDir --
+ *
+ *	Reads a directory, calls traverseProc for each plain file in it and
+ *	queues its subdirectories. The directory is read completely first, so
+ *	deleting its entries cannot upset readdir. The entry type reported by
+ *	readdir is used where possible so that files need not be stat'ed when
+ *	traverseProc does not need their stat info.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Whatever traverseProc does. Failures are recorded in tsPtr.
+ *
+ *---------------------------------------------------------------------------
+ */
+
+static void
+TraverseScanDir(
+    TraverseState *tsPtr,
+    TraverseDir *dirPtr)
+{
+    TclDIR *dp;
+    Tcl_DirEntry *dirEntPtr;
+    Tcl_DString names, source, target, error;
+    Tcl_StatBuf statBuf, *statBufPtr;
+    const char *name, *end;
+    int sourceLen, targetLen = 0;
+    char kind;
+
+    dp = TclOSopendir(Tcl_DStringValue(&dirPtr->source)); /* INTL: Native. */
+    if (dp == NULL) {
+	TraverseFail(tsPtr, NULL, Tcl_DStringValue(&dirPtr->source));
+	return;
+    }
+    Tcl_DStringInit(&error);
+    if (tsPtr->traverseProc(&dirPtr->source,
+	    tsPtr->hasTarget ? &dirPtr->target : NULL, &dirPtr->statBuf,
+	    DOTREE_PRED, &error) != TCL_OK) {
+	TclOSclosedir(dp);
+	TraverseFail(tsPtr, &error, NULL);
+	return;
+    }
+
+    /*
+     * Each entry is stored as a kind character ('d' for a directory, 'f' for
+     * anything else, '?' when readdir doesn't say) followed by the name and
+     * its terminating null.
+     */
+
+    Tcl_DStringInit(&names);
+    while ((dirEntPtr = TclOSreaddir(dp)) != NULL) {	/* INTL: Native. */
+	name = dirEntPtr->d_name;
+	if ((name[0] == '.')
+		&& ((name[1] == '\0') || (strcmp(name, "..") == 0))) {
+	    continue;
+	}
+#ifdef DT_UNKNOWN
+	kind = (dirEntPtr->d_type == DT_DIR) ? 'd'
+		: (dirEntPtr->d_type == DT_UNKNOWN) ? '?' : 'f';
+#else
+	kind = '?';
+#endif
+	Tcl_DStringAppend(&names, &kind, 1);
+	Tcl_DStringAppend(&names, name, strlen(name) + 1);
+    }
+    TclOSclosedir(dp);
+
+    Tcl_DStringInit(&source);
+    Tcl_DStringAppend(&source, Tcl_DStringValue(&dirPtr->source),
+	    Tcl_DStringLength(&dirPtr->source));
+    TclDStringAppendLiteral(&source, "/");
+    sourceLen = Tcl_DStringLength(&source);
+    Tcl_DStringInit(&target);
+    if (tsPtr->hasTarget) {
+	Tcl_DStringAppend(&target, Tcl_DStringValue(&dirPtr->target),
+		Tcl_DStringLength(&dirPtr->target));
+	TclDStringAppendLiteral(&target, "/");
+	targetLen = Tcl_DStringLength(&target);
+    }
+
+    name = Tcl_DStringValue(&names);
+    end = name + Tcl_DStringLength(&names);
+    for (; name < end ; name += strlen(name) + 1) {
+	kind = *name++;
+	Tcl_DStringSetLength(&source, sourceLen);
+	Tcl_DStringAppend(&source, name, -1);
+	if (tsPtr->hasTarget) {
+	    Tcl_DStringSetLength(&target, targetLen);
+	    Tcl_DStringAppend(&target, name, -1);
+	}
+	statBufPtr = NULL;
+	if (tsPtr->needStat || kind == '?') {
+	    statBufPtr = &statBuf;
+	    if (TclOSlstat(Tcl_DStringValue(&source), statBufPtr) != 0) {
+							/* INTL: Native. */
+		TraverseFail(tsPtr, NULL, Tcl_DStringValue(&source));
+		break;
+	    }
+	    kind = S_ISDIR(statBuf.st_mode) ? 'd' : 'f';
+	}
+	if (kind == 'd') {
+	    TraverseQueueDir(tsPtr, dirPtr, &source,
+		    tsPtr->hasTarget ? &target : NULL, statBufPtr);
+	} else if (tsPtr->traverseProc(&source,
+		tsPtr->hasTarget ? &target : NULL,
+		tsPtr->needStat ? &statBuf : NULL, DOTREE_F,
+		&error) != TCL_OK) {
+	    TraverseFail(tsPtr, &error, NULL);
+	    break;
+	}
+    }
+    Tcl_DStringFree(&names);
+    Tcl_DStringFree(&source);
+    Tcl_DStringFree(&target);
+
+    TraverseFinishDir(tsPtr, dirPtr);
+}
+
+/*
+ *---------------------------------------------------------------------------
+ *
+ * TraverseFinishDir --
+ *
+ *	Notes that one more part of a directory (its own scan or one of its
+ *	subdirectories) is complete. When nothing is left, the directory is
+ *	finished with DOTREE_POSTD, which in turn may complete its parent.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Whatever traverseProc does. The traversal is over when the root
+ *	directory is finished.
+ *
+ *---------------------------------------------------------------------------
+ */
+
+static void
+TraverseFinishDir(
+    TraverseState *tsPtr,
+    TraverseDir *dirPtr)
+{
+    Tcl_DString error;
+
+    while (dirPtr != NULL) {
+	Tcl_MutexLock(&tsPtr->lock);
+	if (--dirPtr->pending > 0 || tsPtr->errorFile != NULL) {
+	    Tcl_MutexUnlock(&tsPtr->lock);
+	    return;
+	}
+	Tcl_MutexUnlock(&tsPtr->lock);
+
+	Tcl_DStringInit(&error);
+	if (tsPtr->traverseProc(&dirPtr->source,
+		tsPtr->hasTarget ? &dirPtr->target : NULL, &dirPtr->statBuf,
+		DOTREE_POSTD, &error) != TCL_OK) {
+	    TraverseFail(tsPtr, &error, NULL);
+	    return;
+	}
+	if (dirPtr->parentPtr == NULL) {
+	    Tcl_MutexLock(&tsPtr->lock);
+	    tsPtr->done = 1;
+	    Tcl_ConditionNotify(&tsPtr->cond);
+	    Tcl_MutexUnlock(&tsPtr->lock);
+	}
+	dirPtr = dirPtr->parentPtr;
+    }
+}
+
+/*
+ *---------------------------------------------------------------------------
+ *
+ * TraverseFail --
+ *
+ *	Records that the traversal failed, unless it already has. The name of
+ *	the file at fault is given either as a DString filled by traverseProc
+ *	(which is freed) or as a native name.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Remembers the name of the file and the current errno for the thread
+ *	that started the traversal.
+ *
+ *---------------------------------------------------------------------------
+ */
+
+static void
+TraverseFail(
+    TraverseState *tsPtr,
+    Tcl_DString *utfPtr,	/* UTF-8 name of the file, or NULL. */
+    const char *nativeName)	/* Native name of the file, if utfPtr is
+				 * NULL. */
+{
+    int errorNum = errno;
+    Tcl_DString ds;
+
+    if (utfPtr == NULL) {
+	utfPtr = &ds;
+	Tcl_ExternalToUtfDString(NULL, nativeName, -1, utfPtr);
+    }
+    Tcl_MutexLock(&tsPtr->lock);
+    if (tsPtr->errorFile == NULL) {
+	tsPtr->errorFile = (char *)ckalloc(Tcl_DStringLength(utfPtr) + 1);
+	memcpy(tsPtr->errorFile, Tcl_DStringValue(utfPtr),
+		Tcl_DStringLength(utfPtr) + 1);
+	tsPtr->errorNum = errorNum;
+    }
+    Tcl_MutexUnlock(&tsPtr->lock);
+    Tcl_DStringFree(utfPtr);
+}
+#endif /* TCL_THREADS */
+
 /*
  *----------------------------------------------------------------------
  *
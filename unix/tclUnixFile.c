@@ -12,9 +12,12 @@
 
 #include "tclInt.h"
 #include "tclFileSystem.h"
+#include <sys/mman.h>
 
 static int NativeMatchType(Tcl_Interp *interp, const char* nativeEntry,
 	const char* nativeName, Tcl_GlobTypeData *types);
+static int DirEntryMatchType(Tcl_DirEntry *entryPtr,
+	Tcl_GlobTypeData *types);
 
 /*
  *---------------------------------------------------------------------------
@@ -363,11 +366,14 @@ TclpMatchInDirectory(
 		int typeOk = 1;
 
 		if (types != NULL) {
-		    Tcl_DStringSetLength(&ds, nativeDirLen);
-		    native = Tcl_DStringAppend(&ds, entryPtr->d_name, -1);
-		    matchResult = NativeMatchType(interp, native,
-			    entryPtr->d_name, types);
-		    typeOk = (matchResult == 1);
+		    typeOk = DirEntryMatchType(entryPtr, types);
+		    if (typeOk < 0) {
+			Tcl_DStringSetLength(&ds, nativeDirLen);
+			native = Tcl_DStringAppend(&ds, entryPtr->d_name, -1);
+			matchResult = NativeMatchType(interp, native,
+				entryPtr->d_name, types);
+			typeOk = (matchResult == 1);
+		    }
 		}
 		if (typeOk) {
 		    Tcl_ListObjAppendElement(interp, resultPtr,
@@ -392,6 +398,75 @@ TclpMatchInDirectory(
     return TCL_OK;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * DirEntryMatchType --
+ *
+ *	This routine is used by the globbing code to check if a directory
+ *	entry matches a given type description without calling stat, using
+ *	the file type that readdir reports on most systems.
+ *
+ * Results:
+ *	The return value is 1 or 0 indicating whether the entry matches the
+ *	given criteria, or -1 if that can't be told from the entry alone, in
+ *	which case NativeMatchType must be used.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+DirEntryMatchType(
+    Tcl_DirEntry *entryPtr,	/* Entry returned by readdir. */
+    Tcl_GlobTypeData *types)	/* Type description to match against. */
+{
+#ifdef DT_UNKNOWN
+    int typeBit;
+
+    if (types->perm != 0 || types->type == 0
+	    || types->macType != NULL || types->macCreator != NULL) {
+	return -1;
+    }
+    switch (entryPtr->d_type) {
+    case DT_BLK:
+	typeBit = TCL_GLOB_TYPE_BLOCK;
+	break;
+    case DT_CHR:
+	typeBit = TCL_GLOB_TYPE_CHAR;
+	break;
+    case DT_DIR:
+	typeBit = TCL_GLOB_TYPE_DIR;
+	break;
+    case DT_FIFO:
+	typeBit = TCL_GLOB_TYPE_PIPE;
+	break;
+#ifdef DT_SOCK
+    case DT_SOCK:
+	typeBit = TCL_GLOB_TYPE_SOCK;
+	break;
+#endif /* DT_SOCK */
+    case DT_REG:
+	typeBit = TCL_GLOB_TYPE_FILE;
+	break;
+    case DT_LNK:
+	/*
+	 * A link matches by the type of what it points to, so only a request
+	 * for links can be answered here.
+	 */
+
+	return (types->type & TCL_GLOB_TYPE_LINK) ? 1 : -1;
+    default:
+	return -1;
+    }
+    return (types->type & typeBit) != 0;
+#else
+    return -1;
+#endif /* DT_UNKNOWN */
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -848,6 +923,133 @@ TclpObjStat(
     return TclOSstat(path, bufPtr);
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclpMapFile --
+ *
+ *	Maps part of a file into memory, read-only as far as the file is
+ *	concerned: the pages are mapped copy-on-write, so writes to them stay
+ *	private to the process. A negative length maps up to the end of the
+ *	file; the window is clipped to the end of the file in any case.
+ *
+ * Results:
+ *	0 on success, with the address and length of the mapped bytes and a
+ *	value to pass to TclpUnmapFile stored through the pointer arguments.
+ *	The length may be 0, in which case nothing is mapped. -1 on failure,
+ *	with errno set.
+ *
+ * Side effects:
+ *	Adds a mapping to the process's address space.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclpMapFile(
+    Tcl_Obj *pathPtr,		/* Path of file to map. */
+    Tcl_WideInt offset,		/* Where in the file to start. */
+    Tcl_WideInt length,		/* How many bytes to map, or -1 for all. */
+    unsigned char **bytesPtr,	/* Where to store the first mapped byte. */
+    int *lengthPtr,		/* Where to store the number of bytes. */
+    ClientData *clientDataPtr)	/* Where to store the value to pass to
+				 * TclpUnmapFile. */
+{
+    const char *path = (const char *)Tcl_FSGetNativePath(pathPtr);
+    struct stat statBuf;
+    Tcl_WideInt size, delta;
+    void *addr;
+    int fd;
+
+    if (path == NULL) {
+	return -1;
+    }
+    fd = TclOSopen(path, O_RDONLY, 0);
+    if (fd < 0) {
+	return -1;
+    }
+    if (fstat(fd, &statBuf) != 0) {
+	goto error;
+    }
+    if (!S_ISREG(statBuf.st_mode)) {
+	errno = S_ISDIR(statBuf.st_mode) ? EISDIR : ENODEV;
+	goto error;
+    }
+
+    size = (Tcl_WideInt) statBuf.st_size - offset;
+    if (size < 0) {
+	size = 0;
+    }
+    if (length >= 0 && length < size) {
+	size = length;
+    }
+    if (size > INT_MAX) {
+	errno = EFBIG;
+	goto error;
+    }
+    if (size == 0) {
+	close(fd);
+	*bytesPtr = NULL;
+	*lengthPtr = 0;
+	*clientDataPtr = NULL;
+	return 0;
+    }
+
+    /*
+     * mmap() wants a page-aligned offset; map from the start of the page and
+     * remember how far into it the caller's bytes begin.
+     */
+
+    delta = offset % sysconf(_SC_PAGESIZE);
+    addr = mmap(NULL, (size_t) (size + delta), PROT_READ|PROT_WRITE,
+	    MAP_PRIVATE, fd, (off_t) (offset - delta));
+    if (addr == MAP_FAILED) {
+	goto error;
+    }
+    close(fd);
+
+    *bytesPtr = (unsigned char *) addr + delta;
+    *lengthPtr = (int) size;
+    *clientDataPtr = INT2PTR(delta);
+    return 0;
+
+  error:
+    {
+	int savedErrno = errno;
+
+	close(fd);
+	errno = savedErrno;
+    }
+    return -1;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclpUnmapFile --
+ *
+ *	Releases a mapping made by TclpMapFile.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Removes the mapping from the process's address space.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclpUnmapFile(
+    ClientData clientData,	/* As returned by TclpMapFile. */
+    unsigned char *bytes,	/* The first mapped byte. */
+    int length)			/* The number of mapped bytes. */
+{
+    int delta = PTR2INT(clientData);
+
+    munmap(bytes - delta, (size_t) length + delta);
+}
+
 #ifdef S_IFLNK
 
 Tcl_Obj *
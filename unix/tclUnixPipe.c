@@ -13,10 +13,17 @@
 
 #include "tclInt.h"
 
+/*
+ * Child processes are started with posix_spawnp() where it is known to
+ * report exec failures back to the caller, and otherwise (and whenever
+ * posix_spawnp() can't do what is needed) with vfork() or fork(). Neither
+ * posix_spawnp() nor vfork() copies the page tables of the parent, so the
+ * cost of starting a process does not grow with the size of the heap.
+ */
+
 #ifdef HAVE_POSIX_SPAWNP
 #   if defined(HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDDUP2) \
-	    && defined(HAVE_POSIX_SPAWNATTR_SETFLAGS) \
-	    && !defined(HAVE_VFORK)
+	    && defined(HAVE_POSIX_SPAWNATTR_SETFLAGS)
 #	include <unistd.h>
 #	include <spawn.h>
 #   else
@@ -71,6 +78,10 @@ static int		PipeOutputProc(void *instanceData,
 static void		PipeWatchProc(void *instanceData, int mask);
 static void		RestoreSignals(void);
 static int		SetupStdFile(TclFile file, int type);
+#ifdef HAVE_POSIX_SPAWNP
+static int		SpawnStdFile(posix_spawn_file_actions_t *actionsPtr,
+			    TclFile file, int type);
+#endif
 
 /*
  * This structure describes the channel type structure for command pipe based
@@ -425,7 +436,7 @@ TclpCreateProcess(
     int pid;
     int i;
 #if defined(HAVE_POSIX_SPAWNP)
-    int childErrno;
+    int childErrno = 0;
     static int use_spawn = -1;
 #endif
 
@@ -501,29 +512,36 @@ TclpCreateProcess(
 	posix_spawn_file_actions_t actions;
 	posix_spawnattr_t attr;
 	sigset_t sigs;
+	int joinThisError = errorFile && (errorFile == outputFile);
 
-	posix_spawn_file_actions_init(&actions);
-	posix_spawnattr_init(&attr);
-	sigfillset(&sigs);
-	sigdelset(&sigs, SIGKILL);
-	sigdelset(&sigs, SIGSTOP);
+	/*
+	 * The file actions do what SetupStdFile() does in a forked child.
+	 * When they can't, fall through to fork().
+	 */
 
-	posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGDEF
+	posix_spawn_file_actions_init(&actions);
+	if (SpawnStdFile(&actions, inputFile, TCL_STDIN)
+		&& SpawnStdFile(&actions, outputFile, TCL_STDOUT)
+		&& (joinThisError
+		? (posix_spawn_file_actions_adddup2(&actions, 1, 2) == 0)
+		: SpawnStdFile(&actions, errorFile, TCL_STDERR))) {
+	    posix_spawnattr_init(&attr);
+	    sigfillset(&sigs);
+	    sigdelset(&sigs, SIGKILL);
+	    sigdelset(&sigs, SIGSTOP);
+
+	    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGDEF
 #ifdef POSIX_SPAWN_USEVFORK
-		| POSIX_SPAWN_USEVFORK
+		    | POSIX_SPAWN_USEVFORK
 #endif
-		);
-	posix_spawnattr_setsigdefault(&attr, &sigs);
-
-	posix_spawn_file_actions_adddup2(&actions, GetFd(inputFile), 0);
-	posix_spawn_file_actions_adddup2(&actions, GetFd(outputFile), 1);
-	posix_spawn_file_actions_adddup2(&actions, GetFd(errorFile), 2);
+		    );
+	    posix_spawnattr_setsigdefault(&attr, &sigs);
 
-	status = posix_spawnp(&pid, newArgv[0], &actions, &attr,
-		newArgv, environ);
-	childErrno = errno;
+	    status = posix_spawnp(&pid, newArgv[0], &actions, &attr,
+		    newArgv, environ);
+	    posix_spawnattr_destroy(&attr);
+	}
 	posix_spawn_file_actions_destroy(&actions);
-	posix_spawnattr_destroy(&attr);
 
 	/*
 	 * Fork semantics:
@@ -531,8 +549,10 @@ TclpCreateProcess(
 	 *  - pid == -1: error
 	 *  - pid > 0: parent process
 	 *
-	 * Mimic fork semantics to minimize changes below,
-	 * but retry with fork() as last ressort.
+	 * Mimic fork semantics to minimize changes below. If the spawn
+	 * failed, retry with fork(): the child then reports exactly what
+	 * went wrong, and execvp() also runs scripts without a "#!" line
+	 * with the shell, which posix_spawnp() does not.
 	 */
     }
     if (status != 0) {
@@ -798,6 +818,74 @@ SetupStdFile(
     return 1;
 }
 
+#ifdef HAVE_POSIX_SPAWNP
+/*
+ *----------------------------------------------------------------------
+ *
+ * SpawnStdFile --
+ *
+ *	Adds the actions that set up a standard I/O handle of a process
+ *	started with posix_spawnp() to the given list, in the same way as
+ *	SetupStdFile does for a forked child.
+ *
+ * Results:
+ *	1 if the actions could be added, 0 if the handle can't be set up this
+ *	way. That is the case when the file is already the right handle but
+ *	is marked close-on-exec, since dup2() onto itself does not clear the
+ *	flag everywhere.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+SpawnStdFile(
+    posix_spawn_file_actions_t *actionsPtr,
+				/* List of actions to add to. */
+    TclFile file,		/* File to dup, or NULL. */
+    int type)			/* One of TCL_STDIN, TCL_STDOUT, TCL_STDERR */
+{
+    Tcl_Channel channel;
+    int fd;
+    int targetFd = 0;		/* Initializations here needed only to */
+    int direction = 0;		/* prevent warnings about using uninitialized
+				 * variables. */
+
+    switch (type) {
+    case TCL_STDIN:
+	targetFd = 0;
+	direction = TCL_READABLE;
+	break;
+    case TCL_STDOUT:
+	targetFd = 1;
+	direction = TCL_WRITABLE;
+	break;
+    case TCL_STDERR:
+	targetFd = 2;
+	direction = TCL_WRITABLE;
+	break;
+    }
+
+    if (!file) {
+	channel = Tcl_GetStdChannel(type);
+	if (channel) {
+	    file = TclpMakeFile(channel, direction);
+	}
+    }
+    if (file) {
+	fd = GetFd(file);
+	if (fd != targetFd) {
+	    return posix_spawn_file_actions_adddup2(actionsPtr, fd,
+		    targetFd) == 0;
+	}
+	return !(fcntl(fd, F_GETFD) & FD_CLOEXEC);
+    }
+    return posix_spawn_file_actions_addclose(actionsPtr, targetFd) == 0;
+}
+#endif /* HAVE_POSIX_SPAWNP */
+
 /*
  *----------------------------------------------------------------------
  *
@@ -40,7 +40,9 @@ typedef union {
 } address;
 
 /*
- * This structure describes per-instance state of a tcp-based channel.
+ * This structure describes per-instance state of a tcp-based channel. Its
+ * I/O is always readiness-based, see the io_uring note in tclUnixChan.c for
+ * why sockets have no -async option.
  */
 
 typedef struct TcpState TcpState;
@@ -77,6 +79,11 @@ struct TcpState {
                                  * an async socket is not yet connected. */
     int connectError;           /* Cache SO_ERROR of async socket. */
     int cachedBlocking;         /* Cache blocking mode of async socket. */
+    struct TcpResolve *resolvePtr;
+				/* Background lookup of the remote host of an
+				 * async socket, NULL when not resolving. */
+    const char *resolveError;	/* Why that lookup failed, for reporting by
+				 * [fconfigure -error]. */
 };
 
 /*
@@ -91,6 +98,71 @@ struct TcpState {
 					 * flag indicates that reentry is
 					 * still pending */
 #define TCP_ASYNC_FAILED	(1<<5)	/* An async connect finally failed */
+#define TCP_SERVER		(1<<6)	/* Listening socket, its descriptors are
+					 * always nonblocking. */
+#define TCP_ADDRLIST_COPY	(1<<7)	/* The addrlist was made by CopyAddrList
+					 * rather than by getaddrinfo(). */
+
+/*
+ * This structure describes a lookup of a host name done by a resolver thread
+ * for [socket -async], so that a slow name server does not block the event
+ * loop. It is shared between the thread owning the socket and the resolver,
+ * and is allocated with malloc() as the resolver may outlive Tcl.
+ */
+
+typedef struct TcpResolve {
+    struct TcpResolve *nextPtr;	/* Next lookup in the resolver queue. */
+    int refCount;		/* Owner and resolver hold one reference
+				 * each. */
+    int cancelled;		/* The owner closed the socket and is no
+				 * longer interested in the result. */
+    int fds[2];			/* Pipe, the resolver writes a byte to fds[1]
+				 * when done, the owner watches fds[0]. */
+    char *host;			/* Host name in the native encoding. */
+    char *name;			/* Host name as given to [socket]. */
+    int port;			/* Port to connect to. */
+    int family;			/* AF_UNSPEC, AF_INET or AF_INET6. */
+    int result;			/* Return code of getaddrinfo(). */
+    int sysError;		/* Value of errno if that was EAI_SYSTEM. */
+    struct addrinfo *addrlist;	/* Addresses found by getaddrinfo(). */
+} TcpResolve;
+
+/*
+ * The maximum number of resolver threads. They are started on demand and
+ * exit as soon as there are no lookups left to do.
+ */
+
+#define RESOLVE_THREADS		4
+
+#ifdef TCL_THREADS
+static pthread_mutex_t resolveMutex = PTHREAD_MUTEX_INITIALIZER;
+static TcpResolve *resolveHead = NULL;	/* Queue of pending lookups. */
+static TcpResolve *resolveTail = NULL;
+static int resolveThreads = 0;		/* Number of running resolvers. */
+#endif /* TCL_THREADS */
+
+/*
+ * Host names looked up for client sockets are remembered for a while in a
+ * process wide cache. getaddrinfo() does not tell the TTL of the DNS records,
+ * so a short fixed one is used instead, which can be changed, or set to 0 to
+ * turn the cache off, with [::tcl::unsupported::resolvecache]. The cache is
+ * keyed by address family, port and host name, its values are CachedAddr
+ * structures.
+ */
+
+#define RESOLVE_CACHE_TTL	30	/* Default seconds a lookup is reused. */
+#define RESOLVE_CACHE_SIZE	64	/* Maximum number of cached hosts. */
+
+typedef struct {
+    struct addrinfo *addrlist;	/* Made by CopyAddrList. */
+    long expires;		/* Time in seconds at which the entry must
+				 * no longer be used. */
+} CachedAddr;
+
+static Tcl_HashTable resolveCache;
+static int resolveCacheInitialized = 0;
+static int resolveCacheTtl = RESOLVE_CACHE_TTL;
+TCL_DECLARE_MUTEX(resolveCacheMutex)
 
 /*
  * The following defines the maximum length of the listen queue. This is the
@@ -113,10 +185,30 @@ struct TcpState {
 
 #define SOCKET_BUFSIZE	4096
 
+/*
+ * The maximum number of connections accepted on a server socket each time it
+ * becomes readable. Accepting all pending connections in one go saves a trip
+ * through the notifier for each of them; the limit keeps a flood of them
+ * from starving other event sources.
+ */
+
+#define ACCEPT_BATCH	64
+
 /*
  * Static routines for this file:
  */
 
+static struct addrinfo *CacheLookup(const char *host, int port, int family);
+static void		CacheStore(const char *host, int port, int family,
+			    const struct addrinfo *addrlist);
+static void		CacheFinalize(void *clientData);
+static void		CacheFlush(void);
+static struct addrinfo *CopyAddrList(const struct addrinfo *addrlist);
+static int		IsNumericHost(const char *host);
+#ifdef TCL_THREADS
+static void		ResolveRelease(TcpResolve *resolvePtr);
+static void *		ResolverThread(void *dummy);
+#endif /* TCL_THREADS */
 static void		TcpAsyncCallback(void *clientData, int mask);
 static int		TcpConnect(Tcl_Interp *interp, TcpState *state);
 static void		TcpAccept(void *data, int mask);
@@ -134,6 +226,10 @@ static int		TcpInputProc(void *instanceData, char *buf,
 			    int toRead, int *errorCode);
 static int		TcpOutputProc(void *instanceData,
 			    const char *buf, int toWrite, int *errorCode);
+static void		TcpResolveCancel(TcpState *statePtr);
+static int		TcpResolveFinish(TcpState *statePtr, int *errorPtr);
+static TcpResolve *	TcpResolveStart(const char *host, int port,
+			    int family);
 static void		TcpThreadActionProc(void *instanceData, int action);
 static void		TcpWatchProc(void *instanceData, int mask);
 static int		WaitForConnect(TcpState *statePtr, int *errorCodePtr);
@@ -381,6 +477,14 @@ TcpBlockModeProc(
     } else {
 	SET_BITS(statePtr->flags, TCP_NONBLOCKING);
     }
+    if (GOT_BITS(statePtr->flags, TCP_SERVER)) {
+	/*
+	 * TcpAccept relies on accept() failing once no more connections are
+	 * pending.
+	 */
+
+	return 0;
+    }
     if (GOT_BITS(statePtr->flags, TCP_ASYNC_CONNECT)) {
 	statePtr->cachedBlocking = mode;
 	return 0;
@@ -427,7 +531,7 @@ WaitForConnect(
     TcpState *statePtr,		/* State of the socket. */
     int *errorCodePtr)
 {
-    int timeout;
+    int timeout, fd, mask;
 
     /*
      * Check if an async connect failed already and error reporting is
@@ -453,8 +557,19 @@ WaitForConnect(
 	timeout = -1;
     }
     do {
-	if (TclUnixWaitForFile(statePtr->fds.fd,
-		TCL_WRITABLE | TCL_EXCEPTION, timeout) != 0) {
+	/*
+	 * While the remote host is being looked up, wait for the resolver
+	 * instead of the socket.
+	 */
+
+	if (statePtr->resolvePtr != NULL) {
+	    fd = statePtr->resolvePtr->fds[0];
+	    mask = TCL_READABLE;
+	} else {
+	    fd = statePtr->fds.fd;
+	    mask = TCL_WRITABLE | TCL_EXCEPTION;
+	}
+	if (TclUnixWaitForFile(fd, mask, timeout) != 0) {
 	    TcpConnect(NULL, statePtr);
 	}
 
@@ -608,6 +723,9 @@ TcpCloseProc(
      * that called this function, so we do not have to delete them here.
      */
 
+    if (statePtr->resolvePtr != NULL) {
+	TcpResolveCancel(statePtr);
+    }
     for (fds = &statePtr->fds; fds != NULL; fds = fds->next) {
 	if (fds->fd < 0) {
 	    continue;
@@ -616,7 +734,7 @@ TcpCloseProc(
 	if (close(fds->fd) < 0) {
 	    errorCode = errno;
 	}
-
+	fds->fd = -1;
     }
     fds = statePtr->fds.next;
     while (fds != NULL) {
@@ -625,13 +743,20 @@ TcpCloseProc(
 	ckfree(fds);
 	fds = next;
     }
-    if (statePtr->addrlist != NULL) {
+    if (GOT_BITS(statePtr->flags, TCP_ADDRLIST_COPY)) {
+	ckfree(statePtr->addrlist);
+    } else if (statePtr->addrlist != NULL) {
 	freeaddrinfo(statePtr->addrlist);
     }
     if (statePtr->myaddrlist != NULL) {
 	freeaddrinfo(statePtr->myaddrlist);
     }
-    ckfree(statePtr);
+
+    /*
+     * TcpAccept may be running an accept callback which closed the socket.
+     */
+
+    Tcl_EventuallyFree(statePtr, TCL_DYNAMIC);
     return errorCode;
 }
 
@@ -833,11 +958,16 @@ TcpGetOptionProc(
 	     */
 
 	    errno = 0;
+	} else if (statePtr->resolveError != NULL) {
+	    Tcl_DStringAppend(dsPtr, statePtr->resolveError, -1);
+	    statePtr->resolveError = NULL;
+	    statePtr->connectError = 0;
+	    return TCL_OK;
 	} else if (statePtr->connectError != 0) {
 	    errno = statePtr->connectError;
 	    statePtr->connectError = 0;
 	} else {
-	    int err;
+	    int err = 0;
 
 	    getsockopt(statePtr->fds.fd, SOL_SOCKET, SO_ERROR, (char *) &err,
 		    &optlen);
@@ -976,7 +1106,17 @@ TcpThreadActionProc(
     int action)
 {
     TcpState *statePtr = (TcpState *)instanceData;
+    int fd = statePtr->fds.fd, mask = TCL_WRITABLE | TCL_EXCEPTION;
 
+    if (statePtr->resolvePtr != NULL) {
+	/*
+	 * The handler is on the pipe of the resolver while the remote host is
+	 * being looked up.
+	 */
+
+	fd = statePtr->resolvePtr->fds[0];
+	mask = TCL_READABLE;
+    }
     if (GOT_BITS(statePtr->flags, TCP_ASYNC_CONNECT)) {
 	/*
 	 * Async-connecting socket must get reassigned handler if it have been
@@ -987,11 +1127,10 @@ TcpThreadActionProc(
 	switch (action) {
 	  case TCL_CHANNEL_THREAD_REMOVE:
 	    CLEAR_BITS(statePtr->flags, TCP_ASYNC_PENDING);
-	    Tcl_DeleteFileHandler(statePtr->fds.fd);
+	    Tcl_DeleteFileHandler(fd);
 	  break;
 	  case TCL_CHANNEL_THREAD_INSERT:
-	    Tcl_CreateFileHandler(statePtr->fds.fd,
-		TCL_WRITABLE | TCL_EXCEPTION, TcpAsyncCallback, statePtr);
+	    Tcl_CreateFileHandler(fd, mask, TcpAsyncCallback, statePtr);
 	    SET_BITS(statePtr->flags, TCP_ASYNC_PENDING);
 	  break;
 	}
@@ -1070,6 +1209,13 @@ TcpWatchProc(
 	 */
 
 	statePtr->filehandlers = mask;
+    } else if (statePtr->fds.fd < 0) {
+	/*
+	 * The lookup of the remote host failed, so there never was a socket
+	 * to watch.
+	 */
+
+	return;
     } else if (mask) {
 
 	/*
@@ -1137,7 +1283,8 @@ TcpGetHandleProc(
  *
  *	Called by the event handler that TcpConnect sets up internally for
  *	[socket -async] to get notified when the asynchronous connection
- *	attempt has succeeded or failed.
+ *	attempt has succeeded or failed, or when the remote host has been
+ *	looked up.
  *
  * ----------------------------------------------------------------------
  */
@@ -1196,7 +1343,18 @@ TcpConnect(
     static const int reuseaddr = 1;
 
     if (async_callback) {
-	goto reenter;
+	if (statePtr->resolvePtr == NULL) {
+	    goto reenter;
+	}
+
+	/*
+	 * The resolver has looked up the remote host, start connecting.
+	 */
+
+	CLEAR_BITS(statePtr->flags, TCP_ASYNC_PENDING);
+	if (!TcpResolveFinish(statePtr, &error)) {
+	    goto out;
+	}
     }
 
     for (statePtr->addr = statePtr->addrlist; statePtr->addr != NULL;
@@ -1319,7 +1477,9 @@ TcpConnect(
 	 */
 
 	TcpWatchProc(statePtr, statePtr->filehandlers);
-	TclUnixSetBlockingMode(statePtr->fds.fd, statePtr->cachedBlocking);
+	if (statePtr->fds.fd >= 0) {
+	    TclUnixSetBlockingMode(statePtr->fds.fd, statePtr->cachedBlocking);
+	}
 
 	if (error != 0) {
 	    SET_BITS(statePtr->flags, TCP_ASYNC_FAILED);
@@ -1355,6 +1515,667 @@ TcpConnect(
     return TCL_OK;
 }
 
+/*
+ * ----------------------------------------------------------------------
+ *
+ * IsNumericHost --
+ *
+ *	Checks whether a host is given as an IPv4 or IPv6 address, which
+ *	getaddrinfo() converts without asking a name server.
+ *
+ * Results:
+ *	1 if the host is a numeric address, 0 otherwise.
+ *
+ * Side effects:
+ *	None.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+static int
+IsNumericHost(
+    const char *host)
+{
+    struct in6_addr addr;
+
+    return inet_pton(AF_INET, host, &addr) == 1
+	    || inet_pton(AF_INET6, host, &addr) == 1;
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * CopyAddrList --
+ *
+ *	Copies a list of addresses returned by getaddrinfo() into a single
+ *	block of memory.
+ *
+ * Results:
+ *	The copy, to be freed with ckfree(), or NULL if the list is empty.
+ *
+ * Side effects:
+ *	Allocates memory.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+#define ADDR_SIZE(ai) \
+    ((sizeof(struct addrinfo) + (ai)->ai_addrlen + 7) & ~(size_t)7)
+
+static struct addrinfo *
+CopyAddrList(
+    const struct addrinfo *addrlist)
+{
+    const struct addrinfo *ai;
+    struct addrinfo *copy, *prev = NULL;
+    char *buf;
+    size_t size = 0;
+
+    for (ai = addrlist; ai != NULL; ai = ai->ai_next) {
+	size += ADDR_SIZE(ai);
+    }
+    if (size == 0) {
+	return NULL;
+    }
+    buf = (char *)ckalloc(size);
+    for (ai = addrlist; ai != NULL; ai = ai->ai_next) {
+	copy = (struct addrinfo *) buf;
+	*copy = *ai;
+	copy->ai_canonname = NULL;
+	copy->ai_next = NULL;
+	copy->ai_addr = (struct sockaddr *) (copy + 1);
+	memcpy(copy->ai_addr, ai->ai_addr, ai->ai_addrlen);
+	if (prev != NULL) {
+	    prev->ai_next = copy;
+	}
+	prev = copy;
+	buf += ADDR_SIZE(ai);
+    }
+    return (struct addrinfo *) (buf - size);
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * CacheLookup, CacheStore --
+ *
+ *	Look up a host in, or add it to, the cache of recently resolved
+ *	remote hosts. Expired entries are removed on the way.
+ *
+ * Results:
+ *	CacheLookup returns a copy of the cached addresses, to be freed with
+ *	ckfree(), or NULL if the host isn't cached. CacheStore returns
+ *	nothing.
+ *
+ * Side effects:
+ *	Modifies the cache.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+static void
+CacheKey(
+    Tcl_DString *keyPtr,	/* Initialized by this function. */
+    const char *host,
+    int port,
+    int family)
+{
+    char buf[2 * TCL_INTEGER_SPACE + 2];
+
+    snprintf(buf, sizeof(buf), "%d %d ", family, port);
+    Tcl_DStringInit(keyPtr);
+    Tcl_DStringAppend(keyPtr, buf, -1);
+    Tcl_DStringAppend(keyPtr, host, -1);
+}
+
+static struct addrinfo *
+CacheLookup(
+    const char *host,
+    int port,
+    int family)
+{
+    Tcl_DString key;
+    Tcl_HashEntry *hPtr;
+    CachedAddr *cachePtr;
+    struct addrinfo *addrlist = NULL;
+    Tcl_Time now;
+
+    Tcl_MutexLock(&resolveCacheMutex);
+    if (resolveCacheInitialized) {
+	CacheKey(&key, host, port, family);
+	hPtr = Tcl_FindHashEntry(&resolveCache, Tcl_DStringValue(&key));
+	Tcl_DStringFree(&key);
+	if (hPtr != NULL) {
+	    cachePtr = (CachedAddr *)Tcl_GetHashValue(hPtr);
+	    Tcl_GetTime(&now);
+	    if (now.sec < cachePtr->expires) {
+		addrlist = CopyAddrList(cachePtr->addrlist);
+	    } else {
+		ckfree(cachePtr->addrlist);
+		ckfree(cachePtr);
+		Tcl_DeleteHashEntry(hPtr);
+	    }
+	}
+    }
+    Tcl_MutexUnlock(&resolveCacheMutex);
+    return addrlist;
+}
+
+static void
+CacheStore(
+    const char *host,
+    int port,
+    int family,
+    const struct addrinfo *addrlist)
+{
+    Tcl_DString key;
+    Tcl_HashEntry *hPtr;
+    Tcl_HashSearch search;
+    CachedAddr *cachePtr;
+    Tcl_Time now;
+    int isNew;
+
+    if (addrlist == NULL) {
+	return;
+    }
+    Tcl_GetTime(&now);
+    Tcl_MutexLock(&resolveCacheMutex);
+    if (resolveCacheTtl == 0) {
+	Tcl_MutexUnlock(&resolveCacheMutex);
+	return;
+    }
+    if (!resolveCacheInitialized) {
+	Tcl_InitHashTable(&resolveCache, TCL_STRING_KEYS);
+	Tcl_CreateExitHandler(CacheFinalize, NULL);
+	resolveCacheInitialized = 1;
+    }
+
+    /*
+     * When the cache is full, throw out the expired entries, or an arbitrary
+     * one if there are none.
+     */
+
+    if (resolveCache.numEntries >= RESOLVE_CACHE_SIZE) {
+	for (hPtr = Tcl_FirstHashEntry(&resolveCache, &search);
+		hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+	    cachePtr = (CachedAddr *)Tcl_GetHashValue(hPtr);
+	    if (now.sec >= cachePtr->expires) {
+		ckfree(cachePtr->addrlist);
+		ckfree(cachePtr);
+		Tcl_DeleteHashEntry(hPtr);
+	    }
+	}
+	if (resolveCache.numEntries >= RESOLVE_CACHE_SIZE) {
+	    hPtr = Tcl_FirstHashEntry(&resolveCache, &search);
+	    cachePtr = (CachedAddr *)Tcl_GetHashValue(hPtr);
+	    ckfree(cachePtr->addrlist);
+	    ckfree(cachePtr);
+	    Tcl_DeleteHashEntry(hPtr);
+	}
+    }
+
+    CacheKey(&key, host, port, family);
+    hPtr = Tcl_CreateHashEntry(&resolveCache, Tcl_DStringValue(&key), &isNew);
+    Tcl_DStringFree(&key);
+    if (isNew) {
+	cachePtr = (CachedAddr *)ckalloc(sizeof(CachedAddr));
+	Tcl_SetHashValue(hPtr, cachePtr);
+    } else {
+	cachePtr = (CachedAddr *)Tcl_GetHashValue(hPtr);
+	ckfree(cachePtr->addrlist);
+    }
+    cachePtr->addrlist = CopyAddrList(addrlist);
+    cachePtr->expires = now.sec + resolveCacheTtl;
+    Tcl_MutexUnlock(&resolveCacheMutex);
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * CacheFlush, CacheFinalize --
+ *
+ *	CacheFlush empties the cache of resolved hosts; the caller holds
+ *	resolveCacheMutex. CacheFinalize also deletes it upon exit from Tcl.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Frees allocated memory.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+static void
+CacheFlush(void)
+{
+    Tcl_HashEntry *hPtr;
+    Tcl_HashSearch search;
+    CachedAddr *cachePtr;
+
+    if (!resolveCacheInitialized) {
+	return;
+    }
+    for (hPtr = Tcl_FirstHashEntry(&resolveCache, &search); hPtr != NULL;
+	    hPtr = Tcl_NextHashEntry(&search)) {
+	cachePtr = (CachedAddr *)Tcl_GetHashValue(hPtr);
+	ckfree(cachePtr->addrlist);
+	ckfree(cachePtr);
+	Tcl_DeleteHashEntry(hPtr);
+    }
+}
+
+static void
+CacheFinalize(
+    void *dummy)
+{
+    (void)dummy;
+
+    Tcl_MutexLock(&resolveCacheMutex);
+    CacheFlush();
+    Tcl_DeleteHashTable(&resolveCache);
+    resolveCacheInitialized = 0;
+    resolveCacheTtl = RESOLVE_CACHE_TTL;
+    Tcl_MutexUnlock(&resolveCacheMutex);
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * TclResolveCacheObjCmd --
+ *
+ *	Implements the [::tcl::unsupported::resolvecache] command:
+ *	    resolvecache flush
+ *		Forgets all cached host names.
+ *	    resolvecache info
+ *		Returns a dictionary with the TTL and the number of entries.
+ *	    resolvecache ttl ?seconds?
+ *		Returns the number of seconds host names are reused, after
+ *		setting it if given. 0 turns the cache off.
+ *	The cache is process wide, and so are its settings.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	See above.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+int
+TclResolveCacheObjCmd(
+    void *dummy,
+    Tcl_Interp *interp,
+    int objc,
+    Tcl_Obj *const objv[])
+{
+    static const char *const options[] = {"flush", "info", "ttl", NULL};
+    enum options {RESOLVE_FLUSH, RESOLVE_INFO, RESOLVE_TTL};
+    Tcl_Obj *resultObj;
+    int index, ttl;
+    (void)dummy;
+
+    if (objc < 2) {
+	Tcl_WrongNumArgs(interp, 1, objv, "option ?arg?");
+	return TCL_ERROR;
+    }
+    if (Tcl_GetIndexFromObj(interp, objv[1], options, "option", 0,
+	    &index) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    if ((enum options) index != RESOLVE_TTL && objc != 2) {
+	Tcl_WrongNumArgs(interp, 2, objv, NULL);
+	return TCL_ERROR;
+    }
+
+    switch ((enum options) index) {
+    case RESOLVE_FLUSH:
+	Tcl_MutexLock(&resolveCacheMutex);
+	CacheFlush();
+	Tcl_MutexUnlock(&resolveCacheMutex);
+	break;
+    case RESOLVE_INFO:
+	TclNewObj(resultObj);
+	Tcl_MutexLock(&resolveCacheMutex);
+	TclDictPut(NULL, resultObj, "ttl", Tcl_NewIntObj(resolveCacheTtl));
+	TclDictPut(NULL, resultObj, "entries", Tcl_NewIntObj(
+		resolveCacheInitialized ? resolveCache.numEntries : 0));
+	Tcl_MutexUnlock(&resolveCacheMutex);
+	Tcl_SetObjResult(interp, resultObj);
+	break;
+    case RESOLVE_TTL:
+	if (objc > 3) {
+	    Tcl_WrongNumArgs(interp, 2, objv, "?seconds?");
+	    return TCL_ERROR;
+	}
+	if (objc == 3) {
+	    if (TclGetIntFromObj(interp, objv[2], &ttl) != TCL_OK) {
+		return TCL_ERROR;
+	    }
+	    if (ttl < 0) {
+		Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+			"bad TTL \"%s\": must be non-negative",
+			TclGetString(objv[2])));
+		Tcl_SetErrorCode(interp, "TCL", "VALUE", "TTL", NULL);
+		return TCL_ERROR;
+	    }
+	}
+	Tcl_MutexLock(&resolveCacheMutex);
+	if (objc == 3) {
+	    CacheFlush();
+	    resolveCacheTtl = ttl;
+	}
+	ttl = resolveCacheTtl;
+	Tcl_MutexUnlock(&resolveCacheMutex);
+	Tcl_SetObjResult(interp, Tcl_NewIntObj(ttl));
+	break;
+    }
+    return TCL_OK;
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * ResolverThread --
+ *
+ *	The body of a resolver thread. It does the queued lookups one after
+ *	the other and exits when the queue is empty.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Calls getaddrinfo(), which may take a long time, and wakes up the
+ *	owners of the lookups through their pipes.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+#ifdef TCL_THREADS
+static void *
+ResolverThread(
+    void *dummy)
+{
+    TcpResolve *resolvePtr;
+    struct addrinfo hints;
+    char port[TCL_INTEGER_SPACE];
+    (void)dummy;
+
+    pthread_mutex_lock(&resolveMutex);
+    while ((resolvePtr = resolveHead) != NULL) {
+	resolveHead = resolvePtr->nextPtr;
+	if (resolveHead == NULL) {
+	    resolveTail = NULL;
+	}
+	if (!resolvePtr->cancelled) {
+	    pthread_mutex_unlock(&resolveMutex);
+	    memset(&hints, 0, sizeof(hints));
+	    hints.ai_family = resolvePtr->family;
+	    hints.ai_socktype = SOCK_STREAM;
+
+	    /*
+	     * Same workaround for port 0 as in TclCreateSocketAddress.
+	     */
+
+	    snprintf(port, sizeof(port), "%d", resolvePtr->port);
+	    resolvePtr->result = getaddrinfo(resolvePtr->host,
+		    resolvePtr->port ? port : NULL, &hints,
+		    &resolvePtr->addrlist);
+	    resolvePtr->sysError = errno;
+	    pthread_mutex_lock(&resolveMutex);
+
+	    /*
+	     * The owner closes its end of the pipe when cancelling, so the
+	     * write must be skipped then to not raise SIGPIPE.
+	     */
+
+	    if (!resolvePtr->cancelled) {
+		(void) write(resolvePtr->fds[1], "", 1);
+	    }
+	}
+	close(resolvePtr->fds[1]);
+	ResolveRelease(resolvePtr);
+    }
+    resolveThreads--;
+    pthread_mutex_unlock(&resolveMutex);
+    return NULL;
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * ResolveRelease --
+ *
+ *	Drops a reference to a lookup. Must be called with resolveMutex held.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Frees the lookup when it was the last reference.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+static void
+ResolveRelease(
+    TcpResolve *resolvePtr)
+{
+    if (--resolvePtr->refCount > 0) {
+	return;
+    }
+    if (resolvePtr->addrlist != NULL) {
+	freeaddrinfo(resolvePtr->addrlist);
+    }
+    free(resolvePtr->host);
+    free(resolvePtr->name);
+    free(resolvePtr);
+}
+#endif /* TCL_THREADS */
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * TcpResolveStart --
+ *
+ *	Queues the lookup of the remote host of an async socket for a
+ *	resolver thread, starting one if needed.
+ *
+ * Results:
+ *	The lookup, or NULL if it can't be done in the background, e.g. in a
+ *	build without threads. The caller must then look up the host itself.
+ *
+ * Side effects:
+ *	Creates a pipe and may start a thread.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+static TcpResolve *
+TcpResolveStart(
+    const char *host,
+    int port,
+    int family)
+{
+#ifdef TCL_THREADS
+    TcpResolve *resolvePtr;
+    pthread_t thread;
+    pthread_attr_t attr;
+    Tcl_DString ds;
+    const char *native;
+    size_t len;
+
+    resolvePtr = (TcpResolve *)malloc(sizeof(TcpResolve));
+    if (resolvePtr == NULL) {
+	return NULL;
+    }
+    memset(resolvePtr, 0, sizeof(TcpResolve));
+    if (pipe(resolvePtr->fds) < 0) {
+	free(resolvePtr);
+	return NULL;
+    }
+    fcntl(resolvePtr->fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(resolvePtr->fds[1], F_SETFD, FD_CLOEXEC);
+
+    native = Tcl_UtfToExternalDString(NULL, host, -1, &ds);
+    len = Tcl_DStringLength(&ds);
+    resolvePtr->host = (char *)malloc(len + 1);
+    if (resolvePtr->host != NULL) {
+	memcpy(resolvePtr->host, native, len + 1);
+    }
+    Tcl_DStringFree(&ds);
+    len = strlen(host);
+    resolvePtr->name = (char *)malloc(len + 1);
+    if (resolvePtr->name != NULL) {
+	memcpy(resolvePtr->name, host, len + 1);
+    }
+    resolvePtr->port = port;
+    resolvePtr->family = family;
+    resolvePtr->refCount = 2;
+
+    pthread_mutex_lock(&resolveMutex);
+    if (resolvePtr->host != NULL && resolvePtr->name != NULL
+	    && resolveThreads < RESOLVE_THREADS) {
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	if (pthread_create(&thread, &attr, ResolverThread, NULL) == 0) {
+	    resolveThreads++;
+	}
+	pthread_attr_destroy(&attr);
+    }
+    if (resolvePtr->host == NULL || resolvePtr->name == NULL
+	    || resolveThreads == 0) {
+	pthread_mutex_unlock(&resolveMutex);
+	close(resolvePtr->fds[0]);
+	close(resolvePtr->fds[1]);
+	free(resolvePtr->host);
+	free(resolvePtr->name);
+	free(resolvePtr);
+	return NULL;
+    }
+    if (resolveTail == NULL) {
+	resolveHead = resolvePtr;
+    } else {
+	resolveTail->nextPtr = resolvePtr;
+    }
+    resolveTail = resolvePtr;
+    pthread_mutex_unlock(&resolveMutex);
+    return resolvePtr;
+#else
+    (void)host;
+    (void)port;
+    (void)family;
+
+    return NULL;
+#endif /* TCL_THREADS */
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * TcpResolveFinish, TcpResolveCancel --
+ *
+ *	Release the background lookup of the remote host of an async socket.
+ *	TcpResolveFinish is called once the resolver is done and takes over
+ *	the addresses it found. TcpResolveCancel is called when the socket is
+ *	closed before that.
+ *
+ * Results:
+ *	TcpResolveFinish returns 1 if addresses were found, 0 otherwise, in
+ *	which case an error code is left in *errorPtr and an error message in
+ *	statePtr->resolveError. TcpResolveCancel returns nothing.
+ *
+ * Side effects:
+ *	Sets statePtr->addrlist and adds the host to the cache, or gives the
+ *	socket an unconnected descriptor if the lookup failed.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+static int
+TcpResolveFinish(
+    TcpState *statePtr,
+    int *errorPtr)
+{
+#ifdef TCL_THREADS
+    TcpResolve *resolvePtr = statePtr->resolvePtr;
+    int result;
+
+    statePtr->resolvePtr = NULL;
+    Tcl_DeleteFileHandler(resolvePtr->fds[0]);
+    close(resolvePtr->fds[0]);
+
+    pthread_mutex_lock(&resolveMutex);
+    result = resolvePtr->result;
+    if (result == 0) {
+	statePtr->addrlist = CopyAddrList(resolvePtr->addrlist);
+	SET_BITS(statePtr->flags, TCP_ADDRLIST_COPY);
+    }
+#ifdef EAI_SYSTEM
+    if (result == EAI_SYSTEM && resolvePtr->sysError != 0) {
+	*errorPtr = resolvePtr->sysError;
+    } else
+#endif /* EAI_SYSTEM */
+    if (result != 0) {
+	statePtr->resolveError = gai_strerror(result);
+    }
+    pthread_mutex_unlock(&resolveMutex);
+
+    /*
+     * Only the owner touches the name and the port of the lookup, so there
+     * is no need to hold the resolver mutex while updating the cache.
+     */
+
+    if (result == 0) {
+	CacheStore(resolvePtr->name, resolvePtr->port, resolvePtr->family,
+		statePtr->addrlist);
+    }
+    pthread_mutex_lock(&resolveMutex);
+    ResolveRelease(resolvePtr);
+    pthread_mutex_unlock(&resolveMutex);
+    if (result == 0) {
+	return 1;
+    }
+
+    /*
+     * Give the socket a descriptor that was never connected, so that it
+     * behaves like one whose connection attempts failed, e.g. it becomes
+     * readable and writable for the benefit of [fileevent] scripts.
+     */
+
+    statePtr->fds.fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (statePtr->fds.fd >= 0) {
+	fcntl(statePtr->fds.fd, F_SETFD, FD_CLOEXEC);
+    }
+    return 0;
+#else
+    (void)statePtr;
+    (void)errorPtr;
+
+    return 0;
+#endif /* TCL_THREADS */
+}
+
+static void
+TcpResolveCancel(
+    TcpState *statePtr)
+{
+#ifdef TCL_THREADS
+    TcpResolve *resolvePtr = statePtr->resolvePtr;
+
+    statePtr->resolvePtr = NULL;
+    Tcl_DeleteFileHandler(resolvePtr->fds[0]);
+    pthread_mutex_lock(&resolveMutex);
+    resolvePtr->cancelled = 1;
+    close(resolvePtr->fds[0]);
+    ResolveRelease(resolvePtr);
+    pthread_mutex_unlock(&resolveMutex);
+#else
+    (void)statePtr;
+#endif /* TCL_THREADS */
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -1387,22 +2208,39 @@ Tcl_OpenTcpClient(
     const char *errorMsg = NULL;
     struct addrinfo *addrlist = NULL, *myaddrlist = NULL;
     char channelName[SOCK_CHAN_LENGTH];
+    int family = TclGetSocketFamily(interp);
+    int lookup = (host != NULL && !IsNumericHost(host));
+    int flags = async ? TCP_ASYNC_CONNECT : 0;
+    TcpResolve *resolvePtr = NULL;
 
     /*
-     * Do the name lookups for the local and remote addresses.
+     * Do the name lookups for the local and remote addresses. A remote host
+     * that was looked up recently is taken from the cache. Otherwise, that
+     * of an async socket is looked up by a resolver thread, so that a slow
+     * name server does not block the caller.
      */
 
-    if (!TclCreateSocketAddress(interp, &addrlist, host, port, 0, &errorMsg)
-	    || !TclCreateSocketAddress(interp, &myaddrlist, myaddr, myport, 1,
-		    &errorMsg)) {
+    if (!TclCreateSocketAddress(interp, &myaddrlist, myaddr, myport, 1,
+	    &errorMsg)) {
+	goto error;
+    }
+    if (lookup) {
+	addrlist = CacheLookup(host, port, family);
 	if (addrlist != NULL) {
-	    freeaddrinfo(addrlist);
+	    SET_BITS(flags, TCP_ADDRLIST_COPY);
+	} else if (async) {
+	    resolvePtr = TcpResolveStart(host, port, family);
 	}
-	if (interp != NULL) {
-	    Tcl_SetObjResult(interp, Tcl_ObjPrintf(
-		    "couldn't open socket: %s", errorMsg));
+    }
+    if (addrlist == NULL && resolvePtr == NULL) {
+	if (!TclCreateSocketAddress(interp, &addrlist, host, port, 0,
+		&errorMsg)) {
+	    freeaddrinfo(myaddrlist);
+	    goto error;
+	}
+	if (lookup) {
+	    CacheStore(host, port, family, addrlist);
 	}
-	return NULL;
     }
 
     /*
@@ -1411,17 +2249,24 @@ Tcl_OpenTcpClient(
 
     statePtr = (TcpState *)ckalloc(sizeof(TcpState));
     memset(statePtr, 0, sizeof(TcpState));
-    statePtr->flags = async ? TCP_ASYNC_CONNECT : 0;
+    statePtr->flags = flags;
     statePtr->cachedBlocking = TCL_MODE_BLOCKING;
     statePtr->addrlist = addrlist;
     statePtr->myaddrlist = myaddrlist;
     statePtr->fds.fd = -1;
 
     /*
-     * Create a new client socket and wrap it in a channel.
+     * Create a new client socket and wrap it in a channel. When the remote
+     * host is still being looked up, TcpAsyncCallback calls TcpConnect once
+     * the resolver is done.
      */
 
-    if (TcpConnect(interp, statePtr) != TCL_OK) {
+    if (resolvePtr != NULL) {
+	statePtr->resolvePtr = resolvePtr;
+	Tcl_CreateFileHandler(resolvePtr->fds[0], TCL_READABLE,
+		TcpAsyncCallback, statePtr);
+	SET_BITS(statePtr->flags, TCP_ASYNC_PENDING);
+    } else if (TcpConnect(interp, statePtr) != TCL_OK) {
 	TcpCloseProc(statePtr, NULL);
 	return NULL;
     }
@@ -1436,6 +2281,13 @@ Tcl_OpenTcpClient(
 	return NULL;
     }
     return statePtr->channel;
+
+  error:
+    if (interp != NULL) {
+	Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+		"couldn't open socket: %s", errorMsg));
+    }
+    return NULL;
 }
 
 /*
@@ -1508,9 +2360,12 @@ TclpMakeTcpClientChannelMode(
 /*
  *----------------------------------------------------------------------
  *
- * Tcl_OpenTcpServer --
+ * Tcl_OpenTcpServer, TclOpenTcpServerEx --
  *
  *	Opens a TCP server socket and creates a channel around it.
+ *	TclOpenTcpServerEx takes flags: with TCL_TCPSERVER_REUSEPORT, any
+ *	number of server sockets, in any threads or processes, can listen on
+ *	the same port, and the kernel distributes the connections among them.
  *
  * Results:
  *	The channel or NULL if failed. If an error occurred, an error message
@@ -1531,6 +2386,21 @@ Tcl_OpenTcpServer(
 				/* Callback for accepting connections from new
 				 * clients. */
     void *acceptProcData)	/* Data for the callback. */
+{
+    return TclOpenTcpServerEx(interp, port, myHost, 0, acceptProc,
+	    acceptProcData);
+}
+
+Tcl_Channel
+TclOpenTcpServerEx(
+    Tcl_Interp *interp,		/* For error reporting - may be NULL. */
+    int port,			/* Port number to open. */
+    const char *myHost,		/* Name of local host. */
+    unsigned int flags,		/* Flags, TCL_TCPSERVER_REUSEPORT. */
+    Tcl_TcpAcceptProc *acceptProc,
+				/* Callback for accepting connections from new
+				 * clients. */
+    void *acceptProcData)	/* Data for the callback. */
 {
     int status = 0, sock = -1, reuseaddr = 1, chosenport = 0;
     struct addrinfo *addrlist = NULL, *addrPtr;	/* socket address */
@@ -1547,6 +2417,13 @@ Tcl_OpenTcpServer(
     enum { LOOKUP, SOCKET, BIND, LISTEN } howfar = LOOKUP;
     int my_errno = 0;
 
+#ifndef SO_REUSEPORT
+    if (flags & TCL_TCPSERVER_REUSEPORT) {
+	errorMsg = "SO_REUSEPORT isn't supported by this platform";
+	goto error;
+    }
+#endif
+
     if (!TclCreateSocketAddress(interp, &addrlist, myHost, port, 1, &errorMsg)) {
 	my_errno = errno;
 	goto error;
@@ -1582,6 +2459,14 @@ Tcl_OpenTcpServer(
 
 	(void) setsockopt(sock, SOL_SOCKET, SO_REUSEADDR,
 		(char *) &reuseaddr, sizeof(reuseaddr));
+#ifdef SO_REUSEPORT
+	if (flags & TCL_TCPSERVER_REUSEPORT) {
+	    int reuseport = 1;
+
+	    (void) setsockopt(sock, SOL_SOCKET, SO_REUSEPORT,
+		    (char *) &reuseport, sizeof(reuseport));
+	}
+#endif
 
 	/*
 	 * Make sure we use the same port number when opening two server
@@ -1642,6 +2527,7 @@ Tcl_OpenTcpServer(
 	    sock = -1;
 	    continue;
 	}
+	TclUnixSetBlockingMode(sock, TCL_MODE_NONBLOCKING);
 	if (statePtr == NULL) {
 	    /*
 	     * Allocate a new TcpState for this socket.
@@ -1649,6 +2535,7 @@ Tcl_OpenTcpServer(
 
 	    statePtr = (TcpState *)ckalloc(sizeof(TcpState));
 	    memset(statePtr, 0, sizeof(TcpState));
+	    statePtr->flags = TCP_SERVER;
 	    statePtr->acceptProc = acceptProc;
 	    statePtr->acceptProcData = acceptProcData;
 	    snprintf(channelName, sizeof(channelName), SOCK_TEMPLATE, (long)statePtr);
@@ -1700,14 +2587,16 @@ Tcl_OpenTcpServer(
  *----------------------------------------------------------------------
  *
  * TcpAccept --
- *	Accept a TCP socket connection.	 This is called by the event loop.
+ *	Accept TCP socket connections. This is called by the event loop when
+ *	a server socket is readable, and accepts the connections pending on
+ *	it, up to ACCEPT_BATCH of them.
  *
  * Results:
  *	None.
  *
  * Side effects:
- *	Creates a new connection socket. Calls the registered callback for the
- *	connection acceptance mechanism.
+ *	Creates new connection sockets. Calls the registered callback for the
+ *	connection acceptance mechanism, which may close the server socket.
  *
  *----------------------------------------------------------------------
  */
@@ -1718,47 +2607,76 @@ TcpAccept(
     int mask)			/* Not used. */
 {
     TcpFdList *fds = (TcpFdList *)data;	/* Client data of server socket. */
+    TcpState *statePtr = fds->statePtr;
+    int fd = fds->fd;		/* The fds may be freed by the callback. */
     int newsock;		/* The new client socket */
     TcpState *newSockState;	/* State for new socket. */
     address addr;		/* The remote address */
     socklen_t len;		/* For accept interface */
     char channelName[SOCK_CHAN_LENGTH];
     char host[NI_MAXHOST], port[NI_MAXSERV];
+    int count;
     (void)mask;
 
-    len = sizeof(addr);
-    newsock = accept(fds->fd, &addr.sa, &len);
-    if (newsock < 0) {
-	return;
-    }
+    Tcl_Preserve(statePtr);
+    for (count = 0; count < ACCEPT_BATCH; count++) {
+	len = sizeof(addr);
+	newsock = accept(fd, &addr.sa, &len);
+	if (newsock < 0) {
+	    if (errno == EINTR) {
+		continue;
+	    }
+	    break;
+	}
 
-    /*
-     * Set close-on-exec flag to prevent the newly accepted socket from being
-     * inherited by child processes.
-     */
+	/*
+	 * Set close-on-exec flag to prevent the newly accepted socket from
+	 * being inherited by child processes.
+	 */
 
-    (void) fcntl(newsock, F_SETFD, FD_CLOEXEC);
+	(void) fcntl(newsock, F_SETFD, FD_CLOEXEC);
 
-    newSockState = (TcpState *)ckalloc(sizeof(TcpState));
-    memset(newSockState, 0, sizeof(TcpState));
-    newSockState->flags = 0;
-    newSockState->fds.fd = newsock;
+#ifndef __linux__
+	/*
+	 * BSD derived systems give the new socket the nonblocking mode of the
+	 * server socket, Linux does not.
+	 */
 
-    snprintf(channelName, sizeof(channelName), SOCK_TEMPLATE, (long)newSockState);
-    newSockState->channel = Tcl_CreateChannel(&tcpChannelType, channelName,
-	    newSockState, TCL_READABLE | TCL_WRITABLE);
+	TclUnixSetBlockingMode(newsock, TCL_MODE_BLOCKING);
+#endif
 
-    Tcl_SetChannelOption(NULL, newSockState->channel, "-translation",
-	    "auto crlf");
+	newSockState = (TcpState *)ckalloc(sizeof(TcpState));
+	memset(newSockState, 0, sizeof(TcpState));
+	newSockState->flags = 0;
+	newSockState->fds.fd = newsock;
 
-    if (fds->statePtr->acceptProc != NULL) {
-	getnameinfo(&addr.sa, len, host, sizeof(host), port, sizeof(port),
-		NI_NUMERICHOST|NI_NUMERICSERV);
-	fds->statePtr->acceptProc(fds->statePtr->acceptProcData,
-		newSockState->channel, host, atoi(port));
+	snprintf(channelName, sizeof(channelName), SOCK_TEMPLATE,
+		(long)newSockState);
+	newSockState->channel = Tcl_CreateChannel(&tcpChannelType,
+		channelName, newSockState, TCL_READABLE | TCL_WRITABLE);
+
+	Tcl_SetChannelOption(NULL, newSockState->channel, "-translation",
+		"auto crlf");
+
+	if (statePtr->acceptProc != NULL) {
+	    getnameinfo(&addr.sa, len, host, sizeof(host), port,
+		    sizeof(port), NI_NUMERICHOST|NI_NUMERICSERV);
+	    statePtr->acceptProc(statePtr->acceptProcData,
+		    newSockState->channel, host, atoi(port));
+	}
+
+	if (statePtr->fds.fd < 0) {
+	    /*
+	     * The callback closed the server socket. Connections still
+	     * pending are reset by the kernel.
+	     */
+
+	    break;
+	}
     }
+    Tcl_Release(statePtr);
 }
-
+
 /*
  * Local Variables:
  * mode: c
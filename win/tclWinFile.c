@@ -2012,6 +2012,140 @@ TclpObjStat(
     return NativeStat((const WCHAR *)Tcl_FSGetNativePath(pathPtr), statPtr, 0);
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclpMapFile --
+ *
+ *	Maps part of a file into memory, read-only as far as the file is
+ *	concerned: the view is mapped copy-on-write, so writes to it stay
+ *	private to the process. A negative length maps up to the end of the
+ *	file; the window is clipped to the end of the file in any case.
+ *
+ * Results:
+ *	0 on success, with the address and length of the mapped bytes and a
+ *	value to pass to TclpUnmapFile stored through the pointer arguments.
+ *	The length may be 0, in which case nothing is mapped. -1 on failure,
+ *	with errno set.
+ *
+ * Side effects:
+ *	Adds a view of the file to the process's address space.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TclpMapFile(
+    Tcl_Obj *pathPtr,		/* Path of file to map. */
+    Tcl_WideInt offset,		/* Where in the file to start. */
+    Tcl_WideInt length,		/* How many bytes to map, or -1 for all. */
+    unsigned char **bytesPtr,	/* Where to store the first mapped byte. */
+    int *lengthPtr,		/* Where to store the number of bytes. */
+    ClientData *clientDataPtr)	/* Where to store the value to pass to
+				 * TclpUnmapFile. */
+{
+    const WCHAR *nativePath = (const WCHAR *)Tcl_FSGetNativePath(pathPtr);
+    HANDLE fileHandle, mapHandle;
+    LARGE_INTEGER fileSize;
+    SYSTEM_INFO sysInfo;
+    Tcl_WideInt size, delta, start;
+    char *addr;
+
+    if (nativePath == NULL) {
+	return -1;
+    }
+    TclWinFlushDirtyChannels();
+    fileHandle = CreateFileW(nativePath, GENERIC_READ,
+	    FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+	    OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (fileHandle == INVALID_HANDLE_VALUE) {
+	TclWinConvertError(GetLastError());
+	return -1;
+    }
+    if (!GetFileSizeEx(fileHandle, &fileSize)) {
+	TclWinConvertError(GetLastError());
+	CloseHandle(fileHandle);
+	return -1;
+    }
+
+    size = fileSize.QuadPart - offset;
+    if (size < 0) {
+	size = 0;
+    }
+    if (length >= 0 && length < size) {
+	size = length;
+    }
+    if (size > INT_MAX) {
+	CloseHandle(fileHandle);
+	errno = EFBIG;
+	return -1;
+    }
+    if (size == 0) {
+	CloseHandle(fileHandle);
+	*bytesPtr = NULL;
+	*lengthPtr = 0;
+	*clientDataPtr = NULL;
+	return 0;
+    }
+
+    /*
+     * Views must start on an allocation granularity boundary; map from there
+     * and remember how far into the view the caller's bytes begin. The view
+     * stays valid after both handles are closed.
+     */
+
+    mapHandle = CreateFileMappingW(fileHandle, NULL, PAGE_WRITECOPY, 0, 0,
+	    NULL);
+    if (mapHandle == NULL) {
+	TclWinConvertError(GetLastError());
+	CloseHandle(fileHandle);
+	return -1;
+    }
+    GetSystemInfo(&sysInfo);
+    delta = offset % sysInfo.dwAllocationGranularity;
+    start = offset - delta;
+    addr = MapViewOfFile(mapHandle, FILE_MAP_COPY, (DWORD) (start >> 32),
+	    (DWORD) start, (SIZE_T) (size + delta));
+    if (addr == NULL) {
+	TclWinConvertError(GetLastError());
+    }
+    CloseHandle(mapHandle);
+    CloseHandle(fileHandle);
+    if (addr == NULL) {
+	return -1;
+    }
+
+    *bytesPtr = (unsigned char *) addr + delta;
+    *lengthPtr = (int) size;
+    *clientDataPtr = INT2PTR(delta);
+    return 0;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TclpUnmapFile --
+ *
+ *	Releases a view made by TclpMapFile.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Removes the view from the process's address space.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TclpUnmapFile(
+    ClientData clientData,	/* As returned by TclpMapFile. */
+    unsigned char *bytes,	/* The first mapped byte. */
+    int length)			/* The number of mapped bytes (unused). */
+{
+    UnmapViewOfFile(bytes - PTR2INT(clientData));
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -2140,9 +2140,12 @@ Tcl_MakeTcpClientChannel(
 /*
  *----------------------------------------------------------------------
  *
- * Tcl_OpenTcpServer --
+ * Tcl_OpenTcpServer, TclOpenTcpServerEx --
  *
  *	Opens a TCP server socket and creates a channel around it.
+ *	TclOpenTcpServerEx takes flags; TCL_TCPSERVER_REUSEPORT is not
+ *	supported on Windows, where SO_REUSEADDR lets any socket steal the
+ *	port instead of sharing it.
  *
  * Results:
  *	The channel or NULL if failed. If an error occurred, an error message
@@ -2163,6 +2166,21 @@ Tcl_OpenTcpServer(
 				/* Callback for accepting connections from new
 				 * clients. */
     void *acceptProcData)	/* Data for the callback. */
+{
+    return TclOpenTcpServerEx(interp, port, myHost, 0, acceptProc,
+	    acceptProcData);
+}
+
+Tcl_Channel
+TclOpenTcpServerEx(
+    Tcl_Interp *interp,		/* For error reporting - may be NULL. */
+    int port,			/* Port number to open. */
+    const char *myHost,		/* Name of local host. */
+    unsigned int flags,		/* Flags, TCL_TCPSERVER_REUSEPORT. */
+    Tcl_TcpAcceptProc *acceptProc,
+				/* Callback for accepting connections from new
+				 * clients. */
+    void *acceptProcData)	/* Data for the callback. */
 {
     SOCKET sock = INVALID_SOCKET;
     unsigned short chosenport = 0;
@@ -2187,6 +2205,11 @@ Tcl_OpenTcpServer(
 	return NULL;
     }
 
+    if (flags & TCL_TCPSERVER_REUSEPORT) {
+	errorMsg = "SO_REUSEPORT isn't supported by this platform";
+	goto error;
+    }
+
     /*
      * Construct the addresses for each end of the socket.
      */